@@ -3,9 +3,50 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 #include "rpmalloc.h"
 
+/**
+ * The kind of pages that back the memory of the allocator
+ */
+typedef enum {
+    HUGE_PAGES_OFF,
+    HUGE_PAGES_TRANSPARENT,
+    HUGE_PAGES_HUGETLB
+} wss_huge_pages_t;
+
+/**
+ * Structure holding statistics of the memory used by the server
+ */
+typedef struct {
+    // The resident set size of the process in bytes
+    size_t resident;
+    // The bytes of virtual memory mapped by the allocator, if it keeps track
+    size_t mapped;
+    // The bytes of free memory held by the global caches of the allocator
+    size_t cached;
+    // The bytes of free memory held by the caches of the calling thread
+    size_t thread_cached;
+    // The amount of times threads returned their caches
+    size_t collects;
+    // The amount of times the global caches were trimmed
+    size_t trims;
+    // The bytes returned to the system by trimming
+    size_t trimmed;
+} wss_alloc_statistics_t;
+
+/**
+ * Function that (re-)initializes the allocator, such that its memory is backed
+ * by the given kind of pages. Falls back to transparent huge pages if no huge
+ * pages are reserved, and to regular pages if neither is supported. Must be
+ * called while no memory of the allocator is in use.
+ *
+ * @param 	mode	[wss_huge_pages_t] 	"The kind of pages that is wanted"
+ * @return 	      	[wss_huge_pages_t] 	"The kind of pages that is used"
+ */
+wss_huge_pages_t WSS_alloc_initialize(wss_huge_pages_t mode);
+
 /**
  * Function that allocates memory.
  * @param 	ptr		[void *] 	"The memory that needs to be copies"
@@ -75,4 +116,41 @@ void WSS_free(void **ptr);
  */
 void WSS_free_normal(void *ptr);
 
+/**
+ * Function that returns the amount of allocations and re-allocations the
+ * calling thread has made since it started.
+ *
+ * @return 	      	[size_t] 	"The amount of allocations"
+ */
+size_t WSS_allocations();
+
+/**
+ * Function that returns the free memory held by the caches of the calling
+ * thread to the global caches of the allocator, such that it can be reused by
+ * other threads or returned to the system. Should be called by threads that
+ * have been idle for a while.
+ *
+ * @return 		    [void]
+ */
+void WSS_alloc_collect();
+
+/**
+ * Function that returns free memory of the global caches of the allocator to
+ * the system, until the resident set size of the process is below the target.
+ *
+ * @param 	target	    [size_t] 	"The target of the resident set size in bytes, 0 is no target"
+ * @param 	decommit	[bool] 	    "Whether the pages of the free memory that is kept should be released with madvise"
+ * @return 	      	    [size_t] 	"The bytes of memory returned to the system"
+ */
+size_t WSS_alloc_trim(size_t target, bool decommit);
+
+/**
+ * Function that fills out statistics of the memory used by the server and the
+ * calling thread.
+ *
+ * @param 	stats	[wss_alloc_statistics_t *] 	"The statistics to fill"
+ * @return 		    [void]
+ */
+void WSS_alloc_statistics(wss_alloc_statistics_t *stats);
+
 #endif
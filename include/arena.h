@@ -0,0 +1,95 @@
+#ifndef wss_arena_h
+#define wss_arena_h
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * The amount of bytes the arena of each thread can hand out before
+ * allocations fall back to the heap
+ */
+#define WSS_ARENA_SIZE 262144
+
+/**
+ * Function that starts a scope in which allocations of the calling thread are
+ * served by its arena. Scopes may be nested and the arena is reset once the
+ * outermost scope is left.
+ *
+ * @return 		    [void]
+ */
+void WSS_arena_enter();
+
+/**
+ * Function that ends a scope of the arena of the calling thread. Leaving the
+ * outermost scope releases every allocation of the arena at once.
+ *
+ * @return 		    [void]
+ */
+void WSS_arena_leave();
+
+/**
+ * Function that allocates zeroed memory from the arena of the calling thread.
+ * Outside of a scope, or if the arena is exhausted, the memory is allocated
+ * on the heap.
+ *
+ * @param 	size	[size_t] 	"The size of the memory that should be allocated"
+ * @return 	      	[void *] 	"Returns pointer to allocated memory if successful, otherwise NULL"
+ */
+void *WSS_arena_malloc(size_t size);
+
+/**
+ * Function that re-allocates some memory. Memory of the arena stays in the
+ * arena if possible, whereas any other memory is re-allocated on the heap.
+ * The interface is similar to the realloc(3) function.
+ *
+ * @param 	ptr		[void *] 	"The memory that needs to be rearranged"
+ * @param 	size	[size_t] 	"The size of the memory that should be allocated"
+ * @return 	      	[void *] 	"Returns pointer to allocated memory if successful, otherwise NULL"
+ */
+void *WSS_arena_realloc(void *ptr, size_t size);
+
+/**
+ * Function that frees some memory. Memory of the arena is released once the
+ * scope is left, hence only memory of the heap is freed right away.
+ *
+ * @param 	ptr		[void **] 	"The memory that needs to be freed"
+ * @return 		    [void]
+ */
+void WSS_arena_free(void **ptr);
+
+/**
+ * Function that frees some memory. The interface is of this function is
+ * similar to the free(3) function.
+ *
+ * @param 	ptr		[void *] 	"The memory that needs to be freed"
+ * @return 		    [void]
+ */
+void WSS_arena_free_normal(void *ptr);
+
+/**
+ * Function that checks whether memory belongs to the arena of the calling
+ * thread.
+ *
+ * @param 	ptr		[void *] 	"The memory to check"
+ * @return 	      	[bool] 	    "Whether the memory belongs to the arena"
+ */
+bool WSS_arena_owns(void *ptr);
+
+/**
+ * Function that moves memory of the arena to the heap, such that it outlives
+ * the scope. Memory that is not part of the arena is returned as is.
+ *
+ * @param 	ptr		[void *] 	"The memory that should be kept"
+ * @return 	      	[void *] 	"Returns pointer to memory of the heap if successful, otherwise NULL"
+ */
+void *WSS_arena_promote(void *ptr);
+
+/**
+ * Function that returns the amount of allocations the arena of the calling
+ * thread has served since it started.
+ *
+ * @return 	      	[size_t] 	"The amount of allocations"
+ */
+size_t WSS_arena_allocations();
+
+#endif
@@ -5,6 +5,23 @@
 
 #include "json.h"
 #include "error.h"
+#include "alloc.h"
+
+typedef enum {
+    POOL_DISPATCHER,
+    POOL_SHARDED,
+    POOL_LEADER
+} wss_pool_mode_t;
+
+typedef enum {
+    POOL_QUEUE,
+    POOL_STEALING
+} wss_pool_scheduler_t;
+
+typedef enum {
+    POOL_EPOLL,
+    POOL_IOURING
+} wss_pool_backend_t;
 
 typedef struct {
     char *string;
@@ -30,7 +47,23 @@ typedef struct {
     unsigned int size_frame;
     unsigned int max_frames;
     unsigned int pool_workers;
-    unsigned int pool_retries;
+    unsigned int pool_max_workers;
+    unsigned int pool_max_queue;
+    unsigned int pool_idle_timeout;
+    unsigned int pool_loops;
+    unsigned int pool_fanout;
+    wss_pool_mode_t pool_mode;
+    wss_pool_scheduler_t pool_scheduler;
+    wss_pool_backend_t pool_backend;
+    unsigned int accept_budget;
+    unsigned int accept_defer;
+    unsigned int accept_fastopen;
+    unsigned int session_prewarm;
+    unsigned int session_cache;
+    unsigned int memory_collect;
+    size_t memory_rss;
+    bool memory_decommit;
+    wss_huge_pages_t memory_huge_pages;
     unsigned int timeout_pings;
     int timeout_poll;
     int timeout_read;
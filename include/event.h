@@ -3,6 +3,11 @@
 
 #if defined(__linux__) && !defined(USE_POLL)
 #define WSS_EPOLL 1
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define WSS_IOURING 1
+#endif
+#endif
 #elif defined(__APPLE__)   || defined(__FreeBSD__) || defined(__NetBSD__) || \
       defined(__OpenBSD__) || defined(__bsdi__)    || defined(__DragonFly__)
 #define WSS_KQUEUE 1
@@ -10,6 +15,9 @@
 #define WSS_POLL 1
 #endif
 
+#include <stdbool.h>
+#include <sys/uio.h>
+
 #include "server.h"
 #include "session.h"
 #include "error.h"
@@ -17,12 +25,78 @@
 /**
  * Structure used to send from event loop to threadpool
  */
-typedef struct {
+typedef struct wss_thread_args_s {
     int fd;
     wss_server_t *server;
     wss_session_state_t state;
+    struct wss_thread_args_s *next;
 } wss_thread_args_t;
 
+/**
+ * Function that adds task-function and data instance to worker pool.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @param 	func	[void (*)(void *)] 	"A function pointer"
+ * @param 	args	[void *] 	        "Arguments to be served to the function"
+ * @return 			[wss_error_t]       "The error status"
+ */
+wss_error_t WSS_add_to_threadpool(wss_server_t *server, void (*func)(void *), void *args);
+
+/**
+ * Function that hands a session whose deadline passed to the event loop that
+ * owns it. In dispatcher mode the timeout is added to the threadpool, otherwise
+ * it is queued on the event loop, which is woken to run it.
+ *
+ * @param 	server	[wss_server_t *] 	"The event loop owning the session"
+ * @param 	fd	    [int] 	            "The file descriptor of the session"
+ * @return 			[wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_timeout(wss_server_t *server, int fd);
+
+/**
+ * Function that returns the arguments of a job dispatched by an event loop,
+ * such that the event loop can reuse them for a later event. May be called
+ * from any thread.
+ *
+ * @param 	args	[wss_thread_args_t *] 	"The arguments of the job"
+ * @return 			[void]
+ */
+void WSS_thread_args_release(wss_thread_args_t *args);
+
+/**
+ * Function that dispatches an event of an event loop as a job. Job arguments
+ * are reused from the ones returned by earlier jobs, such that memory only is
+ * allocated when more jobs than ever before are in flight. Unless the thread
+ * that received the event performs the work itself, the job is handed to the
+ * threadpool by the next call to WSS_thread_args_flush.
+ *
+ * @param 	server	[wss_server_t *] 	    "A wss_server_t instance"
+ * @param 	fd	    [int] 	                "The file descriptor of the session"
+ * @param 	state	[wss_session_state_t] 	"The state of the session"
+ * @return 			[wss_error_t]           "The error status"
+ */
+wss_error_t WSS_thread_args_dispatch(wss_server_t *server, int fd, wss_session_state_t state);
+
+/**
+ * Function that hands the jobs collected by the event loop to the threadpool
+ * in a single operation. Jobs that could not be added are returned to the
+ * cache.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @return 			[wss_error_t]       "The error status"
+ */
+wss_error_t WSS_thread_args_flush(wss_server_t *server);
+
+/**
+ * Function that frees the job arguments cached by an event loop and the
+ * timeouts it did not run. Must only be called once no jobs of the event loop
+ * are in flight.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @return 			[void]
+ */
+void WSS_thread_args_free(wss_server_t *server);
+
 /**
  * Function that creates poll instance and adding the filedescriptor of the
  * servers socket to it.
@@ -52,6 +126,38 @@ wss_error_t WSS_poll_set_write(wss_server_t *server, int fd);
  */
 wss_error_t WSS_poll_set_read(wss_server_t *server, int fd);
 
+/**
+ * Function that rearms the poll instance for the servers file descriptor, such
+ * that sessions left in the backlog once the accept budget is spent are
+ * reported by a later event.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_set_accept(wss_server_t *server);
+
+/**
+ * Function that checks whether the poll instance receives and sends the data
+ * of sessions itself, which is done by io_uring for sessions without TLS.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @return 			    [bool]              "Whether data is received and sent by the poll instance"
+ */
+bool WSS_poll_io(wss_server_t *server);
+
+/**
+ * Function that lets the poll instance send data to a session once it is
+ * writable, which reports a write event once everything was sent or a close
+ * event if sending failed. The data must be kept until either is reported.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @param 	fd	        [int]	            "The clients file descriptor"
+ * @param 	iov	        [struct iovec *]	"The segments of data to send"
+ * @param 	count	    [size_t]	        "The amount of segments"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_send(wss_server_t *server, int fd, struct iovec *iov, size_t count);
+
 /**
  * Function removes the client filedescriptor from the poll instance 
  *
@@ -16,6 +16,12 @@
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
 #endif
 
+/**
+ * The maximum size of the header of a frame sent by the server, which never
+ * masks its frames
+ */
+#define WSS_FRAME_HEADER_SIZE 10
+
 typedef enum {
 	CLOSE_NORMAL                 = 1000, /* The connection */
 	CLOSE_SHUTDOWN               = 1001, /* Server is shutting down */
@@ -46,6 +52,44 @@ typedef enum {
  */
 wss_frame_t *WSS_parse_frame(char *payload, size_t payload_length, uint64_t *offset);
 
+/**
+ * Parses a websocket frame as a view into the payload, such that nothing is
+ * allocated or copied. The application data is unmasked in place and the
+ * payload of the frame points into the given payload, or is NULL if the frame
+ * has no application data or is incomplete. In the latter case the offset is
+ * moved beyond the length of the payload. A frame whose payload length uses
+ * the most significant bit or exceeds the limit gets no payload either, and
+ * the offset is only moved past its header.
+ *
+ * @param   payload         [char *]           "The payload to be processed"
+ * @param   payload_length  [size_t]           "The length of the payload"
+ * @param   offset          [size_t *]         "A pointer to an offset"
+ * @param   frame           [wss_frame_t *]    "The frame to fill, which must not be released by WSS_free_frame"
+ * @param   limit           [uint64_t]         "The largest payload length accepted"
+ * @return 		            [bool]             "Whether a frame header could be parsed"
+ */
+bool WSS_parse_frame_view(char *payload, size_t payload_length, size_t *offset, wss_frame_t *frame, uint64_t limit);
+
+/**
+ * Copies a frame, including its application data, such that the copy does not
+ * reference the payload the frame was parsed from. Within a scope of the arena
+ * the copy is allocated from the arena.
+ *
+ * @param   frame   [wss_frame_t *]    "The frame to copy"
+ * @return 		    [wss_frame_t *]    "A websocket frame"
+ */
+wss_frame_t *WSS_copy_frame(wss_frame_t *frame);
+
+/**
+ * Writes the header of a frame, such that the header can be sent in front of
+ * a payload that is kept elsewhere.
+ *
+ * @param   frame    [wss_frame_t *]  "The frame"
+ * @param   header   [char *]         "A char array of at least WSS_FRAME_HEADER_SIZE bytes to fill"
+ * @return 		     [size_t]         "The size of the header"
+ */
+size_t WSS_frame_header(wss_frame_t *frame, char *header);
+
 /**
  * Converts a single frame into a char array.
  *
@@ -66,7 +110,8 @@ size_t WSS_stringify_frame(wss_frame_t *frame, char **message);
 size_t WSS_stringify_frames(wss_frame_t **frames, size_t size, char **message);
 
 /**
- * Creates a series of frames from a message.
+ * Creates a series of frames from a message. Within a scope of the arena the
+ * frames are allocated from the arena.
  *
  * @param   config          [wss_config_t *]   "The server configuration"
  * @param   opcode          [wss_opcode_t]     "The opcode that the frames should be"
@@ -101,7 +146,8 @@ wss_frame_t *WSS_ping_frame();
 wss_frame_t *WSS_pong_frame(wss_frame_t *ping);
 
 /**
- * Releases memory used by a frame.
+ * Releases memory used by a frame. Frames allocated from the arena are
+ * released once the scope of the arena is left.
  *
  * @param   ping     [wss_frame_t *]    "The frame that should be freed"
  * @return 		     [void]         
@@ -4,23 +4,161 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
 
 #include "subprotocol.h"
 #include "extension.h"
+#include "config.h"
 
 /**
- * Structure containing a message that should be sent to a client
+ * Structure containing the framed bytes of a message, which can be referenced
+ * by the messages of several sessions. The bytes are never modified and are
+ * freed once the last reference is released.
+ */
+typedef struct {
+    atomic_size_t references;
+    size_t length;
+    char bytes[];
+} wss_shared_t;
+
+/**
+ * Structure containing a message that should be sent to a client. A message
+ * is either the bytes of msg, or if iov is set, the bytes of its segments, in
+ * which case msg holds the headers of the frames and the segments reference
+ * both the headers and the payload of the frames. If shared is set, msg
+ * points to the bytes of the shared buffer the message holds a reference to.
  */
 typedef struct {
     size_t length;
     char *msg;
     bool framed;
+    struct iovec *iov;
+    size_t iov_count;
+    char *payload;
+    bool owned;
+    bool shareable;
+    wss_shared_t *shared;
 } wss_message_t;
 
 void WSS_message_send_frames(void *server, void *session, wss_frame_t **frames, size_t frames_count);
 
 void WSS_message_send(int fd, wss_opcode_t opcode, char *message, uint64_t message_length);
 
+/**
+ * Sends a message to several sessions. The sessions are looked up in a single
+ * pass and the sessions that have to queue the message share a single framed
+ * copy of it. Sessions that have closed are skipped.
+ *
+ * @param 	fds	            [int *] 	        "The sessions to send the message to"
+ * @param 	fds_count	    [size_t] 	        "The amount of sessions"
+ * @param 	opcode	        [wss_opcode_t] 	    "The opcode of the frames of the message"
+ * @param 	message	        [char *] 	        "The message"
+ * @param 	message_length	[uint64_t] 	        "The length of the message"
+ * @return 	                [void]
+ */
+void WSS_message_send_many(int *fds, size_t fds_count, wss_opcode_t opcode, char *message, uint64_t message_length);
+
+/**
+ * Sends a message to a session and takes ownership of the message, such that
+ * the message is never copied when it has to be queued. The message must be
+ * allocated with WSS_malloc and is freed once it has been written.
+ *
+ * @param 	fd	            [int] 	            "The session to send the message to"
+ * @param 	opcode	        [wss_opcode_t] 	    "The opcode of the frames of the message"
+ * @param 	message	        [char *] 	        "The message"
+ * @param 	message_length	[uint64_t] 	        "The length of the message"
+ * @return 	                [void]
+ */
+void WSS_message_send_owned(int fd, wss_opcode_t opcode, char *message, uint64_t message_length);
+
+/**
+ * Creates a message whose frames consist of inline headers and references to
+ * the payload, such that the payload is not copied. Within a scope of the
+ * arena the message is allocated from the arena.
+ *
+ * @param 	config	        [wss_config_t *] 	"The server configuration"
+ * @param 	opcode	        [wss_opcode_t] 	    "The opcode of the frames of the message"
+ * @param 	payload	        [char *] 	        "The payload to reference"
+ * @param 	payload_length	[size_t] 	        "The length of the payload"
+ * @param 	owned	        [bool] 	            "Whether the payload is freed with the message"
+ * @return 	                [wss_message_t *] 	"The message or NULL"
+ */
+wss_message_t *WSS_message_create(wss_config_t *config, wss_opcode_t opcode, char *payload, size_t payload_length, bool owned);
+
+/**
+ * Fills out segments that describe the bytes of a message from an offset,
+ * such that the message can be written with writev.
+ *
+ * @param 	message	[wss_message_t *] 	"The message"
+ * @param 	offset	[size_t] 	        "The amount of bytes of the message that should be skipped"
+ * @param 	iov	    [struct iovec *] 	"The segments to fill"
+ * @param 	count	[size_t] 	        "The amount of segments that can be filled"
+ * @return 	        [size_t] 	        "The amount of segments filled"
+ */
+size_t WSS_message_iov(wss_message_t *message, size_t offset, struct iovec *iov, size_t count);
+
 void WSS_message_free(wss_message_t *msg);
 
+/**
+ * Moves a message allocated from the arena of the thread to the heap, such
+ * that it can be queued beyond the scope of the arena. A message that
+ * references a payload it does not own is copied into a single buffer.
+ *
+ * @param 	msg	[wss_message_t *] 	"The message to keep"
+ * @return 	    [wss_message_t *] 	"The message on the heap or NULL, in which case the message is freed"
+ */
+wss_message_t *WSS_message_promote(wss_message_t *msg);
+
+/**
+ * Creates a shared buffer holding the framed bytes of a message. The caller
+ * holds the only reference to the buffer.
+ *
+ * @param 	config	        [wss_config_t *] 	"The server configuration"
+ * @param 	opcode	        [wss_opcode_t] 	    "The opcode of the frames of the message"
+ * @param 	payload	        [char *] 	        "The payload of the message"
+ * @param 	payload_length	[size_t] 	        "The length of the payload"
+ * @return 	                [wss_shared_t *] 	"The shared buffer or NULL"
+ */
+wss_shared_t *WSS_shared_create(wss_config_t *config, wss_opcode_t opcode, char *payload, size_t payload_length);
+
+/**
+ * Releases a reference to a shared buffer, which is freed once no references
+ * are left.
+ *
+ * @param 	shared	[wss_shared_t *] 	"The shared buffer"
+ * @return 	        [void]
+ */
+void WSS_shared_release(wss_shared_t *shared);
+
+/**
+ * Creates a message that holds a reference to a shared buffer, such that the
+ * framed bytes are written as is. Within a scope of the arena the message is
+ * allocated from the arena.
+ *
+ * @param 	shared	[wss_shared_t *] 	"The shared buffer"
+ * @return 	        [wss_message_t *] 	"The message or NULL"
+ */
+wss_message_t *WSS_message_share(wss_shared_t *shared);
+
+/**
+ * Marks the start of the delivery of a message to a subprotocol by the calling
+ * thread. Until the delivery ends, messages sent with the delivered payload
+ * that have to be copied share a single copy of the framed message.
+ *
+ * @param 	opcode	        [wss_opcode_t] 	    "The opcode of the delivered message"
+ * @param 	payload	        [char *] 	        "The delivered payload"
+ * @param 	payload_length	[size_t] 	        "The length of the delivered payload"
+ * @return 	                [void]
+ */
+void WSS_message_delivery_begin(wss_opcode_t opcode, char *payload, size_t payload_length);
+
+/**
+ * Marks the end of the delivery of a message to a subprotocol by the calling
+ * thread and releases the shared copy of the message, if any.
+ *
+ * @return 	                [void]
+ */
+void WSS_message_delivery_end();
+
 #endif
@@ -48,19 +48,77 @@ typedef enum {
     threadpool_graceful       = 1
 } threadpool_destroy_flags_t;
 
+typedef enum {
+    threadpool_work_stealing  = 1
+} threadpool_create_flags_t;
+
+/**
+ *  @struct threadpool_stats
+ *  @brief Counters describing the work done by a thread pool
+ *
+ *  @var tasks  Number of tasks added to the pool.
+ *  @var steals Number of tasks taken from the queue of another worker.
+ *  @var parks  Number of times a worker went to sleep waiting for tasks.
+ *  @var threads Number of threads currently running.
+ *  @var spawned Number of threads started beyond the initial ones.
+ *  @var retired Number of threads that retired after being idle.
+ *  @var resizes Number of times the task queue grew.
+ */
+typedef struct {
+    unsigned long tasks;
+    unsigned long steals;
+    unsigned long parks;
+    unsigned long threads;
+    unsigned long spawned;
+    unsigned long retired;
+    unsigned long resizes;
+} threadpool_stats_t;
+
 /**
  * @function threadpool_create
  * @brief Creates a threadpool_t object.
  * @param thread_count Number of worker threads.
  * @param queue_size   Size of the queue.
  * @param thread_size  Size of a thread.
- * @param flags        Unused parameter.
+ * @param flags        Use threadpool_work_stealing to give every worker its
+ *                     own deque and let idle workers steal from each other,
+ *                     otherwise a single shared queue is used.
  * @return a newly created thread pool or NULL
  */
 threadpool_t *threadpool_create(int thread_count, int queue_size, int thread_size, int flags);
 
 char *threadpool_strerror(int err);
 
+/**
+ * @function threadpool_set_limits
+ * @brief Lets a thread pool grow under load and shrink when idle.
+ * @param pool         Thread pool to make elastic.
+ * @param max_threads  Number of threads the pool may grow to.
+ * @param max_queue    Size the task queue may grow to.
+ * @param idle_timeout Milliseconds a thread started beyond the initial ones
+ *                     may be idle before it retires, 0 never retires them.
+ * @return 0 if all goes well, negative values in case of error (@see
+ * threadpool_error_t for codes).
+ *
+ * Limits lower than the sizes the pool was created with are ignored. Pools
+ * created with threadpool_work_stealing cannot be made elastic.
+ */
+int threadpool_set_limits(threadpool_t *pool, int max_threads, int max_queue, int idle_timeout);
+
+/**
+ * @function threadpool_set_idle
+ * @brief Lets idle threads of a thread pool perform a routine.
+ * @param pool     Thread pool whose threads should perform the routine.
+ * @param routine  Pointer to the function that threads call once they have
+ *                 been waiting for tasks for the timeout. The function is
+ *                 called once per idle period.
+ * @param timeout  Milliseconds a thread must have been idle, 0 disables the
+ *                 routine.
+ * @return 0 if all goes well, negative values in case of error (@see
+ * threadpool_error_t for codes).
+ */
+int threadpool_set_idle(threadpool_t *pool, void (*routine)(void), int timeout);
+
 /**
  * @function threadpool_add
  * @brief add a new task in the queue of a thread pool
@@ -73,6 +131,23 @@ char *threadpool_strerror(int err);
  */
 int threadpool_add(threadpool_t *pool, void (*routine)(void *), void *arg, int flags);
 
+/**
+ * @function threadpool_add_batch
+ * @brief add several tasks performed by the same function in one operation
+ * @param pool      Thread pool to which add the tasks.
+ * @param function  Pointer to the function that will perform the tasks.
+ * @param arguments Arguments to be passed to the function, one per task.
+ * @param count     The amount of tasks.
+ * @param flags     Unused parameter.
+ * @return the amount of tasks added, which is less than count if the queue
+ * got full, or negative values in case of error (@see threadpool_error_t for
+ * codes).
+ *
+ * The queue is locked and idle workers are woken up once per batch rather
+ * than once per task.
+ */
+int threadpool_add_batch(threadpool_t *pool, void (*routine)(void *), void **arguments, int count, int flags);
+
 /**
  * @function threadpool_destroy
  * @brief Stops and destroys a thread pool.
@@ -85,4 +160,13 @@ int threadpool_add(threadpool_t *pool, void (*routine)(void *), void *arg, int f
  */
 int threadpool_destroy(threadpool_t *pool, int flags);
 
+/**
+ * @function threadpool_stats
+ * @brief Reads the counters of a thread pool.
+ * @param pool  Thread pool to read counters from.
+ * @param stats Structure to fill with the counters.
+ * @return 0 if all goes well, threadpool_invalid otherwise.
+ */
+int threadpool_stats(threadpool_t *pool, threadpool_stats_t *stats);
+
 #endif /* _THREADPOOL_H_ */
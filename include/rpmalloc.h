@@ -174,8 +174,12 @@ typedef struct rpmalloc_config_t {
 	//  allocator.
 	//  For Windows, see https://docs.microsoft.com/en-us/windows/desktop/memory/large-page-support
 	//  For Linux, see https://www.kernel.org/doc/Documentation/vm/hugetlbpage.txt
+	//  On Linux, memory is mapped with regular pages if no huge pages are reserved.
 	int enable_huge_pages;
-	int unused;
+	//! Enable use of transparent huge pages. If this flag is set to non-zero, mapped
+	//  memory is advised to be backed by transparent huge pages where supported.
+	//  For Linux, see https://www.kernel.org/doc/Documentation/vm/transhuge.txt
+	int enable_transparent_huge_pages;
 } rpmalloc_config_t;
 
 //! Initialize allocator with default configuration
@@ -202,10 +206,17 @@ rpmalloc_thread_initialize(void);
 RPMALLOC_EXPORT void
 rpmalloc_thread_finalize(void);
 
-//! Perform deferred deallocations pending for the calling thread heap
+//! Perform deferred deallocations pending for the calling thread heap and
+//  release the span caches of the thread to the global cache
 RPMALLOC_EXPORT void
 rpmalloc_thread_collect(void);
 
+//! Unmap spans of the global cache until at most limit bytes remain cached,
+//  and optionally decommit the pages of each remaining span except its first
+//  page, which holds the span header, returns the amount of bytes unmapped
+RPMALLOC_EXPORT size_t
+rpmalloc_global_collect(size_t limit, int decommit);
+
 //! Query if allocator is initialized for calling thread
 RPMALLOC_EXPORT int
 rpmalloc_is_thread_initialized(void);
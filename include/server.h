@@ -5,6 +5,7 @@
 #include <sys/socket.h>         /* socket, setsockopt, inet_ntoa, accept, shutdown */
 #include <netinet/in.h>         /* sockaddr_in, inet_ntoa */
 #include <regex.h>              /* regex_t, regcomp, regexec */
+#include <stdatomic.h>          /* atomic_bool, atomic_uchar, _Atomic */
 #include <pthread.h> 			/* pthread_create, pthread_t, pthread_attr_t
                                    pthread_mutex_init */
 #include "pool.h"
@@ -35,7 +36,9 @@ typedef enum {
     HALT_ERROR
 } wss_state_t;
 
-typedef struct {
+struct wss_thread_args_s;
+
+typedef struct wss_server_s {
     int port;
     int fd;
     int poll_fd;
@@ -48,8 +51,23 @@ typedef struct {
     pthread_t thread_id;
     pthread_t cleanup_thread_id;
     pthread_mutex_t lock;
-    int rearm_pipefd[2];
+    int rearm_fd[2];
+    atomic_bool rearm_pending;
+    atomic_uchar *interests;
+    unsigned int interests_length;
+    _Atomic(struct wss_thread_args_s *) jobs_returned;
+    struct wss_thread_args_s *jobs_cache;
+    void **jobs;
+    size_t jobs_length;
+    size_t jobs_size;
+    size_t jobs_dispatched;
+    size_t jobs_allocated;
+    _Atomic(struct wss_thread_args_s *) timeouts;
     regex_t *re;
+    struct wss_server_s **loops;
+    unsigned int loops_length;
+    pthread_t *followers;
+    unsigned int followers_length;
 } wss_server_t;
 
 typedef struct {
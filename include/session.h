@@ -1,27 +1,18 @@
 #ifndef wss_session_h
 #define wss_session_h
 
-#if !defined(uthash_malloc) || !defined(uthash_free)
-#include "alloc.h"
-
-#ifndef uthash_malloc
-#define uthash_malloc(sz) WSS_malloc(sz)   /* malloc fcn */
-#endif
-
-#ifndef uthash_free
-#define uthash_free(ptr,sz) WSS_free((void **)&ptr) /* free fcn */
-#endif
-#endif
-
 #include <time.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <netinet/in.h>         /* in6_addr, INET6_ADDRSTRLEN */
 #include <pthread.h> 			/* pthread_create, pthread_t, pthread_attr_t
                                    pthread_mutex_init */
-#include "uthash.h"
+#include "server.h"
 #include "header.h"
 #include "ringbuf.h"
 #include "frame.h"
 #include "message.h"
+#include "timer.h"
 #include "error.h"
 
 typedef enum {
@@ -38,106 +29,298 @@ typedef enum {
     CONNECTING
 } wss_session_state_t;
 
+/**
+ * Structure holding the messages queued for a session. The queue is only
+ * allocated once a message cannot be written to the session right away.
+ */
 typedef struct {
+    // A ringbuffer containing references to the messages that the session shall receive
+    ringbuf_t *ringbuf;
+    // The size the messages/ringbuffer
+    unsigned int count;
+    // The actual messages, followed by the ringbuffer
+    wss_message_t *messages[];
+} wss_session_queue_t;
+
+/**
+ * Structure holding data that the event loop received on behalf of a session
+ */
+typedef struct wss_session_input_s {
+    // The data received before, or after once taken by the session
+    struct wss_session_input_s *next;
+    // The amount of bytes received
+    size_t length;
+    // The amount of bytes already read by the session
+    size_t offset;
+    // The bytes received
+    char data[];
+} wss_session_input_t;
+
+typedef struct wss_session_s {
+    // Lock that ensures only one thread can perform IO at a time
+    pthread_mutex_t lock;
+
+    // The lock above is kept when a session is recycled by the slab, while
+    // the members from here on are cleared. The members used by every event
+    // come first, such that they share as few cache lines as possible
+
     // The file descriptor of the session
     int fd;
-    // The port of the session
-    int port;
-    // The IP of the session
-    char *ip;
+    // Which state the session is currently in
+    wss_session_state_t state;
+    // Which event the session should continue listening for
+    wss_session_event_t event;
+    // Jobs to be performed
+    atomic_int jobs;
     // Whether session has been WSS handshaked
     bool handshaked;
-    // The ssl object used to communicate with session
-    void *ssl;
     // Whether session has been SSL handshaked
     bool ssl_connected;
     // Whether the session is closing
     bool closing;
     // Whether the session has begun disconnecting
-    bool disconnecting;
-    // Lock that ensures disconnecting check is done atomically
-    pthread_mutex_t lock_disconnecting;
-    // Lock that ensures only one thread can perform IO at a time
-    pthread_mutex_t lock;
-    // Attributes for the lock
-    pthread_mutexattr_t lock_attr;
-    // Jobs to be performed
-    int jobs;
-    // Lock that ensures jobs are incremented/decremented atomically
-    pthread_mutex_t lock_jobs;
-    // Conditional variable that ensures that close call is only performed when no other IO is waiting
-    pthread_cond_t cond_jobs;
-    // Which state the session is currently in
-    wss_session_state_t state;
-    // Which event the session should continue listening for
-    wss_session_event_t event;
-    // The HTTP header of the session
-    wss_header_t *header;
-    // A ringbuffer containing references to the messages that the session shall receive
-    ringbuf_t *ringbuf;
-    // The actual messages
-    wss_message_t **messages;
-    // The size the messages/ringbuffer
-    int messages_count;
+    atomic_bool disconnecting;
+    // Whether other threads queued messages while the session was busy
+    atomic_bool write_pending;
+    // If not all data was written, store many bytes currently written
+    unsigned int written;
+    // Whether the event loop receives and sends the data of the session
+    bool ring;
+    // The amount of bytes the event loop is sending on behalf of the session
+    unsigned int sending;
+    // Set by the event loop once the bytes were sent, or negative on failure
+    atomic_int sent;
+    // The data received by the event loop, most recent first
+    _Atomic(wss_session_input_t *) received;
+    // The data received by the event loop that the session is reading from
+    wss_session_input_t *input;
+    // The server instance (event loop) that owns the session
+    wss_server_t *server;
+    // The ssl object used to communicate with session
+    void *ssl;
+    // The messages queued for the session, NULL until first needed
+    _Atomic(wss_session_queue_t *) queue;
+    // The subprotocol of the session, set once handshaked
+    wss_subprotocol_t *protocol;
+    // The extensions negotiated with the session, set once handshaked
+    wss_extension_t **extensions;
+    // The amount of negotiated extensions
+    unsigned int extensions_count;
+    // The version of the websocket protocol used by the session
+    wss_type_t type;
     // Store the lastest activity of the session
     struct timespec alive;
-    // Store pong application data if a ping was sent to the session
-    char *pong;
+    // Timer that expires at the next deadline of the session
+    wss_timer_t timer;
+
+    // The members from here on are only used while handshaking, pinging or
+    // when reads or writes are incomplete
+
+    // The port of the session
+    int port;
     // Length of the pong application data
     unsigned int pong_length;
-    // If not all data was read, store the payload temporarily
+    // The address of the session
+    struct in6_addr addr;
+    // The IP of the session, formatted from the address when first needed
+    char ip[INET6_ADDRSTRLEN];
+    // The HTTP header of the session, until the handshake is done
+    wss_header_t *header;
+    // Store when the session was last pinged
+    struct timespec pinged;
+    // Store pong application data if a ping was sent to the session
+    char *pong;
+    // If not all data was read, the receive buffer holding the payload
     char *payload;
-    // The size of the temporarily payload
+    // The capacity of the receive buffer, which has room for one more byte
+    size_t payload_size;
+    // The amount of bytes received into the receive buffer
     size_t payload_length;
-    // The offset into the payload where the next frame should be read from
+    // The offset into the payload where the next frame should be read from,
+    // the bytes before it have been parsed
     size_t offset;
-    // If not all frames was read, store the frames temporarily
-    wss_frame_t **frames;
-    // The size of the temporarily frames
-    size_t frames_length;
-    // If not all data was written, store many bytes currently written
-    unsigned int written;
-    // Used for session hash table
-    UT_hash_handle hh;
+    // The fragmented message being reassembled, as its first frame which
+    // payload holds the application data of every frame received so far
+    wss_frame_t *message;
+    // The capacity of the payload of the fragmented message
+    size_t message_size;
+    // The amount of frames of the fragmented message
+    size_t message_frames;
+    // The epoch in which the session was deleted
+    uint_fast64_t retired_epoch;
+    // The next session in the list of deleted or free sessions
+    struct wss_session_s *retired_next;
 } wss_session_t;
 
 /**
- * Function that initialize a mutex lock.
+ * Function that initialize the locks of the session table.
  *
  * @return 		[wss_error_t] 	"The error status"
  */
 wss_error_t WSS_session_init_lock();
 
 /**
- * Function that destroy a mutex lock.
+ * Function that destroy the locks of the session table and frees the epoch
+ * records.
  *
  * @return 		[wss_error_t] 	"The error status"
  */
 wss_error_t WSS_session_destroy_lock();
 
+/**
+ * Function that marks the calling thread as accessing sessions. Sessions
+ * found before the matching call to WSS_session_leave are not freed before
+ * that call, even if deleted by another thread. Calls may be nested.
+ *
+ * @return 		[void]
+ */
+void WSS_session_enter();
+
+/**
+ * Function that returns the receive buffer of the calling thread, which is
+ * reused by every event the thread handles, such that reads need not allocate
+ * memory. The buffer is not cleared between uses.
+ *
+ * @param 	size	[size_t] 	"The minimum size of the buffer"
+ * @return 		    [char *] 	"The buffer or NULL on error"
+ */
+char *WSS_session_buffer(size_t size);
+
+/**
+ * Function that marks the calling thread as no longer accessing sessions and
+ * frees the deleted sessions that no thread can reference any longer.
+ *
+ * @return 		[void]
+ */
+void WSS_session_leave();
+
+/**
+ * Function that advances the epoch if every thread accessing sessions has
+ * observed it, and frees the deleted sessions that no thread can reference any
+ * longer.
+ *
+ * @return 		[void]
+ */
+void WSS_session_reclaim();
+
+/**
+ * Function that creates the slab of sessions, which recycles sessions with
+ * their lock initialized.
+ *
+ * @param 	messages	[unsigned int] 	"The size of the ringbuffer of each session"
+ * @param 	workers	    [unsigned int] 	"The amount of threads that may produce messages"
+ * @param 	prewarm	    [unsigned int] 	"The amount of sessions to allocate up front"
+ * @param 	cache	    [unsigned int] 	"The maximum amount of free sessions kept, 0 is unbounded"
+ * @return 		        [wss_error_t] 	"The error status"
+ */
+wss_error_t WSS_session_slab_init(unsigned int messages, unsigned int workers, unsigned int prewarm, unsigned int cache);
+
+/**
+ * Function that frees the sessions kept by the slab.
+ *
+ * @return 		[void]
+ */
+void WSS_session_slab_destroy();
+
+/**
+ * Function that creates the timer wheel holding the deadlines of the sessions.
+ *
+ * @param 	slots	    [unsigned int] 	"The amount of slots of the wheel"
+ * @param 	resolution	[unsigned int] 	"The amount of milliseconds covered by each slot"
+ * @return 		        [wss_error_t] 	"The error status"
+ */
+wss_error_t WSS_session_timers_init(unsigned int slots, unsigned int resolution);
+
+/**
+ * Function that frees the timer wheel holding the deadlines of the sessions.
+ *
+ * @return 		[void]
+ */
+void WSS_session_timers_destroy();
+
+/**
+ * Function that schedules the timer of a session to expire at the deadline,
+ * unless the timer is already scheduled to expire before that.
+ *
+ * @param 	session	    [wss_session_t *] 	"The session"
+ * @param 	deadline	[uint64_t] 	        "The deadline in milliseconds on the monotonic clock"
+ * @return 		        [void]
+ */
+void WSS_session_timeout(wss_session_t *session, uint64_t deadline);
+
+/**
+ * Function that removes the sessions whose deadline has passed from the timer
+ * wheel.
+ *
+ * @param 	now	    [uint64_t] 	"The current time in milliseconds on the monotonic clock"
+ * @param 	fds	    [int **] 	"Set to the file descriptors of the expired sessions"
+ * @return 		    [size_t] 	"The amount of expired sessions"
+ */
+size_t WSS_session_timeouts(uint64_t now, int **fds);
+
 /**
  * Function that allocates and creates a new session.
  *
- * @param 	fd 		[int] 		        "The filedescriptor associated to the session"
- * @param 	ip 		[char *] 	        "The ip-address of the session"
- * @param 	port 	[int] 	            "The port"
- * @return 		    [wss_session_t *] 	"Returns session if successful, otherwise NULL"
+ * @param 	fd 		[int] 		                "The filedescriptor associated to the session"
+ * @param 	addr 	[const struct in6_addr *] 	"The address of the session"
+ * @param 	port 	[int] 	                    "The port"
+ * @return 		    [wss_session_t *] 	        "Returns session if successful, otherwise NULL"
  */
-wss_session_t *WSS_session_add(int fd, char* ip, int port);
+wss_session_t *WSS_session_add(int fd, const struct in6_addr *addr, int port);
 
 /**
- * Function that frees the allocated memory and removes the session from the 
- * hashtable but without locking the hashtable. This should only be used in
- * conjunction with the WSS_session_all call.
+ * Function that returns the queue of messages of the session, allocating it
+ * if the session has none yet.
  *
- * @param 	session	[wss_session_t *] 	"The session to be deleted"
+ * @param 	session	[wss_session_t *] 	        "The session"
+ * @return 		    [wss_session_queue_t *] 	"The queue or NULL on error"
+ */
+wss_session_queue_t *WSS_session_queue(wss_session_t *session);
+
+/**
+ * Function that stores data received by the event loop on behalf of the
+ * session, such that it is read by the next read of the session.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @param 	data	[const char *] 	    "The data received"
+ * @param 	length	[size_t] 	        "The amount of bytes received"
  * @return 		    [wss_error_t] 	    "The error status"
  */
-wss_error_t WSS_session_delete_no_lock(wss_session_t *session);
+wss_error_t WSS_session_receive(wss_session_t *session, const char *data, size_t length);
+
+/**
+ * Function that reads the data received by the event loop on behalf of the
+ * session. The lock of the session must be held.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @param 	buffer	[char *] 	        "The buffer to put the data into"
+ * @param 	length	[size_t] 	        "The amount of bytes that fit in the buffer"
+ * @return 		    [size_t] 	        "The amount of bytes read"
+ */
+size_t WSS_session_read(wss_session_t *session, char *buffer, size_t length);
+
+/**
+ * Function that checks whether the event loop received data on behalf of the
+ * session, which has not been read yet.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @return 		    [bool] 	            "Whether data is waiting to be read"
+ */
+bool WSS_session_readable(wss_session_t *session);
+
+/**
+ * Function that returns the ip-address of the session as a string. The
+ * address is only formatted the first time, and the lock of the session must
+ * be held.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @return 		    [char *] 	        "The ip-address of the session"
+ */
+char *WSS_session_ip(wss_session_t *session);
 
 /**
- * Function that frees the allocated memory and removes the session from the 
- * hashtable.
+ * Function that removes the session from the session table. The session is
+ * freed once no other thread can reference it any longer.
  *
  * @param 	session	[wss_session_t *] 	"The session to be deleted"
  * @return 		    [wss_error_t] 	    "The error status"
@@ -145,7 +328,8 @@ wss_error_t WSS_session_delete_no_lock(wss_session_t *session);
 wss_error_t WSS_session_delete(wss_session_t *session);
 
 /**
- * Function that frees the allocated memory and deletes all sessions.
+ * Function that frees the allocated memory and deletes all sessions. No other
+ * thread may access sessions while this is called.
  *
  * @return  [wss_error_t] 	"The error status"
  */
@@ -160,7 +344,9 @@ wss_error_t WSS_session_delete_all();
 wss_error_t WSS_session_all(void (*callback)(wss_session_t *));
 
 /**
- * Function that finds a session using the filedescriptor of the session.
+ * Function that finds a session using the filedescriptor of the session. The
+ * lookup never waits, and the calling thread must be between calls to
+ * WSS_session_enter and WSS_session_leave while using the session.
  *
  * @param 	fd 	[int] 		        "The filedescriptor associated to some session"
  * @return 		[wss_session_t *] 	"Returns session if successful, otherwise NULL"
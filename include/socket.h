@@ -20,6 +20,15 @@ wss_error_t WSS_socket_create(wss_server_t *server);
  */
 wss_error_t WSS_socket_reuse(int fd);
 
+/**
+ * Function that allows several sockets to be bound to the same port, such that
+ * the kernel can load balance incoming connections between them.
+ *
+ * @param 	fd		[int]		        "The filedescriptor of the listening socket"
+ * @return 			[wss_error_t]       "The error status"
+ */
+wss_error_t WSS_socket_reuse_port(int fd);
+
 /**
  * Function that binds the socket to a specific port and chooses IPV4.
  *
@@ -59,20 +59,20 @@ void WSS_ssl_handshake(wss_server_t *server, wss_session_t *session);
  * @param   server      [wss_server_t *]    "The server implementation"
  * @param   session     [wss_session_t *]   "The connecting client session"
  * @param   buffer      [char *]            "The buffer to use"
+ * @param   length      [size_t]            "The amount of bytes that fit in the buffer"
  * @return              [int]
  */
-int WSS_ssl_read(wss_server_t *server, wss_session_t *session, char *buffer);
+int WSS_ssl_read(wss_server_t *server, wss_session_t *session, char *buffer, size_t length);
 
 /**
  * Function that performs a ssl write to the connecting client.
  *
  * @param   session       [wss_session_t *]   "The connecting client session"
- * @param   message_index [unsigned int]      "The message index"
  * @param   message       [wss_message_t *]   "The message"
  * @param   bytes_sent    [unsigned int *]    "Pointer to the amount of bytes currently sent"
  * @return                [bool]
  */
-bool WSS_ssl_write_partial(wss_session_t *session, unsigned int message_index, wss_message_t *message, unsigned int* bytes_sent);
+bool WSS_ssl_write_partial(wss_session_t *session, wss_message_t *message, unsigned int* bytes_sent);
 
 /**
  * Function that performs a ssl write to the connecting client.
@@ -97,10 +97,9 @@ bool WSS_session_ssl(wss_server_t *server, wss_session_t *session);
  * Function frees SSL session instance that was used to serve over https.
  *
  * @param   session	[wss_session_t *] 	    "The session instance"
- * @param   lock	[pthread_rwlock_t *] 	"The read/write session lock"
  * @return 			[wss_error_t]           "An error or success"
  */
-wss_error_t WSS_session_ssl_free(wss_session_t *session, pthread_rwlock_t *lock);
+wss_error_t WSS_session_ssl_free(wss_session_t *session);
 
 /**
  * Function creates a sha1 hash of the key.
@@ -25,6 +25,7 @@ typedef struct {
     char *name;
     subAlloc alloc; 
     subInit init; 
+    subInit2 init2; 
     subConnect connect; 
     subMessage message;
     subWrite write; 
@@ -0,0 +1,102 @@
+#ifndef wss_timer_h
+#define wss_timer_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/**
+ * Structure holding a timer, which is embedded in the structure it times
+ */
+typedef struct wss_timer_s {
+    // The previous timer in the slot of the wheel
+    struct wss_timer_s *prev;
+    // The next timer in the slot of the wheel
+    struct wss_timer_s *next;
+    // The deadline in milliseconds on the monotonic clock, 0 if not scheduled
+    atomic_uint_fast64_t deadline;
+    // The file descriptor reported when the timer expires
+    int fd;
+} wss_timer_t;
+
+/**
+ * Structure holding a hashed timer wheel
+ */
+typedef struct {
+    // Lock that ensures the wheel is updated atomically
+    pthread_mutex_t lock;
+    // The sentinels of the slots of the wheel
+    wss_timer_t *slots;
+    // The amount of slots, always a power of two
+    unsigned int length;
+    // The amount of milliseconds covered by each slot
+    unsigned int resolution;
+    // The next tick that should be expired
+    uint64_t tick;
+    // The amount of timers scheduled
+    size_t count;
+    // File descriptors of the timers that expired during the last call
+    int *expired;
+    // The size of the expired array
+    size_t expired_size;
+} wss_timer_wheel_t;
+
+/**
+ * Function that returns the current time of the monotonic clock.
+ *
+ * @return 	[uint64_t] 	"The time in milliseconds"
+ */
+uint64_t WSS_timer_clock();
+
+/**
+ * Function that creates a hashed timer wheel.
+ *
+ * @param 	slots	    [unsigned int] 	        "The amount of slots, rounded up to a power of two"
+ * @param 	resolution	[unsigned int] 	        "The amount of milliseconds covered by each slot"
+ * @param 	now	        [uint64_t] 	            "The current time in milliseconds"
+ * @return 	            [wss_timer_wheel_t *] 	"The timer wheel or NULL on error"
+ */
+wss_timer_wheel_t *WSS_timer_wheel_create(unsigned int slots, unsigned int resolution, uint64_t now);
+
+/**
+ * Function that frees a timer wheel. Timers still scheduled are left untouched.
+ *
+ * @param 	wheel	[wss_timer_wheel_t *] 	"The timer wheel"
+ * @return 	        [void]
+ */
+void WSS_timer_wheel_destroy(wss_timer_wheel_t *wheel);
+
+/**
+ * Function that schedules a timer to expire at the given deadline, unless it
+ * is already scheduled to expire before that. Runs in constant time.
+ *
+ * @param 	wheel	    [wss_timer_wheel_t *] 	"The timer wheel"
+ * @param 	timer	    [wss_timer_t *] 	    "The timer"
+ * @param 	deadline	[uint64_t] 	            "The deadline in milliseconds"
+ * @return 	            [bool]                  "Whether the timer was (re)scheduled"
+ */
+bool WSS_timer_schedule(wss_timer_wheel_t *wheel, wss_timer_t *timer, uint64_t deadline);
+
+/**
+ * Function that removes a timer from the wheel, if it is scheduled.
+ *
+ * @param 	wheel	[wss_timer_wheel_t *] 	"The timer wheel"
+ * @param 	timer	[wss_timer_t *] 	    "The timer"
+ * @return 	        [void]
+ */
+void WSS_timer_cancel(wss_timer_wheel_t *wheel, wss_timer_t *timer);
+
+/**
+ * Function that removes the timers whose deadline has passed from the wheel.
+ * Only the slots elapsed since the last call are visited.
+ *
+ * @param 	wheel	[wss_timer_wheel_t *] 	"The timer wheel"
+ * @param 	now	    [uint64_t] 	            "The current time in milliseconds"
+ * @param 	fds	    [int **] 	            "Set to the file descriptors of the expired timers, valid until the next call"
+ * @return 	        [size_t]                "The amount of expired timers"
+ */
+size_t WSS_timer_expire(wss_timer_wheel_t *wheel, uint64_t now, int **fds);
+
+#endif
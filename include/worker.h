@@ -110,6 +110,48 @@ void WSS_disconnect(wss_server_t *server, wss_session_t *session);
  */
 void WSS_write(wss_server_t *server, wss_session_t *session);
 
+/**
+ * Function that writes a message to a session, or puts it in the queue of the
+ * session if other messages are queued or the write would block. The queue is
+ * only allocated once a message has to be queued.
+ *
+ * @param 	session	[wss_session_t *] 	"The client session"
+ * @param 	message	[wss_message_t *] 	"The message to send"
+ * @param 	direct	[bool] 	            "Whether the message may be written right away, which requires the lock of the session to be held"
+ * @return          [wss_error_t]       "The error status"
+ */
+wss_error_t WSS_write_message(wss_session_t *session, wss_message_t *message, bool direct);
+
+/**
+ * Function that releases the IO lock of a session. Messages queued by other
+ * threads while the lock was held are written first, if the session is idle.
+ *
+ * @param 	server	[wss_server_t *] 	"The server structure"
+ * @param 	session	[wss_session_t *] 	"The session structure"
+ * @return          [void]
+ */
+void WSS_release(wss_server_t *server, wss_session_t *session);
+
+/**
+ * Function that handles a session whose timer expired. Sessions that timed
+ * out are closed and idle sessions are pinged, before the timer is scheduled
+ * for the next deadline.
+ *
+ * @param 	args	[void *] 	"Is a args_t structure holding server_t and filedescriptor"
+ * @return          [void]
+ */
+void WSS_timeout(void *args);
+
+/**
+ * Function that performs the IO work of a single event.
+ *
+ * @param 	server	        [wss_server_t *] 	    "The server structure"
+ * @param 	fd	            [int] 	                "The file descriptor of the session"
+ * @param 	session_state	[wss_session_state_t] 	"The state of the session"
+ * @return                  [void]
+ */
+void WSS_work_event(wss_server_t *server, int fd, wss_session_state_t session_state);
+
 /**
  * Function that performs and distributes the IO work.
  *
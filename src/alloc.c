@@ -1,9 +1,127 @@
 #include <stdlib.h>             /* atoi, malloc, free, realloc */
 #include <string.h>             /* strerror, memset, strncpy, memcpy, strlen */
+#include <stdio.h>              /* fopen, fscanf, fclose */
+#include <unistd.h>             /* sysconf */
+#include <stdatomic.h>
+#if !defined(USE_RPMALLOC) && defined(__GLIBC__)
+#include <malloc.h>             /* malloc_trim */
+#endif
 
 #include "alloc.h"
 #include "predict.h"
 
+/**
+ * The amount of allocations made by the thread
+ */
+static _Thread_local size_t allocations = 0;
+
+/**
+ * The amount of times threads returned their caches and the global caches
+ * were trimmed, and the bytes returned to the system by trimming
+ */
+static atomic_size_t collects = 0;
+static atomic_size_t trims = 0;
+static atomic_size_t trimmed = 0;
+
+/**
+ * Function that checks whether the system has huge pages reserved that are
+ * free to use.
+ *
+ * @return 	      	[bool] 	"Whether huge pages are available"
+ */
+static bool hugetlb_available() {
+    FILE *fp;
+    char line[128];
+    unsigned long pages = 0;
+
+    if ( unlikely(NULL == (fp = fopen("/proc/meminfo", "r"))) ) {
+        return false;
+    }
+    while ( NULL != fgets(line, sizeof(line), fp) ) {
+        if ( sscanf(line, "HugePages_Free: %lu", &pages) == 1 ) {
+            break;
+        }
+    }
+    fclose(fp);
+
+    return pages > 0;
+}
+
+/**
+ * Function that checks whether the system backs memory with transparent huge
+ * pages when advised to.
+ *
+ * @return 	      	[bool] 	"Whether transparent huge pages are available"
+ */
+static bool transparent_available() {
+    FILE *fp;
+    char line[128];
+    bool available = false;
+
+    if ( unlikely(NULL == (fp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r"))) ) {
+        return false;
+    }
+    if ( NULL != fgets(line, sizeof(line), fp) ) {
+        available = NULL == strstr(line, "[never]");
+    }
+    fclose(fp);
+
+    return available;
+}
+
+/**
+ * Function that (re-)initializes the allocator, such that its memory is backed
+ * by the given kind of pages. Falls back to transparent huge pages if no huge
+ * pages are reserved, and to regular pages if neither is supported. Must be
+ * called while no memory of the allocator is in use.
+ *
+ * @param 	mode	[wss_huge_pages_t] 	"The kind of pages that is wanted"
+ * @return 	      	[wss_huge_pages_t] 	"The kind of pages that is used"
+ */
+wss_huge_pages_t WSS_alloc_initialize(wss_huge_pages_t mode) {
+#ifdef USE_RPMALLOC
+    rpmalloc_config_t config;
+
+    if ( mode == HUGE_PAGES_HUGETLB && ! hugetlb_available() ) {
+        mode = HUGE_PAGES_TRANSPARENT;
+    }
+    if ( mode == HUGE_PAGES_TRANSPARENT && ! transparent_available() ) {
+        mode = HUGE_PAGES_OFF;
+    }
+
+    memset(&config, '\0', sizeof(config));
+    config.enable_huge_pages = mode == HUGE_PAGES_HUGETLB;
+    config.enable_transparent_huge_pages = mode == HUGE_PAGES_TRANSPARENT;
+
+    if ( rpmalloc_is_thread_initialized() ) {
+        rpmalloc_finalize();
+    }
+    if ( unlikely(rpmalloc_initialize_config(&config) != 0) ) {
+        return HUGE_PAGES_OFF;
+    }
+
+    // The huge page size is detected by the allocator itself
+    if ( mode == HUGE_PAGES_HUGETLB && ! rpmalloc_config()->enable_huge_pages ) {
+        mode = HUGE_PAGES_OFF;
+    }
+
+    return mode;
+#else
+    (void) mode;
+    return HUGE_PAGES_OFF;
+#endif
+}
+
+/**
+ * Function that returns the amount of allocations and re-allocations the
+ * calling thread has made since it started.
+ *
+ * @return 	      	[size_t] 	"The amount of allocations"
+ */
+size_t WSS_allocations() {
+    return allocations;
+}
+
 /**
  * Function that allocates memory.
  * @param 	ptr		[void *] 	"The memory that needs to be copies"
@@ -36,6 +154,8 @@ void *WSS_malloc(size_t size) {
         return NULL;
     }
 
+    allocations++;
+
 #ifdef USE_RPMALLOC
 	if ( unlikely(NULL == (buffer = rpmalloc( size ))) ) {
 		return NULL;
@@ -66,6 +186,8 @@ void *WSS_calloc(size_t memb, size_t size) {
         return NULL;
     }
 
+    allocations++;
+
 #ifdef USE_RPMALLOC
 	if ( unlikely(NULL == (buffer = rpcalloc(memb, size))) ) {
 		return NULL;
@@ -98,6 +220,8 @@ void *WSS_realloc(void **ptr, size_t oldSize, size_t newSize) {
         return NULL;
     }
     
+    allocations++;
+
     if ( unlikely(ptr == NULL) ) {
 #ifdef USE_RPMALLOC
         if ( unlikely(NULL == (buffer = rprealloc(NULL, newSize))) ) {
@@ -171,3 +295,112 @@ void WSS_free(void **ptr) {
 void WSS_free_normal(void *ptr) {
     WSS_free(&ptr);
 }
+
+/**
+ * Function that returns the resident set size of the process in bytes.
+ *
+ * @return 	      	[size_t] 	"The resident set size or 0 if unknown"
+ */
+static size_t resident() {
+    FILE *fp;
+    unsigned long size, pages = 0;
+
+    if ( unlikely(NULL == (fp = fopen("/proc/self/statm", "r"))) ) {
+        return 0;
+    }
+    if ( unlikely(fscanf(fp, "%lu %lu", &size, &pages) != 2) ) {
+        pages = 0;
+    }
+    fclose(fp);
+
+    return pages*(size_t) sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Function that returns the free memory held by the caches of the calling
+ * thread to the global caches of the allocator, such that it can be reused by
+ * other threads or returned to the system. Should be called by threads that
+ * have been idle for a while.
+ *
+ * @return 		    [void]
+ */
+void WSS_alloc_collect() {
+#ifdef USE_RPMALLOC
+    rpmalloc_thread_collect();
+#endif
+    atomic_fetch_add_explicit(&collects, 1, memory_order_relaxed);
+}
+
+/**
+ * Function that returns free memory of the global caches of the allocator to
+ * the system, until the resident set size of the process is below the target.
+ *
+ * @param 	target	    [size_t] 	"The target of the resident set size in bytes, 0 is no target"
+ * @param 	decommit	[bool] 	    "Whether the pages of the free memory that is kept should be released with madvise"
+ * @return 	      	    [size_t] 	"The bytes of memory returned to the system"
+ */
+size_t WSS_alloc_trim(size_t target, bool decommit) {
+    size_t rss, released = 0;
+
+    if ( target == 0 && ! decommit ) {
+        return 0;
+    }
+
+    rss = resident();
+
+#ifdef USE_RPMALLOC
+    rpmalloc_global_statistics_t stats;
+    size_t excess = rss > target ? rss-target : 0;
+
+    if ( target > 0 && excess > 0 ) {
+        // Only the part of the caches that exceeds the target is unmapped
+        rpmalloc_global_statistics(&stats);
+        released = rpmalloc_global_collect(stats.cached > excess ? stats.cached-excess : 0, decommit);
+    } else {
+        released = rpmalloc_global_collect((size_t) -1, decommit);
+    }
+#elif defined(__GLIBC__)
+    if ( target > 0 && rss > target ) {
+        malloc_trim(0);
+        released = resident();
+        released = rss > released ? rss-released : 0;
+    }
+#endif
+
+    if ( target > 0 && rss > target ) {
+        atomic_fetch_add_explicit(&trims, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&trimmed, released, memory_order_relaxed);
+    }
+
+    return released;
+}
+
+/**
+ * Function that fills out statistics of the memory used by the server and the
+ * calling thread.
+ *
+ * @param 	stats	[wss_alloc_statistics_t *] 	"The statistics to fill"
+ * @return 		    [void]
+ */
+void WSS_alloc_statistics(wss_alloc_statistics_t *stats) {
+    memset(stats, '\0', sizeof(wss_alloc_statistics_t));
+
+#ifdef USE_RPMALLOC
+    rpmalloc_global_statistics_t global;
+    rpmalloc_thread_statistics_t thread;
+
+    rpmalloc_global_statistics(&global);
+    stats->mapped = global.mapped;
+    stats->cached = global.cached;
+
+    if ( rpmalloc_is_thread_initialized() ) {
+        rpmalloc_thread_statistics(&thread);
+        stats->thread_cached = thread.sizecache+thread.spancache;
+    }
+#endif
+
+    stats->resident = resident();
+    stats->collects = atomic_load_explicit(&collects, memory_order_relaxed);
+    stats->trims = atomic_load_explicit(&trims, memory_order_relaxed);
+    stats->trimmed = atomic_load_explicit(&trimmed, memory_order_relaxed);
+}
@@ -0,0 +1,246 @@
+#include <stdint.h>
+#include <string.h>             /* memset, memcpy */
+#include <pthread.h>            /* pthread_key_create, pthread_once */
+#include <sys/mman.h>           /* mmap, munmap */
+
+#include "arena.h"
+#include "alloc.h"
+#include "predict.h"
+
+/**
+ * The alignment of every allocation of the arena
+ */
+#define WSS_ARENA_ALIGN 16
+
+#ifndef MIN
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#endif
+
+#define arena_align(size) (((size)+(WSS_ARENA_ALIGN-1)) & ~((size_t) WSS_ARENA_ALIGN-1))
+
+/**
+ * Structure preceding every allocation of the arena, such that the memory can
+ * be re-allocated and promoted without knowing its size
+ */
+typedef struct {
+    size_t size;
+    size_t padding;
+} wss_arena_block_t;
+
+/**
+ * Structure holding the arena of a thread
+ */
+typedef struct {
+    char *memory;
+    size_t used;
+    size_t last;
+    unsigned int depth;
+    size_t allocations;
+} wss_arena_t;
+
+/**
+ * The arena of the thread
+ */
+static _Thread_local wss_arena_t arena = { NULL, 0, 0, 0, 0 };
+
+/**
+ * Key whose destructor unmaps the memory of the arena once the thread exits.
+ * The memory is mapped directly, as the allocator of the thread might have
+ * been finalized by the time the destructor is run.
+ */
+static pthread_key_t arena_key;
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+
+static void arena_release(void *memory) {
+    munmap(memory, WSS_ARENA_SIZE);
+}
+
+static void arena_key_create() {
+    pthread_key_create(&arena_key, arena_release);
+}
+
+/**
+ * Function that returns the memory of the arena of the calling thread, which
+ * is mapped on first use. Pages are only backed once they are written, hence
+ * a thread only pays for the largest scope it has seen.
+ *
+ * @return 	      	[char *] 	"The memory of the arena or NULL"
+ */
+static char *arena_memory() {
+    void *memory;
+
+    if ( likely(NULL != arena.memory) ) {
+        return arena.memory;
+    }
+
+    pthread_once(&arena_once, arena_key_create);
+
+    memory = mmap(NULL, WSS_ARENA_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if ( unlikely(MAP_FAILED == memory) ) {
+        return NULL;
+    }
+    pthread_setspecific(arena_key, memory);
+    arena.memory = memory;
+
+    return arena.memory;
+}
+
+/**
+ * Function that starts a scope in which allocations of the calling thread are
+ * served by its arena. Scopes may be nested and the arena is reset once the
+ * outermost scope is left.
+ *
+ * @return 		    [void]
+ */
+void WSS_arena_enter() {
+    arena.depth++;
+}
+
+/**
+ * Function that ends a scope of the arena of the calling thread. Leaving the
+ * outermost scope releases every allocation of the arena at once.
+ *
+ * @return 		    [void]
+ */
+void WSS_arena_leave() {
+    if ( likely(arena.depth > 0) && --arena.depth == 0 ) {
+        arena.used = 0;
+        arena.last = 0;
+    }
+}
+
+/**
+ * Function that allocates zeroed memory from the arena of the calling thread.
+ * Outside of a scope, or if the arena is exhausted, the memory is allocated
+ * on the heap.
+ *
+ * @param 	size	[size_t] 	"The size of the memory that should be allocated"
+ * @return 	      	[void *] 	"Returns pointer to allocated memory if successful, otherwise NULL"
+ */
+void *WSS_arena_malloc(size_t size) {
+    size_t needed;
+    char *memory;
+    wss_arena_block_t *block;
+
+    if ( unlikely(size == 0) ) {
+        return NULL;
+    }
+
+    needed = sizeof(wss_arena_block_t)+arena_align(size);
+    if ( unlikely(arena.depth == 0 || needed < size || NULL == (memory = arena_memory()) ||
+                needed > WSS_ARENA_SIZE-arena.used) ) {
+        return WSS_malloc(size);
+    }
+
+    block = (wss_arena_block_t *) (memory+arena.used);
+    block->size = size;
+    arena.last = arena.used;
+    arena.used += needed;
+    arena.allocations++;
+
+    return memset(block+1, '\0', size);
+}
+
+/**
+ * Function that checks whether memory belongs to the arena of the calling
+ * thread.
+ *
+ * @param 	ptr		[void *] 	"The memory to check"
+ * @return 	      	[bool] 	    "Whether the memory belongs to the arena"
+ */
+bool WSS_arena_owns(void *ptr) {
+    return NULL != arena.memory && (uintptr_t) ptr >= (uintptr_t) arena.memory &&
+        (uintptr_t) ptr < (uintptr_t) arena.memory+WSS_ARENA_SIZE;
+}
+
+/**
+ * Function that re-allocates some memory. Memory of the arena stays in the
+ * arena if possible, whereas any other memory is re-allocated on the heap.
+ * The interface is similar to the realloc(3) function.
+ *
+ * @param 	ptr		[void *] 	"The memory that needs to be rearranged"
+ * @param 	size	[size_t] 	"The size of the memory that should be allocated"
+ * @return 	      	[void *] 	"Returns pointer to allocated memory if successful, otherwise NULL"
+ */
+void *WSS_arena_realloc(void *ptr, size_t size) {
+    void *buffer;
+    size_t offset;
+    wss_arena_block_t *block;
+
+    if ( likely(! WSS_arena_owns(ptr)) ) {
+        return WSS_realloc_normal(ptr, size);
+    }
+
+    if ( unlikely(size == 0) ) {
+        return NULL;
+    }
+
+    block = ((wss_arena_block_t *) ptr)-1;
+    offset = (char *) block-arena.memory;
+
+    // The latest allocation can grow or shrink in place
+    if ( likely(offset == arena.last && offset < arena.used && arena_align(size) >= size &&
+                arena_align(size) <= WSS_ARENA_SIZE-offset-sizeof(wss_arena_block_t)) ) {
+        block->size = size;
+        arena.used = offset+sizeof(wss_arena_block_t)+arena_align(size);
+        return ptr;
+    }
+
+    if ( unlikely(NULL == (buffer = WSS_arena_malloc(size))) ) {
+        return NULL;
+    }
+
+    return memcpy(buffer, ptr, MIN(block->size, size));
+}
+
+/**
+ * Function that frees some memory. Memory of the arena is released once the
+ * scope is left, hence only memory of the heap is freed right away.
+ *
+ * @param 	ptr		[void **] 	"The memory that needs to be freed"
+ * @return 		    [void]
+ */
+void WSS_arena_free(void **ptr) {
+    if ( unlikely(WSS_arena_owns(*ptr)) ) {
+        *ptr = NULL;
+        return;
+    }
+
+    WSS_free(ptr);
+}
+
+/**
+ * Function that frees some memory. The interface is of this function is
+ * similar to the free(3) function.
+ *
+ * @param 	ptr		[void *] 	"The memory that needs to be freed"
+ * @return 		    [void]
+ */
+void WSS_arena_free_normal(void *ptr) {
+    WSS_arena_free(&ptr);
+}
+
+/**
+ * Function that moves memory of the arena to the heap, such that it outlives
+ * the scope. Memory that is not part of the arena is returned as is.
+ *
+ * @param 	ptr		[void *] 	"The memory that should be kept"
+ * @return 	      	[void *] 	"Returns pointer to memory of the heap if successful, otherwise NULL"
+ */
+void *WSS_arena_promote(void *ptr) {
+    if ( likely(! WSS_arena_owns(ptr)) ) {
+        return ptr;
+    }
+
+    return WSS_copy(ptr, (((wss_arena_block_t *) ptr)-1)->size);
+}
+
+/**
+ * Function that returns the amount of allocations the arena of the calling
+ * thread has served since it started.
+ *
+ * @return 	      	[size_t] 	"The amount of allocations"
+ */
+size_t WSS_arena_allocations() {
+    return arena.allocations;
+}
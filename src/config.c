@@ -3,6 +3,7 @@
 #include <string.h>             /* strerror, memset, strncpy, memcpy, strlen,
                                    strtok, strtok_r */
 #include <math.h> 				/* floor, log10, abs */
+#include <unistd.h> 			/* sysconf */
 
 #include "config.h"
 #include "str.h"
@@ -542,14 +543,161 @@ wss_error_t WSS_config_load(wss_config_t *config, char *path) {
                                     (unsigned int)temp->u.integer;
                             }
 
-                            // Getting amount of retries
-                            temp = json_value_find(val, "retries");
+                            // Getting maximal amount of workers under load
+                            temp = json_value_find(val, "max_workers");
                             if ( temp != NULL && likely(temp->type == json_integer) ) {
-                                config->pool_retries =
+                                config->pool_max_workers =
+                                    (unsigned int)temp->u.integer;
+                            }
+
+                            // Getting maximal size of the task queue under load
+                            temp = json_value_find(val, "max_queue");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->pool_max_queue =
+                                    (unsigned int)temp->u.integer;
+                            }
+
+                            // Getting how long surplus workers may idle
+                            temp = json_value_find(val, "idle_timeout");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->pool_idle_timeout =
+                                    (unsigned int)temp->u.integer;
+                            }
+
+                            // Getting the threading model of the server
+                            temp = json_value_find(val, "mode");
+                            if ( temp != NULL && likely(temp->type == json_string) ) {
+                                if ( strncmp((char *)temp->u.string.ptr, "sharded", 7) == 0 ) {
+                                    config->pool_mode = POOL_SHARDED;
+                                } else if ( strncmp((char *)temp->u.string.ptr, "leader", 6) == 0 ) {
+                                    config->pool_mode = POOL_LEADER;
+                                } else if ( strncmp((char *)temp->u.string.ptr, "dispatcher", 10) == 0 ) {
+                                    config->pool_mode = POOL_DISPATCHER;
+                                } else {
+                                    WSS_log_warn("Unknown pool mode '%s', using default", (char *)temp->u.string.ptr);
+                                }
+                            }
+
+                            // Getting the scheduler used by the threadpool
+                            temp = json_value_find(val, "scheduler");
+                            if ( temp != NULL && likely(temp->type == json_string) ) {
+                                if ( strncmp((char *)temp->u.string.ptr, "stealing", 8) == 0 ) {
+                                    config->pool_scheduler = POOL_STEALING;
+                                } else if ( strncmp((char *)temp->u.string.ptr, "queue", 5) == 0 ) {
+                                    config->pool_scheduler = POOL_QUEUE;
+                                } else {
+                                    WSS_log_warn("Unknown pool scheduler '%s', using default", (char *)temp->u.string.ptr);
+                                }
+                            }
+
+                            // Getting the event backend used by the event loops
+                            temp = json_value_find(val, "backend");
+                            if ( temp != NULL && likely(temp->type == json_string) ) {
+                                if ( strncmp((char *)temp->u.string.ptr, "io_uring", 8) == 0 ) {
+                                    config->pool_backend = POOL_IOURING;
+                                } else if ( strncmp((char *)temp->u.string.ptr, "epoll", 5) == 0 ) {
+                                    config->pool_backend = POOL_EPOLL;
+                                } else {
+                                    WSS_log_warn("Unknown pool backend '%s', using default", (char *)temp->u.string.ptr);
+                                }
+                            }
+
+                            // Getting amount of event loops in sharded mode
+                            temp = json_value_find(val, "loops");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->pool_loops =
+                                    (unsigned int)temp->u.integer;
+                            }
+
+                            // Getting amount of recipients sent to per worker
+                            temp = json_value_find(val, "fanout");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->pool_fanout =
                                     (unsigned int)temp->u.integer;
                             }
                         }
                     }
+
+                    if ( (val = json_value_find(value, "accept")) != NULL ) {
+                        if ( likely(val->type == json_object) ) {
+                            // Getting how many sessions to accept per wakeup
+                            temp = json_value_find(val, "budget");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->accept_budget =
+                                    (unsigned int)temp->u.integer;
+                            }
+
+                            // Getting how long the kernel may defer accepts
+                            temp = json_value_find(val, "defer");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->accept_defer =
+                                    (unsigned int)temp->u.integer;
+                            }
+
+                            // Getting the queue length of TCP Fast Open
+                            temp = json_value_find(val, "fastopen");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->accept_fastopen =
+                                    (unsigned int)temp->u.integer;
+                            }
+                        }
+                    }
+
+                    if ( (val = json_value_find(value, "session")) != NULL ) {
+                        if ( likely(val->type == json_object) ) {
+                            // Getting how many sessions to allocate up front
+                            temp = json_value_find(val, "prewarm");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->session_prewarm =
+                                    (unsigned int)temp->u.integer;
+                            }
+
+                            // Getting how many free sessions to keep
+                            temp = json_value_find(val, "cache");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->session_cache =
+                                    (unsigned int)temp->u.integer;
+                            }
+                        }
+                    }
+
+                    if ( (val = json_value_find(value, "memory")) != NULL ) {
+                        if ( likely(val->type == json_object) ) {
+                            // Getting how often idle memory is returned
+                            temp = json_value_find(val, "collect");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->memory_collect =
+                                    (unsigned int)temp->u.integer;
+                            }
+
+                            // Getting the resident memory to trim towards
+                            temp = json_value_find(val, "rss");
+                            if ( temp != NULL && likely(temp->type == json_integer) ) {
+                                config->memory_rss =
+                                    (size_t)temp->u.integer;
+                            }
+
+                            // Getting whether cached memory should be decommitted
+                            temp = json_value_find(val, "decommit");
+                            if ( temp != NULL && likely(temp->type == json_boolean) ) {
+                                config->memory_decommit = temp->u.boolean;
+                            }
+
+                            // Getting the kind of pages that should back memory
+                            temp = json_value_find(val, "huge_pages");
+                            if ( temp != NULL && likely(temp->type == json_string) ) {
+                                if ( strncmp((char *)temp->u.string.ptr, "hugetlb", 7) == 0 ) {
+                                    config->memory_huge_pages = HUGE_PAGES_HUGETLB;
+                                } else if ( strncmp((char *)temp->u.string.ptr, "transparent", 11) == 0 ) {
+                                    config->memory_huge_pages = HUGE_PAGES_TRANSPARENT;
+                                } else if ( strncmp((char *)temp->u.string.ptr, "off", 3) == 0 ) {
+                                    config->memory_huge_pages = HUGE_PAGES_OFF;
+                                } else {
+                                    WSS_log_warn("Unknown huge pages '%s', using default", (char *)temp->u.string.ptr);
+                                }
+                            }
+                        }
+                    }
                 }
             }
         } else {
@@ -575,6 +723,19 @@ wss_error_t WSS_config_load(wss_config_t *config, char *path) {
         config->timeout_client = -1;
     }
 
+    if ( config->pool_max_workers < config->pool_workers ) {
+        config->pool_max_workers = config->pool_workers;
+    }
+
+    if ( config->pool_max_queue < config->size_thread ) {
+        config->pool_max_queue = config->size_thread;
+    }
+
+    if ( config->pool_loops == 0 ) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        config->pool_loops = cores > 0 ? (unsigned int)cores : 1;
+    }
+
     if ( unlikely(config->port_http == 0 && config->port_https == 0) ) {
         WSS_log_error("No port chosen");
         WSS_config_free(config);
@@ -2,6 +2,19 @@
 
 #if defined(WSS_EPOLL)
 #include <sys/epoll.h>
+#include <sys/resource.h>
+#if defined(WSS_IOURING)
+#ifndef POLLRDHUP
+#define POLLRDHUP  0x2000
+#endif
+
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
 #elif defined(WSS_KQUEUE)
 #include <sys/event.h>
 #include <sys/time.h>
@@ -20,6 +33,12 @@
 #include <sys/resource.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
@@ -35,55 +54,252 @@
 int close_pipefd[2] = {-1, -1};
 
 /**
- * Writes a rearm message on the rearm pipe.
+ * Creates the file descriptors used to wake up the event loop. On Linux a
+ * single eventfd is used for both ends, elsewhere a non-blocking pipe.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @return 			[wss_error_t]       "The error status"
+ */
+static wss_error_t rearm_init(wss_server_t *server) {
+    wss_error_t err;
+
+    WSS_log_trace("Creating rearm file descriptors");
+
+    atomic_init(&server->rearm_pending, false);
+
+#if defined(__linux__)
+    if ( unlikely((server->rearm_fd[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) ) {
+        WSS_log_trace("Unable to create rearm eventfd: %s", strerror(errno));
+        server->rearm_fd[0] = -1;
+        server->rearm_fd[1] = -1;
+        return WSS_POLL_PIPE_ERROR;
+    }
+    server->rearm_fd[1] = server->rearm_fd[0];
+#else
+    if ( unlikely(pipe(server->rearm_fd) == -1) ) {
+        WSS_log_trace("Unable to create rearm pipe file descriptors: %s", strerror(errno));
+        server->rearm_fd[0] = -1;
+        server->rearm_fd[1] = -1;
+        return WSS_POLL_PIPE_ERROR;
+    }
+
+    if ( unlikely((err = WSS_socket_non_blocking(server->rearm_fd[1])) != WSS_SUCCESS ) ) {
+        return err;
+    }
+#endif
+
+    if ( unlikely((err = WSS_socket_non_blocking(server->rearm_fd[0])) != WSS_SUCCESS ) ) {
+        return err;
+    }
+
+    WSS_server_set_max_fd(server, server->rearm_fd[0]);
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Wakes up the event loop. Notifications are coalesced, such that only the
+ * first request after the event loop woke up reaches the kernel.
  *
  * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
  * @return 			[void]
  */
 static inline void rearm(wss_server_t *server) {
-    int n;
+    ssize_t n;
+#if defined(__linux__)
+    uint64_t value = 1;
+#else
+    char value = 1;
+#endif
+
+    if ( unlikely(server->rearm_fd[1] == -1) ) {
+        return;
+    }
+
+    if ( atomic_exchange(&server->rearm_pending, true) ) {
+        return;
+    }
 
     WSS_log_trace("Notify about rearm");
 
-    if ( likely(server->rearm_pipefd[0] != -1 && server->rearm_pipefd[1] != -1) ) {
-        do {
-            errno = 0;
-            n = write(server->rearm_pipefd[1], "ARM", 3);
-            if ( unlikely(n < 0) ) {
-                if ( unlikely(errno != EINTR) ) {
-                    WSS_log_fatal("Unable to write rearm message through pipe");
-                }
+    do {
+        errno = 0;
+        n = write(server->rearm_fd[1], &value, sizeof(value));
+        if ( unlikely(n < 0) ) {
+            if ( unlikely(errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) ) {
+                WSS_log_fatal("Unable to write rearm notification: %s", strerror(errno));
             }
-        } while ( unlikely(errno == EINTR) );
-    }
+        }
+    } while ( unlikely(errno == EINTR) );
 }
 
 /**
- * Reads as much as possible from rearm pipe.
+ * Consumes the pending rearm notifications.
  *
  * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
  * @return 			[void]
  */
 static inline void handle_rearm(wss_server_t *server) {
-    int n;
-    char buf[server->config->size_buffer];
+    ssize_t n;
+#if defined(__linux__)
+    uint64_t buf;
+#else
+    char buf[64];
+#endif
 
     WSS_log_trace("Handle rearm");
 
-    if ( likely(server->rearm_pipefd[0] != -1 && server->rearm_pipefd[1] != -1) ) {
-        do {
-            n = read(server->rearm_pipefd[0], buf, server->config->size_buffer);
-            if ( unlikely(n < 0) ) {
-                if ( likely(errno == EAGAIN || errno == EWOULDBLOCK) ) {
-                    return;
-                } else if ( likely(errno == EINTR) ) {
-                    errno = 0;
-                    continue;
-                } else {
-                    WSS_log_fatal("Unable to read rearm message through pipe");
-                }
+    if ( unlikely(server->rearm_fd[0] == -1) ) {
+        return;
+    }
+
+    // Cleared before reading, such that requests made while the event loop
+    // rebuilds its interests are guaranteed to wake it up again
+    atomic_store(&server->rearm_pending, false);
+
+    do {
+        errno = 0;
+        n = read(server->rearm_fd[0], &buf, sizeof(buf));
+        if ( unlikely(n < 0) ) {
+            if ( likely(errno == EAGAIN || errno == EWOULDBLOCK) ) {
+                return;
+            } else if ( unlikely(errno != EINTR) ) {
+                WSS_log_fatal("Unable to read rearm notification: %s", strerror(errno));
+                return;
             }
-        } while ( n > 0 );
+        }
+#if defined(__linux__)
+    } while ( unlikely(errno == EINTR) );
+#else
+    } while ( unlikely(errno == EINTR) || n > 0 );
+#endif
+}
+
+/**
+ * Runs the timeouts handed to the event loop by the cleanup thread, such that
+ * sessions only are changed by the event loop that owns them.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @return 			[void]
+ */
+static inline void handle_timeouts(wss_server_t *server) {
+    wss_thread_args_t *args, *next;
+
+    args = atomic_exchange_explicit(&server->timeouts, NULL, memory_order_acquire);
+    for (; NULL != args; args = next) {
+        next = args->next;
+        WSS_timeout(args);
+    }
+}
+
+/**
+ * Closes the file descriptors used to wake up the event loop.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @return 			[void]
+ */
+static void rearm_close(wss_server_t *server) {
+    if ( likely(server->rearm_fd[1] != -1) ) {
+        if (server->rearm_fd[1] != server->rearm_fd[0]) {
+            close(server->rearm_fd[1]);
+        }
+        server->rearm_fd[1] = -1;
+    }
+
+    if ( likely(server->rearm_fd[0] != -1) ) {
+        close(server->rearm_fd[0]);
+        server->rearm_fd[0] = -1;
+    }
+}
+
+#if defined(WSS_EPOLL)
+/**
+ * Upper bound on the number of file descriptors whose interests are tracked
+ */
+#define WSS_INTERESTS_MAX 1048576
+
+/**
+ * Interests that a file descriptor is currently armed with
+ */
+typedef enum {
+    INTEREST_NONE  = 0,
+    INTEREST_READ  = 1,
+    INTEREST_WRITE = 2,
+    // The event loop of an io_uring instance receives data for the session
+    INTEREST_RECV  = 4
+} wss_interest_t;
+
+/**
+ * Allocates the table holding the interests each file descriptor is armed
+ * with, such that redundant rearms can be skipped.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @return 			[wss_error_t]       "The error status"
+ */
+static wss_error_t interests_init(wss_server_t *server) {
+    struct rlimit limits;
+
+    if ( unlikely(getrlimit(RLIMIT_NOFILE, &limits) < 0) ) {
+        return WSS_RLIMIT_ERROR;
+    }
+
+    if ( unlikely(limits.rlim_cur == RLIM_INFINITY || limits.rlim_cur > WSS_INTERESTS_MAX) ) {
+        server->interests_length = WSS_INTERESTS_MAX;
+    } else {
+        server->interests_length = (unsigned int) limits.rlim_cur;
+    }
+
+    if ( unlikely(NULL == (server->interests = WSS_calloc(server->interests_length, sizeof(atomic_uchar)))) ) {
+        WSS_log_fatal("Unable to calloc interests of file descriptors");
+        server->interests_length = 0;
+        return WSS_MEMORY_ERROR;
+    }
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Returns the interest slot of a file descriptor, or NULL if the file
+ * descriptor is not tracked.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @param 	fd	    [int]	            "The file descriptor"
+ * @return 			[atomic_uchar *]    "The interest slot or NULL"
+ */
+static inline atomic_uchar *interest(wss_server_t *server, int fd) {
+    if ( unlikely(fd < 0 || (unsigned int) fd >= server->interests_length) ) {
+        return NULL;
+    }
+    return &server->interests[fd];
+}
+#endif
+
+/**
+ * Function that converts an error of the threadpool into an error status.
+ *
+ * @param 	err	    [int] 	            "The error of the threadpool"
+ * @return 			[wss_error_t]       "The error status"
+ */
+static wss_error_t threadpool_error(int err) {
+    switch (err) {
+        case threadpool_invalid:
+            WSS_log_fatal("Threadpool was served with invalid data");
+            return WSS_THREADPOOL_INVALID_ERROR;
+        case threadpool_lock_failure:
+            WSS_log_fatal("Locking in thread failed");
+            return WSS_THREADPOOL_LOCK_ERROR;
+        case threadpool_queue_full:
+            WSS_log_error("Threadpool queue is full");
+            return WSS_THREADPOOL_FULL_ERROR;
+        case threadpool_shutdown:
+            WSS_log_error("Threadpool is shutting down");
+            return WSS_THREADPOOL_SHUTDOWN_ERROR;
+        case threadpool_thread_failure:
+            WSS_log_fatal("Threadpool thread return an error");
+            return WSS_THREADPOOL_THREAD_ERROR;
+        default:
+            WSS_log_fatal("Unknown error occured with threadpool");
+            return WSS_THREADPOOL_ERROR;
     }
 }
 
@@ -97,47 +313,223 @@ static inline void handle_rearm(wss_server_t *server) {
  */
 wss_error_t WSS_add_to_threadpool(wss_server_t *server, void (*func)(void *), void *args) {
     int err;
-    struct timespec tim;
-    unsigned int retries = 0;
 
-    tim.tv_sec = 0;
-    tim.tv_nsec = 100000000;
+    // In sharded and leader/follower mode the thread that received the event
+    // performs the work
+    if (server->config->pool_mode != POOL_DISPATCHER) {
+        func(args);
+        return WSS_SUCCESS;
+    }
+
+    // The threadpool grows its queue and threads up to the configured
+    // maximums by itself, so a full queue means that the limits are reached
+    if ( unlikely((err = threadpool_add(server->pool, func, args, 0)) != 0) ) {
+        return threadpool_error(err);
+    }
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Function that hands a session whose deadline passed to the event loop that
+ * owns it. In dispatcher mode the timeout is added to the threadpool, otherwise
+ * it is queued on the event loop, which is woken to run it.
+ *
+ * @param 	server	[wss_server_t *] 	"The event loop owning the session"
+ * @param 	fd	    [int] 	            "The file descriptor of the session"
+ * @return 			[wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_timeout(wss_server_t *server, int fd) {
+    wss_error_t err;
+    wss_thread_args_t *args, *head;
+
+    if ( unlikely(NULL == (args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t)))) ) {
+        return WSS_MEMORY_ERROR;
+    }
+
+    args->server = server;
+    args->fd = fd;
+    args->state = IDLE;
 
+    if (server->config->pool_mode == POOL_DISPATCHER) {
+        if ( unlikely((err = WSS_add_to_threadpool(server, &WSS_timeout, (void *) args)) != WSS_SUCCESS) ) {
+            WSS_free((void **) &args);
+        }
+        return err;
+    }
+
+    if ( unlikely(server->rearm_fd[1] == -1) ) {
+        WSS_free((void **) &args);
+        return WSS_POLL_SET_ERROR;
+    }
+
+    head = atomic_load_explicit(&server->timeouts, memory_order_relaxed);
     do {
-        if ( unlikely((err = threadpool_add(server->pool, func, args, 0)) != 0) ) {
-            switch (err) {
-                case threadpool_invalid:
-                    WSS_log_fatal("Threadpool was served with invalid data");
-                    return WSS_THREADPOOL_INVALID_ERROR;
-                case threadpool_lock_failure:
-                    WSS_log_fatal("Locking in thread failed");
-                    return WSS_THREADPOOL_LOCK_ERROR;
-                case threadpool_queue_full:
-                    if ( likely(retries < server->config->pool_retries) ) {
-                        retries += 1;
-                        WSS_log_trace("Threadpool full, will retry shortly. Retry number: %d", retries);
-                        nanosleep(&tim, NULL);
-                        continue;
-                    }
+        args->next = head;
+    } while ( unlikely(! atomic_compare_exchange_weak_explicit(&server->timeouts,
+                    &head, args, memory_order_release, memory_order_relaxed)) );
+
+    rearm(server);
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Function that returns the arguments of a job dispatched by an event loop,
+ * such that the event loop can reuse them for a later event. May be called
+ * from any thread.
+ *
+ * @param 	args	[wss_thread_args_t *] 	"The arguments of the job"
+ * @return 			[void]
+ */
+void WSS_thread_args_release(wss_thread_args_t *args) {
+    wss_server_t *server = args->server;
+    wss_thread_args_t *head = atomic_load_explicit(&server->jobs_returned, memory_order_relaxed);
+
+    // Only the event loop pops, and it takes the whole list at once, hence
+    // pushing is not subject to the ABA problem
+    do {
+        args->next = head;
+    } while ( unlikely(! atomic_compare_exchange_weak_explicit(&server->jobs_returned,
+                    &head, args, memory_order_release, memory_order_relaxed)) );
+}
+
+/**
+ * Function that frees the job arguments cached by an event loop and the
+ * timeouts it did not run. Must only be called once no jobs of the event loop
+ * are in flight.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @return 			[void]
+ */
+void WSS_thread_args_free(wss_server_t *server) {
+    size_t i;
+    wss_thread_args_t *args, *next;
+
+    for (i = 0; i < server->jobs_length; i++) {
+        WSS_free(&server->jobs[i]);
+    }
+    server->jobs_length = 0;
+    server->jobs_size = 0;
+    WSS_free((void **) &server->jobs);
+
+    for (args = server->jobs_cache; NULL != args; args = next) {
+        next = args->next;
+        WSS_free((void **) &args);
+    }
+    server->jobs_cache = NULL;
+
+    args = atomic_exchange(&server->jobs_returned, NULL);
+    for (; NULL != args; args = next) {
+        next = args->next;
+        WSS_free((void **) &args);
+    }
+    // Timeouts that the event loop did not get to run before it stopped
+    args = atomic_exchange(&server->timeouts, NULL);
+    for (; NULL != args; args = next) {
+        next = args->next;
+        WSS_free((void **) &args);
+    }
+}
+
+/**
+ * Function that hands the jobs collected by the event loop to the threadpool
+ * in a single operation. Jobs that could not be added are returned to the
+ * cache.
+ *
+ * @param 	server	[wss_server_t *] 	"A wss_server_t instance"
+ * @return 			[wss_error_t]       "The error status"
+ */
+wss_error_t WSS_thread_args_flush(wss_server_t *server) {
+    int n;
+    size_t i;
+    wss_error_t err = WSS_SUCCESS;
+
+    if ( unlikely(server->jobs_length == 0) ) {
+        return WSS_SUCCESS;
+    }
+
+    n = threadpool_add_batch(server->pool, &WSS_work, server->jobs, (int) server->jobs_length, 0);
+    if ( unlikely(n < 0) ) {
+        err = threadpool_error(n);
+        n = 0;
+    } else if ( unlikely((size_t) n < server->jobs_length) ) {
+        err = threadpool_error(threadpool_queue_full);
+    }
+
+    for (i = (size_t) n; unlikely(i < server->jobs_length); i++) {
+        WSS_thread_args_release((wss_thread_args_t *) server->jobs[i]);
+    }
+    server->jobs_length = 0;
+
+    return err;
+}
+
+/**
+ * Function that dispatches an event of an event loop as a job. Job arguments
+ * are reused from the ones returned by earlier jobs, such that memory only is
+ * allocated when more jobs than ever before are in flight. Unless the thread
+ * that received the event performs the work itself, the job is handed to the
+ * threadpool by the next call to WSS_thread_args_flush.
+ *
+ * @param 	server	[wss_server_t *] 	    "A wss_server_t instance"
+ * @param 	fd	    [int] 	                "The file descriptor of the session"
+ * @param 	state	[wss_session_state_t] 	"The state of the session"
+ * @return 			[wss_error_t]           "The error status"
+ */
+wss_error_t WSS_thread_args_dispatch(wss_server_t *server, int fd, wss_session_state_t state) {
+    size_t size;
+    void **jobs;
+    wss_error_t err;
+    wss_thread_args_t *args;
+
+    // In sharded and leader/follower mode the thread that received the event
+    // performs the work, hence no job is needed
+    if (server->config->pool_mode != POOL_DISPATCHER) {
+        WSS_work_event(server, fd, state);
+        return WSS_SUCCESS;
+    }
 
-                    // Currently we treat a full threadpool as an error, but
-                    // we could try to handle this by dynamically increasing size
-                    // of threadpool, and maybe reset thread count to that of the
-                    // configuration when the hot load is over
-                    WSS_log_error("Threadpool queue is full");
-                    return WSS_THREADPOOL_FULL_ERROR;
-                case threadpool_shutdown:
-                    WSS_log_error("Threadpool is shutting down");
-                    return WSS_THREADPOOL_SHUTDOWN_ERROR;
-                case threadpool_thread_failure:
-                    WSS_log_fatal("Threadpool thread return an error");
-                    return WSS_THREADPOOL_THREAD_ERROR;
-                default:
-                    WSS_log_fatal("Unknown error occured with threadpool");
-                    return WSS_THREADPOOL_ERROR;
+    if ( unlikely(NULL == server->jobs_cache) ) {
+        server->jobs_cache = atomic_exchange_explicit(&server->jobs_returned, NULL, memory_order_acquire);
+    }
+
+    if ( likely(NULL != (args = server->jobs_cache)) ) {
+        server->jobs_cache = args->next;
+    } else if ( likely(NULL != (args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t)))) ) {
+        server->jobs_allocated++;
+    } else {
+        WSS_log_fatal("Failed allocating threadpool argument");
+        return WSS_MEMORY_ERROR;
+    }
+
+    args->server = server;
+    args->fd = fd;
+    args->state = state;
+    args->next = NULL;
+    server->jobs_dispatched++;
+
+    if ( unlikely(server->jobs_length == server->jobs_size) ) {
+        size = server->jobs_size == 0 ? 64 : server->jobs_size*2;
+
+        // Hand the jobs collected so far to the threadpool, if the batch
+        // cannot grow
+        if ( unlikely(NULL == (jobs = WSS_malloc(size*sizeof(void *)))) ) {
+            if ( unlikely((err = WSS_thread_args_flush(server)) != WSS_SUCCESS) ) {
+                WSS_thread_args_release(args);
+                return err;
+            }
+        } else {
+            if (server->jobs_length > 0) {
+                memcpy(jobs, server->jobs, server->jobs_length*sizeof(void *));
             }
+            WSS_free((void **) &server->jobs);
+            server->jobs = jobs;
+            server->jobs_size = size;
         }
-    } while (0);
+    }
+
+    server->jobs[server->jobs_length++] = (void *) args;
 
     return WSS_SUCCESS;
 }
@@ -213,36 +605,23 @@ wss_error_t WSS_poll_init(wss_server_t *server) {
 
     WSS_server_set_max_fd(server, close_pipefd[0]);
 
-    WSS_log_trace("Creating arm pipe file descriptors");
-
-    if ( unlikely(pipe(server->rearm_pipefd) == -1) ) {
-        WSS_log_trace("Unable to create arm pipe file descriptors: %s", strerror(errno));
-        return WSS_POLL_PIPE_ERROR;
-    }
-
-    if ( unlikely((err = WSS_socket_non_blocking(server->rearm_pipefd[0])) != WSS_SUCCESS) ) {
-        return err;
-    }
-
-    if ( unlikely((err = WSS_socket_non_blocking(server->rearm_pipefd[1])) != WSS_SUCCESS ) ) {
+    if ( unlikely((err = rearm_init(server)) != WSS_SUCCESS) ) {
         return err;
     }
 
-    WSS_log_trace("Arms rearm pipe file descriptor to kqueue instance");
+    WSS_log_trace("Arms rearm file descriptor to kqueue instance");
 
     do {
         errno = 0;
-        EV_SET(&event, server->rearm_pipefd[0], EVFILT_READ, EV_ADD, 0, 0, ((void *) &server->rearm_pipefd[0])); 
+        EV_SET(&event, server->rearm_fd[0], EVFILT_READ, EV_ADD, 0, 0, ((void *) &server->rearm_fd[0])); 
         ret = kevent(server->poll_fd, &event, 1, NULL, 0, NULL);
     } while ( unlikely(errno == EINTR) );
 
     if ( unlikely(ret < 0) ) {
-        WSS_log_error("Failed to (re)arm arm pipe file descriptor to kqueue: %s", strerror(errno));
+        WSS_log_error("Failed to (re)arm rearm file descriptor to kqueue: %s", strerror(errno));
         return WSS_POLL_SET_ERROR;
     }
 
-    WSS_server_set_max_fd(server, server->rearm_pipefd[0]);
-
     WSS_log_trace("Arms server file descriptor to kqueue instance");
 
     do {
@@ -363,6 +742,54 @@ wss_error_t WSS_poll_remove(wss_server_t *server, int fd) {
     return WSS_SUCCESS;
 } 
 
+/**
+ * Function that rearms the poll instance for the servers file descriptor, such
+ * that sessions left in the backlog once the accept budget is spent are
+ * reported by a later event.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_set_accept(wss_server_t *server) {
+    // The servers file descriptor is level-triggered
+    (void) server;
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Function that checks whether the poll instance receives and sends the data
+ * of sessions itself, which is done by io_uring for sessions without TLS.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @return 			    [bool]              "Whether data is received and sent by the poll instance"
+ */
+bool WSS_poll_io(wss_server_t *server) {
+    (void) server;
+
+    return false;
+}
+
+/**
+ * Function that lets the poll instance send data to a session once it is
+ * writable, which reports a write event once everything was sent or a close
+ * event if sending failed. The data must be kept until either is reported.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @param 	fd	        [int]	            "The clients file descriptor"
+ * @param 	iov	        [struct iovec *]	"The segments of data to send"
+ * @param 	count	    [size_t]	        "The amount of segments"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_send(wss_server_t *server, int fd, struct iovec *iov, size_t count) {
+    (void) server;
+    (void) fd;
+    (void) iov;
+    (void) count;
+
+    return WSS_POLL_SET_ERROR;
+}
+
 /**
  * Function that listens for new events on the servers file descriptor 
  *
@@ -407,50 +834,34 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
         if (events[i].flags & (EV_EOF | EV_ERROR)) {
             if ( unlikely(fd == server->fd) ) {
                 WSS_log_fatal("A server error occured upon kqueue");
+                WSS_thread_args_flush(server);
                 return WSS_POLL_WAIT_ERROR;
             }
 
             WSS_log_trace("Session %d disconnecting", fd);
 
-            wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-            if ( unlikely(NULL == args) ) {
-                WSS_log_fatal("Failed allocating threadpool argument");
-                return WSS_MEMORY_ERROR;
-            }
-            args->server = server;
-            args->fd = fd;
-            args->state = CLOSING
-
-            err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)
-            if ( unlikely(err != WSS_SUCCESS) ) {
+            if ( unlikely((err = WSS_thread_args_dispatch(server, fd, CLOSING)) != WSS_SUCCESS) ) {
                 WSS_log_fatal("Failed adding disconnect job to worker pool");
-                WSS_free((void **)&args);
+                WSS_thread_args_flush(server);
                 return err;
             }
         } else if ( fd == server->fd ) {
             WSS_log_trace("New session connecting");
 
-            wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-            if ( unlikely(NULL == args) ) {
-                WSS_log_fatal("Failed allocating threadpool argument");
-                return WSS_MEMORY_ERROR;
-            }
-            args->server = server;
-            args->state = CONNECTING
-
             /**
              * If new session has connected
              */
-            err = WSS_add_to_threadpool(server, &WSS_work, (void *)args);
-            if ( unlikely(err != WSS_SUCCESS) ) {
+            if ( unlikely((err = WSS_thread_args_dispatch(server, -1, CONNECTING)) != WSS_SUCCESS) ) {
                 WSS_log_fatal("Failed adding connect job to worker pool");
+                WSS_thread_args_flush(server);
                 return err;
             }
         } else if ( unlikely(fd == close_pipefd[0]) ) {
             // Pipe file descriptor is used to interrupt blocking wait
             continue;
-        } else if ( likely(fd == server->rearm_pipefd[0]) ) {
+        } else if ( likely(fd == server->rearm_fd[0]) ) {
             handle_rearm(server);
+            handle_timeouts(server);
             continue;
         } else {
             if (events[i].filter == EVFILT_READ) {
@@ -459,19 +870,9 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
                 /**
                  * If new reads are ready
                  */
-                wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-                if ( unlikely(NULL == args) ) {
-                    WSS_log_fatal("Failed allocating threadpool argument");
-                    return WSS_MEMORY_ERROR;
-                }
-                args->server = server;
-                args->fd = fd;
-                args->state = READING
-
-                err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)
-                if ( unlikely(err != WSS_SUCCESS) ) {
+                if ( unlikely((err = WSS_thread_args_dispatch(server, fd, READING)) != WSS_SUCCESS) ) {
                     WSS_log_fatal("Failed adding read job to worker pool");
-                    WSS_free((void **)&args);
+                    WSS_thread_args_flush(server);
                     return err;
                 }
             }
@@ -482,68 +883,873 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
                 /**
                  * If new writes are ready
                  */
-                wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-                if ( unlikely(NULL == args) ) {
-                    WSS_log_fatal("Failed allocating threadpool argument");
-                    return WSS_MEMORY_ERROR;
-                }
-                args->server = server;
-                args->fd = fd;
-                args->state = WRITING
-
-                err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)
-                if ( unlikely(err != WSS_SUCCESS) ) {
+                if ( unlikely((err = WSS_thread_args_dispatch(server, fd, WRITING)) != WSS_SUCCESS) ) {
                     WSS_log_fatal("Failed adding write job to worker pool");
-                    WSS_free((void **)&args);
+                    WSS_thread_args_flush(server);
                     return err;
                 }
             }
         }
     }
 
-    return WSS_SUCCESS;
-}
+    // All jobs of the wait are handed to the threadpool at once
+    return WSS_thread_args_flush(server);
+}
+
+/******************************************************************************
+ *                                   EPOLL                                    *
+ ******************************************************************************/
+
+#elif defined(WSS_EPOLL)
+static inline wss_error_t WSS_poll_add(int poll_fd, int fd, uint32_t events) {
+    struct epoll_event event;
+    int ret;
+
+    WSS_log_trace("Modifying filedescriptor on epoll eventlist");
+
+    do {
+        memset(&event, 0, sizeof(event));
+
+        event.events = events;
+        event.data.fd = fd;
+
+        if ( unlikely((ret = epoll_ctl(poll_fd, EPOLL_CTL_MOD, fd, &event)) < 0) ) {
+            if ( likely(errno == ENOENT) ) {
+                WSS_log_trace("Adding file descriptor to epoll eventlist");
+                errno = 0;
+
+                memset(&event, 0, sizeof(event));
+
+                event.events = events;
+                event.data.fd = fd;
+
+                ret = epoll_ctl(poll_fd, EPOLL_CTL_ADD, fd, &event);
+            }
+        }
+    } while ( unlikely(errno == EINTR) );
+
+    if ( unlikely(ret < 0) ) {
+        WSS_log_error("Failed to (re)arm file descriptor to epoll: %s", strerror(errno));
+        return WSS_POLL_SET_ERROR;
+    }
+
+    return WSS_SUCCESS;
+}
+
+/******************************************************************************
+ *                                  IO_URING                                  *
+ ******************************************************************************/
+
+#if defined(WSS_IOURING)
+
+#define WSS_URING_ENTRIES 4096
+
+/**
+ * The amount of buffers provided to the ring for receiving data of sessions
+ */
+#define WSS_URING_BUFFERS 256
+
+/**
+ * Kinds of requests submitted to the ring, stored in the lower bits of the
+ * user data next to the file descriptor
+ */
+typedef enum {
+    URING_READ    = 1,
+    URING_WRITE   = 2,
+    URING_REMOVE  = 3,
+    URING_ACCEPT  = 4,
+    URING_CONNECT = 5,
+    URING_RECV    = 6,
+    URING_NOTIFY  = 7,
+    URING_SEND    = 8,
+    URING_SENT    = 9
+} wss_uring_kind_t;
+
+/**
+ * How long accepting is paused after running out of file descriptors
+ */
+static const struct __kernel_timespec uring_accept_delay = { .tv_sec = 0, .tv_nsec = 100000000 };
+
+/**
+ * Structure holding a ring that is used instead of epoll
+ */
+typedef struct {
+    int fd;
+    pthread_mutex_t lock;
+    unsigned int pending;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_entries;
+    unsigned int *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    // Whether connections are accepted by a multishot accept
+    bool accept;
+    // Whether the data of sessions without TLS is received and sent by the ring
+    bool io;
+    // The ring of buffers provided for receiving, only touched by the event loop
+    struct io_uring_buf_ring *buffers;
+    unsigned short buffers_tail;
+    char *buffer;
+    size_t buffer_size;
+} wss_uring_t;
+
+/**
+ * The server whose ring is being drained by the current thread. Requests made
+ * by that thread are submitted together with the next wait, instead of
+ * entering the kernel once per request.
+ */
+static _Thread_local wss_server_t *uring_owner = NULL;
+
+static inline int uring_enter(int fd, unsigned int submit, unsigned int wait, unsigned int flags, void *arg, size_t size) {
+    return (int) syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, size);
+}
+
+/**
+ * Submits the requests that has been queued. Must be called while holding the
+ * lock of the ring.
+ */
+static inline wss_error_t uring_flush(wss_uring_t *ring) {
+    int n;
+
+    while ( likely(ring->pending > 0) ) {
+        n = uring_enter(ring->fd, ring->pending, 0, 0, NULL, 0);
+        if ( unlikely(n < 0) ) {
+            if ( likely(errno == EINTR || errno == EAGAIN || errno == EBUSY) ) {
+                continue;
+            }
+            WSS_log_error("Unable to submit io_uring requests: %s", strerror(errno));
+            return WSS_POLL_SET_ERROR;
+        }
+        ring->pending -= (unsigned int) n;
+    }
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Takes the lock of the ring and makes room for the amount of requests given,
+ * by submitting the queued requests if needed.
+ */
+static wss_error_t uring_lock(wss_uring_t *ring, unsigned int count) {
+    wss_error_t err;
+
+    pthread_mutex_lock(&ring->lock);
+
+    if ( unlikely(*ring->sq_tail + count - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) > *ring->sq_entries) ) {
+        if ( unlikely((err = uring_flush(ring)) != WSS_SUCCESS) ) {
+            pthread_mutex_unlock(&ring->lock);
+            return err;
+        }
+    }
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Queues a cleared request on the ring, which is filled in by the caller. Must
+ * be called while holding the lock of the ring.
+ */
+static inline struct io_uring_sqe *uring_sqe(wss_uring_t *ring) {
+    unsigned int tail = *ring->sq_tail;
+    unsigned int index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->pending++;
+
+    return sqe;
+}
+
+/**
+ * Releases the lock of the ring, after submitting the queued requests unless
+ * the calling thread is the one waiting for completions on the ring.
+ */
+static wss_error_t uring_unlock(wss_server_t *server, wss_uring_t *ring, bool flush) {
+    wss_error_t err = WSS_SUCCESS;
+
+    if (flush || uring_owner != server) {
+        err = uring_flush(ring);
+    }
+
+    pthread_mutex_unlock(&ring->lock);
+
+    return err;
+}
+
+/**
+ * Queues a request on the ring and submits it, unless the calling thread is
+ * the one waiting for completions on the ring.
+ */
+static wss_error_t uring_submit(wss_server_t *server, uint8_t opcode, int fd, uint32_t events, uint64_t user_data, uint64_t addr, uint32_t len) {
+    wss_error_t err;
+    struct io_uring_sqe *sqe;
+    wss_uring_t *ring = (wss_uring_t *) server->events;
+
+    if ( unlikely((err = uring_lock(ring, 1)) != WSS_SUCCESS) ) {
+        return err;
+    }
+
+    sqe = uring_sqe(ring);
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->user_data = user_data;
+    sqe->addr = addr;
+    sqe->len = len;
+
+    return uring_unlock(server, ring, false);
+}
+
+static inline uint64_t uring_data(int fd, wss_uring_kind_t kind) {
+    return (((uint64_t) (unsigned int) fd) << 8) | kind;
+}
+
+/**
+ * Submits a multishot accept on the servers file descriptor, which completes
+ * with the file descriptor of every new session. After running out of file
+ * descriptors the accept is delayed, such that the event loop does not spin.
+ */
+static wss_error_t uring_accept(wss_server_t *server, bool delay) {
+    wss_error_t err;
+    struct io_uring_sqe *sqe;
+    wss_uring_t *ring = (wss_uring_t *) server->events;
+
+    if ( unlikely((err = uring_lock(ring, 2)) != WSS_SUCCESS) ) {
+        return err;
+    }
+
+    if ( unlikely(delay) ) {
+        sqe = uring_sqe(ring);
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->fd = -1;
+        sqe->addr = (uint64_t) (uintptr_t) &uring_accept_delay;
+        sqe->len = 1;
+        sqe->timeout_flags = IORING_TIMEOUT_ETIME_SUCCESS;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = uring_data(server->fd, URING_REMOVE);
+    }
+
+    sqe = uring_sqe(ring);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server->fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = uring_data(server->fd, URING_CONNECT);
+
+    return uring_unlock(server, ring, false);
+}
+
+/**
+ * Submits a multishot receive on the file descriptor of a session, which
+ * completes with a provided buffer whenever data arrives.
+ */
+static wss_error_t uring_recv(wss_server_t *server, int fd) {
+    wss_error_t err;
+    struct io_uring_sqe *sqe;
+    wss_uring_t *ring = (wss_uring_t *) server->events;
+
+    if ( unlikely((err = uring_lock(ring, 1)) != WSS_SUCCESS) ) {
+        return err;
+    }
+
+    sqe = uring_sqe(ring);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = uring_data(fd, URING_RECV);
+
+    return uring_unlock(server, ring, false);
+}
+
+/**
+ * Gives a provided buffer back to the ring, once its data has been stored.
+ */
+static inline void uring_buffer(wss_uring_t *ring, unsigned short id) {
+    struct io_uring_buf *buf = &ring->buffers->bufs[ring->buffers_tail & (WSS_URING_BUFFERS-1)];
+
+    buf->addr = (uint64_t) (uintptr_t) (ring->buffer + (size_t) id*ring->buffer_size);
+    buf->len = (uint32_t) ring->buffer_size;
+    buf->bid = id;
+    ring->buffers_tail++;
+
+    __atomic_store_n(&ring->buffers->tail, ring->buffers_tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * Checks whether the kernel supports multishot accepts and receives, which
+ * were completed by Linux 6.0 together with zero-copy sends.
+ */
+static bool uring_probe(int fd) {
+    bool supported;
+    struct io_uring_probe *probe;
+    size_t size = sizeof(struct io_uring_probe) + (IORING_OP_SEND_ZC+1)*sizeof(struct io_uring_probe_op);
+
+    if ( unlikely(NULL == (probe = WSS_malloc(size))) ) {
+        return false;
+    }
+
+    supported = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_SEND_ZC+1) == 0 &&
+        probe->last_op >= IORING_OP_SEND_ZC && (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED);
+
+    WSS_free((void **) &probe);
+
+    return supported;
+}
+
+/**
+ * Registers the buffers that the kernel receives the data of sessions into.
+ */
+static wss_error_t uring_buffers_init(wss_server_t *server, wss_uring_t *ring) {
+    unsigned short i;
+    struct io_uring_buf_reg reg;
+
+    ring->buffers = mmap(NULL, WSS_URING_BUFFERS*sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ( unlikely(MAP_FAILED == (void *) ring->buffers) ) {
+        ring->buffers = NULL;
+        return WSS_MEMORY_ERROR;
+    }
+
+    ring->buffer_size = server->config->size_buffer;
+    if ( unlikely(NULL == (ring->buffer = WSS_malloc(WSS_URING_BUFFERS*ring->buffer_size))) ) {
+        return WSS_MEMORY_ERROR;
+    }
+
+    for (i = 0; i < WSS_URING_BUFFERS; i++) {
+        uring_buffer(ring, i);
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t) (uintptr_t) ring->buffers;
+    reg.ring_entries = WSS_URING_BUFFERS;
+    reg.bgid = 0;
+
+    if ( unlikely(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) ) {
+        WSS_log_warn("Unable to register io_uring buffers: %s", strerror(errno));
+        return WSS_POLL_CREATE_ERROR;
+    }
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Frees the ring of a server
+ */
+static void uring_free(wss_uring_t *ring) {
+    if ( NULL != ring->buffers ) {
+        munmap(ring->buffers, WSS_URING_BUFFERS*sizeof(struct io_uring_buf));
+    }
+    WSS_free((void **) &ring->buffer);
+
+    if ( likely(NULL != ring->sqes && MAP_FAILED != (void *) ring->sqes) ) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+
+    if ( likely(NULL != ring->cq_ring && MAP_FAILED != ring->cq_ring && ring->cq_ring != ring->sq_ring) ) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+
+    if ( likely(NULL != ring->sq_ring && MAP_FAILED != ring->sq_ring) ) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+
+    pthread_mutex_destroy(&ring->lock);
+}
+
+/**
+ * Creates a ring for the server. Fails with WSS_POLL_CREATE_ERROR without any
+ * side effects if the kernel does not support the features needed.
+ *
+ * @param 	server	    [wss_server_t *]    "A pointer to a server structure"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+static wss_error_t uring_init(wss_server_t *server) {
+    int fd;
+    wss_error_t err;
+    wss_uring_t *ring;
+    struct io_uring_params params;
+    unsigned int required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+        IORING_FEAT_POLL_32BITS | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+
+    memset(&params, 0, sizeof(params));
+
+    if ( unlikely((fd = (int) syscall(__NR_io_uring_setup, WSS_URING_ENTRIES, &params)) < 0) ) {
+        WSS_log_warn("Unable to create io_uring instance: %s", strerror(errno));
+        return WSS_POLL_CREATE_ERROR;
+    }
+
+    // Multishot polls and waiting with a timeout requires Linux 5.13
+    if ( unlikely((params.features & required) != required) ) {
+        WSS_log_warn("The kernel lacks io_uring features required by the server");
+        close(fd);
+        return WSS_POLL_CREATE_ERROR;
+    }
+
+    WSS_log_info("Using IO_URING");
+
+    if ( unlikely(NULL == (ring = WSS_malloc(sizeof(wss_uring_t)))) ) {
+        WSS_log_fatal("Unable to allocate io_uring structure");
+        close(fd);
+        return WSS_MEMORY_ERROR;
+    }
+
+    ring->fd = fd;
+    pthread_mutex_init(&ring->lock, NULL);
+    server->events = ring;
+    server->poll_fd = fd;
+    WSS_server_set_max_fd(server, server->poll_fd);
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->cq_ring_size > ring->sq_ring_size) {
+        ring->sq_ring_size = ring->cq_ring_size;
+    }
+    ring->cq_ring_size = ring->sq_ring_size;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->sq_ring;
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    if ( unlikely(MAP_FAILED == ring->sq_ring || MAP_FAILED == (void *) ring->sqes) ) {
+        WSS_log_fatal("Unable to map io_uring: %s", strerror(errno));
+        return WSS_POLL_CREATE_ERROR;
+    }
+
+    ring->sq_head = (unsigned int *) ((char *) ring->sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned int *) ((char *) ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = (unsigned int *) ((char *) ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_entries = (unsigned int *) ((char *) ring->sq_ring + params.sq_off.ring_entries);
+    ring->sq_array = (unsigned int *) ((char *) ring->sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned int *) ((char *) ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned int *) ((char *) ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned int *) ((char *) ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) ((char *) ring->cq_ring + params.cq_off.cqes);
+
+    if ( close_pipefd[0] == -1 && close_pipefd[1] == -1 ) {
+        WSS_log_trace("Creating close pipe file descriptors");
+
+        if ( unlikely(pipe(close_pipefd) == -1) ) {
+            WSS_log_trace("Unable to create close pipe file descriptors: %s", strerror(errno));
+            return WSS_POLL_PIPE_ERROR;
+        }
+
+        if ( unlikely((err = WSS_socket_non_blocking(close_pipefd[0])) != WSS_SUCCESS) ) {
+            return err;
+        }
+
+        if ( unlikely((err = WSS_socket_non_blocking(close_pipefd[1])) != WSS_SUCCESS) ) {
+            return err;
+        }
+    }
+
+    WSS_log_trace("Arms close pipe file descriptor to io_uring instance");
+
+    if ( unlikely((err = uring_submit(server, IORING_OP_POLL_ADD, close_pipefd[0], POLLIN,
+                        uring_data(close_pipefd[0], URING_READ), 0, IORING_POLL_ADD_MULTI)) != WSS_SUCCESS) ) {
+        return err;
+    }
+
+    WSS_server_set_max_fd(server, close_pipefd[0]);
+
+    // Without a threadpool the event loop runs the timeouts of its sessions
+    // itself, once woken by the cleanup thread
+    if (server->config->pool_mode != POOL_DISPATCHER) {
+        if ( unlikely((err = rearm_init(server)) != WSS_SUCCESS) ) {
+            return err;
+        }
+
+        WSS_log_trace("Arms rearm file descriptor to io_uring instance");
+
+        if ( unlikely((err = uring_submit(server, IORING_OP_POLL_ADD, server->rearm_fd[0], POLLIN,
+                            uring_data(server->rearm_fd[0], URING_READ), 0, IORING_POLL_ADD_MULTI)) != WSS_SUCCESS) ) {
+            return err;
+        }
+    }
+
+    if ( unlikely((err = interests_init(server)) != WSS_SUCCESS) ) {
+        return err;
+    }
+
+    // Since Linux 6.0 connections are accepted by the ring, and sessions
+    // without TLS have their data received and sent by it, while sessions
+    // with TLS are still polled for readiness
+    ring->accept = uring_probe(fd) && (params.features & IORING_FEAT_CQE_SKIP);
+    if (ring->accept && NULL == server->ssl_ctx) {
+        if ( likely((err = uring_buffers_init(server, ring)) == WSS_SUCCESS) ) {
+            WSS_log_info("Receiving and sending through IO_URING");
+            ring->io = true;
+        } else if ( unlikely(err == WSS_MEMORY_ERROR) ) {
+            WSS_log_fatal("Unable to allocate io_uring buffers");
+            return err;
+        }
+    }
+
+    WSS_log_trace("Arms server file descriptor to io_uring instance");
+
+    if (ring->accept) {
+        err = uring_accept(server, false);
+    } else {
+        err = uring_submit(server, IORING_OP_POLL_ADD, server->fd, POLLIN,
+                uring_data(server->fd, URING_READ), 0, IORING_POLL_ADD_MULTI);
+    }
+
+    if ( unlikely(err != WSS_SUCCESS) ) {
+        return err;
+    }
+
+    WSS_server_set_max_fd(server, server->fd);
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Arms a session for read events of a ring that receives on its behalf. The
+ * receive is only submitted once, after which the session is told to read
+ * when data arrives, or right away if data arrived since it last read.
+ *
+ * @param 	server	    [wss_server_t *]    "A pointer to a server structure"
+ * @param 	fd	        [int]	            "The clients file descriptor"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+static wss_error_t uring_set_read(wss_server_t *server, int fd) {
+    wss_error_t err;
+    wss_session_t *session;
+    unsigned char prev = INTEREST_NONE;
+    atomic_uchar *slot = interest(server, fd);
+
+    if ( likely(NULL != slot) ) {
+        prev = atomic_fetch_or(slot, INTEREST_READ | INTEREST_RECV);
+    }
+
+    if ( unlikely(! (prev & INTEREST_RECV)) ) {
+        WSS_log_trace("Receives data of session %d through io_uring", fd);
+        WSS_server_set_max_fd(server, fd);
+
+        if ( unlikely((err = uring_recv(server, fd)) != WSS_SUCCESS && NULL != slot) ) {
+            atomic_fetch_and(slot, (unsigned char) ~(INTEREST_READ | INTEREST_RECV));
+        }
+
+        return err;
+    }
+
+    if ( prev & INTEREST_READ ) {
+        WSS_log_trace("Session %d is already armed for read io_uring events", fd);
+        return WSS_SUCCESS;
+    }
+
+    // Data received before the interest was recorded was not reported
+    if ( NULL != (session = WSS_session_find(fd)) && WSS_session_readable(session) ) {
+        WSS_log_trace("Session %d has received data meanwhile", fd);
+        return uring_submit(server, IORING_OP_NOP, -1, 0, uring_data(fd, URING_NOTIFY), 0, 0);
+    }
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Handles a completion of the multishot accept, which holds the file
+ * descriptor of a new session.
+ *
+ * @param 	server	    [wss_server_t *]        "A pointer to a server structure"
+ * @param 	cqe	        [struct io_uring_cqe *] "The completion"
+ * @return 			    [wss_error_t]           "The error status"
+ */
+static wss_error_t uring_accepted(wss_server_t *server, struct io_uring_cqe *cqe) {
+    wss_error_t err;
+    bool exhausted = cqe->res == -EMFILE || cqe->res == -ENFILE || cqe->res == -ENOBUFS || cqe->res == -ENOMEM;
+
+    if ( unlikely(cqe->res < 0) ) {
+        if ( unlikely(! exhausted && cqe->res != -ECONNABORTED && cqe->res != -EINTR && cqe->res != -EAGAIN) ) {
+            WSS_log_fatal("A server error occured upon io_uring: %s", strerror(-cqe->res));
+            return WSS_POLL_WAIT_ERROR;
+        }
+
+        WSS_log_error("Accept failed: %s", strerror(-cqe->res));
+    }
+
+    // The accept ends upon errors, or if the kernel cannot post more
+    // completions, and is submitted again
+    if ( unlikely(! (cqe->flags & IORING_CQE_F_MORE)) ) {
+        if ( unlikely((err = uring_accept(server, exhausted)) != WSS_SUCCESS) ) {
+            return err;
+        }
+    }
+
+    if ( unlikely(cqe->res < 0) ) {
+        return WSS_SUCCESS;
+    }
+
+    WSS_log_trace("New session connecting");
+
+    return WSS_thread_args_dispatch(server, cqe->res, CONNECTING);
+}
+
+/**
+ * Handles a completion of the multishot receive of a session. The data is
+ * stored with the session and the buffer given back to the ring right away,
+ * before the session is told to read if it is waiting for data.
+ *
+ * @param 	server	    [wss_server_t *]        "A pointer to a server structure"
+ * @param 	cqe	        [struct io_uring_cqe *] "The completion"
+ * @param 	fd	        [int]                   "The file descriptor of the session"
+ * @param 	slot	    [atomic_uchar *]        "The interest slot of the session or NULL"
+ * @return 			    [wss_error_t]           "The error status"
+ */
+static wss_error_t uring_received(wss_server_t *server, struct io_uring_cqe *cqe, int fd, atomic_uchar *slot) {
+    unsigned short id;
+    bool stored = true;
+    wss_session_t *session;
+    wss_uring_t *ring = (wss_uring_t *) server->events;
+
+    if ( likely(cqe->flags & IORING_CQE_F_BUFFER) ) {
+        id = (unsigned short) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+        if ( likely(cqe->res > 0 && NULL != (session = WSS_session_find(fd))) ) {
+            stored = WSS_session_receive(session, ring->buffer + (size_t) id*ring->buffer_size,
+                    (size_t) cqe->res) == WSS_SUCCESS;
+        }
+
+        uring_buffer(ring, id);
+    }
+
+    if ( unlikely(! stored || (cqe->res <= 0 && cqe->res != -ENOBUFS)) ) {
+        WSS_log_trace("Session %d disconnecting", fd);
+        return WSS_thread_args_dispatch(server, fd, CLOSING);
+    }
+
+    // The receive ends once the ring ran out of buffers, and is submitted
+    // again unless the session was removed meanwhile
+    if ( unlikely(! (cqe->flags & IORING_CQE_F_MORE)) && (NULL == slot || (atomic_load(slot) & INTEREST_RECV)) ) {
+        uring_recv(server, fd);
+    }
+
+    if ( likely(cqe->res > 0) && (NULL == slot ||
+                (atomic_fetch_and(slot, (unsigned char) ~INTEREST_READ) & INTEREST_READ)) ) {
+        WSS_log_trace("Session %d begins to read", fd);
+        return WSS_thread_args_dispatch(server, fd, READING);
+    }
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Handles a completion of the sends of a session, which is only posted by a
+ * send that failed or by the request linked after the last send.
+ *
+ * @param 	server	    [wss_server_t *]        "A pointer to a server structure"
+ * @param 	cqe	        [struct io_uring_cqe *] "The completion"
+ * @param 	fd	        [int]                   "The file descriptor of the session"
+ * @param 	slot	    [atomic_uchar *]        "The interest slot of the session or NULL"
+ * @param 	kind	    [wss_uring_kind_t]      "The kind of the request"
+ * @return 			    [wss_error_t]           "The error status"
+ */
+static wss_error_t uring_sent(wss_server_t *server, struct io_uring_cqe *cqe, int fd, atomic_uchar *slot, wss_uring_kind_t kind) {
+    wss_session_t *session;
+    bool sent = kind == URING_SENT && cqe->res >= 0;
+
+    if ( likely(NULL != slot) ) {
+        atomic_fetch_and(slot, (unsigned char) ~INTEREST_WRITE);
+    }
+
+    if ( likely(NULL != (session = WSS_session_find(fd))) ) {
+        atomic_store(&session->sent, sent ? 1 : -1);
+    }
+
+    if ( unlikely(! sent) ) {
+        WSS_log_trace("Session %d failed to send", fd);
+        return WSS_thread_args_dispatch(server, fd, CLOSING);
+    }
+
+    WSS_log_trace("Session %d begins to write", fd);
+    return WSS_thread_args_dispatch(server, fd, WRITING);
+}
+
+/**
+ * Waits for completions on the ring and hands the events to the threadpool.
+ * Requests queued by the event loop itself are submitted in the same system
+ * call as the wait.
+ *
+ * @param 	server	    [wss_server_t *]    "A pointer to a server structure"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+static wss_error_t uring_delegate(wss_server_t *server) {
+    int n, fd;
+    unsigned int head, tail, submit, flags = IORING_ENTER_GETEVENTS;
+    wss_error_t err;
+    wss_uring_kind_t kind;
+    atomic_uchar *slot;
+    struct io_uring_cqe *cqe;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    wss_uring_t *ring = (wss_uring_t *) server->events;
+
+    memset(&arg, 0, sizeof(arg));
+    if (server->config->timeout_poll >= 0) {
+        ts.tv_sec = server->config->timeout_poll / 1000;
+        ts.tv_nsec = (server->config->timeout_poll % 1000) * 1000000;
+        arg.ts = (uint64_t) (uintptr_t) &ts;
+    }
+    flags |= IORING_ENTER_EXT_ARG;
+
+    pthread_mutex_lock(&ring->lock);
+    submit = ring->pending;
+    ring->pending = 0;
+    pthread_mutex_unlock(&ring->lock);
+
+    if (server->ssl_ctx != NULL) {
+        WSS_log_trace("Listening for HTTPS io_uring events");
+    } else {
+        WSS_log_trace("Listening for HTTP io_uring events");
+    }
+
+    do {
+        errno = 0;
+        n = uring_enter(ring->fd, submit, 1, flags, &arg, sizeof(arg));
+        if ( unlikely(n < 0) ) {
+            if ( likely(errno == ETIME) ) {
+                errno = 0;
+                break;
+            }
+
+            if ( unlikely(errno != EINTR && errno != EAGAIN && errno != EBUSY) ) {
+                return WSS_POLL_WAIT_ERROR;
+            }
+        } else {
+            submit -= (unsigned int) n;
+        }
+    } while ( unlikely(errno == EINTR || errno == EAGAIN || errno == EBUSY) );
+
+    uring_owner = server;
+
+    head = *ring->cq_head;
+    tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    if (server->ssl_ctx != NULL) {
+        WSS_log_trace("Received %d HTTPS events", tail - head);
+    } else {
+        WSS_log_trace("Received %d HTTP events", tail - head);
+    }
+
+    // Sessions are looked up while receiving and sending on their behalf
+    if (ring->io) {
+        WSS_session_enter();
+    }
 
-/******************************************************************************
- *                                   EPOLL                                    *
- ******************************************************************************/
+    for (err = WSS_SUCCESS; head != tail && err == WSS_SUCCESS; head++) {
+        cqe = &ring->cqes[head & *ring->cq_mask];
+        fd = (int) (cqe->user_data >> 8);
+        kind = (wss_uring_kind_t) (cqe->user_data & 0xFF);
 
-#elif defined(WSS_EPOLL)
-static inline wss_error_t WSS_poll_add(int poll_fd, int fd, uint32_t events) {
-    struct epoll_event event;
-    int ret;
+        if ( unlikely(kind == URING_REMOVE || cqe->res == -ECANCELED || cqe->res == -ENOENT) ) {
+            continue;
+        }
 
-    WSS_log_trace("Modifying filedescriptor on epoll eventlist");
+        slot = interest(server, fd);
 
-    do {
-        memset(&event, 0, sizeof(event));
+        if ( likely(kind == URING_RECV) ) {
+            err = uring_received(server, cqe, fd, slot);
+            continue;
+        } else if ( likely(kind == URING_SENT || kind == URING_SEND) ) {
+            err = uring_sent(server, cqe, fd, slot, kind);
+            continue;
+        } else if ( unlikely(kind == URING_NOTIFY) ) {
+            if ( NULL == slot || (atomic_fetch_and(slot, (unsigned char) ~INTEREST_READ) & INTEREST_READ) ) {
+                WSS_log_trace("Session %d begins to read", fd);
+                err = WSS_thread_args_dispatch(server, fd, READING);
+            }
+            continue;
+        } else if ( unlikely(kind == URING_CONNECT) ) {
+            err = uring_accepted(server, cqe);
+            continue;
+        }
 
-        event.events = events;
-        event.data.fd = fd;
+        // The poll of a session is consumed by its completion
+        if ( likely(fd != server->fd && fd != close_pipefd[0] && fd != server->rearm_fd[0] && NULL != slot) ) {
+            atomic_fetch_and(slot, (unsigned char) ~kind);
+        }
 
-        if ( unlikely((ret = epoll_ctl(poll_fd, EPOLL_CTL_MOD, fd, &event)) < 0) ) {
-            if ( likely(errno == ENOENT) ) {
-                WSS_log_trace("Adding file descriptor to epoll eventlist");
-                errno = 0;
+        if ( unlikely(fd == server->fd) ) {
+            if ( unlikely(cqe->res < 0 || (cqe->res & (POLLHUP | POLLERR))) ) {
+                WSS_log_fatal("A server error occured upon io_uring");
+                err = WSS_POLL_WAIT_ERROR;
+                break;
+            }
 
-                memset(&event, 0, sizeof(event));
+            WSS_log_trace("New session connecting");
 
-                event.events = events;
-                event.data.fd = fd;
+            if ( unlikely(kind != URING_ACCEPT && ! (cqe->flags & IORING_CQE_F_MORE)) ) {
+                uring_submit(server, IORING_OP_POLL_ADD, server->fd, POLLIN,
+                        uring_data(server->fd, URING_READ), 0, IORING_POLL_ADD_MULTI);
+            }
 
-                ret = epoll_ctl(poll_fd, EPOLL_CTL_ADD, fd, &event);
+            err = WSS_thread_args_dispatch(server, -1, CONNECTING);
+        } else if ( unlikely(fd == close_pipefd[0]) ) {
+            // Pipe file descriptor is used to interrupt blocking wait
+            continue;
+        } else if ( unlikely(fd == server->rearm_fd[0]) ) {
+            if ( unlikely(! (cqe->flags & IORING_CQE_F_MORE)) ) {
+                uring_submit(server, IORING_OP_POLL_ADD, server->rearm_fd[0], POLLIN,
+                        uring_data(server->rearm_fd[0], URING_READ), 0, IORING_POLL_ADD_MULTI);
             }
+
+            handle_rearm(server);
+            handle_timeouts(server);
+        } else if ( unlikely(cqe->res < 0 || (cqe->res & (POLLHUP | POLLERR | POLLRDHUP))) ) {
+            WSS_log_trace("Session %d disconnecting", fd);
+            err = WSS_thread_args_dispatch(server, fd, CLOSING);
+        } else if (kind == URING_READ) {
+            WSS_log_trace("Session %d begins to read", fd);
+            err = WSS_thread_args_dispatch(server, fd, READING);
+        } else {
+            WSS_log_trace("Session %d begins to write", fd);
+            err = WSS_thread_args_dispatch(server, fd, WRITING);
         }
-    } while ( unlikely(errno == EINTR) );
+    }
 
-    if ( unlikely(ret < 0) ) {
-        WSS_log_error("Failed to (re)arm file descriptor to epoll: %s", strerror(errno));
-        return WSS_POLL_SET_ERROR;
+    // Only the completions that were handled are consumed
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    if (ring->io) {
+        WSS_session_leave();
     }
 
-    return WSS_SUCCESS;
+    // All jobs of the wait are handed to the threadpool at once
+    if ( likely(err == WSS_SUCCESS) ) {
+        err = WSS_thread_args_flush(server);
+    } else {
+        WSS_thread_args_flush(server);
+    }
+
+    uring_owner = NULL;
+
+    // Submit the requests made while handling the events, if the event loop
+    // performed the work itself
+    pthread_mutex_lock(&ring->lock);
+    ring->pending += submit;
+    pthread_mutex_unlock(&ring->lock);
+
+    return err;
 }
 
+#endif
+
 /**
  * Function that creates poll instance and adding the filedescriptor of the
  * servers socket to it.
@@ -552,9 +1758,21 @@ static inline wss_error_t WSS_poll_add(int poll_fd, int fd, uint32_t events) {
  * @return 			    [wss_error_t]       "The error status"
  */
 wss_error_t WSS_poll_init(wss_server_t *server) {
+    uint32_t flags;
     wss_error_t err;
     struct epoll_event event;
 
+#if defined(WSS_IOURING)
+    if (server->config->pool_backend == POOL_IOURING) {
+        if ( likely((err = uring_init(server)) != WSS_POLL_CREATE_ERROR || NULL != server->events) ) {
+            return err;
+        }
+
+        WSS_log_warn("Falling back to epoll");
+        server->config->pool_backend = POOL_EPOLL;
+    }
+#endif
+
     memset(&event, 0, sizeof(event));
 
     WSS_log_info("Using EPOLL");
@@ -597,36 +1815,57 @@ wss_error_t WSS_poll_init(wss_server_t *server) {
 
     WSS_log_trace("Arms close pipe file descriptor to epoll instance");
 
-    if ( unlikely((err = WSS_poll_add(server->poll_fd, close_pipefd[0], EPOLLIN | EPOLLET | EPOLLRDHUP)) != WSS_SUCCESS) ) {
+    // In leader/follower mode the close pipe is level-triggered, such that
+    // every thread waiting on the epoll instance is woken
+    if (server->config->pool_mode == POOL_LEADER) {
+        flags = EPOLLIN | EPOLLRDHUP;
+    } else {
+        flags = EPOLLIN | EPOLLET | EPOLLRDHUP;
+    }
+
+    if ( unlikely((err = WSS_poll_add(server->poll_fd, close_pipefd[0], flags)) != WSS_SUCCESS) ) {
         return err;
     }
 
     WSS_server_set_max_fd(server, close_pipefd[0]);
 
-    WSS_log_trace("Creating arm pipe file descriptors");
+    // Without a threadpool the event loop runs the timeouts of its sessions
+    // itself, once woken by the cleanup thread
+    if (server->config->pool_mode != POOL_DISPATCHER) {
+        if ( unlikely((err = rearm_init(server)) != WSS_SUCCESS) ) {
+            return err;
+        }
 
-    if ( unlikely(pipe(server->rearm_pipefd) == -1) ) {
-        WSS_log_trace("Unable to create arm pipe file descriptors: %s", strerror(errno));
-        return WSS_POLL_PIPE_ERROR;
-    }
+        WSS_log_trace("Arms rearm file descriptor to epoll instance");
 
-    if ( unlikely((err = WSS_socket_non_blocking(server->rearm_pipefd[0])) != WSS_SUCCESS ) ) {
-        return err;
+        if ( unlikely((err = WSS_poll_add(server->poll_fd, server->rearm_fd[0], EPOLLIN | EPOLLET)) != WSS_SUCCESS) ) {
+            return err;
+        }
     }
 
-    if ( unlikely((err = WSS_socket_non_blocking(server->rearm_pipefd[1])) != WSS_SUCCESS ) ) {
+    if ( unlikely((err = interests_init(server)) != WSS_SUCCESS) ) {
         return err;
     }
 
-    WSS_log_trace("Arms arm pipe file descriptor to poll instance");
+    WSS_log_trace("Arms server file descriptor to epoll instance");
 
-    if ( unlikely((err = WSS_poll_add(server->poll_fd, server->rearm_pipefd[0], EPOLLIN | EPOLLET | EPOLLRDHUP)) != WSS_SUCCESS) ) {
-        return err;
-    }
+#if defined(EPOLLEXCLUSIVE)
+    // In leader/follower mode only one of the waiting threads is woken for
+    // new sessions. Exclusive wakeups can only be requested when adding
+    if (server->config->pool_mode == POOL_LEADER) {
+        event.events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
+        event.data.fd = server->fd;
 
-    WSS_server_set_max_fd(server, server->rearm_pipefd[0]);
+        if ( unlikely(epoll_ctl(server->poll_fd, EPOLL_CTL_ADD, server->fd, &event) < 0) ) {
+            WSS_log_error("Failed to arm server file descriptor to epoll: %s", strerror(errno));
+            return WSS_POLL_SET_ERROR;
+        }
 
-    WSS_log_trace("Arms server file descriptor to epoll instance");
+        WSS_server_set_max_fd(server, server->fd);
+
+        return WSS_SUCCESS;
+    }
+#endif
 
     if ( unlikely((err = WSS_poll_add(server->poll_fd, server->fd, EPOLLIN | EPOLLET | EPOLLRDHUP)) != WSS_SUCCESS) ) {
         return err;
@@ -647,10 +1886,44 @@ wss_error_t WSS_poll_init(wss_server_t *server) {
  */
 wss_error_t WSS_poll_set_write(wss_server_t *server, int fd) {
     wss_error_t err;
+    atomic_uchar *slot;
+
+#if defined(WSS_IOURING)
+    if (server->config->pool_backend == POOL_IOURING) {
+        if ( likely(NULL != (slot = interest(server, fd))) ) {
+            if ( atomic_fetch_or(slot, INTEREST_WRITE) & INTEREST_WRITE ) {
+                WSS_log_trace("Session %d is already armed for write io_uring events", fd);
+                return WSS_SUCCESS;
+            }
+        }
+
+        WSS_log_trace("Rearms session %d for write io_uring events", fd);
+        WSS_server_set_max_fd(server, fd);
+
+        if ( unlikely((err = uring_submit(server, IORING_OP_POLL_ADD, fd, POLLOUT,
+                            uring_data(fd, URING_WRITE), 0, 0)) != WSS_SUCCESS && NULL != slot) ) {
+            atomic_fetch_and(slot, (unsigned char) ~INTEREST_WRITE);
+        }
+
+        return err;
+    }
+#endif
+
+    // The interest is recorded before the file descriptor is armed, such that
+    // the event loop clearing it upon delivery always happens afterwards
+    if ( likely(NULL != (slot = interest(server, fd))) ) {
+        if ( atomic_exchange(slot, INTEREST_WRITE) == INTEREST_WRITE ) {
+            WSS_log_trace("Session %d is already armed for write epoll events", fd);
+            return WSS_SUCCESS;
+        }
+    }
 
     WSS_log_trace("Rearms session %d for write epoll events", fd);
 
     if ( unlikely((err = WSS_poll_add(server->poll_fd, fd, EPOLLOUT | EPOLLET | EPOLLONESHOT)) != WSS_SUCCESS) ) {
+        if ( likely(NULL != slot) ) {
+            atomic_store(slot, INTEREST_NONE);
+        }
         return err;
     }
 
@@ -669,10 +1942,46 @@ wss_error_t WSS_poll_set_write(wss_server_t *server, int fd) {
  */
 wss_error_t WSS_poll_set_read(wss_server_t *server, int fd) {
     wss_error_t err;
+    atomic_uchar *slot;
+
+#if defined(WSS_IOURING)
+    if (server->config->pool_backend == POOL_IOURING) {
+        if ( likely(((wss_uring_t *) server->events)->io) ) {
+            return uring_set_read(server, fd);
+        }
+
+        if ( likely(NULL != (slot = interest(server, fd))) ) {
+            if ( atomic_fetch_or(slot, INTEREST_READ) & INTEREST_READ ) {
+                WSS_log_trace("Session %d is already armed for read io_uring events", fd);
+                return WSS_SUCCESS;
+            }
+        }
+
+        WSS_log_trace("Rearms session %d for read io_uring events", fd);
+        WSS_server_set_max_fd(server, fd);
+
+        if ( unlikely((err = uring_submit(server, IORING_OP_POLL_ADD, fd, POLLIN | POLLRDHUP,
+                            uring_data(fd, URING_READ), 0, 0)) != WSS_SUCCESS && NULL != slot) ) {
+            atomic_fetch_and(slot, (unsigned char) ~INTEREST_READ);
+        }
+
+        return err;
+    }
+#endif
+
+    if ( likely(NULL != (slot = interest(server, fd))) ) {
+        if ( atomic_exchange(slot, INTEREST_READ) == INTEREST_READ ) {
+            WSS_log_trace("Session %d is already armed for read epoll events", fd);
+            return WSS_SUCCESS;
+        }
+    }
 
     WSS_log_trace("Rearms session %d for read epoll events", fd);
 
     if ( unlikely((err = WSS_poll_add(server->poll_fd, fd, EPOLLIN | EPOLLET | EPOLLONESHOT | EPOLLRDHUP)) != WSS_SUCCESS) ) {
+        if ( likely(NULL != slot) ) {
+            atomic_store(slot, INTEREST_NONE);
+        }
         return err;
     }
 
@@ -690,8 +1999,56 @@ wss_error_t WSS_poll_set_read(wss_server_t *server, int fd) {
  */
 wss_error_t WSS_poll_remove(wss_server_t *server, int fd) {
     struct epoll_event event;
+    atomic_uchar *slot;
     int ret;
 
+    if ( likely(NULL != (slot = interest(server, fd))) ) {
+        atomic_store(slot, INTEREST_NONE);
+    }
+
+#if defined(WSS_IOURING)
+    if (server->config->pool_backend == POOL_IOURING) {
+        wss_error_t err;
+
+        WSS_log_trace("Removing session %d from io_uring events", fd);
+
+        // The receive, sends and polls of the session are cancelled at once,
+        // and right away such that it happens before the session is closed
+        if ( likely(((wss_uring_t *) server->events)->io) ) {
+            wss_uring_t *ring = (wss_uring_t *) server->events;
+            struct io_uring_sqe *sqe;
+
+            if ( unlikely(uring_lock(ring, 1) != WSS_SUCCESS) ) {
+                return WSS_POLL_REMOVE_ERROR;
+            }
+
+            sqe = uring_sqe(ring);
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = fd;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+            sqe->user_data = uring_data(fd, URING_REMOVE);
+
+            if ( unlikely(uring_unlock(server, ring, true) != WSS_SUCCESS) ) {
+                return WSS_POLL_REMOVE_ERROR;
+            }
+
+            return WSS_SUCCESS;
+        }
+
+        if ( unlikely((err = uring_submit(server, IORING_OP_POLL_REMOVE, -1, 0,
+                            uring_data(fd, URING_REMOVE), uring_data(fd, URING_READ), 0)) != WSS_SUCCESS) ) {
+            return WSS_POLL_REMOVE_ERROR;
+        }
+
+        if ( unlikely((err = uring_submit(server, IORING_OP_POLL_REMOVE, -1, 0,
+                            uring_data(fd, URING_REMOVE), uring_data(fd, URING_WRITE), 0)) != WSS_SUCCESS) ) {
+            return WSS_POLL_REMOVE_ERROR;
+        }
+
+        return WSS_SUCCESS;
+    }
+#endif
+
     WSS_log_trace("Removing session %d from epoll events", fd);
 
     do {
@@ -711,6 +2068,124 @@ wss_error_t WSS_poll_remove(wss_server_t *server, int fd) {
     return WSS_SUCCESS;
 }
 
+/**
+ * Function that rearms the poll instance for the servers file descriptor, such
+ * that sessions left in the backlog once the accept budget is spent are
+ * reported by a later event.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_set_accept(wss_server_t *server) {
+#if defined(WSS_IOURING)
+    // A single-shot poll is submitted next to the multishot one, which only
+    // reports new connections. A multishot accept takes every connection.
+    if (server->config->pool_backend == POOL_IOURING) {
+        if ( likely(((wss_uring_t *) server->events)->accept) ) {
+            return WSS_SUCCESS;
+        }
+
+        return uring_submit(server, IORING_OP_POLL_ADD, server->fd, POLLIN,
+                uring_data(server->fd, URING_ACCEPT), 0, 0);
+    }
+#endif
+
+    // File descriptors added with EPOLLEXCLUSIVE cannot be modified, hence
+    // threads in leader/follower mode drain the backlog instead
+    if (server->config->pool_mode == POOL_LEADER) {
+        return WSS_SUCCESS;
+    }
+
+    // Modifying an edge-triggered file descriptor reports it again, if it is
+    // still readable
+    return WSS_poll_add(server->poll_fd, server->fd, EPOLLIN | EPOLLET | EPOLLRDHUP);
+}
+
+/**
+ * Function that checks whether the poll instance receives and sends the data
+ * of sessions itself, which is done by io_uring for sessions without TLS.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @return 			    [bool]              "Whether data is received and sent by the poll instance"
+ */
+bool WSS_poll_io(wss_server_t *server) {
+#if defined(WSS_IOURING)
+    if (server->config->pool_backend == POOL_IOURING) {
+        return ((wss_uring_t *) server->events)->io;
+    }
+#endif
+
+    (void) server;
+
+    return false;
+}
+
+/**
+ * Function that lets the poll instance send data to a session once it is
+ * writable, which reports a write event once everything was sent or a close
+ * event if sending failed. The data must be kept until either is reported.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @param 	fd	        [int]	            "The clients file descriptor"
+ * @param 	iov	        [struct iovec *]	"The segments of data to send"
+ * @param 	count	    [size_t]	        "The amount of segments"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_send(wss_server_t *server, int fd, struct iovec *iov, size_t count) {
+#if defined(WSS_IOURING)
+    size_t i;
+    wss_error_t err;
+    atomic_uchar *slot;
+    struct io_uring_sqe *sqe;
+    wss_uring_t *ring = (wss_uring_t *) server->events;
+
+    if ( likely(server->config->pool_backend == POOL_IOURING && ring->io) ) {
+        WSS_log_trace("Sends %zu segments to session %d through io_uring", count, fd);
+
+        if ( likely(NULL != (slot = interest(server, fd))) ) {
+            atomic_fetch_or(slot, INTEREST_WRITE);
+        }
+
+        if ( unlikely((err = uring_lock(ring, (unsigned int) count+1)) != WSS_SUCCESS) ) {
+            if ( likely(NULL != slot) ) {
+                atomic_fetch_and(slot, (unsigned char) ~INTEREST_WRITE);
+            }
+            return err;
+        }
+
+        // The sends are linked, such that they are performed in order and the
+        // sends after one that failed are cancelled
+        for (i = 0; likely(i < count); i++) {
+            sqe = uring_sqe(ring);
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = fd;
+            sqe->addr = (uint64_t) (uintptr_t) iov[i].iov_base;
+            sqe->len = (uint32_t) iov[i].iov_len;
+            sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+            sqe->flags = IOSQE_IO_LINK | IOSQE_CQE_SKIP_SUCCESS;
+            sqe->user_data = uring_data(fd, URING_SEND);
+        }
+
+        // Only completes once every send succeeded
+        sqe = uring_sqe(ring);
+        sqe->opcode = IORING_OP_NOP;
+        sqe->fd = -1;
+        sqe->user_data = uring_data(fd, URING_SENT);
+
+        WSS_server_set_max_fd(server, fd);
+
+        return uring_unlock(server, ring, false);
+    }
+#endif
+
+    (void) server;
+    (void) fd;
+    (void) iov;
+    (void) count;
+
+    return WSS_POLL_SET_ERROR;
+}
+
 /**
  * Function that listens for new events on the servers file descriptor 
  *
@@ -720,7 +2195,16 @@ wss_error_t WSS_poll_remove(wss_server_t *server, int fd) {
 wss_error_t WSS_poll_delegate(wss_server_t *server) {
     int i, n;
     wss_error_t err;
+    atomic_uchar *slot;
+    struct epoll_event leader;
     struct epoll_event *events = server->events;
+    int max = (int) server->config->pool_workers;
+
+#if defined(WSS_IOURING)
+    if (server->config->pool_backend == POOL_IOURING) {
+        return uring_delegate(server);
+    }
+#endif
 
     if (server->ssl_ctx != NULL) {
         WSS_log_trace("Listening for HTTPS epoll events");
@@ -728,9 +2212,16 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
         WSS_log_trace("Listening for HTTP epoll events");
     }
 
+    // In leader/follower mode every thread waits on the epoll instance and
+    // takes a single event, such that the next event goes to another thread
+    if (server->config->pool_mode == POOL_LEADER) {
+        events = &leader;
+        max = 1;
+    }
+
     do {
         errno = 0;
-        n = epoll_wait(server->poll_fd, events, server->config->pool_workers, server->config->timeout_poll);
+        n = epoll_wait(server->poll_fd, events, max, server->config->timeout_poll);
         if ( unlikely(n < 0) ) {
             if ( unlikely(errno != EINTR) ) {
                 return WSS_POLL_WAIT_ERROR;
@@ -745,54 +2236,46 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
     }
 
     for (i = 0; i < n; i++) {
+        // One-shot file descriptors are disarmed once their event is reported
+        if ( likely(events[i].data.fd != server->fd && events[i].data.fd != close_pipefd[0] &&
+                    events[i].data.fd != server->rearm_fd[0] &&
+                    NULL != (slot = interest(server, events[i].data.fd))) ) {
+            atomic_store(slot, INTEREST_NONE);
+        }
+
         if ( unlikely((events[i].events & EPOLLHUP) ||
                     (events[i].events & EPOLLERR) ||
                     (events[i].events & EPOLLRDHUP)) ) {
             if ( unlikely(events[i].data.fd == server->fd) ) {
                 WSS_log_fatal("A server error occured upon epoll");
+                WSS_thread_args_flush(server);
                 return WSS_POLL_WAIT_ERROR;
             }
 
             WSS_log_trace("Session %d disconnecting", events[i].data.fd);
 
-            wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-            if ( unlikely(NULL == args) ) {
-                WSS_log_fatal("Failed allocating threadpool argument");
-                return WSS_MEMORY_ERROR;
-            }
-            args->server = server;
-            args->fd = events[i].data.fd;
-            args->state = CLOSING;
-
-            if ( unlikely((err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)) != WSS_SUCCESS) ) {
+            if ( unlikely((err = WSS_thread_args_dispatch(server, events[i].data.fd, CLOSING)) != WSS_SUCCESS) ) {
                 WSS_log_fatal("Failed adding disconnect job to worker pool");
-                WSS_free((void **)&args);
+                WSS_thread_args_flush(server);
                 return err;
             }
         } else if ( events[i].data.fd == server->fd ) {
             WSS_log_trace("New session connecting");
 
-            wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-            if ( unlikely(NULL == args) ) {
-                WSS_log_fatal("Failed allocating threadpool argument");
-                return WSS_MEMORY_ERROR;
-            }
-            args->server = server;
-            args->state = CONNECTING;
-
             /**
              * If new session has connected
              */
-            if ( unlikely((err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)) != WSS_SUCCESS) ) {
+            if ( unlikely((err = WSS_thread_args_dispatch(server, -1, CONNECTING)) != WSS_SUCCESS) ) {
                 WSS_log_fatal("Failed adding connect job to worker pool");
+                WSS_thread_args_flush(server);
                 return err;
             }
         } else if ( unlikely(events[i].data.fd == close_pipefd[0]) ) {
             // Pipe file descriptor is used to interrupt blocking wait
             continue;
-        } else if ( likely(events[i].data.fd == server->rearm_pipefd[0]) ) {
+        } else if ( unlikely(events[i].data.fd == server->rearm_fd[0]) ) {
             handle_rearm(server);
-            continue;
+            handle_timeouts(server);
         } else {
             if ( events[i].events & EPOLLIN ) {
                 WSS_log_trace("Session %d begins to read", events[i].data.fd);
@@ -800,18 +2283,9 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
                 /**
                  * If new reads are ready
                  */
-                wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-                if ( unlikely(NULL == args) ) {
-                    WSS_log_fatal("Failed allocating threadpool argument");
-                    return WSS_MEMORY_ERROR;
-                }
-                args->server = server;
-                args->fd = events[i].data.fd;
-                args->state = READING;
-
-                if ( unlikely((err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)) != WSS_SUCCESS) ) {
+                if ( unlikely((err = WSS_thread_args_dispatch(server, events[i].data.fd, READING)) != WSS_SUCCESS) ) {
                     WSS_log_fatal("Failed adding read job to worker pool");
-                    WSS_free((void **)&args);
+                    WSS_thread_args_flush(server);
                     return err;
                 }
             }
@@ -822,25 +2296,17 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
                 /**
                  * If new writes are ready
                  */
-                wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-                if ( unlikely(NULL == args) ) {
-                    WSS_log_fatal("Failed allocating threadpool argument");
-                    return WSS_MEMORY_ERROR;
-                }
-                args->server = server;
-                args->fd = events[i].data.fd;
-                args->state = WRITING;
-
-                if ( unlikely((err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)) != WSS_SUCCESS) ) {
+                if ( unlikely((err = WSS_thread_args_dispatch(server, events[i].data.fd, WRITING)) != WSS_SUCCESS) ) {
                     WSS_log_fatal("Failed adding write job to worker pool");
-                    WSS_free((void **)&args);
+                    WSS_thread_args_flush(server);
                     return err;
                 }
             }
         }
     }
     
-    return WSS_SUCCESS;
+    // All jobs of the wait are handed to the threadpool at once
+    return WSS_thread_args_flush(server);
 }
 
 /******************************************************************************
@@ -908,24 +2374,13 @@ wss_error_t WSS_poll_init(wss_server_t *server) {
         return err;
     }
 
-    WSS_log_trace("Creating arm pipe file descriptors");
-
-    if ( unlikely(pipe(server->rearm_pipefd) == -1) ) {
-        WSS_log_trace("Unable to create arm pipe file descriptors: %s", strerror(errno));
-        return WSS_POLL_PIPE_ERROR;
-    }
-
-    if ( unlikely((err = WSS_socket_non_blocking(server->rearm_pipefd[0])) != WSS_SUCCESS) ) {
-        return err;
-    }
-
-    if ( unlikely((err = WSS_socket_non_blocking(server->rearm_pipefd[1])) != WSS_SUCCESS) ) {
+    if ( unlikely((err = rearm_init(server)) != WSS_SUCCESS) ) {
         return err;
     }
 
-    WSS_log_trace("Arms arm pipe file descriptor to poll instance");
+    WSS_log_trace("Arms rearm file descriptor to poll instance");
 
-    if ( unlikely((err = WSS_poll_set_read(server, server->rearm_pipefd[0])) != WSS_SUCCESS)) {
+    if ( unlikely((err = WSS_poll_set_read(server, server->rearm_fd[0])) != WSS_SUCCESS)) {
         return err;
     }
 
@@ -950,6 +2405,11 @@ wss_error_t WSS_poll_set_write(wss_server_t *server, int fd) {
         return WSS_POLL_SET_ERROR;
     }
 
+    if ( events[fd].fd == fd && events[fd].events == (POLLOUT) ) {
+        WSS_log_trace("Session %d is already armed for write events on poll", fd);
+        return WSS_SUCCESS;
+    }
+
     WSS_log_trace("Session %d (re)armed for write events on poll", fd);
 
     WSS_server_set_max_fd(server, fd);
@@ -957,7 +2417,7 @@ wss_error_t WSS_poll_set_write(wss_server_t *server, int fd) {
     events[fd].fd = fd;
     events[fd].events = POLLOUT;
 
-    if (fd != server->rearm_pipefd[0] && fd != close_pipefd[0] && fd != server->fd) {
+    if (fd != server->rearm_fd[0] && fd != close_pipefd[0] && fd != server->fd) {
         rearm(server);
     }
 
@@ -979,6 +2439,11 @@ wss_error_t WSS_poll_set_read(wss_server_t *server, int fd) {
         return WSS_POLL_SET_ERROR;
     }
 
+    if ( events[fd].fd == fd && events[fd].events == (POLLPRI | POLLIN | POLLRDHUP) ) {
+        WSS_log_trace("Session %d is already armed for read events on poll", fd);
+        return WSS_SUCCESS;
+    }
+
     WSS_log_trace("Session %d (re)armed for read events on poll", fd);
 
     WSS_server_set_max_fd(server, fd);
@@ -986,7 +2451,7 @@ wss_error_t WSS_poll_set_read(wss_server_t *server, int fd) {
     events[fd].fd = fd;
     events[fd].events = POLLPRI | POLLIN | POLLRDHUP;
 
-    if (fd != server->rearm_pipefd[0] && fd != close_pipefd[0] && fd != server->fd) {
+    if (fd != server->rearm_fd[0] && fd != close_pipefd[0] && fd != server->fd) {
         rearm(server);
     }
 
@@ -1012,13 +2477,61 @@ wss_error_t WSS_poll_remove(wss_server_t *server, int fd) {
     events[fd].fd = -1;
     events[fd].events = 0;
 
-    if (fd != server->rearm_pipefd[0] && fd != close_pipefd[0] && fd != server->fd) {
+    if (fd != server->rearm_fd[0] && fd != close_pipefd[0] && fd != server->fd) {
         rearm(server);
     }
 
     return WSS_SUCCESS;
 }
 
+/**
+ * Function that rearms the poll instance for the servers file descriptor, such
+ * that sessions left in the backlog once the accept budget is spent are
+ * reported by a later event.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_set_accept(wss_server_t *server) {
+    // The servers file descriptor is level-triggered
+    (void) server;
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Function that checks whether the poll instance receives and sends the data
+ * of sessions itself, which is done by io_uring for sessions without TLS.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @return 			    [bool]              "Whether data is received and sent by the poll instance"
+ */
+bool WSS_poll_io(wss_server_t *server) {
+    (void) server;
+
+    return false;
+}
+
+/**
+ * Function that lets the poll instance send data to a session once it is
+ * writable, which reports a write event once everything was sent or a close
+ * event if sending failed. The data must be kept until either is reported.
+ *
+ * @param 	server	    [wss_server_t *]	"A pointer to a server structure"
+ * @param 	fd	        [int]	            "The clients file descriptor"
+ * @param 	iov	        [struct iovec *]	"The segments of data to send"
+ * @param 	count	    [size_t]	        "The amount of segments"
+ * @return 			    [wss_error_t]       "The error status"
+ */
+wss_error_t WSS_poll_send(wss_server_t *server, int fd, struct iovec *iov, size_t count) {
+    (void) server;
+    (void) fd;
+    (void) iov;
+    (void) count;
+
+    return WSS_POLL_SET_ERROR;
+}
+
 /**
  * Function that listens for new events on the servers file descriptor 
  *
@@ -1075,6 +2588,7 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
             if ( unlikely(events[i].revents & (POLLHUP | POLLERR | POLLRDHUP | POLLNVAL)) ) {
                 if ( unlikely(fd == server->fd) ) {
                     WSS_log_fatal("A server error occured upon poll");
+                    WSS_thread_args_flush(server);
                     return WSS_POLL_WAIT_ERROR;
                 }
 
@@ -1082,42 +2596,27 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
 
                 WSS_log_trace("Session %d is disconnecting", fd);
 
-                wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-                if ( unlikely(NULL == args) ) {
-                    WSS_log_fatal("Failed allocating threadpool argument");
-                    return WSS_MEMORY_ERROR;
-                }
-                args->server = server;
-                args->fd = fd;
-                args->state = CLOSING;
-
-                if ( unlikely((err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)) != WSS_SUCCESS) ) {
+                if ( unlikely((err = WSS_thread_args_dispatch(server, fd, CLOSING)) != WSS_SUCCESS) ) {
                     WSS_log_fatal("Failed adding disconnect job to worker pool");
-                    WSS_free((void **)&args);
+                    WSS_thread_args_flush(server);
                     return err;
                 }
             } else if (fd == server->fd) {
                 WSS_log_trace("New session connecting");
 
-                wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-                if ( unlikely(NULL == args) ) {
-                    WSS_log_fatal("Failed allocating threadpool argument");
-                    return WSS_MEMORY_ERROR;
-                }
-                args->server = server;
-                args->state = CONNECTING;
-
                 /**
                  * If new session has connected
                  */
-                if ( unlikely((err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)) != WSS_SUCCESS) ) {
+                if ( unlikely((err = WSS_thread_args_dispatch(server, -1, CONNECTING)) != WSS_SUCCESS) ) {
                     WSS_log_fatal("Failed adding connect job to worker pool");
+                    WSS_thread_args_flush(server);
                     return err;
                 }
             } else if ( unlikely(fd == close_pipefd[0]) ) {
                 continue;
-            } else if ( likely(fd == server->rearm_pipefd[0]) ) {
+            } else if ( likely(fd == server->rearm_fd[0]) ) {
                 handle_rearm(server);
+                handle_timeouts(server);
                 continue;
             } else {
                 WSS_poll_remove(server, fd);
@@ -1128,18 +2627,9 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
                     /**
                      * If new reads are ready
                      */
-                    wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-                    if ( unlikely(NULL == args) ) {
-                        WSS_log_fatal("Failed allocating threadpool argument");
-                        return WSS_MEMORY_ERROR;
-                    }
-                    args->server = server;
-                    args->fd = fd;
-                    args->state = READING;
-
-                    if ( unlikely((err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)) != WSS_SUCCESS) ) {
+                    if ( unlikely((err = WSS_thread_args_dispatch(server, fd, READING)) != WSS_SUCCESS) ) {
                         WSS_log_fatal("Failed adding read job to worker pool");
-                        WSS_free((void **)&args);
+                        WSS_thread_args_flush(server);
                         return err;
                     }
                 }
@@ -1150,18 +2640,9 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
                     /**
                      * If new writes are ready
                      */
-                    wss_thread_args_t *args = (wss_thread_args_t *) WSS_malloc(sizeof(wss_thread_args_t));
-                    if ( unlikely(NULL == args) ) {
-                        WSS_log_fatal("Failed allocating threadpool argument");
-                        return WSS_MEMORY_ERROR;
-                    }
-                    args->server = server;
-                    args->fd = fd;
-                    args->state = WRITING;
-
-                    if ( unlikely((err = WSS_add_to_threadpool(server, &WSS_work, (void *)args)) != WSS_SUCCESS) ) {
+                    if ( unlikely((err = WSS_thread_args_dispatch(server, fd, WRITING)) != WSS_SUCCESS) ) {
                         WSS_log_fatal("Failed adding write job to worker pool");
-                        WSS_free((void **)&args);
+                        WSS_thread_args_flush(server);
                         return err;
                     }
                 }
@@ -1169,7 +2650,8 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
         }
     }
 
-    return WSS_SUCCESS;
+    // All jobs of the wait are handed to the threadpool at once
+    return WSS_thread_args_flush(server);
 }
 #endif
 
@@ -1180,16 +2662,28 @@ wss_error_t WSS_poll_delegate(wss_server_t *server) {
  * @return 			    [wss_error_t]       "The error status"
  */
 wss_error_t WSS_poll_close(wss_server_t *server) {
-    if ( likely(server->rearm_pipefd[0] != -1) ) {
-        close(server->rearm_pipefd[0]);
-        server->rearm_pipefd[0] = -1;
+    unsigned int i;
+
+#if defined(WSS_IOURING)
+    if (server->config->pool_backend == POOL_IOURING) {
+        for (i = 1; i < server->loops_length; i++) {
+            if ( likely(NULL != server->loops[i]->events) ) {
+                uring_free((wss_uring_t *) server->loops[i]->events);
+            }
+        }
+
+        if ( likely(NULL != server->events) ) {
+            uring_free((wss_uring_t *) server->events);
+        }
     }
+#endif
 
-    if ( likely(server->rearm_pipefd[1] != -1) ) {
-        close(server->rearm_pipefd[1]);
-        server->rearm_pipefd[1] = -1;
+    for (i = 1; i < server->loops_length; i++) {
+        rearm_close(server->loops[i]);
     }
 
+    rearm_close(server);
+
     if ( likely(close_pipefd[0] != -1) ) {
         close(close_pipefd[0]);
         close_pipefd[0] = -1;
@@ -5,6 +5,7 @@
 #include "extensions.h"
 #include "uthash.h"
 #include "alloc.h"
+#include "arena.h"
 #include "log.h"
 #include "predict.h"
 
@@ -152,7 +153,10 @@ void WSS_load_extensions(wss_config_t *config)
 
         WSS_log_trace("Setting custom allocators for extension %s", proto->name);
 
-        proto->alloc(WSS_malloc, WSS_realloc_normal, WSS_free_normal);
+        // Frames handed to the extension may be allocated from the arena of
+        // the thread, hence they must be re-allocated and freed through it
+
+        proto->alloc(WSS_malloc, WSS_arena_realloc, WSS_arena_free_normal);
 
         WSS_log_trace("Initializing extension %s", proto->name);
 
@@ -11,6 +11,7 @@
 #include "frame.h"
 #include "str.h"
 #include "alloc.h"
+#include "arena.h"
 #include "log.h"
 #include "predict.h"
 
@@ -102,13 +103,12 @@ static inline uint16_t htons16(uint16_t value) {
 	}
 }
 
-static void unmask(wss_frame_t *frame) {
-    char *applicationData = frame->payload+frame->extensionDataLength;
+static void unmask(char *applicationData, uint64_t length, char *key) {
     uint64_t i = 0;
 #if defined(__AVX512F__)
     __m512i masked_data;
     uint32_t mask;
-    memcpy(&mask, frame->maskingKey, sizeof(uint32_t));
+    memcpy(&mask, key, sizeof(uint32_t));
     __m512i maskingKey = _mm512_setr_epi32(
             (int)mask,
             (int)mask,
@@ -130,149 +130,142 @@ static void unmask(wss_frame_t *frame) {
 
     uint64_t size = sizeof(__m512i);
 
-    if ( likely(frame->applicationDataLength > size) ) {
-        for (; likely(i <= frame->applicationDataLength - size); i += size) {
+    if ( likely(length > size) ) {
+        for (; likely(i <= length - size); i += size) {
             masked_data = _mm512_loadu_si512((const void *)(applicationData+i));
             _mm512_storeu_si512((void *)(applicationData+i), _mm512_xor_si512 (masked_data, maskingKey));
         }
     }
 
     // last part
-    if ( likely(i < frame->applicationDataLength) ) {
+    if ( likely(i < length) ) {
         char buffer[size];
         memset(buffer, '\0', size);
-        memcpy(buffer, applicationData + i, frame->applicationDataLength - i);
+        memcpy(buffer, applicationData + i, length - i);
         masked_data = _mm512_loadu_si512((const void *)buffer);
         _mm512_storeu_si512((void *)buffer, _mm512_xor_si512 (masked_data, maskingKey));
-        memcpy(applicationData + i, buffer, (frame->applicationDataLength - i));
+        memcpy(applicationData + i, buffer, (length - i));
     }
 #elif defined(__AVX2__) && defined(__AVX__)
     __m256i masked_data;
     __m256i maskingKey = _mm256_setr_epi8(
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3]
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3]
                 );
 
     uint64_t size = sizeof(__m256i);
 
-    if ( likely(frame->applicationDataLength > size) ) {
-        for (; likely(i <= frame->applicationDataLength - size); i += size) {
+    if ( likely(length > size) ) {
+        for (; likely(i <= length - size); i += size) {
             masked_data = _mm256_loadu_si256((const __m256i *)(applicationData+i));
             _mm256_storeu_si256((__m256i *)(applicationData+i), _mm256_xor_si256 (masked_data, maskingKey));
         }
     }
 
     // last part
-    if ( likely(i < frame->applicationDataLength) ) {
+    if ( likely(i < length) ) {
         char buffer[size];
         memset(buffer, '\0', size);
-        memcpy(buffer, applicationData + i, frame->applicationDataLength - i);
+        memcpy(buffer, applicationData + i, length - i);
         masked_data = _mm256_loadu_si256((const __m256i *)buffer);
         _mm256_storeu_si256((__m256i *)buffer, _mm256_xor_si256 (masked_data, maskingKey));
-        memcpy(applicationData + i, buffer, (frame->applicationDataLength - i));
+        memcpy(applicationData + i, buffer, (length - i));
     }
 #elif defined(__SSE2__)
     __m128i masked_data;
     __m128i maskingKey = _mm_setr_epi8(
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3],
-            frame->maskingKey[0],
-            frame->maskingKey[1],
-            frame->maskingKey[2],
-            frame->maskingKey[3]
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3],
+            key[0],
+            key[1],
+            key[2],
+            key[3]
             );
 
     uint64_t size = sizeof(__m128i);
 
-    if ( likely(frame->applicationDataLength > size) ) {
-        for (; likely(i <= frame->applicationDataLength - size); i += size) {
+    if ( likely(length > size) ) {
+        for (; likely(i <= length - size); i += size) {
             masked_data = _mm_loadu_si128((const __m128i *)(applicationData+i));
             _mm_storeu_si128((__m128i *)(applicationData+i), _mm_xor_si128 (masked_data, maskingKey));
         }
     }
 
-    if ( likely(i < frame->applicationDataLength) ) {
+    if ( likely(i < length) ) {
         char buffer[size];
         memset(buffer, '\0', size);
-        memcpy(buffer, applicationData + i, frame->applicationDataLength - i);
+        memcpy(buffer, applicationData + i, length - i);
         masked_data = _mm_loadu_si128((const __m128i *)buffer);
         _mm_storeu_si128((__m128i *)buffer, _mm_xor_si128 (masked_data, maskingKey));
-        memcpy(applicationData + i, buffer, (frame->applicationDataLength - i));
+        memcpy(applicationData + i, buffer, (length - i));
     }
 #else
     uint64_t j;
-    for (j = 0; likely(i < frame->applicationDataLength); i++, j++){
-        applicationData[j] = applicationData[i] ^ frame->maskingKey[j % 4];
+    for (j = 0; likely(i < length); i++, j++){
+        applicationData[j] = applicationData[i] ^ key[j % 4];
     }
 #endif
 }
 
 /**
- * Parses a payload of data into a websocket frame. Returns the frame and
- * corrects the offset pointer in order for multiple frames to be processed 
- * from the same payload.
+ * Parses the header of a websocket frame and advances the offset past the
+ * frame. If the whole frame is present the payload of the frame is set to
+ * point at the masked application data within the given payload. A frame
+ * whose payload length uses the most significant bit or exceeds the limit
+ * is never given a payload, and the offset is only advanced past its header.
  *
  * @param   payload [char *]           "The payload to be processed"
  * @param   length  [size_t]           "The length of the payload"
  * @param   offset  [size_t *]         "A pointer to an offset"
- * @return 		    [wss_frame_t *]    "A websocket frame"
+ * @param   frame   [wss_frame_t *]    "The frame to fill"
+ * @param   limit   [uint64_t]         "The largest payload length accepted"
+ * @return 		    [void]
  */
-wss_frame_t *WSS_parse_frame(char *payload, size_t length, size_t *offset) {
-    wss_frame_t *frame;
-
-    if ( unlikely(NULL == payload) ) {
-        WSS_log_error("Payload cannot be NULL");
-        return NULL;
-    }
-
-    if ( unlikely(NULL == (frame = WSS_malloc(sizeof(wss_frame_t)))) ) {
-        WSS_log_error("Unable to allocate frame");
-        return NULL;
-    }
-
+static void parse_header(char *payload, size_t length, size_t *offset, wss_frame_t *frame, uint64_t limit) {
     WSS_log_trace("Parsing frame starting from offset %lu", *offset);
 
     frame->mask = false;
+    frame->payload = NULL;
     frame->payloadLength = 0;
     frame->applicationDataLength = 0;
     frame->extensionDataLength = 0;
@@ -316,94 +309,201 @@ wss_frame_t *WSS_parse_frame(char *payload, size_t length, size_t *offset) {
     }
 
     frame->applicationDataLength = frame->payloadLength-frame->extensionDataLength;
-    if ( likely(frame->applicationDataLength > 0) ) {
-        if ( likely(*offset+frame->applicationDataLength <= length) ) {
-            if ( unlikely(NULL == (frame->payload = WSS_malloc(frame->applicationDataLength))) ) {
-                WSS_log_error("Unable to allocate frame application data");
-                return NULL;
-            }
 
-            memcpy(frame->payload, payload+*offset, frame->applicationDataLength);
+    // A length close to 2^64 would wrap the offset, hence such frames are
+    // rejected by their header alone
+    if ( unlikely((frame->payloadLength & ((uint64_t)1 << (sizeof(uint64_t)*8-1))) ||
+                frame->payloadLength > limit) ) {
+        WSS_log_trace("Frame payload length %lu exceeds the limit", frame->payloadLength);
+        return;
+    }
+
+    if ( likely(frame->applicationDataLength > 0) ) {
+        if ( likely(*offset <= length && frame->applicationDataLength <= length-*offset) ) {
+            frame->payload = payload+*offset;
         }
         *offset += frame->applicationDataLength;
     }
+}
+
+/**
+ * Parses a payload of data into a websocket frame. Returns the frame and
+ * corrects the offset pointer in order for multiple frames to be processed 
+ * from the same payload.
+ *
+ * @param   payload [char *]           "The payload to be processed"
+ * @param   length  [size_t]           "The length of the payload"
+ * @param   offset  [size_t *]         "A pointer to an offset"
+ * @return 		    [wss_frame_t *]    "A websocket frame"
+ */
+wss_frame_t *WSS_parse_frame(char *payload, size_t length, size_t *offset) {
+    char *data;
+    wss_frame_t *frame;
+
+    if ( unlikely(NULL == payload) ) {
+        WSS_log_error("Payload cannot be NULL");
+        return NULL;
+    }
 
-    if ( likely(frame->mask && *offset <= length) ) {
-        unmask(frame);
+    if ( unlikely(NULL == (frame = WSS_malloc(sizeof(wss_frame_t)))) ) {
+        WSS_log_error("Unable to allocate frame");
+        return NULL;
+    }
+
+    parse_header(payload, length, offset, frame, UINT64_MAX);
+
+    if ( likely(NULL != (data = frame->payload)) ) {
+        if ( unlikely(NULL == (frame->payload = WSS_copy(data, frame->applicationDataLength))) ) {
+            WSS_log_error("Unable to allocate frame application data");
+            WSS_free((void **) &frame);
+            return NULL;
+        }
+
+        if ( likely(frame->mask) ) {
+            unmask(frame->payload, frame->applicationDataLength, frame->maskingKey);
+        }
     }
 
     return frame;
 }
 
 /**
- * Converts a single frame into a char array.
+ * Parses a websocket frame as a view into the payload. The application data
+ * is unmasked in place and the payload of the frame points into the given
+ * payload, hence nothing is allocated and nothing is copied. The frame is
+ * only valid as long as the payload is, and must not be released by
+ * WSS_free_frame. The application data of a frame larger than the limit is
+ * left masked and untouched.
  *
- * @param   frame    [wss_frame_t *]  "The frame"
- * @param   message  [char **]        "A pointer to a char array which should be filled with the frame data"
- * @return 		     [size_t]         "The size of the frame data"
+ * @param   payload [char *]           "The payload to be processed"
+ * @param   length  [size_t]           "The length of the payload"
+ * @param   offset  [size_t *]         "A pointer to an offset"
+ * @param   frame   [wss_frame_t *]    "The frame to fill"
+ * @param   limit   [uint64_t]         "The largest payload length accepted"
+ * @return 		    [bool]             "Whether a frame header could be parsed"
  */
-size_t WSS_stringify_frame(wss_frame_t *frame, char **message) {
-    size_t offset = 0;
-    size_t len = 2;
-    char *mes;
+bool WSS_parse_frame_view(char *payload, size_t length, size_t *offset, wss_frame_t *frame, uint64_t limit) {
+    if ( unlikely(NULL == payload) ) {
+        WSS_log_error("Payload cannot be NULL");
+        return false;
+    }
 
-    if ( unlikely(NULL == frame) ) {
-        *message = NULL;
-        return 0;
+    parse_header(payload, length, offset, frame, limit);
+
+    if ( likely(frame->mask && NULL != frame->payload) ) {
+        unmask(frame->payload, frame->applicationDataLength, frame->maskingKey);
     }
 
-    WSS_log_trace("Creating byte message from frame");
+    return true;
+}
 
-    if ( likely(frame->payloadLength > 125) ) {
-        if ( likely(frame->payloadLength <= 65535) ) {
-            len += sizeof(uint16_t);
-        } else {
-            len += sizeof(uint64_t);
+/**
+ * Copies a frame, including its application data, such that the copy does not
+ * reference the payload the frame was parsed from.
+ *
+ * @param   frame   [wss_frame_t *]    "The frame to copy"
+ * @return 		    [wss_frame_t *]    "A websocket frame"
+ */
+wss_frame_t *WSS_copy_frame(wss_frame_t *frame) {
+    wss_frame_t *copy;
+
+    if ( unlikely(NULL == (copy = WSS_arena_malloc(sizeof(wss_frame_t)))) ) {
+        WSS_log_error("Unable to allocate frame");
+        return NULL;
+    }
+    memcpy(copy, frame, sizeof(wss_frame_t));
+
+    if ( likely(NULL != frame->payload) ) {
+        if ( unlikely(NULL == (copy->payload = WSS_arena_malloc(frame->extensionDataLength+frame->applicationDataLength))) ) {
+            WSS_log_error("Unable to allocate frame application data");
+            WSS_arena_free((void **) &copy);
+            return NULL;
         }
+        memcpy(copy->payload, frame->payload, frame->extensionDataLength+frame->applicationDataLength);
     }
 
-    len += frame->payloadLength;
+    return copy;
+}
 
-    if ( unlikely(NULL == (mes = WSS_malloc(len*sizeof(char)))) ) {
-        WSS_log_error("Unable to allocate return message");
-        *message = NULL;
-        return 0;
-    }
+/**
+ * Writes the header of a frame, such that the header can be sent in front of
+ * a payload that is kept elsewhere.
+ *
+ * @param   frame    [wss_frame_t *]  "The frame"
+ * @param   header   [char *]         "A char array of at least WSS_FRAME_HEADER_SIZE bytes to fill"
+ * @return 		     [size_t]         "The size of the header"
+ */
+size_t WSS_frame_header(wss_frame_t *frame, char *header) {
+    size_t offset = 0;
+
+    header[offset] = 0;
 
     if (frame->fin) {
-        mes[offset] |= 0x80;
+        header[offset] |= 0x80;
     }
 
     if (frame->rsv1) {
-        mes[offset] |= 0x40;
+        header[offset] |= 0x40;
     }
 
     if ( unlikely(frame->rsv2) ) {
-        mes[offset] |= 0x20;
+        header[offset] |= 0x20;
     }
 
     if ( unlikely(frame->rsv3) ) {
-        mes[offset] |= 0x10;
+        header[offset] |= 0x10;
     }
 
-    mes[offset++] |= 0xF & frame->opcode;
+    header[offset++] |= 0xF & frame->opcode;
 
     if ( unlikely(frame->payloadLength <= 125) ) {
-        mes[offset++] = frame->payloadLength;
+        header[offset++] = frame->payloadLength;
     } else if ( likely(frame->payloadLength <= 65535) ) {
         uint16_t plen;
-        mes[offset++] = 126;
+        header[offset++] = 126;
         plen = htons16(frame->payloadLength);
-        memcpy(mes+offset, &plen, sizeof(plen));
+        memcpy(header+offset, &plen, sizeof(plen));
         offset += sizeof(plen);
     } else {
         uint64_t plen;
-        mes[offset++] = 127;
+        header[offset++] = 127;
         plen = htonl64(frame->payloadLength);
-        memcpy(mes+offset, &plen, sizeof(plen));
+        memcpy(header+offset, &plen, sizeof(plen));
         offset += sizeof(plen);
     }
 
+    return offset;
+}
+
+/**
+ * Converts a single frame into a char array.
+ *
+ * @param   frame    [wss_frame_t *]  "The frame"
+ * @param   message  [char **]        "A pointer to a char array which should be filled with the frame data"
+ * @return 		     [size_t]         "The size of the frame data"
+ */
+size_t WSS_stringify_frame(wss_frame_t *frame, char **message) {
+    size_t offset;
+    char *mes;
+    char header[WSS_FRAME_HEADER_SIZE];
+
+    if ( unlikely(NULL == frame) ) {
+        *message = NULL;
+        return 0;
+    }
+
+    WSS_log_trace("Creating byte message from frame");
+
+    offset = WSS_frame_header(frame, header);
+
+    if ( unlikely(NULL == (mes = WSS_arena_malloc((offset+frame->payloadLength)*sizeof(char)))) ) {
+        WSS_log_error("Unable to allocate return message");
+        *message = NULL;
+        return 0;
+    }
+
+    memcpy(mes, header, offset);
+
     if ( unlikely(frame->extensionDataLength > 0) ) {
         memcpy(mes+offset, frame->payload, frame->extensionDataLength);
         offset += frame->extensionDataLength;
@@ -442,23 +542,30 @@ size_t WSS_stringify_frames(wss_frame_t **frames, size_t size, char **message) {
         if ( unlikely(n < 2) ) {
             WSS_log_error("Received invalid frame");
             *message = NULL;
-            WSS_free((void **)&f);
-            WSS_free((void **)&msg);
+            WSS_arena_free((void **)&f);
+            WSS_arena_free((void **)&msg);
             return 0;
         }
 
-        if ( unlikely(NULL == (msg = WSS_realloc((void **) &msg, 
-                        message_length*sizeof(char), (message_length+n+1)*sizeof(char)))) ) {
+        // Memory that is re-allocated stays where it was allocated, hence the
+        // first allocation must be made from the arena
+        if (NULL == msg) {
+            msg = WSS_arena_malloc((n+1)*sizeof(char));
+        } else {
+            msg = WSS_arena_realloc(msg, (message_length+n+1)*sizeof(char));
+        }
+
+        if ( unlikely(NULL == msg) ) {
             WSS_log_error("Unable to allocate message string");
             *message = NULL;
-            WSS_free((void **)&f);
+            WSS_arena_free((void **)&f);
             return 0;
         }
 
         memcpy(msg+message_length, f, n);
         message_length += n;
 
-        WSS_free((void **) &f);
+        WSS_arena_free((void **) &f);
     }
 
     *message = msg;
@@ -496,7 +603,7 @@ size_t WSS_create_frames(wss_config_t *config, wss_opcode_t opcode, char *messag
 
     frames_count = MAX(1, (size_t)ceil((double)message_length/(double)config->size_frame));
 
-    if ( unlikely(NULL == (*fs = WSS_malloc(frames_count*sizeof(wss_frame_t *)))) ) {
+    if ( unlikely(NULL == (*fs = WSS_arena_malloc(frames_count*sizeof(wss_frame_t *)))) ) {
         WSS_log_error("Unable to allocate closing frame");
         *fs = NULL;
         return 0;
@@ -523,28 +630,28 @@ size_t WSS_create_frames(wss_config_t *config, wss_opcode_t opcode, char *messag
 
     for (i = 0; i < frames_count; i++) {
         // Always allocate one frame
-        if ( unlikely(NULL == (frame = WSS_malloc(sizeof(wss_frame_t)))) ) {
+        if ( unlikely(NULL == (frame = WSS_arena_malloc(sizeof(wss_frame_t)))) ) {
             WSS_log_error("Unable to allocate frame");
             for (j = 0; j < i; j++) {
                 WSS_free_frame(frames[j]);
             }
-            WSS_free((void **)&frames);
+            WSS_arena_free((void **)&frames);
             *fs = NULL;
             return 0;
         }
 
         frame->fin = 0;
-        frame->opcode = opcode;
+        frame->opcode = i == 0 ? opcode : CONTINUATION_FRAME;
         frame->mask = 0;
 
         frame->applicationDataLength = MIN(message_length-(config->size_frame*i), config->size_frame);
-        if ( unlikely(NULL == (frame->payload = WSS_malloc(frame->applicationDataLength+1))) ) {
+        if ( unlikely(NULL == (frame->payload = WSS_arena_malloc(frame->applicationDataLength+1))) ) {
             WSS_log_error("Unable to allocate frame application data");
             for (j = 0; j < i; j++) {
                 WSS_free_frame(frames[j]);
             }
-            WSS_free((void **)&frame);
-            WSS_free((void **)&frames);
+            WSS_arena_free((void **)&frame);
+            WSS_arena_free((void **)&frames);
             *fs = NULL;
             return 0;
         }
@@ -574,7 +681,7 @@ wss_frame_t *WSS_closing_frame(wss_close_t reason, char *message) {
 
     WSS_log_trace("Creating closing frame");
 
-    if ( unlikely(NULL == (frame = WSS_malloc(sizeof(wss_frame_t)))) ) {
+    if ( unlikely(NULL == (frame = WSS_arena_malloc(sizeof(wss_frame_t)))) ) {
         WSS_log_error("Unable to allocate closing frame");
         return NULL;
     }
@@ -637,7 +744,7 @@ wss_frame_t *WSS_closing_frame(wss_close_t reason, char *message) {
         }
     }
     frame->applicationDataLength = strlen(reason_str)+sizeof(uint16_t);
-    if ( unlikely(NULL == (frame->payload = WSS_malloc(frame->applicationDataLength+1))) ) {
+    if ( unlikely(NULL == (frame->payload = WSS_arena_malloc(frame->applicationDataLength+1))) ) {
         WSS_log_error("Unable to allocate closing frame application data");
         WSS_free_frame(frame);
         return NULL;
@@ -717,7 +824,7 @@ wss_frame_t *WSS_pong_frame(wss_frame_t *ping) {
  */
 void WSS_free_frame(wss_frame_t *frame) {
     if ( likely(NULL != frame) ) {
-        WSS_free((void **) &frame->payload);
+        WSS_arena_free((void **) &frame->payload);
     }
-    WSS_free((void **) &frame);
+    WSS_arena_free((void **) &frame);
 }
@@ -166,31 +166,16 @@ wss_error_t WSS_http_regex_init(wss_server_t *server) {
 }
 
 /**
- * Function that initializes a http server instance and creating thread where
- * the instance is being run.
+ * Function that creates the listening socket of a server instance or one of its
+ * event loops.
  *
  * @param   server	[wss_server_t *] 	"The server instance"
  * @return 			[wss_error_t]       "The error status"
  */
-wss_error_t WSS_http_server(wss_server_t *server) {
+static wss_error_t http_server_listen(wss_server_t *server) {
     int err;
     char straddr[INET6_ADDRSTRLEN];
 
-    if (NULL == server->ssl_ctx) {
-        WSS_log_trace("Starting HTTP instance");
-    } else {
-        WSS_log_trace("Starting HTTPS instance");
-    }
-
-    WSS_log_trace("Assigning server to port %d", server->port);
-
-    /**
-     * Setting port and initializes filedescriptors to -1 in the server
-     * structure.
-     */
-    server->fd = -1;
-    server->poll_fd = -1;
-
     WSS_log_trace("Creating socket filedescriptor");
     if ( unlikely((err = WSS_socket_create(server)) != WSS_SUCCESS) ) {
         return err;
@@ -201,6 +186,13 @@ wss_error_t WSS_http_server(wss_server_t *server) {
         return err;
     }
 
+    if (server->config->pool_mode == POOL_SHARDED) {
+        WSS_log_trace("Allowing port to be shared between event loops");
+        if ( unlikely((err = WSS_socket_reuse_port(server->fd)) != WSS_SUCCESS) ) {
+            return err;
+        }
+    }
+
     WSS_log_trace("Creating socket structure for instance");
     if ( unlikely((err = WSS_socket_bind(server)) != WSS_SUCCESS) ) {
         return err;
@@ -220,11 +212,165 @@ wss_error_t WSS_http_server(wss_server_t *server) {
         return err;
     }
 
-    WSS_log_trace("Creating threadpool");
-    if ( unlikely((err = WSS_socket_threadpool(server)) != WSS_SUCCESS) ) {
+    return WSS_SUCCESS;
+}
+
+/**
+ * Function that creates the additional event loops of a server running in
+ * sharded mode. Each loop owns a listening socket bound to the same port, its
+ * own poll instance and the sessions it accepts. The server instance itself
+ * runs the first loop.
+ *
+ * @param   server	[wss_server_t *] 	"The server instance"
+ * @return 			[wss_error_t]       "The error status"
+ */
+static wss_error_t http_server_loops(wss_server_t *server) {
+    int err;
+    unsigned int i;
+    wss_server_t *loop;
+    unsigned int loops = server->config->pool_loops;
+
+    if ( unlikely(NULL == (server->loops = WSS_calloc(loops, sizeof(wss_server_t *)))) ) {
+        WSS_log_fatal("Unable to allocate event loops");
+        return WSS_MEMORY_ERROR;
+    }
+
+    server->loops[0] = server;
+    server->loops_length = 1;
+
+    for (i = 1; likely(i < loops); i++) {
+        WSS_log_trace("Creating event loop %u", i);
+
+        if ( unlikely(NULL == (loop = WSS_malloc(sizeof(wss_server_t)))) ) {
+            WSS_log_fatal("Unable to allocate event loop structure");
+            return WSS_MEMORY_ERROR;
+        }
+
+        if ( unlikely(0 != (err = pthread_mutex_init(&loop->lock, NULL))) ) {
+            WSS_log_fatal("Unable to initialize event loop lock: %s", strerror(err));
+            WSS_free((void **) &loop);
+            return WSS_THREAD_CREATE_ERROR;
+        }
+
+        loop->config          = server->config;
+        loop->port            = server->port;
+        loop->ssl_ctx         = server->ssl_ctx;
+        loop->re              = server->re;
+        loop->fd              = -1;
+        loop->poll_fd         = -1;
+        loop->rearm_fd[0]     = -1;
+        loop->rearm_fd[1]     = -1;
+
+        server->loops[i] = loop;
+        server->loops_length++;
+
+        if ( unlikely((err = http_server_listen(loop)) != WSS_SUCCESS) ) {
+            return err;
+        }
+
+        WSS_log_trace("Initializing event loop poll");
+        if ( unlikely(WSS_SUCCESS != (err = WSS_poll_init(loop))) ) {
+            return err;
+        }
+    }
+
+    for (i = 1; likely(i < server->loops_length); i++) {
+        WSS_log_trace("Creating event loop thread %u", i);
+        if ( unlikely(0 != (err = pthread_create(&server->loops[i]->thread_id, NULL, WSS_server_run, (void *) server->loops[i]))) ) {
+            WSS_log_error("Unable to create event loop thread: %s", strerror(err));
+            return WSS_THREAD_CREATE_ERROR;
+        }
+    }
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Function that creates the follower threads of a server running in
+ * leader/follower mode. All threads wait on the poll instance of the server
+ * and handle the events they receive themselves. The server thread itself is
+ * the first of them.
+ *
+ * @param   server	[wss_server_t *] 	"The server instance"
+ * @return 			[wss_error_t]       "The error status"
+ */
+static wss_error_t http_server_followers(wss_server_t *server) {
+    int err;
+    unsigned int i;
+    unsigned int followers = server->config->pool_workers > 1 ? server->config->pool_workers-1 : 0;
+
+    if ( unlikely(followers == 0) ) {
+        return WSS_SUCCESS;
+    }
+
+    if ( unlikely(NULL == (server->followers = WSS_calloc(followers, sizeof(pthread_t)))) ) {
+        WSS_log_fatal("Unable to allocate follower threads");
+        return WSS_MEMORY_ERROR;
+    }
+
+    for (i = 0; likely(i < followers); i++) {
+        WSS_log_trace("Creating follower thread %u", i+1);
+        if ( unlikely(0 != (err = pthread_create(&server->followers[i], NULL, WSS_server_run, (void *) server))) ) {
+            WSS_log_error("Unable to create follower thread: %s", strerror(err));
+            return WSS_THREAD_CREATE_ERROR;
+        }
+        server->followers_length++;
+    }
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Function that initializes a http server instance and creating thread where
+ * the instance is being run.
+ *
+ * @param   server	[wss_server_t *] 	"The server instance"
+ * @return 			[wss_error_t]       "The error status"
+ */
+wss_error_t WSS_http_server(wss_server_t *server) {
+    int err;
+
+    if (NULL == server->ssl_ctx) {
+        WSS_log_trace("Starting HTTP instance");
+    } else {
+        WSS_log_trace("Starting HTTPS instance");
+    }
+
+    WSS_log_trace("Assigning server to port %d", server->port);
+
+    /**
+     * Setting port and initializes filedescriptors to -1 in the server
+     * structure.
+     */
+    server->fd = -1;
+    server->poll_fd = -1;
+    server->rearm_fd[0] = -1;
+    server->rearm_fd[1] = -1;
+
+    if ( unlikely((err = http_server_listen(server)) != WSS_SUCCESS) ) {
         return err;
     }
 
+    // All workers can only wait on the same poll instance with epoll
+#if defined(WSS_EPOLL)
+    if (server->config->pool_mode == POOL_LEADER && server->config->pool_backend != POOL_EPOLL) {
+        WSS_log_warn("Leader/follower mode requires the epoll backend, using epoll");
+        server->config->pool_backend = POOL_EPOLL;
+    }
+#else
+    if (server->config->pool_mode == POOL_LEADER) {
+        WSS_log_warn("Leader/follower mode requires epoll, using dispatcher mode");
+        server->config->pool_mode = POOL_DISPATCHER;
+    }
+#endif
+
+    if (server->config->pool_mode == POOL_DISPATCHER) {
+        WSS_log_trace("Creating threadpool");
+        if ( unlikely((err = WSS_socket_threadpool(server)) != WSS_SUCCESS) ) {
+            return err;
+        }
+    }
+
     WSS_log_trace("Initializing server regexp");
     if ( unlikely((err = WSS_http_regex_init(server)) != WSS_SUCCESS) ) {
         return err;
@@ -235,6 +381,20 @@ wss_error_t WSS_http_server(wss_server_t *server) {
         return err;
     }
 
+    if (server->config->pool_mode == POOL_SHARDED) {
+        WSS_log_info("Running %u sharded event loops", server->config->pool_loops);
+        if ( unlikely((err = http_server_loops(server)) != WSS_SUCCESS) ) {
+            return err;
+        }
+    }
+
+    if (server->config->pool_mode == POOL_LEADER) {
+        WSS_log_info("Running %u leader/follower threads", server->config->pool_workers);
+        if ( unlikely((err = http_server_followers(server)) != WSS_SUCCESS) ) {
+            return err;
+        }
+    }
+
     WSS_log_trace("Creating server thread");
     if ( unlikely(pthread_create(&server->thread_id, NULL, WSS_server_run, (void *) server) != 0) ) {
         WSS_log_error("Unable to create server thread", strerror(errno));
@@ -253,9 +413,36 @@ wss_error_t WSS_http_server(wss_server_t *server) {
  */
 wss_error_t WSS_http_server_free(wss_server_t *server) {
     int err;
+    unsigned int i;
+    wss_server_t *loop;
     int res = WSS_SUCCESS;
 
     if ( likely(NULL != server) ) {
+        /**
+         * Freeing the additional event loops, which shares regex and SSL
+         * context with the server instance
+         */
+        if ( NULL != server->loops ) {
+            for (i = 1; likely(i < server->loops_length); i++) {
+                loop = server->loops[i];
+                loop->re = NULL;
+                loop->ssl_ctx = NULL;
+
+                if ( unlikely(WSS_SUCCESS != (err = WSS_http_server_free(loop))) ) {
+                    res = err;
+                }
+
+                pthread_mutex_destroy(&loop->lock);
+                WSS_free((void **) &loop);
+            }
+
+            WSS_free((void **) &server->loops);
+            server->loops_length = 0;
+        }
+
+        WSS_free((void **) &server->followers);
+        server->followers_length = 0;
+
         /**
          * Shutting down socket, such that no more reads is allowed.
          */
@@ -270,6 +457,14 @@ wss_error_t WSS_http_server_free(wss_server_t *server) {
          * Shutting down threadpool gracefully
          */
         if ( likely(NULL != server->pool) ) {
+            threadpool_stats_t stats;
+            if ( likely(threadpool_stats(server->pool, &stats) == 0) ) {
+                WSS_log_info("Threadpool ran %lu tasks, %lu were stolen and workers parked %lu times",
+                        stats.tasks, stats.steals, stats.parks);
+                WSS_log_info("Threadpool spawned %lu and retired %lu workers, and grew its queue %lu times",
+                        stats.spawned, stats.retired, stats.resizes);
+            }
+
             if ( unlikely((err = threadpool_destroy(server->pool, threadpool_graceful)) != 0) ) {
                 WSS_log_error("Unable to destroy threadpool gracefully: %s", threadpool_strerror(errno));
 
@@ -296,6 +491,15 @@ wss_error_t WSS_http_server_free(wss_server_t *server) {
             }
         }
 
+        /**
+         * Freeing the job arguments reused by the event loop
+         */
+        if ( likely(server->jobs_dispatched > 0) ) {
+            WSS_log_info("Event loop dispatched %zu jobs using %zu allocations",
+                    server->jobs_dispatched, server->jobs_allocated);
+        }
+        WSS_thread_args_free(server);
+
         if ( NULL != server->re ) {
             regfree(server->re);
             WSS_free((void **) &server->re);
@@ -305,6 +509,7 @@ wss_error_t WSS_http_server_free(wss_server_t *server) {
          * Freeing epoll structures
          */
         WSS_free((void **) &server->events);
+        WSS_free((void **) &server->interests);
 
         /**
          * Closing epoll
@@ -26,6 +26,8 @@ static void log_mutex(void *udata, int lock) {
     }
 }
 
+static const char *huge_pages[] = { "regular", "transparent huge", "huge" };
+
 static inline void wss_help(FILE *stream) {
     fprintf(
             stream,
@@ -38,8 +40,10 @@ static inline void wss_help(FILE *stream) {
 
 int main(int argc, char *argv[]) {
     int err, res;
-    wss_config_t config;
+    wss_config_t config, defaults;
+    wss_huge_pages_t pages = HUGE_PAGES_OFF;
     FILE *file;
+    char *path = NULL;
     pthread_mutex_t log_lock;
     char *echo = "subprotocols/echo/echo.so", *broadcast = "subprotocols/broadcast/broadcast.so";
 
@@ -86,7 +90,23 @@ int main(int argc, char *argv[]) {
     config.size_frame           = 1048576;
     config.max_frames           = 1048576;
     config.pool_workers         = 4;
-    config.pool_retries         = 5;
+    config.pool_max_workers     = 0;     // Same as workers
+    config.pool_max_queue       = 0;     // Same as the initial queue
+    config.pool_idle_timeout    = 60000; // 1 Minute
+    config.pool_loops           = 0;     // One event loop per online core
+    config.pool_fanout          = 4096;
+    config.pool_mode            = POOL_DISPATCHER;
+    config.pool_scheduler       = POOL_QUEUE;
+    config.pool_backend         = POOL_EPOLL;
+    config.accept_budget        = 64;    // Sessions accepted per wakeup
+    config.accept_defer         = 0;     // Disabled
+    config.accept_fastopen      = 0;     // Disabled
+    config.session_prewarm      = 0;     // No sessions allocated up front
+    config.session_cache        = 0;     // Unbounded
+    config.memory_collect       = 10000; // 10 Seconds
+    config.memory_rss           = 0;     // No target
+    config.memory_decommit      = false;
+    config.memory_huge_pages    = HUGE_PAGES_OFF;
     config.timeout_pings        = 1;     // Times that a client will be pinged before timeout occurs
     config.timeout_poll         = -1;    // Infinite
     config.timeout_read         = 1000;  // 1 Second
@@ -133,6 +153,8 @@ int main(int argc, char *argv[]) {
     // Set lock function for logging functions
     log_set_lock(log_mutex);
 
+    defaults = config;
+
     while ( likely((err = getopt_long(argc, argv, "c:h", long_options, NULL)) != -1)) {
         switch (err) {
             case 'c':
@@ -149,6 +171,7 @@ int main(int argc, char *argv[]) {
 #endif
                     return EXIT_FAILURE;
                 }
+                path = optarg;
                 break;
             case 'h':
                 wss_help(stdout);
@@ -180,6 +203,28 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // The allocator can only back its memory with huge pages if it is
+    // initialized for it, hence the configuration is loaded once more
+    if ( config.memory_huge_pages != HUGE_PAGES_OFF ) {
+        WSS_config_free(&config);
+        pages = WSS_alloc_initialize(config.memory_huge_pages);
+        config = defaults;
+
+        if ( unlikely(WSS_SUCCESS != WSS_config_load(&config, path)) ) {
+            WSS_config_free(&config);
+
+            if ( unlikely((err = pthread_mutex_destroy(&log_lock)) != 0) ) {
+                WSS_log_error("Unable to initialize log lock: %s", strerror(err));
+            }
+
+            fclose(file);
+#ifdef USE_RPMALLOC
+            rpmalloc_finalize();
+#endif
+            return EXIT_FAILURE;
+        }
+    }
+
     // If in production mode do not print to stdout
 #ifdef NDEBUG
     WSS_log_info("Log is in quiet mode");
@@ -189,6 +234,12 @@ int main(int argc, char *argv[]) {
     // Set log level to what what specified in the configuration
     log_set_level(config.log);
 
+    if ( unlikely(pages != config.memory_huge_pages) ) {
+        WSS_log_warn("Memory can not be backed by %s pages, falling back to %s pages",
+                huge_pages[config.memory_huge_pages], huge_pages[pages]);
+    }
+    WSS_log_info("Memory is backed by %s pages", huge_pages[pages]);
+
     // Setting echo and broadcast protocols as default if none was loaded
     if ( config.subprotocols_length == 0 && config.subprotocols == NULL) {
         if ( NULL != (config.subprotocols = WSS_calloc(2, sizeof(char *)))) {
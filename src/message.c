@@ -1,4 +1,5 @@
 #include "message.h"
+#include "frame.h"
 #include "server.h"
 #include "worker.h"
 #include "ringbuf.h"
@@ -7,32 +8,95 @@
 #include "str.h"
 #include "log.h"
 #include "alloc.h"
+#include "arena.h"
 #include "error.h"
+#include "pool.h"
 #include "predict.h"
 
-#include <time.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * Structure containing a message that is being sent to several sessions,
+ * along with the copy of the message shared by the sessions that had to
+ * queue it
+ */
+typedef struct {
+    char *payload;
+    size_t length;
+    wss_opcode_t opcode;
+    wss_shared_t *shared;
+} wss_delivery_t;
+
+/**
+ * The message the thread is delivering to a subprotocol or sending to several
+ * sessions
+ */
+static _Thread_local wss_delivery_t delivery = { NULL, 0, 0, NULL };
+
+/**
+ * Structure containing a message sent to many sessions, whose recipients are
+ * split into chunks that several workers claim and send
+ */
+typedef struct {
+    atomic_size_t references;
+    atomic_size_t next;
+    atomic_size_t done;
+    size_t chunk;
+    size_t chunks;
+    int *fds;
+    size_t fds_count;
+    wss_opcode_t opcode;
+    char *message;
+    uint64_t message_length;
+    wss_shared_t *shared;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} wss_fanout_t;
+
+/**
+ * Writes a message to a session right away if no other thread is performing
+ * IO on the session. Otherwise it is queued and the session is marked as
+ * having messages to write, such that the thread performing IO writes the
+ * message once it is done and the sender never has to wait for the session.
+ *
+ * @param 	server	[wss_server_t *] 	"The server of the session"
+ * @param 	session	[wss_session_t *] 	"The session to send the message to"
+ * @param 	m	    [wss_message_t *] 	"The message"
+ * @return 	        [void]
+ */
+static void message_submit(wss_server_t *server, wss_session_t *session, wss_message_t *m) {
+    if ( pthread_mutex_trylock(&session->lock) == 0 ) {
+        WSS_write_message(session, m, ! session->closing);
+        WSS_release(server, session);
+    } else {
+        WSS_write_message(session, m, false);
+
+        if ( pthread_mutex_trylock(&session->lock) == 0 ) {
+            WSS_release(server, session);
+        }
+    }
+}
 
 void WSS_message_send_frames(void *serv, void *sess, wss_frame_t **frames, size_t frames_count) {
     size_t j, k;
-    ssize_t off;
     char *out;
     uint64_t out_length;
     wss_message_t *m;
-    ringbuf_worker_t *w = NULL;
-    struct timespec tim;
     wss_server_t *server = (wss_server_t *)serv;
     wss_session_t *session = (wss_session_t *)sess;
 
     // Use extensions
-    if ( NULL != session->header->ws_extensions ) {
-        for (j = 0; likely(j < session->header->ws_extensions_count); j++) {
-            session->header->ws_extensions[j]->ext->outframes(
+    if ( NULL != session->extensions ) {
+        for (j = 0; likely(j < session->extensions_count); j++) {
+            session->extensions[j]->outframes(
                     session->fd,
                     frames,
                     frames_count);
 
             for (k = 0; likely(k < frames_count); k++) {
-                session->header->ws_extensions[j]->ext->outframe(session->fd, frames[k]);
+                session->extensions[j]->outframe(session->fd, frames[k]);
             }
         }
     }
@@ -43,10 +107,10 @@ void WSS_message_send_frames(void *serv, void *sess, wss_frame_t **frames, size_
         return;
     }
 
-    if ( unlikely(NULL == (m = WSS_malloc(sizeof(wss_message_t)))) ) {
+    if ( unlikely(NULL == (m = WSS_arena_malloc(sizeof(wss_message_t)))) ) {
         WSS_log_error("Unable to allocate message structure");
 
-        WSS_free((void **) &out);
+        WSS_arena_free((void **) &out);
 
         return;
     }
@@ -54,86 +118,619 @@ void WSS_message_send_frames(void *serv, void *sess, wss_frame_t **frames, size_
     m->length = out_length;
     m->framed = true;
 
-    WSS_log_trace("Putting message into ringbuffer");
+    message_submit(server, session, m);
 
-    if ( unlikely(-1 == (off = ringbuf_acquire(session->ringbuf, &w, 1))) ) {
-        WSS_log_error("Failed to acquire space in ringbuffer");
+    WSS_session_jobs_dec(session);
+}
 
-        WSS_message_free(m);
+static wss_message_t *message_flatten(wss_message_t *msg);
 
+/**
+ * Sends a message to a session that has been found and whose jobs have been
+ * incremented. Unless the session uses extensions, which need the frames of
+ * the message, the payload is referenced by the message rather than copied
+ * into frames. Sessions using SSL write the message from a single buffer,
+ * which is shared with other sessions if the message is the one being
+ * delivered.
+ *
+ * @param 	session	        [wss_session_t *] 	"The session to send the message to"
+ * @param 	opcode	        [wss_opcode_t] 	    "The opcode of the frames of the message"
+ * @param 	message	        [char *] 	        "The message"
+ * @param 	message_length	[uint64_t] 	        "The length of the message"
+ * @param 	owned	        [bool] 	            "Whether the message is freed once sent"
+ * @return 	                [void]
+ */
+static void message_dispatch(wss_session_t *session, wss_opcode_t opcode, char *message, uint64_t message_length, bool owned) {
+    size_t k;
+    size_t frames_count;
+    wss_frame_t **frames;
+    wss_message_t *m;
+    wss_server_t *server = session->server;
+
+    if ( likely(NULL == session->extensions && opcode != CLOSE_FRAME) ) {
+        WSS_log_trace("Creating message referencing the payload");
+
+        if ( unlikely(NULL == (m = WSS_message_create(server->config, opcode, message, message_length, owned))) ) {
+            WSS_log_error("Unable to create message");
+            if (owned) {
+                WSS_free((void **) &message);
+            }
+        } else {
+            m->shareable = ! owned && message == delivery.payload &&
+                message_length == delivery.length && opcode == delivery.opcode;
+
+            if ( unlikely(NULL != session->ssl && NULL == (m = message_flatten(m))) ) {
+                WSS_log_error("Unable to copy message");
+            } else {
+                message_submit(server, session, m);
+            }
+        }
+
+        WSS_session_jobs_dec(session);
         return;
     }
 
-    session->messages[off] = m;
-    ringbuf_produce(session->ringbuf, &w);
-    tim.tv_sec = 0;
-    tim.tv_nsec = 100000000;
+    WSS_log_trace("Creating frames");
 
-    do {
-        pthread_mutex_lock(&session->lock);
+    frames_count = WSS_create_frames(server->config, opcode, message, message_length, &frames);
 
-        switch (session->state) {
-        case READING:
-            pthread_mutex_unlock(&session->lock);
-            nanosleep(&tim, NULL);
-            break;
-        case CLOSING:
-            WSS_session_jobs_dec(session);
-            pthread_mutex_unlock(&session->lock);
-            return;
-        case CONNECTING:
-            pthread_mutex_unlock(&session->lock);
-            nanosleep(&tim, NULL);
-            break;
-        case WRITING:
-            WSS_session_jobs_dec(session);
-            pthread_mutex_unlock(&session->lock);
-            return;
-        case IDLE:
-            session->state = WRITING;
-            WSS_write(server, session);
-            WSS_session_jobs_dec(session);
-            pthread_mutex_unlock(&session->lock);
-            return;
-        }
-    } while (1);
+    if (owned) {
+        WSS_free((void **) &message);
+    }
+
+    WSS_message_send_frames(server, session, frames, frames_count);
+
+    for (k = 0; likely(k < frames_count); k++) {
+        WSS_free_frame(frames[k]);
+    }
+    WSS_arena_free((void **) &frames);
 }
 
-void WSS_message_send(int fd, wss_opcode_t opcode, char *message, uint64_t message_length) {
-    size_t k;
-    size_t frames_count;
+/**
+ * Sends a message to the session of a filedescriptor.
+ *
+ * @param 	fd	            [int] 	            "The session to send the message to"
+ * @param 	opcode	        [wss_opcode_t] 	    "The opcode of the frames of the message"
+ * @param 	message	        [char *] 	        "The message"
+ * @param 	message_length	[uint64_t] 	        "The length of the message"
+ * @param 	owned	        [bool] 	            "Whether the message is freed once sent"
+ * @return 	                [void]
+ */
+static void message_send(int fd, wss_opcode_t opcode, char *message, uint64_t message_length, bool owned) {
     wss_session_t *session;
-    wss_frame_t **frames;
-    wss_server_t *server = servers.http;
+
+    WSS_session_enter();
 
     if ( unlikely(NULL == (session = WSS_session_find(fd))) ) {
         WSS_log_error("Unable to find session to send message to");
+        WSS_session_leave();
+        if (owned) {
+            WSS_free((void **) &message);
+        }
         return;
     }
 
     WSS_session_jobs_inc(session);
 
-    if (NULL != session->ssl && session->ssl_connected) {
-        server = servers.https;
+    message_dispatch(session, opcode, message, message_length, owned);
+
+    WSS_session_leave();
+}
+
+void WSS_message_send(int fd, wss_opcode_t opcode, char *message, uint64_t message_length) {
+    message_send(fd, opcode, message, message_length, false);
+}
+
+void WSS_message_send_owned(int fd, wss_opcode_t opcode, char *message, uint64_t message_length) {
+    message_send(fd, opcode, message, message_length, true);
+}
+
+/**
+ * Sends a message to the sessions of a range of filedescriptors. The calling
+ * thread must be between calls to WSS_session_enter and WSS_session_leave.
+ *
+ * @param 	fds	            [int *] 	        "The sessions to send the message to"
+ * @param 	fds_count	    [size_t] 	        "The amount of sessions"
+ * @param 	opcode	        [wss_opcode_t] 	    "The opcode of the frames of the message"
+ * @param 	message	        [char *] 	        "The message"
+ * @param 	message_length	[uint64_t] 	        "The length of the message"
+ * @return 	                [void]
+ */
+static void message_send_fds(int *fds, size_t fds_count, wss_opcode_t opcode, char *message, uint64_t message_length) {
+    size_t i;
+    wss_session_t *session;
+
+    for (i = 0; likely(i < fds_count); i++) {
+        // Sessions may close while the message is sent to the others
+        if ( unlikely(NULL == (session = WSS_session_find(fds[i]))) ) {
+            WSS_log_trace("Unable to find session %d to send message to", fds[i]);
+            continue;
+        }
+
+        WSS_session_jobs_inc(session);
+
+        message_dispatch(session, opcode, message, message_length, false);
     }
+}
 
-    WSS_log_trace("Creating frames");
+/**
+ * Releases a reference to a fanout, which is freed once no references are
+ * left.
+ *
+ * @param 	fanout	[wss_fanout_t *] 	"The fanout"
+ * @return 	        [void]
+ */
+static void fanout_release(wss_fanout_t *fanout) {
+    if ( 1 == atomic_fetch_sub_explicit(&fanout->references, 1, memory_order_acq_rel) ) {
+        WSS_shared_release(fanout->shared);
+        pthread_mutex_destroy(&fanout->lock);
+        pthread_cond_destroy(&fanout->finished);
+        WSS_free((void **) &fanout);
+    }
+}
 
-    frames_count = WSS_create_frames(server->config, opcode, message, message_length, &frames);
+/**
+ * Sends the chunks of a fanout until no chunks are left to claim. Every
+ * recipient of a chunk shares the framed copy of the fanout.
+ *
+ * @param 	fanout	[wss_fanout_t *] 	"The fanout"
+ * @return 	        [void]
+ */
+static void fanout_send(wss_fanout_t *fanout) {
+    size_t i, offset;
+    wss_delivery_t outer = delivery;
 
-    WSS_message_send_frames(server, session, frames, frames_count);
+    delivery.payload = fanout->message;
+    delivery.length = fanout->message_length;
+    delivery.opcode = fanout->opcode;
+    delivery.shared = NULL;
 
-    for (k = 0; likely(k < frames_count); k++) {
-        WSS_free_frame(frames[k]);
+    WSS_session_enter();
+
+    while ( (i = atomic_fetch_add_explicit(&fanout->next, 1, memory_order_relaxed)) < fanout->chunks ) {
+        // Messages that have to be queued reference the copy of the fanout
+        if ( NULL == delivery.shared && NULL != fanout->shared ) {
+            atomic_fetch_add_explicit(&fanout->shared->references, 1, memory_order_relaxed);
+            delivery.shared = fanout->shared;
+        }
+
+        offset = i*fanout->chunk;
+        message_send_fds(fanout->fds+offset, MIN(fanout->chunk, fanout->fds_count-offset),
+                fanout->opcode, fanout->message, fanout->message_length);
+
+        if ( atomic_fetch_add_explicit(&fanout->done, 1, memory_order_acq_rel)+1 == fanout->chunks ) {
+            pthread_mutex_lock(&fanout->lock);
+            pthread_cond_signal(&fanout->finished);
+            pthread_mutex_unlock(&fanout->lock);
+        }
+    }
+
+    WSS_session_leave();
+
+    WSS_message_delivery_end();
+
+    delivery = outer;
+}
+
+/**
+ * Task performed by a worker of the threadpool that helps sending the chunks
+ * of a fanout.
+ *
+ * @param 	arg	    [void *] 	"The fanout"
+ * @return 	        [void]
+ */
+static void fanout_task(void *arg) {
+    wss_fanout_t *fanout = (wss_fanout_t *) arg;
+
+    WSS_arena_enter();
+    fanout_send(fanout);
+    WSS_arena_leave();
+
+    fanout_release(fanout);
+}
+
+/**
+ * Splits a message sent to many sessions into chunks that idle workers of the
+ * threadpool help sending. The calling thread sends chunks as well and
+ * returns once every chunk has been sent, such that a message sent afterwards
+ * is never queued before this one.
+ *
+ * @param 	server	        [wss_server_t *] 	"The server whose threadpool should help"
+ * @param 	fds	            [int *] 	        "The sessions to send the message to"
+ * @param 	fds_count	    [size_t] 	        "The amount of sessions"
+ * @param 	opcode	        [wss_opcode_t] 	    "The opcode of the frames of the message"
+ * @param 	message	        [char *] 	        "The message"
+ * @param 	message_length	[uint64_t] 	        "The length of the message"
+ * @return 	                [bool] 	            "Whether the message was sent"
+ */
+static bool message_fanout(wss_server_t *server, int *fds, size_t fds_count, wss_opcode_t opcode, char *message, uint64_t message_length) {
+    size_t i, helpers;
+    wss_fanout_t *fanout;
+
+    if ( unlikely(NULL == (fanout = WSS_malloc(sizeof(wss_fanout_t)))) ) {
+        return false;
+    }
+
+    if ( unlikely(NULL == (fanout->shared = WSS_shared_create(server->config, opcode, message, message_length))) ) {
+        WSS_free((void **) &fanout);
+        return false;
+    }
+
+    // Without the lock the helpers could never be waited for, hence the
+    // message is sent by the calling thread alone
+    if ( unlikely(pthread_mutex_init(&fanout->lock, NULL) != 0) ) {
+        WSS_log_error("Unable to initialize fanout lock");
+        WSS_shared_release(fanout->shared);
+        WSS_free((void **) &fanout);
+        return false;
+    }
+
+    if ( unlikely(pthread_cond_init(&fanout->finished, NULL) != 0) ) {
+        WSS_log_error("Unable to initialize fanout condition");
+        pthread_mutex_destroy(&fanout->lock);
+        WSS_shared_release(fanout->shared);
+        WSS_free((void **) &fanout);
+        return false;
+    }
+
+    atomic_init(&fanout->references, 1);
+    atomic_init(&fanout->next, 0);
+    atomic_init(&fanout->done, 0);
+    fanout->chunk = server->config->pool_fanout;
+    fanout->chunks = (fds_count+fanout->chunk-1)/fanout->chunk;
+    fanout->fds = fds;
+    fanout->fds_count = fds_count;
+    fanout->opcode = opcode;
+    fanout->message = message;
+    fanout->message_length = message_length;
+
+    helpers = MIN(fanout->chunks-1, server->config->pool_workers);
+
+    WSS_log_trace("Splitting message to %zu sessions into %zu chunks", fds_count, fanout->chunks);
+
+    // Helpers that are not started before the chunks run out return right away
+    for (i = 0; likely(i < helpers); i++) {
+        atomic_fetch_add_explicit(&fanout->references, 1, memory_order_relaxed);
+        if ( unlikely(threadpool_add(server->pool, fanout_task, fanout, 0) != 0) ) {
+            atomic_fetch_sub_explicit(&fanout->references, 1, memory_order_relaxed);
+            break;
+        }
+    }
+
+    fanout_send(fanout);
+
+    pthread_mutex_lock(&fanout->lock);
+    while ( atomic_load_explicit(&fanout->done, memory_order_acquire) < fanout->chunks ) {
+        pthread_cond_wait(&fanout->finished, &fanout->lock);
+    }
+    pthread_mutex_unlock(&fanout->lock);
+
+    fanout_release(fanout);
+
+    return true;
+}
+
+void WSS_message_send_many(int *fds, size_t fds_count, wss_opcode_t opcode, char *message, uint64_t message_length) {
+    size_t i;
+    wss_session_t *session = NULL;
+    wss_server_t *server = NULL;
+    wss_delivery_t outer = delivery;
+
+    if ( unlikely(NULL == fds || fds_count == 0) ) {
+        return;
+    }
+
+    WSS_log_trace("Sending message to %zu sessions", fds_count);
+
+    WSS_session_enter();
+
+    // The threadpool of the server of the recipients helps sending to many
+    for (i = 0; likely(i < fds_count && NULL == session); i++) {
+        session = WSS_session_find(fds[i]);
+    }
+
+    if ( likely(NULL != session) ) {
+        server = session->server;
+    }
+
+    if ( unlikely(NULL != server && NULL != server->pool && server->config->pool_fanout > 0 &&
+                fds_count > server->config->pool_fanout && opcode != CLOSE_FRAME &&
+                message_fanout(server, fds, fds_count, opcode, message, message_length)) ) {
+        WSS_session_leave();
+        return;
     }
-    WSS_free((void **) &frames);
+
+    // The recipients that have to queue the message share a single copy of it
+    WSS_message_delivery_begin(opcode, message, message_length);
+
+    message_send_fds(fds, fds_count, opcode, message, message_length);
+
+    WSS_message_delivery_end();
+
+    delivery = outer;
+
+    WSS_session_leave();
+}
+
+wss_message_t *WSS_message_create(wss_config_t *config, wss_opcode_t opcode, char *payload, size_t payload_length, bool owned) {
+    size_t i, n, frames_count, offset = 0, header_length = 0;
+    wss_frame_t frame;
+    wss_message_t *m;
+
+    if ( unlikely(NULL == config || config->size_frame == 0 || (NULL == payload && payload_length != 0)) ) {
+        return NULL;
+    }
+
+    frames_count = MAX(1, (payload_length+config->size_frame-1)/config->size_frame);
+
+    if ( unlikely(NULL == (m = WSS_arena_malloc(sizeof(wss_message_t)))) ) {
+        return NULL;
+    }
+
+    if ( unlikely(NULL == (m->msg = WSS_arena_malloc(frames_count*WSS_FRAME_HEADER_SIZE))) ) {
+        WSS_arena_free((void **) &m);
+        return NULL;
+    }
+
+    if ( unlikely(NULL == (m->iov = WSS_arena_malloc(2*frames_count*sizeof(struct iovec)))) ) {
+        WSS_arena_free((void **) &m->msg);
+        WSS_arena_free((void **) &m);
+        return NULL;
+    }
+
+    memset(&frame, '\0', sizeof(frame));
+
+    for (i = 0; likely(i < frames_count); i++) {
+        frame.fin = i == frames_count-1;
+        frame.opcode = i == 0 ? opcode : CONTINUATION_FRAME;
+        frame.payloadLength = MIN(payload_length-offset, config->size_frame);
+
+        n = WSS_frame_header(&frame, m->msg+header_length);
+
+        m->iov[2*i].iov_base = m->msg+header_length;
+        m->iov[2*i].iov_len = n;
+        m->iov[2*i+1].iov_base = payload+offset;
+        m->iov[2*i+1].iov_len = frame.payloadLength;
+
+        header_length += n;
+        offset += frame.payloadLength;
+    }
+
+    m->iov_count = 2*frames_count;
+    m->length = header_length+payload_length;
+    m->payload = payload;
+    m->owned = owned;
+    m->framed = true;
+
+    return m;
+}
+
+size_t WSS_message_iov(wss_message_t *message, size_t offset, struct iovec *iov, size_t count) {
+    size_t i, n = 0;
+
+    if ( likely(NULL == message->iov) ) {
+        if ( unlikely(offset >= message->length || count == 0) ) {
+            return 0;
+        }
+
+        iov[0].iov_base = message->msg+offset;
+        iov[0].iov_len = message->length-offset;
+
+        return 1;
+    }
+
+    for (i = 0; likely(i < message->iov_count && n < count); i++) {
+        if (offset >= message->iov[i].iov_len) {
+            offset -= message->iov[i].iov_len;
+            continue;
+        }
+
+        iov[n].iov_base = (char *) message->iov[i].iov_base+offset;
+        iov[n].iov_len = message->iov[i].iov_len-offset;
+        offset = 0;
+        n++;
+    }
+
+    return n;
 }
 
 void WSS_message_free(wss_message_t *msg) {
     if (NULL != msg) {
-        if (NULL != msg->msg) {
-            WSS_free((void **)&msg->msg); 
+        if (NULL != msg->shared) {
+            WSS_shared_release(msg->shared);
+        } else if (NULL != msg->msg) {
+            WSS_arena_free((void **)&msg->msg); 
+        }
+        if (NULL != msg->iov) {
+            WSS_arena_free((void **)&msg->iov); 
+        }
+        if (msg->owned) {
+            WSS_free((void **)&msg->payload); 
+        }
+        WSS_arena_free((void **)&msg);
+    }
+}
+
+/**
+ * Copies the bytes of a message into a new shared buffer, which holds a
+ * single reference.
+ *
+ * @param 	msg	[wss_message_t *] 	"The message to copy"
+ * @return 	    [wss_shared_t *] 	"The shared buffer or NULL"
+ */
+static wss_shared_t *shared_copy(wss_message_t *msg) {
+    size_t i, offset = 0;
+    wss_shared_t *shared;
+
+    if ( unlikely(NULL == (shared = WSS_malloc(sizeof(wss_shared_t)+msg->length))) ) {
+        return NULL;
+    }
+
+    if ( likely(NULL != msg->iov) ) {
+        for (i = 0; likely(i < msg->iov_count); i++) {
+            memcpy(shared->bytes+offset, msg->iov[i].iov_base, msg->iov[i].iov_len);
+            offset += msg->iov[i].iov_len;
+        }
+    } else {
+        memcpy(shared->bytes, msg->msg, msg->length);
+    }
+
+    atomic_init(&shared->references, 1);
+    shared->length = msg->length;
+
+    return shared;
+}
+
+/**
+ * Copies the segments of a message that references a payload into a single
+ * buffer on the heap. Messages referencing the payload being delivered share
+ * one copy of it.
+ *
+ * @param 	msg	[wss_message_t *] 	"The message to copy"
+ * @return 	    [wss_message_t *] 	"The message on the heap or NULL, in which case the message is freed"
+ */
+static wss_message_t *message_flatten(wss_message_t *msg) {
+    wss_shared_t *shared;
+    wss_message_t *m;
+
+    if ( msg->shareable && NULL != delivery.shared ) {
+        WSS_log_trace("Sharing copy of delivered message");
+
+        shared = delivery.shared;
+        atomic_fetch_add_explicit(&shared->references, 1, memory_order_relaxed);
+    } else if ( unlikely(NULL == (shared = shared_copy(msg))) ) {
+        WSS_message_free(msg);
+        return NULL;
+    } else if ( msg->shareable ) {
+        // The delivery keeps a reference, such that later recipients can share it
+        atomic_fetch_add_explicit(&shared->references, 1, memory_order_relaxed);
+        delivery.shared = shared;
+    }
+
+    if ( unlikely(NULL == (m = WSS_malloc(sizeof(wss_message_t)))) ) {
+        WSS_shared_release(shared);
+        WSS_message_free(msg);
+        return NULL;
+    }
+    m->msg = shared->bytes;
+    m->length = shared->length;
+    m->framed = msg->framed;
+    m->shared = shared;
+
+    WSS_message_free(msg);
+
+    return m;
+}
+
+wss_message_t *WSS_message_promote(wss_message_t *msg) {
+    size_t i;
+    wss_message_t *m;
+    struct iovec *iov;
+    char *out = msg->msg;
+
+    if ( NULL != msg->iov && ! msg->owned ) {
+        return message_flatten(msg);
+    }
+
+    // The segments of the headers follow the headers to the heap
+    if ( NULL != msg->iov ) {
+        if ( unlikely(NULL == (iov = WSS_arena_promote(msg->iov))) ) {
+            WSS_message_free(msg);
+            return NULL;
         }
-        WSS_free((void **)&msg);
+        if ( unlikely(NULL == (out = WSS_arena_promote(out))) ) {
+            if (iov != msg->iov) {
+                WSS_free((void **) &iov);
+            }
+            WSS_message_free(msg);
+            return NULL;
+        }
+        for (i = 0; likely(i < msg->iov_count); i += 2) {
+            iov[i].iov_base = out+((char *) iov[i].iov_base-msg->msg);
+        }
+        msg->iov = iov;
+        msg->msg = out;
+
+        if ( unlikely(NULL == (m = WSS_arena_promote(msg))) ) {
+            WSS_message_free(msg);
+            return NULL;
+        }
+
+        return m;
+    }
+
+    if ( unlikely(NULL != out && NULL == (out = WSS_arena_promote(out))) ) {
+        WSS_message_free(msg);
+        return NULL;
+    }
+
+    if ( unlikely(NULL == (m = WSS_arena_promote(msg))) ) {
+        if (out != msg->msg) {
+            WSS_free((void **) &out);
+        }
+        WSS_message_free(msg);
+        return NULL;
+    }
+    m->msg = out;
+
+    return m;
+}
+
+wss_shared_t *WSS_shared_create(wss_config_t *config, wss_opcode_t opcode, char *payload, size_t payload_length) {
+    wss_message_t *m;
+    wss_shared_t *shared;
+
+    WSS_arena_enter();
+
+    if ( unlikely(NULL == (m = WSS_message_create(config, opcode, payload, payload_length, false))) ) {
+        WSS_arena_leave();
+        return NULL;
+    }
+
+    shared = shared_copy(m);
+
+    WSS_message_free(m);
+
+    WSS_arena_leave();
+
+    return shared;
+}
+
+void WSS_shared_release(wss_shared_t *shared) {
+    if ( NULL != shared && 1 == atomic_fetch_sub_explicit(&shared->references, 1, memory_order_acq_rel) ) {
+        WSS_free((void **) &shared);
     }
 }
+
+wss_message_t *WSS_message_share(wss_shared_t *shared) {
+    wss_message_t *m;
+
+    if ( unlikely(NULL == shared || NULL == (m = WSS_arena_malloc(sizeof(wss_message_t)))) ) {
+        return NULL;
+    }
+
+    atomic_fetch_add_explicit(&shared->references, 1, memory_order_relaxed);
+
+    m->msg = shared->bytes;
+    m->length = shared->length;
+    m->framed = true;
+    m->shared = shared;
+
+    return m;
+}
+
+void WSS_message_delivery_begin(wss_opcode_t opcode, char *payload, size_t payload_length) {
+    delivery.payload = payload;
+    delivery.length = payload_length;
+    delivery.opcode = opcode;
+    delivery.shared = NULL;
+}
+
+void WSS_message_delivery_end() {
+    WSS_shared_release(delivery.shared);
+
+    delivery.payload = NULL;
+    delivery.length = 0;
+    delivery.opcode = 0;
+    delivery.shared = NULL;
+}
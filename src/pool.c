@@ -32,17 +32,38 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 
 #include "pool.h"
 #include "alloc.h"
 
+/* Minimal amount of tasks each worker deque can hold */
+#define THREADPOOL_DEQUE_MIN 64
+
+/* Maximal amount of tasks each worker deque can hold, further tasks scheduled
+ * by a worker are added to the injection queue */
+#define THREADPOOL_DEQUE_MAX 1024
+
+/* Amount of times an idle worker looks for tasks before it parks */
+#define THREADPOOL_SPINS 16
+
 typedef enum {
     immediate_shutdown = 1,
     graceful_shutdown  = 2
 } threadpool_shutdown_t;
 
+typedef enum {
+    thread_free    = 0,
+    thread_running = 1,
+    thread_exited  = 2
+} threadpool_thread_state_t;
+
 /**
  *  @struct threadpool_task
  *  @brief the work struct
@@ -56,6 +77,51 @@ typedef struct {
     void *argument;
 } threadpool_task_t;
 
+/**
+ *  @struct threadpool_slot
+ *  @brief A task slot that can be read by other threads while being written
+ *
+ *  @var sequence Sequence number used by the injection queue.
+ *  @var function Pointer to the function that will perform the task.
+ *  @var argument Argument to be passed to the function.
+ */
+typedef struct {
+    atomic_long sequence;
+    _Atomic(void (*)(void *)) function;
+    _Atomic(void *) argument;
+} threadpool_slot_t;
+
+/**
+ *  @struct threadpool_deque
+ *  @brief A bounded Chase-Lev deque. The owning worker pushes and pops at the
+ *  bottom, while other workers steal from the top.
+ *
+ *  @var top    Index of the oldest task, advanced by thieves.
+ *  @var bottom Index of the next free slot, only written by the owner.
+ *  @var mask   Size of the deque minus one (size is a power of two).
+ *  @var slots  Array containing the tasks.
+ */
+typedef struct {
+    atomic_long top;
+    atomic_long bottom;
+    long mask;
+    threadpool_slot_t *slots;
+} threadpool_deque_t;
+
+/**
+ *  @struct threadpool_worker
+ *  @brief State of a single worker of a work stealing pool
+ *
+ *  @var pool  The pool which own the worker.
+ *  @var seed  Seed used to pick victims to steal from.
+ *  @var deque The deque of tasks owned by the worker.
+ */
+typedef struct {
+    struct threadpool_t *pool;
+    unsigned int seed;
+    threadpool_deque_t deque;
+} threadpool_worker_t;
+
 /**
  *  @struct threadpool
  *  @brief The threadpool struct
@@ -63,7 +129,17 @@ typedef struct {
  *  @var attr 		  Attribute variable to give the thread attributes.
  *  @var notify       Condition variable to notify worker threads.
  *  @var threads      Array containing worker threads ID.
+ *  @var thread_states State of each entry in the threads array.
+ *  @var threads_length Number of entries in the threads array.
  *  @var thread_count Number of threads
+ *  @var min_threads  Number of threads the pool never shrinks below.
+ *  @var max_threads  Number of threads the pool may grow to.
+ *  @var max_queue    Size the task queue may grow to.
+ *  @var idle_timeout Milliseconds a surplus thread may idle before retiring.
+ *  @var idle         Number of threads waiting for tasks.
+ *  @var idle_routine Function called by a thread that has waited for tasks
+ *                    for idle_routine_timeout milliseconds.
+ *  @var idle_routine_timeout Milliseconds before idle_routine is called.
  *  @var queue        Array containing the task queue.
  *  @var queue_size   Size of the task queue.
  *  @var head         Index of the first element.
@@ -71,22 +147,67 @@ typedef struct {
  *  @var count        Number of pending tasks
  *  @var shutdown     Flag indicating if the pool is shutting down
  *  @var started      Number of started threads
+ *  @var flags        Flags given when the pool was created
+ *  @var workers      Array containing the workers of a work stealing pool.
+ *  @var workers_length Number of workers allocated.
+ *  @var inject       Queue used to hand tasks to a work stealing pool from
+ *                    threads that are not workers of the pool.
+ *  @var inject_mask  Size of the injection queue minus one.
+ *  @var inject_head  Index of the next task to take from the injection queue.
+ *  @var inject_tail  Index of the next free slot in the injection queue.
+ *  @var sleepers     Number of workers about to park or parked.
+ *  @var wakeups      Incremented every time parked workers are notified.
+ *  @var tasks        Number of tasks added.
+ *  @var steals       Number of tasks stolen from other workers.
+ *  @var parks        Number of times a worker parked.
+ *  @var spawned      Number of threads started beyond the initial ones.
+ *  @var retired      Number of idle threads that retired.
+ *  @var resizes      Number of times the task queue grew.
  */
 struct threadpool_t {
     pthread_mutex_t lock;
     pthread_cond_t notify;
     pthread_attr_t attr;
     pthread_t *threads;
+    threadpool_thread_state_t *thread_states;
+    int threads_length;
     threadpool_task_t *queue;
     int thread_count;
+    int min_threads;
+    int max_threads;
+    int max_queue;
+    int idle_timeout;
+    int idle;
+    void (*idle_routine)(void);
+    int idle_routine_timeout;
     int queue_size;
     int head;
     int tail;
     int count;
-    int shutdown;
-    int started;
+    atomic_int shutdown;
+    atomic_int started;
+    int flags;
+    threadpool_worker_t *workers;
+    int workers_length;
+    threadpool_slot_t *inject;
+    long inject_mask;
+    atomic_long inject_head;
+    atomic_long inject_tail;
+    atomic_int sleepers;
+    unsigned long wakeups;
+    atomic_ulong tasks;
+    atomic_ulong steals;
+    atomic_ulong parks;
+    unsigned long spawned;
+    unsigned long retired;
+    unsigned long resizes;
 };
 
+/**
+ * The worker of a work stealing pool that is running on the current thread
+ */
+static _Thread_local threadpool_worker_t *current_worker = NULL;
+
 /**
  * @function void *threadpool_thread(void *threadpool)
  * @brief the worker thread
@@ -94,8 +215,300 @@ struct threadpool_t {
  */
 static void *threadpool_thread(void *threadpool);
 
+/**
+ * @function void *threadpool_stealing_thread(void *worker)
+ * @brief the worker thread of a work stealing pool
+ * @param worker the worker state owned by the thread
+ */
+static void *threadpool_stealing_thread(void *worker);
+
 int threadpool_free(threadpool_t *pool);
 
+static long threadpool_pow2(long n) {
+    long size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+/**
+ * Pushes a task at the bottom of a deque. Must only be called by the owner.
+ */
+static int deque_push(threadpool_deque_t *deque, void (*function)(void *), void *argument) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    threadpool_slot_t *slot;
+
+    if (b - t > deque->mask) {
+        return -1;
+    }
+
+    slot = &deque->slots[b & deque->mask];
+    atomic_store_explicit(&slot->function, function, memory_order_relaxed);
+    atomic_store_explicit(&slot->argument, argument, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+
+    return 0;
+}
+
+/**
+ * Pops the newest task from the bottom of a deque. Must only be called by the
+ * owner.
+ */
+static int deque_pop(threadpool_deque_t *deque, threadpool_task_t *task) {
+    int found = 1;
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    long t;
+    threadpool_slot_t *slot;
+
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return 0;
+    }
+
+    slot = &deque->slots[b & deque->mask];
+    task->function = atomic_load_explicit(&slot->function, memory_order_relaxed);
+    task->argument = atomic_load_explicit(&slot->argument, memory_order_relaxed);
+
+    if (t == b) {
+        /* Last task, race against thieves */
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                    memory_order_seq_cst, memory_order_relaxed)) {
+            found = 0;
+        }
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+
+    return found;
+}
+
+/**
+ * Steals the oldest task from the top of a deque owned by another worker.
+ */
+static int deque_steal(threadpool_deque_t *deque, threadpool_task_t *task) {
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    long b;
+    threadpool_slot_t *slot;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (t >= b) {
+        return 0;
+    }
+
+    slot = &deque->slots[t & deque->mask];
+    task->function = atomic_load_explicit(&slot->function, memory_order_relaxed);
+    task->argument = atomic_load_explicit(&slot->argument, memory_order_relaxed);
+
+    return atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed);
+}
+
+/**
+ * Adds a task to the bounded multi-producer/multi-consumer injection queue.
+ */
+static int inject_push(threadpool_t *pool, void (*function)(void *), void *argument) {
+    threadpool_slot_t *slot;
+    long sequence, diff;
+    long pos = atomic_load_explicit(&pool->inject_tail, memory_order_relaxed);
+
+    for (;;) {
+        slot = &pool->inject[pos & pool->inject_mask];
+        sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        diff = sequence - pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&pool->inject_tail, &pos, pos + 1,
+                        memory_order_seq_cst, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&pool->inject_tail, memory_order_relaxed);
+        }
+    }
+
+    atomic_store_explicit(&slot->function, function, memory_order_relaxed);
+    atomic_store_explicit(&slot->argument, argument, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+
+    return 0;
+}
+
+/**
+ * Takes a task from the injection queue.
+ */
+static int inject_pop(threadpool_t *pool, threadpool_task_t *task) {
+    threadpool_slot_t *slot;
+    long sequence, diff;
+    long pos = atomic_load_explicit(&pool->inject_head, memory_order_relaxed);
+
+    for (;;) {
+        slot = &pool->inject[pos & pool->inject_mask];
+        sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        diff = sequence - (pos + 1);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&pool->inject_head, &pos, pos + 1,
+                        memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&pool->inject_head, memory_order_relaxed);
+        }
+    }
+
+    task->function = atomic_load_explicit(&slot->function, memory_order_relaxed);
+    task->argument = atomic_load_explicit(&slot->argument, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, pos + pool->inject_mask + 1, memory_order_release);
+
+    return 1;
+}
+
+/**
+ * Whether any task is waiting in the injection queue or any worker deque.
+ */
+static int threadpool_has_work(threadpool_t *pool) {
+    int i;
+
+    if (atomic_load(&pool->inject_tail) != atomic_load(&pool->inject_head)) {
+        return 1;
+    }
+
+    for (i = 0; i < pool->thread_count; i++) {
+        if (atomic_load(&pool->workers[i].deque.bottom) > atomic_load(&pool->workers[i].deque.top)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Wakes a parked worker, if any. The common case where no workers are parked
+ * costs no system calls.
+ */
+static void threadpool_notify(threadpool_t *pool) {
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load(&pool->sleepers) > 0) {
+        pthread_mutex_lock(&(pool->lock));
+        pool->wakeups++;
+        pthread_cond_signal(&(pool->notify));
+        pthread_mutex_unlock(&(pool->lock));
+    }
+}
+
+/**
+ * Finds the next task for a worker, first from its own deque, then from the
+ * injection queue and lastly by stealing from the other workers.
+ */
+static int threadpool_next(threadpool_worker_t *worker, threadpool_task_t *task) {
+    int i, victim;
+    threadpool_t *pool = worker->pool;
+
+    if (deque_pop(&worker->deque, task)) {
+        return 1;
+    }
+
+    if (inject_pop(pool, task)) {
+        return 1;
+    }
+
+    if (pool->thread_count > 1) {
+        victim = rand_r(&worker->seed) % pool->thread_count;
+        for (i = 0; i < pool->thread_count; i++, victim = (victim + 1) % pool->thread_count) {
+            if (&pool->workers[victim] == worker) {
+                continue;
+            }
+
+            if (deque_steal(&pool->workers[victim].deque, task)) {
+                atomic_fetch_add_explicit(&pool->steals, 1, memory_order_relaxed);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Starts an additional worker thread. Must be called while holding the lock.
+ */
+static int threadpool_spawn(threadpool_t *pool) {
+    int i;
+
+    for (i = 0; i < pool->threads_length; i++) {
+        if (pool->thread_states[i] != thread_running) {
+            break;
+        }
+    }
+
+    if (i == pool->threads_length) {
+        return -1;
+    }
+
+    /* Reap the thread that previously retired from this slot */
+    if (pool->thread_states[i] == thread_exited) {
+        pthread_join(pool->threads[i], NULL);
+        pool->thread_states[i] = thread_free;
+    }
+
+    if (pthread_create(&(pool->threads[i]), &pool->attr, threadpool_thread,
+                (void*) pool) != 0) {
+        return -1;
+    }
+
+    pool->thread_states[i] = thread_running;
+    pool->thread_count++;
+    pool->started++;
+    pool->spawned++;
+
+    return 0;
+}
+
+/**
+ * Doubles the size of the task queue, bounded by the maximal queue size. Must
+ * be called while holding the lock.
+ */
+static int threadpool_grow(threadpool_t *pool) {
+    int i, size;
+    threadpool_task_t *queue;
+
+    if (pool->queue_size >= pool->max_queue) {
+        return -1;
+    }
+
+    size = pool->queue_size > pool->max_queue/2 ? pool->max_queue : pool->queue_size*2;
+    if ((queue = (threadpool_task_t *) WSS_malloc(sizeof(threadpool_task_t) * size)) == NULL) {
+        return -1;
+    }
+
+    /* Unwrap the ring such that the pending tasks start at the beginning */
+    for (i = 0; i < pool->count; i++) {
+        queue[i] = pool->queue[(pool->head + i) % pool->queue_size];
+    }
+
+    WSS_free((void **) &pool->queue);
+    pool->queue = queue;
+    pool->queue_size = size;
+    pool->head = 0;
+    pool->tail = pool->count;
+    pool->resizes++;
+
+    return 0;
+}
+
 char *threadpool_strerror(int err) {
     switch (err) {
         case threadpool_thread_failure:
@@ -129,6 +542,7 @@ threadpool_t *threadpool_create(int thread_count, int queue_size,
     pool->queue_size = queue_size;
     pool->head = pool->tail = pool->count = 0;
     pool->shutdown = pool->started = 0;
+    pool->flags = flags;
 
     /* Allocate attributes */
     pthread_attr_init(&pool->attr);
@@ -136,23 +550,72 @@ threadpool_t *threadpool_create(int thread_count, int queue_size,
 
     /* Allocate thread and task queue */
     pool->threads = (pthread_t *) WSS_malloc(sizeof(pthread_t) * thread_count);
-    pool->queue = (threadpool_task_t *) WSS_malloc(sizeof(threadpool_task_t) * queue_size);
+    pool->thread_states = (threadpool_thread_state_t *) WSS_malloc(sizeof(threadpool_thread_state_t) * thread_count);
+    pool->threads_length = thread_count;
+    pool->min_threads = pool->max_threads = thread_count;
+    pool->max_queue = queue_size;
+
+    if (flags & threadpool_work_stealing) {
+        long deque_size = threadpool_pow2(queue_size / (thread_count > 0 ? thread_count : 1));
+        if (deque_size < THREADPOOL_DEQUE_MIN) {
+            deque_size = THREADPOOL_DEQUE_MIN;
+        }
+        if (deque_size > THREADPOOL_DEQUE_MAX) {
+            deque_size = THREADPOOL_DEQUE_MAX;
+        }
+
+        pool->inject_mask = threadpool_pow2(queue_size) - 1;
+        pool->inject = (threadpool_slot_t *) WSS_malloc(sizeof(threadpool_slot_t) * (pool->inject_mask + 1));
+        pool->workers = (threadpool_worker_t *) WSS_malloc(sizeof(threadpool_worker_t) * thread_count);
+
+        if (pool->inject != NULL) {
+            for (i = 0; i <= pool->inject_mask; i++) {
+                atomic_init(&pool->inject[i].sequence, i);
+            }
+        }
+
+        for (i = 0; pool->workers != NULL && i < thread_count; i++) {
+            pool->workers_length++;
+            pool->workers[i].pool = pool;
+            pool->workers[i].seed = (unsigned int) i + 1;
+            pool->workers[i].deque.mask = deque_size - 1;
+            pool->workers[i].deque.slots = (threadpool_slot_t *) WSS_malloc(sizeof(threadpool_slot_t) * deque_size);
+            if (pool->workers[i].deque.slots == NULL) {
+                WSS_free((void **) &pool->inject);
+                break;
+            }
+        }
+
+        if (pool->workers == NULL) {
+            WSS_free((void **) &pool->inject);
+        }
+    } else {
+        pool->queue = (threadpool_task_t *) WSS_malloc(sizeof(threadpool_task_t) * queue_size);
+    }
 
     /* Initialize mutex and conditional variable first */
     if ( (pthread_mutex_init(&(pool->lock), NULL) != 0) ||
             (pthread_cond_init(&(pool->notify), NULL) != 0) ||
             (pool->threads == NULL) ||
-            (pool->queue == NULL)) {
+            (pool->thread_states == NULL) ||
+            (pool->queue == NULL && pool->inject == NULL)) {
         goto err;
     }
 
     /* Start worker threads */
     for (i = 0; i < thread_count; i++) {
-        if (pthread_create(&(pool->threads[i]), &pool->attr, threadpool_thread,
+        if (flags & threadpool_work_stealing) {
+            if (pthread_create(&(pool->threads[i]), &pool->attr, threadpool_stealing_thread,
+                        (void*) &pool->workers[i]) != 0) {
+                threadpool_destroy(pool, 0);
+                return NULL;
+            }
+        } else if (pthread_create(&(pool->threads[i]), &pool->attr, threadpool_thread,
                     (void*) pool) != 0) {
             threadpool_destroy(pool, 0);
             return NULL;
         }
+        pool->thread_states[i] = thread_running;
         pool->thread_count++;
         pool->started++;
     }
@@ -166,6 +629,71 @@ err:
     return NULL;
 }
 
+int threadpool_set_limits(threadpool_t *pool, int max_threads, int max_queue,
+        int idle_timeout) {
+    int err = 0;
+    pthread_t *threads;
+    threadpool_thread_state_t *states;
+
+    if (NULL == pool || (pool->flags & threadpool_work_stealing) || idle_timeout < 0) {
+        return threadpool_invalid;
+    }
+
+    if (pthread_mutex_lock(&(pool->lock)) != 0) {
+        return threadpool_lock_failure;
+    }
+
+    do {
+        if (max_threads > pool->threads_length) {
+            threads = (pthread_t *) WSS_malloc(sizeof(pthread_t) * max_threads);
+            states = (threadpool_thread_state_t *) WSS_malloc(sizeof(threadpool_thread_state_t) * max_threads);
+            if (threads == NULL || states == NULL) {
+                WSS_free((void **) &threads);
+                WSS_free((void **) &states);
+                err = threadpool_invalid;
+                break;
+            }
+
+            memcpy(threads, pool->threads, sizeof(pthread_t) * pool->threads_length);
+            memcpy(states, pool->thread_states, sizeof(threadpool_thread_state_t) * pool->threads_length);
+            WSS_free((void **) &pool->threads);
+            WSS_free((void **) &pool->thread_states);
+            pool->threads = threads;
+            pool->thread_states = states;
+            pool->threads_length = max_threads;
+        }
+
+        pool->max_threads = max_threads > pool->min_threads ? max_threads : pool->min_threads;
+        pool->max_queue = max_queue > pool->queue_size ? max_queue : pool->queue_size;
+        pool->idle_timeout = idle_timeout;
+    } while(0);
+
+    if (pthread_mutex_unlock(&pool->lock) != 0) {
+        err = threadpool_lock_failure;
+    }
+
+    return err;
+}
+
+int threadpool_set_idle(threadpool_t *pool, void (*routine)(void), int timeout) {
+    if (NULL == pool || timeout < 0) {
+        return threadpool_invalid;
+    }
+
+    if (pthread_mutex_lock(&(pool->lock)) != 0) {
+        return threadpool_lock_failure;
+    }
+
+    pool->idle_routine = timeout > 0 ? routine : NULL;
+    pool->idle_routine_timeout = timeout;
+
+    if (pthread_mutex_unlock(&pool->lock) != 0) {
+        return threadpool_lock_failure;
+    }
+
+    return 0;
+}
+
 int threadpool_add(threadpool_t *pool, void (*function)(void *),
         void *argument, int flags){
     int err = 0;
@@ -177,6 +705,24 @@ int threadpool_add(threadpool_t *pool, void (*function)(void *),
         return threadpool_invalid;
     }
 
+    if (pool->flags & threadpool_work_stealing) {
+        if (pool->shutdown) {
+            return threadpool_shutdown;
+        }
+
+        /* Workers of the pool push to their own deque */
+        if ( (NULL == current_worker || current_worker->pool != pool ||
+                    deque_push(&current_worker->deque, function, argument) != 0) &&
+                inject_push(pool, function, argument) != 0 ) {
+            return threadpool_queue_full;
+        }
+
+        atomic_fetch_add_explicit(&pool->tasks, 1, memory_order_relaxed);
+        threadpool_notify(pool);
+
+        return 0;
+    }
+
     if (pthread_mutex_lock(&(pool->lock)) != 0) {
         return threadpool_lock_failure;
     }
@@ -185,23 +731,33 @@ int threadpool_add(threadpool_t *pool, void (*function)(void *),
     next = (next == pool->queue_size) ? 0 : next;
 
     do {
-        /* Are we full ? */
-        if (pool->count == pool->queue_size) {
-            err = threadpool_queue_full;
-            break;
-        }
-
         /* Are we shutting down ? */
         if (pool->shutdown) {
             err = threadpool_shutdown;
             break;
         }
 
+        /* Are we full ? */
+        if (pool->count == pool->queue_size) {
+            if (threadpool_grow(pool) != 0) {
+                err = threadpool_queue_full;
+                break;
+            }
+            next = pool->tail + 1;
+            next = (next == pool->queue_size) ? 0 : next;
+        }
+
         /* Add task to queue */
         pool->queue[pool->tail].function = function;
         pool->queue[pool->tail].argument = argument;
         pool->tail = next;
         pool->count += 1;
+        atomic_fetch_add_explicit(&pool->tasks, 1, memory_order_relaxed);
+
+        /* Start another thread if no idle thread is left to take the task */
+        if (pool->count > pool->idle && pool->thread_count < pool->max_threads) {
+            threadpool_spawn(pool);
+        }
 
         /* pthread_cond_broadcast */
         if (pthread_cond_signal(&(pool->notify)) != 0) {
@@ -217,6 +773,112 @@ int threadpool_add(threadpool_t *pool, void (*function)(void *),
     return err;
 }
 
+int threadpool_add_batch(threadpool_t *pool, void (*function)(void *),
+        void **arguments, int count, int flags) {
+    int i, next, added = 0;
+    int err = 0;
+
+    (void) flags;
+
+    if (NULL == pool || NULL == function || NULL == arguments || count < 0) {
+        return threadpool_invalid;
+    }
+
+    if (pool->flags & threadpool_work_stealing) {
+        if (pool->shutdown) {
+            return threadpool_shutdown;
+        }
+
+        for (added = 0; added < count; added++) {
+            if ( (NULL == current_worker || current_worker->pool != pool ||
+                        deque_push(&current_worker->deque, function, arguments[added]) != 0) &&
+                    inject_push(pool, function, arguments[added]) != 0 ) {
+                break;
+            }
+        }
+
+        if (added == 0) {
+            return count == 0 ? 0 : threadpool_queue_full;
+        }
+
+        atomic_fetch_add_explicit(&pool->tasks, added, memory_order_relaxed);
+
+        /* Wake all parked workers at once, if there is more than one task */
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load(&pool->sleepers) > 0) {
+            pthread_mutex_lock(&(pool->lock));
+            pool->wakeups++;
+            if (added > 1) {
+                pthread_cond_broadcast(&(pool->notify));
+            } else {
+                pthread_cond_signal(&(pool->notify));
+            }
+            pthread_mutex_unlock(&(pool->lock));
+        }
+
+        return added;
+    }
+
+    if (pthread_mutex_lock(&(pool->lock)) != 0) {
+        return threadpool_lock_failure;
+    }
+
+    do {
+        /* Are we shutting down ? */
+        if (pool->shutdown) {
+            err = threadpool_shutdown;
+            break;
+        }
+
+        for (added = 0; added < count; added++) {
+            /* Are we full ? */
+            if (pool->count == pool->queue_size && threadpool_grow(pool) != 0) {
+                break;
+            }
+
+            next = pool->tail + 1;
+            next = (next == pool->queue_size) ? 0 : next;
+
+            /* Add task to queue */
+            pool->queue[pool->tail].function = function;
+            pool->queue[pool->tail].argument = arguments[added];
+            pool->tail = next;
+            pool->count += 1;
+        }
+
+        if (added == 0) {
+            err = count == 0 ? 0 : threadpool_queue_full;
+            break;
+        }
+
+        atomic_fetch_add_explicit(&pool->tasks, added, memory_order_relaxed);
+
+        /* Start a thread for every task no idle thread is left to take */
+        for (i = 0; i < added && pool->count - i > pool->idle &&
+                pool->thread_count < pool->max_threads; i++) {
+            if (threadpool_spawn(pool) != 0) {
+                break;
+            }
+        }
+
+        if (added > 1) {
+            if (pthread_cond_broadcast(&(pool->notify)) != 0) {
+                err = threadpool_lock_failure;
+                break;
+            }
+        } else if (pthread_cond_signal(&(pool->notify)) != 0) {
+            err = threadpool_lock_failure;
+            break;
+        }
+    } while(0);
+
+    if (pthread_mutex_unlock(&pool->lock) != 0) {
+        err = threadpool_lock_failure;
+    }
+
+    return err != 0 ? err : added;
+}
+
 int threadpool_destroy(threadpool_t *pool, int flags) {
     int i, err = 0;
 
@@ -237,6 +899,7 @@ int threadpool_destroy(threadpool_t *pool, int flags) {
 
         pool->shutdown = (flags & threadpool_graceful) ?
             graceful_shutdown : immediate_shutdown;
+        pool->wakeups++;
 
         /* Wake up all worker threads */
         if ( (pthread_cond_broadcast(&(pool->notify)) != 0) ||
@@ -245,11 +908,16 @@ int threadpool_destroy(threadpool_t *pool, int flags) {
             break;
         }
 
-        /* Join all worker thread */
-        for (i = 0; i < pool->thread_count; i++) {
+        /* Join all worker thread, including those that retired */
+        for (i = 0; i < pool->threads_length; i++) {
+            if (pool->thread_states[i] == thread_free) {
+                continue;
+            }
+
             if (pthread_join(pool->threads[i], NULL) != 0) {
                 err = threadpool_thread_failure;
             }
+            pool->thread_states[i] = thread_free;
         }
     } while(0);
 
@@ -260,15 +928,45 @@ int threadpool_destroy(threadpool_t *pool, int flags) {
     return err;
 }
 
+int threadpool_stats(threadpool_t *pool, threadpool_stats_t *stats) {
+    if (NULL == pool || NULL == stats) {
+        return threadpool_invalid;
+    }
+
+    stats->tasks = atomic_load_explicit(&pool->tasks, memory_order_relaxed);
+    stats->steals = atomic_load_explicit(&pool->steals, memory_order_relaxed);
+    stats->parks = atomic_load_explicit(&pool->parks, memory_order_relaxed);
+
+    pthread_mutex_lock(&(pool->lock));
+    stats->threads = (unsigned long) pool->thread_count;
+    stats->spawned = pool->spawned;
+    stats->retired = pool->retired;
+    stats->resizes = pool->resizes;
+    pthread_mutex_unlock(&(pool->lock));
+
+    return 0;
+}
+
 int threadpool_free(threadpool_t *pool) {
+    int i;
+
     if(NULL == pool || pool->started > 0) {
         return -1;
     }
 
+    if (pool->workers) {
+        for (i = 0; i < pool->workers_length; i++) {
+            WSS_free((void **) &pool->workers[i].deque.slots);
+        }
+        WSS_free((void **) &pool->workers);
+    }
+    WSS_free((void **) &pool->inject);
+
     /* Did we manage to allocate ? */
     if (pool->threads) {
         pthread_attr_destroy(&pool->attr);
         WSS_free((void **) &pool->threads);
+        WSS_free((void **) &pool->thread_states);
         WSS_free((void **) &pool->queue);
 
         /* Because we allocate pool->threads after initializing the
@@ -284,9 +982,90 @@ int threadpool_free(threadpool_t *pool) {
 }
 
 
+/**
+ * Computes the absolute deadline lying the given amount of milliseconds ahead.
+ */
+static void threadpool_deadline(struct timespec *deadline, int timeout) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout / 1000;
+    deadline->tv_nsec += (long) (timeout % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec += 1;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+/**
+ * Waits for a task. Threads beyond the minimal amount only wait for the idle
+ * timeout, after which 1 is returned to signal that the thread should retire.
+ * Threads that have not called the idle routine since their last task only
+ * wait for the timeout of the routine, after which 2 is returned to signal
+ * that the routine should be called. Must be called while holding the lock.
+ */
+static int threadpool_wait(threadpool_t *pool, int routine) {
+    struct timespec deadline;
+    int err;
+    int timeout = 0;
+    int retire = pool->thread_count > pool->min_threads && pool->idle_timeout != 0;
+
+    atomic_fetch_add_explicit(&pool->parks, 1, memory_order_relaxed);
+    pool->idle++;
+
+    if (retire) {
+        timeout = pool->idle_timeout;
+    }
+
+    if (routine && NULL != pool->idle_routine && (timeout == 0 || pool->idle_routine_timeout < timeout)) {
+        timeout = pool->idle_routine_timeout;
+        retire = 0;
+    }
+
+    if (timeout == 0) {
+        pthread_cond_wait(&(pool->notify), &(pool->lock));
+        pool->idle--;
+        return 0;
+    }
+
+    threadpool_deadline(&deadline, timeout);
+
+    err = pthread_cond_timedwait(&(pool->notify), &(pool->lock), &deadline);
+    pool->idle--;
+
+    if (err != ETIMEDOUT || pool->count != 0 || pool->shutdown) {
+        return 0;
+    }
+
+    if (! retire) {
+        return 2;
+    }
+
+    return pool->thread_count > pool->min_threads;
+}
+
+/**
+ * Marks the slot of the calling thread as exited, such that it can be joined
+ * and reused. Must be called while holding the lock.
+ */
+static void threadpool_retire(threadpool_t *pool) {
+    int i;
+    pthread_t self = pthread_self();
+
+    for (i = 0; i < pool->threads_length; i++) {
+        if (pool->thread_states[i] == thread_running && pthread_equal(pool->threads[i], self)) {
+            pool->thread_states[i] = thread_exited;
+            break;
+        }
+    }
+
+    pool->thread_count--;
+    pool->retired++;
+}
+
 static void *threadpool_thread(void *arguments) {
     threadpool_t *pool = (threadpool_t *)arguments;
     threadpool_task_t task;
+    int retire = 0;
+    int routine = 1;
 
 #ifdef USE_RPMALLOC
     rpmalloc_thread_initialize();
@@ -298,8 +1077,22 @@ static void *threadpool_thread(void *arguments) {
 
         /* Wait on condition variable, check for spurious wakeups.
            When returning from pthread_cond_wait(), we own the lock. */
-        while ( (pool->count == 0) && (!pool->shutdown) ) {
-            pthread_cond_wait(&(pool->notify), &(pool->lock));
+        while ( (pool->count == 0) && (!pool->shutdown) && !retire ) {
+            retire = threadpool_wait(pool, routine);
+
+            /* The idle routine is called once per idle period */
+            if (retire == 2) {
+                retire = 0;
+                routine = 0;
+                pthread_mutex_unlock(&(pool->lock));
+                pool->idle_routine();
+                pthread_mutex_lock(&(pool->lock));
+            }
+        }
+
+        if (retire) {
+            threadpool_retire(pool);
+            break;
         }
 
         if ( (pool->shutdown == immediate_shutdown) ||
@@ -313,6 +1106,7 @@ static void *threadpool_thread(void *arguments) {
         pool->head += 1;
         pool->head = (pool->head == pool->queue_size) ? 0 : pool->head;
         pool->count -= 1;
+        routine = 1;
 
         /* Unlock */
         pthread_mutex_unlock(&(pool->lock));
@@ -331,3 +1125,87 @@ static void *threadpool_thread(void *arguments) {
     pthread_exit(NULL);
     return NULL;
 }
+
+static void *threadpool_stealing_thread(void *arguments) {
+    threadpool_worker_t *worker = (threadpool_worker_t *)arguments;
+    threadpool_t *pool = worker->pool;
+    threadpool_task_t task;
+    struct timespec deadline;
+    unsigned long wakeups;
+    int spins = 0;
+    int routine = 1;
+    int expired;
+
+#ifdef USE_RPMALLOC
+    rpmalloc_thread_initialize();
+#endif
+
+    current_worker = worker;
+
+    for (;;) {
+        if (pool->shutdown == immediate_shutdown) {
+            break;
+        }
+
+        if (threadpool_next(worker, &task)) {
+            spins = 0;
+            routine = 1;
+            /* Get to work */
+            (*(task.function))(task.argument);
+            continue;
+        }
+
+        if (pool->shutdown == graceful_shutdown && !threadpool_has_work(pool)) {
+            break;
+        }
+
+        if (spins++ < THREADPOOL_SPINS) {
+            sched_yield();
+            continue;
+        }
+        spins = 0;
+
+        /* Park until notified. The sleepers counter is raised before work is
+           checked a final time, such that producers either see a sleeper or
+           the worker sees the task. */
+        expired = 0;
+        pthread_mutex_lock(&(pool->lock));
+        atomic_fetch_add(&pool->sleepers, 1);
+        if (!pool->shutdown && !threadpool_has_work(pool)) {
+            atomic_fetch_add_explicit(&pool->parks, 1, memory_order_relaxed);
+            wakeups = pool->wakeups;
+
+            /* Workers that have not called the idle routine since their last
+               task only park until the routine is due */
+            if (routine && NULL != pool->idle_routine) {
+                threadpool_deadline(&deadline, pool->idle_routine_timeout);
+                while (wakeups == pool->wakeups && !pool->shutdown && !expired) {
+                    expired = pthread_cond_timedwait(&(pool->notify), &(pool->lock), &deadline) == ETIMEDOUT;
+                }
+            }
+
+            while (wakeups == pool->wakeups && !pool->shutdown && !expired) {
+                pthread_cond_wait(&(pool->notify), &(pool->lock));
+            }
+        }
+        atomic_fetch_sub(&pool->sleepers, 1);
+        pthread_mutex_unlock(&(pool->lock));
+
+        /* The idle routine is called once per idle period */
+        if (expired) {
+            routine = 0;
+            pool->idle_routine();
+        }
+    }
+
+    current_worker = NULL;
+
+    pool->started--;
+
+#ifdef USE_RPMALLOC
+    rpmalloc_thread_finalize();
+#endif
+
+    pthread_exit(NULL);
+    return NULL;
+}
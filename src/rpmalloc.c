@@ -553,6 +553,8 @@ struct global_cache_t {
 	atomic32_t lock;
 	//! Cache count
 	uint32_t count;
+	//! Count of the spans at the bottom of the cache that are decommitted
+	uint32_t decommitted;
 	//! Cached spans
 	span_t* span[GLOBAL_CACHE_MULTIPLIER * MAX_THREAD_SPAN_CACHE];
 #if ENABLE_UNLIMITED_CACHE
@@ -787,6 +789,9 @@ _rpmalloc_mmap_os(size_t size, size_t* offset) {
 	void* ptr = mmap(0, size + padding, PROT_READ | PROT_WRITE, flags, fd, 0);
 #  elif defined(MAP_HUGETLB)
 	void* ptr = mmap(0, size + padding, PROT_READ | PROT_WRITE, (_memory_huge_pages ? MAP_HUGETLB : 0) | flags, -1, 0);
+	//Fall back to regular pages once the reserved huge pages are exhausted
+	if ((ptr == MAP_FAILED) && _memory_huge_pages)
+		ptr = mmap(0, size + padding, PROT_READ | PROT_WRITE, flags, -1, 0);
 #  elif defined(MAP_ALIGN)
 	caddr_t base = (_memory_huge_pages ? (caddr_t)(4 << 20) : 0);
 	void* ptr = mmap(base, size + padding, PROT_READ | PROT_WRITE, (_memory_huge_pages ? MAP_ALIGN : 0) | flags, -1, 0);
@@ -797,6 +802,10 @@ _rpmalloc_mmap_os(size_t size, size_t* offset) {
 		assert("Failed to map virtual memory block" == 0);
 		return 0;
 	}
+#  if defined(MADV_HUGEPAGE)
+	if (_memory_config.enable_transparent_huge_pages)
+		madvise(ptr, size + padding, MADV_HUGEPAGE);
+#  endif
 #endif
 	_rpmalloc_stat_add(&_mapped_pages_os, (int32_t)((size + padding) >> _memory_page_size_shift));
 	if (padding) {
@@ -1187,6 +1196,7 @@ _rpmalloc_global_cache_finalize(global_cache_t* cache) {
 	for (size_t ispan = 0; ispan < cache->count; ++ispan)
 		_rpmalloc_span_unmap(cache->span[ispan]);
 	cache->count = 0;
+	cache->decommitted = 0;
 
 #if ENABLE_UNLIMITED_CACHE
 	while (cache->overflow) {
@@ -1244,6 +1254,8 @@ _rpmalloc_global_cache_extract_spans(span_t** span, size_t span_count, size_t co
 
 	memcpy(span, cache->span + (cache->count - extract_count), sizeof(span_t*) * extract_count);
 	cache->count -= (uint32_t)extract_count;
+	if (cache->decommitted > cache->count)
+		cache->decommitted = cache->count;
 #if ENABLE_UNLIMITED_CACHE
 	while ((extract_count < count) && cache->overflow) {
 		span_t* current_span = cache->overflow;
@@ -2740,6 +2752,75 @@ rpmalloc_usable_size(void* ptr) {
 
 extern inline void
 rpmalloc_thread_collect(void) {
+	heap_t* heap = get_thread_heap_raw();
+	if (!heap)
+		return;
+	_rpmalloc_heap_cache_adopt_deferred(heap, 0);
+#if ENABLE_THREAD_CACHE
+	for (size_t iclass = 0; iclass < LARGE_CLASS_COUNT; ++iclass) {
+		span_cache_t* span_cache;
+		if (!iclass)
+			span_cache = &heap->span_cache;
+		else
+			span_cache = (span_cache_t*)(heap->span_large_cache + (iclass - 1));
+		if (!span_cache->count)
+			continue;
+#if ENABLE_GLOBAL_CACHE
+		_rpmalloc_stat_add64(&heap->thread_to_global, span_cache->count * (iclass + 1) * _memory_span_size);
+		_rpmalloc_stat_add(&heap->span_use[iclass].spans_to_global, span_cache->count);
+		_rpmalloc_global_cache_insert_spans(span_cache->span, iclass + 1, span_cache->count);
+#else
+		for (size_t ispan = 0; ispan < span_cache->count; ++ispan)
+			_rpmalloc_span_unmap(span_cache->span[ispan]);
+#endif
+		span_cache->count = 0;
+	}
+#endif
+}
+
+size_t
+rpmalloc_global_collect(size_t limit, int decommit) {
+	size_t released = 0;
+#if ENABLE_GLOBAL_CACHE
+	span_t* batch[THREAD_SPAN_CACHE_TRANSFER];
+	size_t cached = 0;
+	for (size_t iclass = 0; iclass < LARGE_CLASS_COUNT; ++iclass)
+		cached += _memory_span_cache[iclass].count * (iclass + 1) * _memory_span_size;
+
+	//Larger spans are unmapped first, and outside of the cache lock
+	for (size_t iclass = LARGE_CLASS_COUNT; iclass-- > 0;) {
+		global_cache_t* cache = &_memory_span_cache[iclass];
+		size_t span_size = (iclass + 1) * _memory_span_size;
+		while (cached > limit) {
+			size_t count = (cached - limit + span_size - 1) / span_size;
+			if (count > THREAD_SPAN_CACHE_TRANSFER)
+				count = THREAD_SPAN_CACHE_TRANSFER;
+			count = _rpmalloc_global_cache_extract_spans(batch, iclass + 1, count);
+			if (!count)
+				break;
+			for (size_t ispan = 0; ispan < count; ++ispan)
+				_rpmalloc_span_unmap(batch[ispan]);
+			released += count * span_size;
+			cached = (cached > count * span_size) ? cached - count * span_size : 0;
+		}
+
+		//The first page holds the span header, which must survive in the cache
+		if (!decommit || (span_size <= _memory_page_size))
+			continue;
+		while (!atomic_cas32_acquire(&cache->lock, 1, 0))
+			/* Spin */;
+		//Spans are inserted and extracted at the top, hence only the spans
+		//inserted since the last collect are still committed
+		for (size_t ispan = cache->decommitted; ispan < cache->count; ++ispan)
+			_rpmalloc_unmap(pointer_offset(cache->span[ispan], _memory_page_size), span_size - _memory_page_size, 0, 0);
+		cache->decommitted = cache->count;
+		atomic_store32_release(&cache->lock, 0);
+	}
+#else
+	(void)sizeof(limit);
+	(void)sizeof(decommit);
+#endif
+	return released;
 }
 
 void
@@ -2758,7 +2839,7 @@ rpmalloc_thread_statistics(rpmalloc_thread_statistics_t* stats) {
 			if (span->free_list_limit < block_count)
 				block_count = span->free_list_limit;
 			free_count += (block_count - span->used_count);
-			stats->sizecache = free_count * size_class->block_size;
+			stats->sizecache += free_count * size_class->block_size;
 			span = span->next;
 		}
 	}
@@ -2770,14 +2851,14 @@ rpmalloc_thread_statistics(rpmalloc_thread_statistics_t* stats) {
 			span_cache = &heap->span_cache;
 		else
 			span_cache = (span_cache_t*)(heap->span_large_cache + (iclass - 1));
-		stats->spancache = span_cache->count * (iclass + 1) * _memory_span_size;
+		stats->spancache += span_cache->count * (iclass + 1) * _memory_span_size;
 	}
 #endif
 
 	span_t* deferred = (span_t*)atomic_load_ptr(&heap->span_free_deferred);
 	while (deferred) {
 		if (deferred->size_class != SIZE_CLASS_HUGE)
-			stats->spancache = (size_t)deferred->span_count * _memory_span_size;
+			stats->spancache += (size_t)deferred->span_count * _memory_span_size;
 		deferred = (span_t*)deferred->free_list;
 	}
 
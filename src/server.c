@@ -6,6 +6,9 @@
 #include <poll.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#if defined(__linux__)
+#include <sys/timerfd.h>
+#endif
 
 #include "server.h"
 #include "frame.h"
@@ -23,6 +26,7 @@
 #include "extensions.h"
 #include "predict.h"
 #include "ssl.h"
+#include "timer.h"
 
 /**
  * Global state of server
@@ -35,154 +39,58 @@ wss_server_state_t state;
 wss_servers_t servers;
 
 /**
- * Global variable holding current timestamp 
+ * Amount of slots in the timer wheel holding the deadlines of the sessions
  */
-struct timespec now;
-
-static inline void write_control_frame(wss_frame_t *frame, wss_session_t *session) {
-    size_t j;
-    char *message;
-    size_t message_length;
-    int n = 0;
-    int fd = session->fd;
-
-    // Use extensions
-    for (j = 0; likely(j < session->header->ws_extensions_count); j++) {
-        session->header->ws_extensions[j]->ext->outframes(
-                fd,
-                &frame,
-                1);
-
-        session->header->ws_extensions[j]->ext->outframe(
-                fd,
-                frame);
-    }
+#define WSS_TIMER_SLOTS 4096
 
-    if (0 == (message_length = WSS_stringify_frame(frame, &message))) {
-        WSS_log_fatal("Unable to represent frame as bytes");
-        WSS_free_frame(frame);
-        return;
-    }
-
-    WSS_free_frame(frame);
-
-    if (session->ssl_connected) {
-        WSS_ssl_write(session, message, message_length);
-    } else {
-        size_t written = 0;
-        do {
-            n = write(fd, message+written, message_length-written);
-            if ( unlikely(n < 0) ) {
-                if ( likely(errno == EINTR) ) {
-                    errno = 0;
-                    n = 0;
-                    continue;
-                }
-                break;
-            }
-            written += n;
-        } while ( written < message_length );
-    }
-
-    WSS_free((void **) &message);
-}
+/**
+ * The resolution of the timer wheel is the shortest timeout divided by this
+ */
+#define WSS_TIMER_PRECISION 10
 
-static void cleanup_session(wss_session_t *session) {
-    wss_error_t err;
-    wss_frame_t *frame;
-    long unsigned int ms;
-    int fd = session->fd;
-    wss_server_t *server = servers.http;
-    bool dc;
+/**
+ * Function that determines how many milliseconds each slot of the timer wheel
+ * should cover, based on the shortest timeout of the configuration.
+ *
+ * @param 	config	[wss_config_t *]    "The configuration of the server"
+ * @return 	        [unsigned int]      "The resolution in milliseconds"
+ */
+static unsigned int timer_resolution(wss_config_t *config) {
+    long int shortest = 1000*WSS_TIMER_PRECISION;
 
-    if (! session->handshaked) {
-        return;
+    if (config->timeout_read >= 0 && config->timeout_read < shortest) {
+        shortest = config->timeout_read;
     }
 
-    if (NULL != session->ssl && session->ssl_connected) {
-        server = servers.https;
+    if (config->timeout_write >= 0 && config->timeout_write < shortest) {
+        shortest = config->timeout_write;
     }
 
-    ms = (((now.tv_sec - session->alive.tv_sec)*1000)+(now.tv_nsec/1000000)) - (session->alive.tv_nsec/1000000);
-
-    WSS_log_info("Check timeout %d ms", ms);
-
-    // Session timed out
-    if ( unlikely(server->config->timeout_client >= 0 && ms >= (long unsigned int)server->config->timeout_client) ) {
-        WSS_session_is_disconnecting(session, &dc);
-        if (dc) {
-            return;
-        }
-
-        WSS_session_jobs_wait(session);
-
-        WSS_log_info("Session %d has timedout last active %d ms ago", fd, ms);
-
-        session->closing = true;
-        session->state = CLOSING;
-
-        if (! session->ssl_connected) {
-            WSS_log_trace("Session %d disconnected from ip: %s:%d using HTTP request, due to timing out", session->fd, session->ip, session->port);
-        } else {
-            WSS_log_trace("Session %d disconnected from ip: %s:%d using HTTPS request, due to timing out", session->fd, session->ip, session->port);
+    if (config->timeout_client >= 0) {
+        if (config->timeout_client < shortest) {
+            shortest = config->timeout_client;
         }
 
-        WSS_log_trace("Informing subprotocol of client with file descriptor %d disconnecting", session->fd);
-
-        if ( NULL != session->header && session->header->ws_protocol != NULL ) {
-            WSS_log_trace("Informing subprotocol about session close");
-            session->header->ws_protocol->close(session->fd);
+        if (config->timeout_pings > 0 && config->timeout_client/config->timeout_pings < shortest) {
+            shortest = config->timeout_client/config->timeout_pings;
         }
+    }
 
-        WSS_log_trace("Removing poll filedescriptor from eventlist");
-
-        WSS_poll_remove(server, fd);
-
-        WSS_log_trace("Sending close frame", fd);
-
-        frame = WSS_closing_frame(CLOSE_TRY_AGAIN, NULL);
-
-        write_control_frame(frame, session);
-
-        WSS_log_trace("Deleting client session");
-
-        if ( unlikely(WSS_SUCCESS != (err = WSS_session_delete_no_lock(session))) ) {
-            switch (err) {
-                case WSS_SSL_SHUTDOWN_READ_ERROR:
-                        WSS_poll_set_read(server, fd);
-                    return;
-                case WSS_SSL_SHUTDOWN_WRITE_ERROR:
-                        WSS_poll_set_write(server, fd);
-                    return;
-                default:
-                    break;
-            }
-            WSS_log_error("Unable to delete client session, received error code: %d", err);
-            return;
-        }
-
-        WSS_log_info("Client with session %d disconnected", fd);
-
-    // Ping session to keep it alive
-    } else if (server->config->timeout_pings > 0 ) {
-        WSS_log_info("Pinging session %d", fd);
-
-        frame = WSS_ping_frame();
-        if (session->pong != NULL) {
-            WSS_free((void **) &session->pong);
-            session->pong_length = 0;
-        }
-
-        if (NULL == (session->pong = WSS_malloc(frame->applicationDataLength))) {
-            WSS_free_frame(frame);
-            return;
-        }
-        session->pong_length = frame->applicationDataLength;
-
-        memcpy(session->pong, frame->payload+frame->extensionDataLength, frame->applicationDataLength);
+    return (unsigned int) MAX(1, shortest/WSS_TIMER_PRECISION);
+}
 
-        write_control_frame(frame, session);
+/**
+ * Function that determines how many threads may produce messages to a
+ * session, which is the size of the ringbuffer producer table.
+ *
+ * @param 	config	[wss_config_t *]    "The configuration of the server"
+ * @return 	        [unsigned int]      "The amount of producers"
+ */
+static unsigned int session_workers(wss_config_t *config) {
+    if (config->pool_mode == POOL_SHARDED) {
+        return config->pool_loops+1;
     }
+    return config->pool_workers+1;
 }
 
 /**
@@ -213,54 +121,137 @@ void WSS_server_set_max_fd(wss_server_t *server, int fd) {
 }
 
 /**
- * Cleanup client sessions, that is, closes connections to clients which is 
- * timedout based on the servers timeout_client setting.
+ * Cleanup client sessions, that is, hands the sessions whose deadline passed
+ * on the timer wheel to the event loops owning them, such that sessions which timed out are
+ * closed and idle ones are pinged. Only expiring sessions are touched.
  *
  * @return 	pthread_exit 	[void *] 	"0 if successfull and otherwise <0"
  */
 void *WSS_cleanup() {
-    int n;
-    wss_error_t err;
-    struct pollfd fds[1];
+    int n, *fds;
+    size_t i, expired, released;
+    uint64_t now, collect = 0;
+    struct pollfd events[2];
+    wss_alloc_statistics_t stats;
+    wss_session_t *session;
     wss_server_t *server = servers.http;
-    long int timeout = server->config->timeout_client;
+    unsigned int resolution = timer_resolution(server->config);
+#if defined(__linux__)
+    uint64_t ticks;
+    struct itimerspec interval;
+#endif
 
 #ifdef USE_RPMALLOC
     rpmalloc_thread_initialize();
 #endif
 
-    fds[0].fd = close_pipefd[0];
-    fds[0].events = POLLIN | POLLPRI;
+    events[0].fd = close_pipefd[0];
+    events[0].events = POLLIN | POLLPRI;
+
+#if defined(__linux__)
+    if ( unlikely((events[1].fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) ) {
+        WSS_log_fatal("Unable to create timer of cleanup thread: %s", strerror(errno));
+#ifdef USE_RPMALLOC
+        rpmalloc_thread_finalize();
+#endif
+        pthread_exit( ((void *) ((uintptr_t)WSS_CLEANUP_ERROR)) );
+    }
+    events[1].events = POLLIN;
 
-    WSS_log_info("Cleanup thread started with %ld", timeout);
+    interval.it_interval.tv_sec = resolution/1000;
+    interval.it_interval.tv_nsec = (resolution%1000)*1000000;
+    interval.it_value = interval.it_interval;
 
-    if (timeout >= 0 && server->config->timeout_pings > 0) {
-        timeout = timeout/server->config->timeout_pings;
-        WSS_log_info("Cleanup thread will run every %ld milliseconds", timeout);
+    if ( unlikely(timerfd_settime(events[1].fd, 0, &interval, NULL) < 0) ) {
+        WSS_log_fatal("Unable to arm timer of cleanup thread: %s", strerror(errno));
+        close(events[1].fd);
+#ifdef USE_RPMALLOC
+        rpmalloc_thread_finalize();
+#endif
+        pthread_exit( ((void *) ((uintptr_t)WSS_CLEANUP_ERROR)) );
     }
+#endif
+
+    WSS_log_info("Cleanup thread started with a resolution of %u milliseconds", resolution);
 
     while ( likely(state.state == RUNNING) ) {
-        n = poll(fds, 1, timeout);
+#if defined(__linux__)
+        n = poll(events, 2, -1);
+#else
+        n = poll(events, 1, resolution);
+#endif
         if ( unlikely(n < 0 && errno != EINTR) ) {
+#if defined(__linux__)
+            close(events[1].fd);
+#endif
 #ifdef USE_RPMALLOC
             rpmalloc_thread_finalize();
 #endif
             pthread_exit( ((void *) ((uintptr_t)WSS_CLEANUP_ERROR)) );
-        } else if ( likely(n == 0) ) {
-            WSS_log_info("Pings clients and cleanup timedout ones");
-            
-            clock_gettime(CLOCK_MONOTONIC, &now);
-            if ( unlikely(WSS_SUCCESS != (err = WSS_session_all(cleanup_session))) ) {
-#ifdef USE_RPMALLOC
-                rpmalloc_thread_finalize();
+        }
+
+#if defined(__linux__)
+        if ( n <= 0 || ! (events[1].revents & POLLIN) || read(events[1].fd, &ticks, sizeof(ticks)) < 0 ) {
+            continue;
+        }
+#else
+        if ( n != 0 ) {
+            continue;
+        }
 #endif
-                pthread_exit( ((void *) &err) );
+
+        now = WSS_timer_clock();
+        expired = WSS_session_timeouts(now, &fds);
+
+        if (expired > 0) {
+            WSS_log_trace("Handing %zu timed out sessions to their event loops", expired);
+        }
+
+        WSS_session_enter();
+
+        for (i = 0; i < expired; i++) {
+            if ( unlikely(NULL == (session = WSS_session_find(fds[i])) || NULL == session->server) ) {
+                continue;
+            }
+
+            // The event loop owning the session runs the timeout
+            if ( likely(WSS_poll_timeout(session->server, fds[i]) == WSS_SUCCESS) ) {
+                continue;
+            }
+
+            // Try again on the next tick, if the session could not be handled
+            WSS_session_timeout(session, now + resolution);
+        }
+
+        WSS_session_leave();
+
+        // Deleted sessions are otherwise only freed when threads stop
+        // accessing sessions, which might not happen once the server is idle
+        WSS_session_reclaim();
+
+        // Returning the memory that was cached during a spike of traffic
+        if ( server->config->memory_collect > 0 && now >= collect ) {
+            collect = now + server->config->memory_collect;
+
+            WSS_alloc_collect();
+            if ( (released = WSS_alloc_trim(server->config->memory_rss, server->config->memory_decommit)) > 0 ) {
+                WSS_alloc_statistics(&stats);
+                WSS_log_info("Returned %zu kB of cached memory, %zu kB resident and %zu kB cached",
+                        released/1024, stats.resident/1024, stats.cached/1024);
             }
         }
     }
 
     WSS_log_info("Cleanup thread shutting down");
 
+    WSS_alloc_statistics(&stats);
+    WSS_log_info("Allocator caches were collected %zu times and trimmed %zu times returning %zu kB, %zu kB resident, %zu kB mapped and %zu kB cached",
+            stats.collects, stats.trims, stats.trimmed/1024, stats.resident/1024, stats.mapped/1024, stats.cached/1024);
+
+#if defined(__linux__)
+    close(events[1].fd);
+#endif
+
 #ifdef USE_RPMALLOC
     rpmalloc_thread_finalize();
 #endif
@@ -349,6 +340,34 @@ static void WSS_server_interrupt(int sig) {
     }
 }
 
+/**
+ * Joins the threads running the additional event loops of a server in sharded
+ * mode, or the follower threads of a server in leader/follower mode.
+ *
+ * @param 	server	[wss_server_t *]    "The server object"
+ * @return 	        [void]
+ */
+static void WSS_server_loops_join(wss_server_t *server) {
+    int err;
+    unsigned int i;
+
+    for (i = 1; likely(i < server->loops_length); i++) {
+        pthread_join(server->loops[i]->thread_id, (void **) &err);
+        if ( unlikely(WSS_SUCCESS != err) ) {
+            WSS_log_error("Event loop thread %u returned with error: %s", i, strerror(err));
+            WSS_server_set_state(HALT_ERROR);
+        }
+    }
+
+    for (i = 0; likely(i < server->followers_length); i++) {
+        pthread_join(server->followers[i], (void **) &err);
+        if ( unlikely(WSS_SUCCESS != err) ) {
+            WSS_log_error("Follower thread %u returned with error: %s", i+1, strerror(err));
+            WSS_server_set_state(HALT_ERROR);
+        }
+    }
+}
+
 /**
  * Function that frees all memory that the server has allocated
  *
@@ -502,11 +521,37 @@ int WSS_server_start(wss_config_t *config) {
         return EXIT_FAILURE;
     }
 
+    if ( unlikely(WSS_SUCCESS != WSS_session_slab_init(config->size_ringbuffer, session_workers(config), config->session_prewarm, config->session_cache)) ) {
+        WSS_log_fatal("Unable to initialize session slab");
+
+        WSS_session_destroy_lock();
+        WSS_destroy_subprotocols();
+        WSS_destroy_extensions();
+        pthread_mutex_destroy(&state.lock);
+
+        return EXIT_FAILURE;
+    }
+
+    if ( unlikely(WSS_SUCCESS != WSS_session_timers_init(WSS_TIMER_SLOTS, timer_resolution(config))) ) {
+        WSS_log_fatal("Unable to initialize session timers");
+
+        WSS_session_slab_destroy();
+        WSS_session_destroy_lock();
+        WSS_destroy_subprotocols();
+        WSS_destroy_extensions();
+        pthread_mutex_destroy(&state.lock);
+
+        return EXIT_FAILURE;
+    }
+
     WSS_log_trace("Allocating memory for HTTP instance");
 
     if ( unlikely(NULL == (http = WSS_malloc(sizeof(wss_server_t)))) ) {
         WSS_log_fatal("Unable to allocate server structure");
 
+        WSS_session_timers_destroy();
+
+        WSS_session_slab_destroy();
         WSS_session_destroy_lock();
         WSS_destroy_subprotocols();
         WSS_destroy_extensions();
@@ -519,6 +564,8 @@ int WSS_server_start(wss_config_t *config) {
 
     if ( unlikely(0 != (err = pthread_mutex_init(&http->lock, NULL))) ) {
         WSS_server_free(http);
+        WSS_session_timers_destroy();
+        WSS_session_slab_destroy();
         WSS_session_destroy_lock();
         WSS_destroy_subprotocols();
         WSS_destroy_extensions();
@@ -537,6 +584,8 @@ int WSS_server_start(wss_config_t *config) {
         WSS_log_fatal("Unable to initialize http server");
 
         WSS_server_free(http);
+        WSS_session_timers_destroy();
+        WSS_session_slab_destroy();
         WSS_session_destroy_lock();
         WSS_destroy_subprotocols();
         WSS_destroy_extensions();
@@ -550,6 +599,8 @@ int WSS_server_start(wss_config_t *config) {
 
         if ( unlikely(NULL == (https = (wss_server_t *) WSS_malloc(sizeof(wss_server_t)))) ) {
             WSS_server_free(http);
+            WSS_session_timers_destroy();
+            WSS_session_slab_destroy();
             WSS_session_destroy_lock();
             WSS_destroy_subprotocols();
             WSS_destroy_extensions();
@@ -569,6 +620,8 @@ int WSS_server_start(wss_config_t *config) {
         if ( unlikely(WSS_SUCCESS != WSS_http_ssl(https)) ) {
             WSS_server_free(https);
             WSS_server_free(http);
+            WSS_session_timers_destroy();
+            WSS_session_slab_destroy();
             WSS_session_destroy_lock();
             WSS_destroy_subprotocols();
             WSS_destroy_extensions();
@@ -582,6 +635,8 @@ int WSS_server_start(wss_config_t *config) {
         if ( unlikely(WSS_SUCCESS != WSS_http_server(https)) ) {
             WSS_server_free(https);
             WSS_server_free(http);
+            WSS_session_timers_destroy();
+            WSS_session_slab_destroy();
             WSS_session_destroy_lock();
             WSS_destroy_subprotocols();
             WSS_destroy_extensions();
@@ -600,6 +655,8 @@ int WSS_server_start(wss_config_t *config) {
             WSS_server_free(https);
         }
         WSS_server_free(http);
+        WSS_session_timers_destroy();
+        WSS_session_slab_destroy();
         WSS_session_destroy_lock();
         WSS_destroy_subprotocols();
         WSS_destroy_extensions();
@@ -625,6 +682,8 @@ int WSS_server_start(wss_config_t *config) {
         WSS_server_set_state(HALT_ERROR);
     }
 
+    WSS_server_loops_join(http);
+
     WSS_log_trace("HTTP server thread has shutdown");
 
     if (ssl) {
@@ -634,11 +693,11 @@ int WSS_server_start(wss_config_t *config) {
             WSS_server_set_state(HALT_ERROR);
         }
 
+        WSS_server_loops_join(https);
+
         WSS_log_trace("HTTPS server thread has shutdown");
     }
 
-    pthread_join(http->thread_id, (void **) &err);
-
     if ( unlikely(WSS_poll_close(http) != WSS_SUCCESS) ) {
         WSS_server_set_state(HALT_ERROR);
     }
@@ -667,6 +726,10 @@ int WSS_server_start(wss_config_t *config) {
 
     WSS_log_trace("Freed all sessions");
 
+    WSS_session_slab_destroy();
+
+    WSS_session_timers_destroy();
+
     if ( unlikely(WSS_SUCCESS != WSS_session_destroy_lock()) ) {
         WSS_server_set_state(HALT_ERROR);
     }
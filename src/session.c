@@ -4,9 +4,10 @@
 #include <stdlib.h>             /* atoi, malloc, free, realloc */
 #include <unistd.h>             /* close */
 #include <stdio.h>              /* close */
+#include <arpa/inet.h>          /* inet_ntop */
 
-#include <pthread.h> 			/* pthread_create, pthread_t, pthread_attr_t
-                                   pthread_rwlock_init */
+#include <sys/socket.h>         /* shutdown */
+#include <pthread.h> 			/* pthread_mutex_init, pthread_key_create */
 
 #include "session.h"
 #include "log.h"
@@ -16,39 +17,397 @@
 #include "ringbuf.h"
 #include "predict.h"
 #include "ssl.h"
+#include "timer.h"
 
 /**
- * A hashtable containing all active sessions
+ * The amount of sessions held by each chunk of the session table
  */
-wss_session_t * volatile sessions = NULL;
+#define WSS_SESSION_CHUNK_SIZE 1024
 
 /**
- * A lock that ensures the hash table is update atomically
+ * The maximum amount of chunks of the session table, which bounds the largest
+ * file descriptor that can be held by a session
  */
-pthread_rwlock_t lock;
+#define WSS_SESSION_CHUNKS 4096
 
 /**
- * Function that initialize a rwlock lock.
+ * The amount of locks and conditions shared by the sessions that wait for
+ * their jobs to be done
+ */
+#define WSS_SESSION_JOBS_STRIPES 64
+
+/**
+ * A slot of the session table
+ */
+typedef _Atomic(wss_session_t *) wss_session_slot_t;
+
+/**
+ * Structure holding the epoch observed by a thread that accesses sessions
+ */
+typedef struct wss_session_epoch_s {
+    // The epoch the thread entered in, 0 if the thread does not access sessions
+    atomic_uint_fast64_t epoch;
+    // Whether the record is owned by a running thread
+    atomic_bool used;
+    // How many times the owning thread has entered without leaving
+    unsigned int depth;
+    // The receive buffer of the owning thread
+    char *buffer;
+    // The size of the receive buffer
+    size_t buffer_size;
+    // The next record
+    struct wss_session_epoch_s *next;
+} wss_session_epoch_t;
+
+/**
+ * A table of all active sessions indexed by file descriptor. The chunks are
+ * allocated when first needed and are never moved, such that lookups never
+ * have to wait for sessions being added or deleted
+ */
+static _Atomic(wss_session_slot_t *) sessions[WSS_SESSION_CHUNKS];
+
+/**
+ * The global epoch, which is advanced once every thread accessing sessions
+ * has observed it
+ */
+static atomic_uint_fast64_t epoch = 1;
+
+/**
+ * The epoch records of all threads that have accessed sessions
+ */
+static _Atomic(wss_session_epoch_t *) records = NULL;
+
+/**
+ * Incremented whenever the epoch records are freed, such that threads know to
+ * acquire a new record
+ */
+static atomic_uint generation = 0;
+
+/**
+ * Sessions that were deleted, but might still be referenced by other threads
+ */
+static _Atomic(wss_session_t *) retired = NULL;
+
+/**
+ * The epoch record of the calling thread
+ */
+static _Thread_local wss_session_epoch_t *record = NULL;
+
+/**
+ * The generation of the epoch record of the calling thread
+ */
+static _Thread_local unsigned int record_generation = 0;
+
+/**
+ * Key used to give up the epoch record of a thread once it exits
+ */
+static pthread_key_t record_key;
+
+/**
+ * A lock that ensures only one thread at a time frees retired sessions
+ */
+pthread_mutex_t lock;
+
+/**
+ * A timer wheel holding the next deadline of every session
+ */
+static wss_timer_wheel_t *timers = NULL;
+
+/**
+ * The locks and conditions used to wait for the jobs of a session to be done,
+ * shared by sessions such that each session only needs a job counter
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} jobs[WSS_SESSION_JOBS_STRIPES];
+
+/**
+ * Structure holding the slab of free sessions
+ */
+static struct {
+    // Lock that ensures the free sessions are updated atomically
+    pthread_mutex_t lock;
+    // The free sessions, linked through their retired_next member
+    wss_session_t *sessions;
+    // The amount of free sessions
+    size_t length;
+    // The maximum amount of free sessions, 0 is unbounded
+    size_t cache;
+    // The size of the ringbuffer of each session
+    unsigned int messages;
+    // The amount of threads that may produce messages to a session
+    unsigned int workers;
+    // The amount of sessions allocated
+    size_t allocated;
+    // The amount of sessions handed out again after being freed
+    size_t recycled;
+} slab;
+
+/**
+ * Function that allocates a session with its lock initialized.
+ *
+ * @return 		[wss_session_t *] 	"The session or NULL on error"
+ */
+static wss_session_t *slab_create() {
+    int err;
+    wss_session_t *session;
+    pthread_mutexattr_t lock_attr;
+
+    if ( unlikely(NULL == (session = (wss_session_t *) WSS_malloc(sizeof(wss_session_t)))) ) {
+        WSS_log_error("Unable to allocate memory for session");
+        return NULL;
+    }
+
+    pthread_mutexattr_init(&lock_attr);
+    
+    if ( unlikely((err = pthread_mutexattr_settype(&lock_attr, PTHREAD_MUTEX_RECURSIVE)) != 0) ) {
+        WSS_log_error("Unable to initialize session locks attributes: %s", strerror(err));
+        pthread_mutexattr_destroy(&lock_attr);
+        WSS_free((void **) &session);
+        return NULL;
+    }
+
+    // The attributes are copied into the lock, hence they need not be kept
+    err = pthread_mutex_init(&session->lock, &lock_attr);
+    pthread_mutexattr_destroy(&lock_attr);
+
+    if ( unlikely(err != 0) ) {
+        WSS_log_error("Unable to initialize session lock: %s", strerror(err));
+        WSS_free((void **) &session);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&slab.lock);
+    slab.allocated++;
+    pthread_mutex_unlock(&slab.lock);
+
+    return session;
+}
+
+/**
+ * Function that destroys the lock of a session and frees it.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @return 		    [wss_error_t] 	    "The error status"
+ */
+static wss_error_t slab_destroy(wss_session_t *session) {
+    wss_error_t err = WSS_SUCCESS;
+
+    if ( unlikely(pthread_mutex_destroy(&session->lock) != 0) ) {
+        err = WSS_SESSION_LOCK_DESTROY_ERROR;
+    }
+
+    WSS_free((void **) &session);
+
+    return err;
+}
+
+/**
+ * Function that takes a free session from the slab, or allocates a new one if
+ * the slab is empty.
+ *
+ * @return 		[wss_session_t *] 	"The session or NULL on error"
+ */
+static wss_session_t *slab_get() {
+    wss_session_t *session;
+
+    pthread_mutex_lock(&slab.lock);
+    if ( likely(NULL != (session = slab.sessions)) ) {
+        slab.sessions = session->retired_next;
+        session->retired_next = NULL;
+        slab.length--;
+        slab.recycled++;
+    }
+    pthread_mutex_unlock(&slab.lock);
+
+    if ( unlikely(NULL == session) ) {
+        session = slab_create();
+    }
+
+    return session;
+}
+
+/**
+ * Function that clears a session whose resources have been freed and returns
+ * it to the slab, or frees it if the slab is full.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @return 		    [wss_error_t] 	    "The error status"
+ */
+static wss_error_t slab_put(wss_session_t *session) {
+    // A session whose lock is still held cannot be handed out again
+    if ( unlikely(pthread_mutex_trylock(&session->lock) != 0) ) {
+        WSS_log_error("Unable to recycle session %d whose lock is held", session->fd);
+        return WSS_SESSION_LOCK_DESTROY_ERROR;
+    }
+    pthread_mutex_unlock(&session->lock);
+
+    memset(&session->fd, 0, sizeof(wss_session_t) - offsetof(wss_session_t, fd));
+
+    pthread_mutex_lock(&slab.lock);
+    if ( likely(slab.cache == 0 || slab.length < slab.cache) ) {
+        session->retired_next = slab.sessions;
+        slab.sessions = session;
+        slab.length++;
+        pthread_mutex_unlock(&slab.lock);
+        return WSS_SUCCESS;
+    }
+    pthread_mutex_unlock(&slab.lock);
+
+    return slab_destroy(session);
+}
+
+/**
+ * Function that gives up the epoch record of an exiting thread.
+ *
+ * @param 	arg	[void *] 	"The epoch record"
+ * @return 		[void]
+ */
+static void record_release(void *arg) {
+    wss_session_epoch_t *r = (wss_session_epoch_t *) arg;
+
+    r->depth = 0;
+    atomic_store_explicit(&r->epoch, 0, memory_order_release);
+    atomic_store_explicit(&r->used, false, memory_order_release);
+}
+
+/**
+ * Function that returns the epoch record of the calling thread, claiming an
+ * unused record or allocating a new one the first time.
+ *
+ * @return 		[wss_session_epoch_t *] 	"The epoch record or NULL on error"
+ */
+static wss_session_epoch_t *record_acquire() {
+    bool expected;
+    wss_session_epoch_t *r, *head;
+
+    if ( likely(NULL != record && record_generation == atomic_load_explicit(&generation, memory_order_relaxed)) ) {
+        return record;
+    }
+
+    for (r = atomic_load(&records); NULL != r; r = r->next) {
+        expected = false;
+        if ( atomic_compare_exchange_strong(&r->used, &expected, true) ) {
+            break;
+        }
+    }
+
+    if ( unlikely(NULL == r) ) {
+        if ( unlikely(NULL == (r = WSS_malloc(sizeof(wss_session_epoch_t)))) ) {
+            WSS_log_error("Unable to allocate epoch record");
+            return NULL;
+        }
+        atomic_init(&r->epoch, 0);
+        atomic_init(&r->used, true);
+
+        head = atomic_load(&records);
+        do {
+            r->next = head;
+        } while ( unlikely(! atomic_compare_exchange_weak(&records, &head, r)) );
+    }
+
+    r->depth = 0;
+    pthread_setspecific(record_key, r);
+    record = r;
+    record_generation = atomic_load(&generation);
+
+    return r;
+}
+
+/**
+ * Function that returns the slot of the session table holding the session
+ * with the given file descriptor.
+ *
+ * @param 	fd 	    [int] 		            "The filedescriptor"
+ * @param 	create	[bool] 		            "Whether to allocate the chunk of the slot if missing"
+ * @return 		    [wss_session_slot_t *] 	"The slot or NULL if not present"
+ */
+static inline wss_session_slot_t *session_slot(int fd, bool create) {
+    unsigned int i;
+    wss_session_slot_t *chunk, *expected = NULL;
+
+    if ( unlikely(fd < 0 || (unsigned int) fd >= WSS_SESSION_CHUNKS*WSS_SESSION_CHUNK_SIZE) ) {
+        return NULL;
+    }
+
+    i = (unsigned int) fd/WSS_SESSION_CHUNK_SIZE;
+
+    if ( likely(NULL != (chunk = atomic_load_explicit(&sessions[i], memory_order_acquire))) ) {
+        return &chunk[fd%WSS_SESSION_CHUNK_SIZE];
+    }
+
+    if (! create) {
+        return NULL;
+    }
+
+    if ( unlikely(NULL == (chunk = WSS_calloc(WSS_SESSION_CHUNK_SIZE, sizeof(wss_session_slot_t)))) ) {
+        WSS_log_error("Unable to allocate chunk of session table");
+        return NULL;
+    }
+
+    // Another thread might have allocated the chunk in the meantime
+    if ( unlikely(! atomic_compare_exchange_strong(&sessions[i], &expected, chunk)) ) {
+        WSS_free((void **) &chunk);
+        chunk = expected;
+    }
+
+    return &chunk[fd%WSS_SESSION_CHUNK_SIZE];
+}
+
+/**
+ * Function that initialize the locks of the session table.
  *
  * @return 		[wss_error_t] 	"The error status"
  */
 wss_error_t WSS_session_init_lock() {
     int err;
-    if ( unlikely((err = pthread_rwlock_init(&lock, NULL)) != 0) ) {
+    unsigned int i;
+
+    if ( unlikely((err = pthread_mutex_init(&lock, NULL)) != 0) ) {
         WSS_log_error("Unable to initialize session lock: %s", strerror(err));
         return WSS_SESSION_LOCK_CREATE_ERROR;
     }
+    if ( unlikely((err = pthread_key_create(&record_key, record_release)) != 0) ) {
+        WSS_log_error("Unable to create epoch record key: %s", strerror(err));
+        pthread_mutex_destroy(&lock);
+        return WSS_SESSION_LOCK_CREATE_ERROR;
+    }
+    for (i = 0; i < WSS_SESSION_JOBS_STRIPES; i++) {
+        pthread_mutex_init(&jobs[i].lock, NULL);
+        pthread_cond_init(&jobs[i].cond, NULL);
+    }
     return WSS_SUCCESS;
 }
 
 /**
- * Function that destroy a rwlock lock.
+ * Function that destroy the locks of the session table and frees the epoch
+ * records.
  *
  * @return 		[wss_error_t] 	"The error status"
  */
 wss_error_t WSS_session_destroy_lock() {
     int err;
-    if ( unlikely((err = pthread_rwlock_destroy(&lock)) != 0) ) {
+    unsigned int i;
+    wss_session_epoch_t *r, *next;
+
+    pthread_key_delete(record_key);
+
+    for (i = 0; i < WSS_SESSION_JOBS_STRIPES; i++) {
+        pthread_mutex_destroy(&jobs[i].lock);
+        pthread_cond_destroy(&jobs[i].cond);
+    }
+
+    r = atomic_exchange(&records, NULL);
+    while (NULL != r) {
+        next = r->next;
+        WSS_free((void **) &r->buffer);
+        WSS_free((void **) &r);
+        r = next;
+    }
+    atomic_fetch_add(&generation, 1);
+
+    if ( unlikely((err = pthread_mutex_destroy(&lock)) != 0) ) {
         WSS_log_error("Unable to destroy session lock: %s", strerror(err));
         return WSS_SESSION_LOCK_DESTROY_ERROR;
     }
@@ -56,241 +415,613 @@ wss_error_t WSS_session_destroy_lock() {
 }
 
 /**
- * Function that allocates and creates a new session.
+ * Function that marks the calling thread as accessing sessions. Sessions
+ * found before the matching call to WSS_session_leave are not freed before
+ * that call, even if deleted by another thread. Calls may be nested.
  *
- * @param 	fd 		[int] 		        "The filedescriptor associated to the session"
- * @param 	ip 		[char *] 	        "The ip-address of the session"
- * @param 	port 	[int] 	            "The port"
- * @return 		    [wss_session_t *] 	"Returns session if successful, otherwise NULL"
+ * @return 		[void]
  */
-wss_session_t *WSS_session_add(int fd, char* ip, int port) {
-    int length, err;
-    wss_session_t *session = NULL;
+void WSS_session_enter() {
+    uint_fast64_t e;
+    wss_session_epoch_t *r;
 
-    WSS_log_trace("Adding session");
+    if ( unlikely(NULL == (r = record_acquire())) ) {
+        return;
+    }
 
-    if ( unlikely(NULL != (session = WSS_session_find(fd))) ) {
-        return NULL;
+    if ( likely(r->depth++ == 0) ) {
+        // The epoch is published before any slot is read, and re-read such
+        // that the record never lags behind an epoch that already advanced
+        do {
+            e = atomic_load(&epoch);
+            atomic_store(&r->epoch, e);
+        } while ( unlikely(e != atomic_load(&epoch)) );
     }
+}
 
-    if ( unlikely((err = pthread_rwlock_wrlock(&lock)) != 0) ) {
-        WSS_log_error("Unable to lock session lock: %s", strerror(err));
+/**
+ * Function that returns the receive buffer of the calling thread, which is
+ * reused by every event the thread handles. The buffer is kept with the epoch
+ * record of the thread, such that it is handed to another thread once the
+ * thread exits.
+ *
+ * @param 	size	[size_t] 	"The minimum size of the buffer"
+ * @return 		    [char *] 	"The buffer or NULL on error"
+ */
+char *WSS_session_buffer(size_t size) {
+    wss_session_epoch_t *r;
+
+    if ( unlikely(NULL == (r = record_acquire())) ) {
         return NULL;
     }
 
-    if ( unlikely(NULL == (session = (wss_session_t *) WSS_malloc(sizeof(wss_session_t)))) ) {
-        WSS_log_error("Unable to allocate memory for session");
-        pthread_rwlock_unlock(&lock);
-        return NULL;
+    if ( unlikely(r->buffer_size < size) ) {
+        WSS_free((void **) &r->buffer);
+        r->buffer_size = 0;
+
+        if ( unlikely(NULL == (r->buffer = WSS_malloc(size))) ) {
+            WSS_log_error("Unable to allocate receive buffer");
+            return NULL;
+        }
+        r->buffer_size = size;
     }
 
-    pthread_mutexattr_init(&session->lock_attr);
-    
-    if ( unlikely((err = pthread_mutexattr_settype(&session->lock_attr, PTHREAD_MUTEX_RECURSIVE)) != 0) ) {
-        WSS_log_error("Unable to initialize session locks attributes: %s", strerror(err));
-        WSS_free((void **) &session);
+    return r->buffer;
+}
+
+/**
+ * Function that marks the calling thread as no longer accessing sessions and
+ * frees the deleted sessions that no thread can reference any longer.
+ *
+ * @return 		[void]
+ */
+void WSS_session_leave() {
+    wss_session_epoch_t *r = record;
+
+    if ( unlikely(NULL == r || r->depth == 0) ) {
+        return;
     }
 
-    if ( unlikely((err = pthread_mutex_init(&session->lock, &session->lock_attr)) != 0) ) {
-        WSS_log_error("Unable to initialize session lock: %s", strerror(err));
-        pthread_mutexattr_destroy(&session->lock_attr);
-        WSS_free((void **) &session);
-        pthread_rwlock_unlock(&lock);
+    if ( likely(--r->depth == 0) ) {
+        atomic_store_explicit(&r->epoch, 0, memory_order_release);
+
+        if ( unlikely(NULL != atomic_load_explicit(&retired, memory_order_relaxed)) ) {
+            WSS_session_reclaim();
+        }
+    }
+}
+
+/**
+ * Function that creates the slab of sessions, which recycles sessions with
+ * their lock initialized.
+ *
+ * @param 	messages	[unsigned int] 	"The size of the ringbuffer of each session"
+ * @param 	workers	    [unsigned int] 	"The amount of threads that may produce messages"
+ * @param 	prewarm	    [unsigned int] 	"The amount of sessions to allocate up front"
+ * @param 	cache	    [unsigned int] 	"The maximum amount of free sessions kept, 0 is unbounded"
+ * @return 		        [wss_error_t] 	"The error status"
+ */
+wss_error_t WSS_session_slab_init(unsigned int messages, unsigned int workers, unsigned int prewarm, unsigned int cache) {
+    int err;
+    unsigned int i;
+    wss_session_t *session;
+
+    if ( unlikely((err = pthread_mutex_init(&slab.lock, NULL)) != 0) ) {
+        WSS_log_error("Unable to initialize session slab lock: %s", strerror(err));
+        return WSS_SESSION_LOCK_CREATE_ERROR;
+    }
+
+    slab.sessions = NULL;
+    slab.length = 0;
+    slab.cache = cache;
+    slab.messages = messages;
+    slab.workers = workers;
+    slab.allocated = 0;
+    slab.recycled = 0;
+
+    if ( unlikely(cache != 0 && prewarm > cache) ) {
+        prewarm = cache;
+    }
+
+    for (i = 0; i < prewarm; i++) {
+        if ( unlikely(NULL == (session = slab_create())) ) {
+            WSS_session_slab_destroy();
+            return WSS_MEMORY_ERROR;
+        }
+
+        session->retired_next = slab.sessions;
+        slab.sessions = session;
+        slab.length++;
+    }
+
+    WSS_log_info("Session slab prewarmed with %u sessions", prewarm);
+
+    return WSS_SUCCESS;
+}
+
+/**
+ * Function that frees the sessions kept by the slab.
+ *
+ * @return 		[void]
+ */
+void WSS_session_slab_destroy() {
+    wss_session_t *session;
+
+    WSS_log_info("Session slab allocated %zu sessions and recycled %zu", slab.allocated, slab.recycled);
+
+    while (NULL != (session = slab.sessions)) {
+        slab.sessions = session->retired_next;
+        slab_destroy(session);
+    }
+    slab.length = 0;
+
+    pthread_mutex_destroy(&slab.lock);
+}
+
+/**
+ * Function that creates the timer wheel holding the deadlines of the sessions.
+ *
+ * @param 	slots	    [unsigned int] 	"The amount of slots of the wheel"
+ * @param 	resolution	[unsigned int] 	"The amount of milliseconds covered by each slot"
+ * @return 		        [wss_error_t] 	"The error status"
+ */
+wss_error_t WSS_session_timers_init(unsigned int slots, unsigned int resolution) {
+    if ( unlikely(NULL == (timers = WSS_timer_wheel_create(slots, resolution, WSS_timer_clock()))) ) {
+        WSS_log_error("Unable to create session timers");
+        return WSS_MEMORY_ERROR;
+    }
+    return WSS_SUCCESS;
+}
+
+/**
+ * Function that frees the timer wheel holding the deadlines of the sessions.
+ *
+ * @return 		[void]
+ */
+void WSS_session_timers_destroy() {
+    WSS_timer_wheel_destroy(timers);
+    timers = NULL;
+}
+
+/**
+ * Function that schedules the timer of a session to expire at the deadline,
+ * unless the timer is already scheduled to expire before that.
+ *
+ * @param 	session	    [wss_session_t *] 	"The session"
+ * @param 	deadline	[uint64_t] 	        "The deadline in milliseconds on the monotonic clock"
+ * @return 		        [void]
+ */
+void WSS_session_timeout(wss_session_t *session, uint64_t deadline) {
+    if ( likely(NULL != timers) ) {
+        if ( WSS_timer_schedule(timers, &session->timer, deadline) ) {
+            WSS_log_trace("Rescheduled timeout of session %d", session->fd);
+        }
+    }
+}
+
+/**
+ * Function that removes the sessions whose deadline has passed from the timer
+ * wheel.
+ *
+ * @param 	now	    [uint64_t] 	"The current time in milliseconds on the monotonic clock"
+ * @param 	fds	    [int **] 	"Set to the file descriptors of the expired sessions"
+ * @return 		    [size_t] 	"The amount of expired sessions"
+ */
+size_t WSS_session_timeouts(uint64_t now, int **fds) {
+    if ( unlikely(NULL == timers) ) {
+        *fds = NULL;
+        return 0;
+    }
+    return WSS_timer_expire(timers, now, fds);
+}
+
+/**
+ * Function that allocates and creates a new session.
+ *
+ * @param 	fd 		[int] 		                "The filedescriptor associated to the session"
+ * @param 	addr 	[const struct in6_addr *] 	"The address of the session"
+ * @param 	port 	[int] 	                    "The port"
+ * @return 		    [wss_session_t *] 	        "Returns session if successful, otherwise NULL"
+ */
+wss_session_t *WSS_session_add(int fd, const struct in6_addr *addr, int port) {
+    wss_session_slot_t *slot;
+    wss_session_t *session = NULL;
+
+    WSS_log_trace("Adding session");
+
+    if ( unlikely(NULL == (slot = session_slot(fd, true))) ) {
+        WSS_log_error("Unable to find slot for session %d", fd);
         return NULL;
     }
 
-    if ( unlikely((err = pthread_mutex_init(&session->lock_jobs, NULL)) != 0) ) {
-        WSS_log_error("Unable to initialize session job lock: %s", strerror(err));
-        pthread_mutex_destroy(&session->lock);
-        pthread_mutexattr_destroy(&session->lock_attr);
-        WSS_free((void **) &session);
-        pthread_rwlock_unlock(&lock);
+    if ( unlikely(NULL != atomic_load_explicit(slot, memory_order_acquire)) ) {
         return NULL;
     }
 
-    if ( unlikely((err = pthread_mutex_init(&session->lock_disconnecting, NULL)) != 0) ) {
-        WSS_log_error("Unable to initialize session disconnecting lock: %s", strerror(err));
-        pthread_mutex_destroy(&session->lock);
-        pthread_mutex_destroy(&session->lock_jobs);
-        pthread_mutexattr_destroy(&session->lock_attr);
-        WSS_free((void **) &session);
-        pthread_rwlock_unlock(&lock);
+    if ( unlikely(NULL == (session = slab_get())) ) {
         return NULL;
     }
 
     session->fd = fd;
     session->port = port;
     session->header = NULL;
+    session->timer.fd = fd;
 
-    length = strlen(ip);
-    if ( unlikely(NULL == (session->ip = (char *) WSS_malloc( (length+1)*sizeof(char)))) ) {
-        WSS_log_error("Unable to allocate memory for IP");
-        pthread_mutex_destroy(&session->lock);
-        pthread_mutex_destroy(&session->lock_jobs);
-        pthread_mutex_destroy(&session->lock_disconnecting);
-        pthread_mutexattr_destroy(&session->lock_attr);
-        WSS_free((void **) &session);
-        pthread_rwlock_unlock(&lock);
+    session->addr = *addr;
+
+    // Publishing the session makes it visible to lookups of other threads
+    atomic_store_explicit(slot, session, memory_order_release);
+
+    return session;
+}
+
+/**
+ * Function that returns the queue of messages of the session, allocating it
+ * if the session has none yet.
+ *
+ * @param 	session	[wss_session_t *] 	        "The session"
+ * @return 		    [wss_session_queue_t *] 	"The queue or NULL on error"
+ */
+wss_session_queue_t *WSS_session_queue(wss_session_t *session) {
+    size_t ringbuf_size;
+    wss_session_queue_t *queue, *expected = NULL;
+
+    if ( likely(NULL != (queue = atomic_load_explicit(&session->queue, memory_order_acquire))) ) {
+        return queue;
+    }
+
+    ringbuf_get_sizes(0, slab.workers, &ringbuf_size, NULL);
+
+    // The ringbuffer is laid out after the message slots, such that
+    // everything is 8 byte aligned
+    if ( unlikely(NULL == (queue = (wss_session_queue_t *) WSS_malloc(sizeof(wss_session_queue_t) +
+                        slab.messages*sizeof(wss_message_t *) + ringbuf_size))) ) {
+        WSS_log_error("Unable to allocate message queue of session");
         return NULL;
     }
 
-    memcpy(session->ip, ip, length);
+    queue->count = slab.messages;
+    queue->ringbuf = (ringbuf_t *) (queue->messages+slab.messages);
+    ringbuf_setup(queue->ringbuf, 0, slab.workers, slab.messages);
 
-    HASH_ADD_INT(sessions, fd, session);
+    // Another thread may have allocated a queue for the session meanwhile
+    if ( unlikely(! atomic_compare_exchange_strong(&session->queue, &expected, queue)) ) {
+        WSS_free((void **) &queue);
+        return expected;
+    }
 
-    pthread_rwlock_unlock(&lock);
+    return queue;
+}
 
-    return session;
+/**
+ * Function that stores data received by the event loop on behalf of the
+ * session, such that it is read by the next read of the session.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @param 	data	[const char *] 	    "The data received"
+ * @param 	length	[size_t] 	        "The amount of bytes received"
+ * @return 		    [wss_error_t] 	    "The error status"
+ */
+wss_error_t WSS_session_receive(wss_session_t *session, const char *data, size_t length) {
+    wss_session_input_t *input, *head;
+
+    if ( unlikely(NULL == (input = (wss_session_input_t *) WSS_malloc(sizeof(wss_session_input_t)+length))) ) {
+        WSS_log_error("Unable to allocate data received by session");
+        return WSS_MEMORY_ERROR;
+    }
+
+    memcpy(input->data, data, length);
+    input->length = length;
+
+    head = atomic_load(&session->received);
+    do {
+        input->next = head;
+    } while ( unlikely(! atomic_compare_exchange_weak(&session->received, &head, input)) );
+
+    return WSS_SUCCESS;
 }
 
-static wss_error_t session_delete(wss_session_t *session) {
-    int i, err = WSS_SUCCESS;
-    size_t j;
+/**
+ * Function that reads the data received by the event loop on behalf of the
+ * session. The lock of the session must be held.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @param 	buffer	[char *] 	        "The buffer to put the data into"
+ * @param 	length	[size_t] 	        "The amount of bytes that fit in the buffer"
+ * @return 		    [size_t] 	        "The amount of bytes read"
+ */
+size_t WSS_session_read(wss_session_t *session, char *buffer, size_t length) {
+    size_t n, read = 0;
+    wss_session_input_t *input, *next, *prev;
+
+    while ( likely(read < length) ) {
+        if ( NULL == (input = session->input) ) {
+            if ( NULL == (input = atomic_exchange(&session->received, NULL)) ) {
+                break;
+            }
 
-    if ( likely(NULL != session) ) {
-        pthread_mutex_unlock(&session->lock);
-        if ( unlikely((err = pthread_mutex_destroy(&session->lock)) != 0) ) {
-            err = WSS_SESSION_LOCK_DESTROY_ERROR;
+            // The data is received most recent first, hence it is reversed
+            for (prev = NULL; NULL != input; input = next) {
+                next = input->next;
+                input->next = prev;
+                prev = input;
+            }
+            session->input = input = prev;
         }
 
-        if ( unlikely((err = pthread_mutexattr_destroy(&session->lock_attr)) != 0) ) {
-            err = WSS_SESSION_LOCK_DESTROY_ERROR;
-        }
+        n = MIN(length-read, input->length-input->offset);
+        memcpy(buffer+read, input->data+input->offset, n);
+        input->offset += n;
+        read += n;
 
-        if ( unlikely((err = pthread_mutex_destroy(&session->lock_jobs)) != 0) ) {
-            err = WSS_SESSION_LOCK_DESTROY_ERROR;
+        if ( likely(input->offset == input->length) ) {
+            session->input = input->next;
+            WSS_free((void **) &input);
         }
+    }
+
+    return read;
+}
 
-        if ( unlikely((err = pthread_mutex_destroy(&session->lock_disconnecting)) != 0) ) {
-            err = WSS_SESSION_LOCK_DESTROY_ERROR;
+/**
+ * Function that checks whether the event loop received data on behalf of the
+ * session since it was last read.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @return 		    [bool] 	            "Whether data is waiting to be read"
+ */
+bool WSS_session_readable(wss_session_t *session) {
+    return NULL != atomic_load(&session->received);
+}
+
+/**
+ * Function that returns the ip-address of the session as a string. The
+ * address is only formatted the first time, and the lock of the session must
+ * be held.
+ *
+ * @param 	session	[wss_session_t *] 	"The session"
+ * @return 		    [char *] 	        "The ip-address of the session"
+ */
+char *WSS_session_ip(wss_session_t *session) {
+    if ( unlikely(session->ip[0] == '\0') ) {
+        if ( unlikely(NULL == inet_ntop(AF_INET6, &session->addr, session->ip, sizeof(session->ip))) ) {
+            session->ip[0] = '\0';
         }
+    }
+
+    return session->ip;
+}
+
+/**
+ * Function that frees a session and closes its filedescriptor. The session
+ * must no longer be referenced by any thread, and its subprotocol and
+ * extensions must already have been informed that it closed.
+ *
+ * @param 	session	[wss_session_t *] 	"The session to be freed"
+ * @return 		    [wss_error_t] 	    "The error status"
+ */
+static wss_error_t session_free(wss_session_t *session) {
+    size_t j;
+    wss_error_t err = WSS_SUCCESS;
+    wss_session_queue_t *queue;
+    wss_session_input_t *input, *next;
 
-        WSS_log_trace("Free ip string");
-        WSS_free((void **) &session->ip);
+    if ( likely(NULL != timers) ) {
+        WSS_timer_cancel(timers, &session->timer);
+    }
 
-        WSS_log_trace("Free pong string");
-        WSS_free((void **) &session->pong);
+    WSS_log_trace("Free pong string");
+    WSS_free((void **) &session->pong);
 
-        WSS_log_trace("Free payload");
-        WSS_free((void **) &session->payload);
+    WSS_log_trace("Free payload");
+    WSS_free((void **) &session->payload);
 
-        WSS_log_trace("Free frames");
-        for (j = 0; likely(j < session->frames_length); j++) {
-            WSS_free((void **) &session->frames[j]);
-        }
-        WSS_free((void **) &session->frames);
+    WSS_log_trace("Free fragmented message");
+    WSS_free_frame(session->message);
 
-        WSS_log_trace("Free session header structure");
-        if ( likely(NULL != session->header) ) {
-            for (j = 0; j < session->header->ws_extensions_count; j++) {
-                session->header->ws_extensions[j]->ext->close(session->fd);
-            }
+    WSS_log_trace("Free session header structure");
+    WSS_free_header(session->header);
 
-            session->header->ws_protocol->close(session->fd);
+    WSS_free((void **) &session->extensions);
 
-            WSS_free_header(session->header);
-        }
+    WSS_log_trace("Free data received on behalf of session");
+    for (input = atomic_load(&session->received); NULL != input; input = next) {
+        next = input->next;
+        WSS_free((void **) &input);
+    }
+    for (input = session->input; NULL != input; input = next) {
+        next = input->next;
+        WSS_free((void **) &input);
+    }
 
-        WSS_log_trace("Free ringbuf");
-        for (i = 0; likely(i < session->messages_count); i++) {
-            if ( likely(NULL != session->messages[i]) ) {
-                if ( likely(NULL != session->messages[i]->msg) ) {
-                    WSS_free((void **) &session->messages[i]->msg);
-                }
-                WSS_free((void **) &session->messages[i]);
-            }
+    WSS_log_trace("Free messages of ringbuf");
+    if ( NULL != (queue = atomic_load(&session->queue)) ) {
+        for (j = 0; likely(j < queue->count); j++) {
+            WSS_message_free(queue->messages[j]);
         }
-        WSS_free((void **) &session->messages);
-        WSS_free((void **) &session->ringbuf);
+        WSS_free((void **) &queue);
+    }
+
+    if ( unlikely(NULL != session->ssl) ) {
+        WSS_session_ssl_free(session);
+    }
+
+    WSS_log_trace("Closing client filedescriptor");
+    if ( unlikely(close(session->fd) < 0) ) {
+        WSS_log_error("Unable to close clients filedescriptor: %s", strerror(errno));
+        err = WSS_SOCKET_CLOSE_ERROR;
+    }
+
+    WSS_log_trace("Return session structure to slab");
+    if ( unlikely(WSS_SUCCESS != slab_put(session)) ) {
+        err = WSS_SESSION_LOCK_DESTROY_ERROR;
+    }
+
+    return err;
+}
+
+/**
+ * Function that removes the session from the session table and retires it,
+ * such that it is freed once no thread can reference it any longer.
+ *
+ * @param 	session	[wss_session_t *] 	"The session to be deleted"
+ * @return 		    [wss_error_t] 	    "The error status"
+ */
+static wss_error_t session_delete(wss_session_t *session) {
+    wss_session_t *expected = session, *head;
+    wss_session_slot_t *slot;
+
+    if ( likely(NULL != session) ) {
+        pthread_mutex_unlock(&session->lock);
 
         if (NULL != session->ssl) {
-            err = WSS_session_ssl_free(session, &lock);
+            WSS_session_ssl_free(session);
         }
 
-        WSS_log_trace("Deleting client from hash table");
-
-        HASH_DEL(sessions, session);
+        WSS_log_trace("Deleting client from session table");
 
-        WSS_log_trace("Closing client filedescriptor");
-        if ( unlikely(close(session->fd) < 0) ) {
-            WSS_log_error("Unable to close clients filedescriptor: %s", strerror(err));
-            err = WSS_SOCKET_CLOSE_ERROR;
+        if ( likely(NULL != (slot = session_slot(session->fd, false))) ) {
+            atomic_compare_exchange_strong(slot, &expected, NULL);
         }
 
-        WSS_log_trace("Free session structure");
-        WSS_free((void **) &session);
+        // The filedescriptor is only closed once the session is freed, such
+        // that it cannot be reused by a new session while other threads
+        // still reference this one, hence the connection is shut down now
+        shutdown(session->fd, SHUT_RDWR);
+
+        session->retired_epoch = atomic_load(&epoch);
+
+        head = atomic_load(&retired);
+        do {
+            session->retired_next = head;
+        } while ( unlikely(! atomic_compare_exchange_weak(&retired, &head, session)) );
     }
 
     return WSS_SUCCESS;
 }
 
 /**
- * Function that frees the allocated memory and removes the session from the 
- * hashtable but without locking the hashtable. This should only be used in
- * conjunction with the WSS_session_all call.
+ * Function that advances the epoch if every thread accessing sessions has
+ * observed it, and frees the deleted sessions that no thread can reference any
+ * longer.
  *
- * @param 	session	[wss_session_t *] 	"The session to be deleted"
- * @return 		    [wss_error_t] 	    "The error status"
+ * @return 		[void]
  */
-wss_error_t WSS_session_delete_no_lock(wss_session_t *session) {
-    wss_error_t err;
+void WSS_session_reclaim() {
+    uint_fast64_t e, observed;
+    wss_session_epoch_t *r;
+    wss_session_t *session, *next, *head = NULL, *tail = NULL;
 
-    WSS_log_trace("Deleting session");
+    if ( NULL == atomic_load(&retired) || pthread_mutex_trylock(&lock) != 0 ) {
+        return;
+    }
 
-    err = session_delete(session);
+    e = atomic_load(&epoch);
 
-    return err;
+    for (r = atomic_load(&records); NULL != r; r = r->next) {
+        observed = atomic_load(&r->epoch);
+        if (observed != 0 && observed != e) {
+            break;
+        }
+    }
+
+    if (NULL == r) {
+        atomic_store(&epoch, ++e);
+    }
+
+    // A session retired in some epoch can be referenced by threads that
+    // entered in that epoch, which have all left once the epoch advanced twice
+    for (session = atomic_exchange(&retired, NULL); NULL != session; session = next) {
+        next = session->retired_next;
+
+        if (session->retired_epoch + 2 <= e) {
+            WSS_log_trace("Freeing session %d", session->fd);
+            session_free(session);
+            continue;
+        }
+
+        session->retired_next = head;
+        head = session;
+        if (NULL == tail) {
+            tail = session;
+        }
+    }
+
+    if (NULL != head) {
+        next = atomic_load(&retired);
+        do {
+            tail->retired_next = next;
+        } while ( unlikely(! atomic_compare_exchange_weak(&retired, &next, head)) );
+    }
+
+    pthread_mutex_unlock(&lock);
 }
 
 /**
- * Function that frees the allocated memory and removes the session from the 
- * hashtable.
+ * Function that removes the session from the session table. The session is
+ * freed once no other thread can reference it any longer.
  *
  * @param 	session	[wss_session_t *] 	"The session to be deleted"
  * @return 		    [wss_error_t] 	    "The error status"
  */
 wss_error_t WSS_session_delete(wss_session_t *session) {
-    wss_error_t err;
-
     WSS_log_trace("Deleting session");
 
-    if ( unlikely((err = pthread_rwlock_wrlock(&lock)) != 0) ) {
-        WSS_log_error("Unable to lock session lock: %s", strerror(err));
-        return WSS_SESSION_LOCK_ERROR;
-    }
-
-    err = session_delete(session);
-
-    pthread_rwlock_unlock(&lock);
-
-    return err;
+    return session_delete(session);
 }
 
 /**
- * Function that frees the allocated memory and deletes all sessions.
+ * Function that frees the allocated memory and deletes all sessions. No other
+ * thread may access sessions while this is called.
  *
  * @return  [wss_error_t] 	"The error status"
  */
 wss_error_t WSS_session_delete_all() {
+    unsigned int i, j;
+    size_t k;
     wss_error_t err, tmp_err;
-    wss_session_t *session, *tmp;
+    wss_session_slot_t *chunk;
+    wss_session_t *session, *next;
 
     WSS_log_trace("Deleting all sessions");
 
-    if ( unlikely((err = pthread_rwlock_wrlock(&lock)) != 0) ) {
-        WSS_log_error("Unable to lock session lock: %s", strerror(err));
-        return WSS_SESSION_LOCK_ERROR;
-    }
-
     err = WSS_SUCCESS;
 
-    HASH_ITER(hh, sessions, session, tmp) {
-        tmp_err = session_delete(session);
+    for (i = 0; i < WSS_SESSION_CHUNKS; i++) {
+        if ( NULL == (chunk = atomic_exchange(&sessions[i], NULL)) ) {
+            continue;
+        }
+
+        for (j = 0; j < WSS_SESSION_CHUNK_SIZE; j++) {
+            if ( NULL != (session = atomic_load(&chunk[j])) ) {
+                // Sessions that were never disconnected still have to inform
+                // their subprotocol and extensions
+                if ( NULL != session->protocol ) {
+                    for (k = 0; k < session->extensions_count; k++) {
+                        session->extensions[k]->close(session->fd);
+                    }
+
+                    session->protocol->close(session->fd);
+                }
+
+                pthread_mutex_unlock(&session->lock);
+                tmp_err = session_free(session);
+                if ( likely(err == WSS_SUCCESS) ) {
+                    err = tmp_err;
+                }
+            }
+        }
+
+        WSS_free((void **) &chunk);
+    }
+
+    for (session = atomic_exchange(&retired, NULL); NULL != session; session = next) {
+        next = session->retired_next;
+        tmp_err = session_free(session);
         if ( likely(err == WSS_SUCCESS) ) {
             err = tmp_err;
         }
     }
-    pthread_rwlock_unlock(&lock);
 
     return err;
 }
@@ -302,19 +1033,11 @@ wss_error_t WSS_session_delete_all() {
  * @return  [wss_error_t] 	"The error status"
  */
 wss_error_t WSS_session_jobs_inc(wss_session_t *session) {
-    wss_error_t err;
-
-    if ( unlikely((err = pthread_mutex_lock(&session->lock_jobs)) != 0) ) {
-        WSS_log_error("Unable to lock session jobs lock: %s", strerror(err));
-        return WSS_SESSION_LOCK_ERROR;
-    }
-    session->jobs++;
-
-    WSS_log_trace("session %d incremented to %d jobs", session->fd, session->jobs);
+    int n = atomic_fetch_add(&session->jobs, 1) + 1;
 
-    pthread_mutex_unlock(&session->lock_jobs);
+    WSS_log_trace("session %d incremented to %d jobs", session->fd, n);
 
-    return err;
+    return WSS_SUCCESS;
 }
 
 /**
@@ -325,23 +1048,26 @@ wss_error_t WSS_session_jobs_inc(wss_session_t *session) {
  * @return            [wss_error_t] 	 "The error status"
  */
 wss_error_t WSS_session_jobs_dec(wss_session_t *session) {
-    wss_error_t err;
-
-    if ( unlikely((err = pthread_mutex_lock(&session->lock_jobs)) != 0) ) {
-        WSS_log_error("Unable to lock session jobs lock: %s", strerror(err));
-        return WSS_SESSION_LOCK_ERROR;
-    }
-    session->jobs--;
+    int err;
+    int n = atomic_fetch_sub(&session->jobs, 1) - 1;
+    unsigned int stripe = (unsigned int) session->fd%WSS_SESSION_JOBS_STRIPES;
 
-    WSS_log_trace("session %d decremented to %d jobs", session->fd, session->jobs);
+    WSS_log_trace("session %d decremented to %d jobs", session->fd, n);
 
-    if (session->jobs == 0) {
-        pthread_cond_signal(&session->cond_jobs);
+    if ( likely(n != 0) ) {
+        return WSS_SUCCESS;
     }
 
-    pthread_mutex_unlock(&session->lock_jobs);
+    // The condition is shared, hence every waiting session is woken up and
+    // checks its own counter again
+    if ( unlikely((err = pthread_mutex_lock(&jobs[stripe].lock)) != 0) ) {
+        WSS_log_error("Unable to lock session jobs lock: %s", strerror(err));
+        return WSS_SESSION_LOCK_ERROR;
+    }
+    pthread_cond_broadcast(&jobs[stripe].cond);
+    pthread_mutex_unlock(&jobs[stripe].lock);
 
-    return err;
+    return WSS_SUCCESS;
 }
 
 /**
@@ -351,9 +1077,14 @@ wss_error_t WSS_session_jobs_dec(wss_session_t *session) {
  * @return            [wss_error_t]  	 "The error status"
  */
 wss_error_t WSS_session_jobs_wait(wss_session_t *session) {
-    wss_error_t err;
+    int err;
+    unsigned int stripe = (unsigned int) session->fd%WSS_SESSION_JOBS_STRIPES;
+
+    if ( likely(atomic_load(&session->jobs) == 0) ) {
+        return WSS_SUCCESS;
+    }
 
-    if ( unlikely((err = pthread_mutex_lock(&session->lock_jobs)) != 0) ) {
+    if ( unlikely((err = pthread_mutex_lock(&jobs[stripe].lock)) != 0) ) {
         WSS_log_error("Unable to lock session jobs lock: %s", strerror(err));
         return WSS_SESSION_LOCK_ERROR;
     }
@@ -361,13 +1092,13 @@ wss_error_t WSS_session_jobs_wait(wss_session_t *session) {
     WSS_log_trace("session %d waiting to close", session->fd);
 
     // Wait for all jobs on session to be finished
-    while (session->jobs > 0) {
-        pthread_cond_wait(&session->cond_jobs, &session->lock_jobs);
+    while (atomic_load(&session->jobs) > 0) {
+        pthread_cond_wait(&jobs[stripe].cond, &jobs[stripe].lock);
     }
 
-    pthread_mutex_unlock(&session->lock_jobs);
+    pthread_mutex_unlock(&jobs[stripe].lock);
 
-    return err;
+    return WSS_SUCCESS;
 }
 
 /**
@@ -379,23 +1110,9 @@ wss_error_t WSS_session_jobs_wait(wss_session_t *session) {
  * @return       [wss_error_t]  "The error status"
  */
 wss_error_t WSS_session_is_disconnecting(wss_session_t *session, bool *dc) {
-    wss_error_t err;
-
-    *dc = true;
-
-    if ( unlikely((err = pthread_mutex_lock(&session->lock_disconnecting)) != 0) ) {
-        WSS_log_error("Unable to lock session disconnecting lock: %s", strerror(err));
-        return WSS_SESSION_LOCK_ERROR;
-    }
-
-    if (! session->disconnecting) {
-        *dc = false;
-        session->disconnecting = true;
-    }
-
-    pthread_mutex_unlock(&session->lock_disconnecting);
+    *dc = atomic_exchange(&session->disconnecting, true);
 
-    return err;
+    return WSS_SUCCESS;
 }
 
 /**
@@ -405,47 +1122,47 @@ wss_error_t WSS_session_is_disconnecting(wss_session_t *session, bool *dc) {
  * @return                 [wss_error_t] 	                      "The error status"
  */
 wss_error_t WSS_session_all(void (*callback)(wss_session_t *)) {
-    int err;
-    wss_session_t *session, *tmp;
+    unsigned int i, j;
+    wss_session_slot_t *chunk;
+    wss_session_t *session;
 
     WSS_log_trace("Finding all sessions");
 
-    if ( unlikely((err = pthread_rwlock_rdlock(&lock)) != 0) ) {
-        WSS_log_error("Unable to lock session lock: %s", strerror(err));
-        return WSS_SESSION_LOCK_ERROR;
-    }
+    WSS_session_enter();
 
-    HASH_ITER(hh, sessions, session, tmp) {
-        if ( likely(NULL != session) ) {
-            callback(session);
+    for (i = 0; i < WSS_SESSION_CHUNKS; i++) {
+        if ( NULL == (chunk = atomic_load_explicit(&sessions[i], memory_order_acquire)) ) {
+            continue;
+        }
+
+        for (j = 0; j < WSS_SESSION_CHUNK_SIZE; j++) {
+            if ( NULL != (session = atomic_load_explicit(&chunk[j], memory_order_acquire)) ) {
+                callback(session);
+            }
         }
     }
 
-    pthread_rwlock_unlock(&lock);
+    WSS_session_leave();
 
     return WSS_SUCCESS;
 }
 
 /**
- * Function that finds a session using the filedescriptor of the session.
+ * Function that finds a session using the filedescriptor of the session. The
+ * lookup never waits, and the calling thread must be between calls to
+ * WSS_session_enter and WSS_session_leave while using the session.
  *
  * @param 	fd 	[int] 		        "The filedescriptor associated to some session"
  * @return 		[wss_session_t *] 	"Returns session if successful, otherwise NULL"
  */
 wss_session_t *WSS_session_find(int fd) {
-    int err;
-    wss_session_t *session = NULL;
+    wss_session_slot_t *slot;
 
     WSS_log_trace("Finding session");
 
-    if ( unlikely((err = pthread_rwlock_rdlock(&lock)) != 0) ) {
-        WSS_log_error("Unable to lock session lock", strerror(err));
+    if ( unlikely(NULL == (slot = session_slot(fd, false))) ) {
         return NULL;
     }
 
-    HASH_FIND_INT(sessions, &fd, session);
-
-    pthread_rwlock_unlock(&lock);
-
-    return session;
+    return atomic_load_explicit(slot, memory_order_acquire);
 }
@@ -6,6 +6,7 @@
 #include <sys/types.h>          /* socket, setsockopt, accept, send, recv */
 #include <sys/socket.h>         /* socket, setsockopt, inet_ntoa, accept */
 #include <netinet/in.h>         /* sockaddr_in, inet_ntoa */
+#include <netinet/tcp.h>        /* TCP_DEFER_ACCEPT, TCP_FASTOPEN */
 #include <arpa/inet.h>          /* htonl, htons, inet_ntoa */
 
 #include "socket.h"
@@ -16,7 +17,16 @@
 #include "predict.h"
 
 /**
- * Function that initializes a socket and store the filedescriptor.
+ * The amount of tasks the injection queue of the work stealing threadpool can
+ * hold, unless the pool is limited to less by its maximal queue size
+ */
+#define WSS_STEALING_QUEUE 65536
+
+/**
+ * Function that initializes a socket and store the filedescriptor. If
+ * configured, accepting connections is deferred until data arrives and TCP
+ * Fast Open is enabled. These are optimizations only, hence failing to enable
+ * them is not an error.
  *
  * @param 	server	[server_t  **]	"The server instance"
  * @return 			[wss_error_t]   "The error status"
@@ -32,6 +42,32 @@ wss_error_t WSS_socket_create(wss_server_t *server) {
         return WSS_SOCKET_CREATE_ERROR;
     }
 
+    if ( NULL == server->config ) {
+        return WSS_SUCCESS;
+    }
+
+    if ( server->config->accept_defer > 0 ) {
+#ifdef TCP_DEFER_ACCEPT
+        int value = (int) server->config->accept_defer;
+        if ( unlikely(setsockopt(server->fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &value, sizeof(value)) < 0) ) {
+            WSS_log_warn("Unable to defer accepting connections: %s", strerror(errno));
+        }
+#else
+        WSS_log_warn("Deferring accepting connections is not supported on this platform");
+#endif
+    }
+
+    if ( server->config->accept_fastopen > 0 ) {
+#ifdef TCP_FASTOPEN
+        int value = (int) server->config->accept_fastopen;
+        if ( unlikely(setsockopt(server->fd, IPPROTO_TCP, TCP_FASTOPEN, &value, sizeof(value)) < 0) ) {
+            WSS_log_warn("Unable to enable TCP Fast Open: %s", strerror(errno));
+        }
+#else
+        WSS_log_warn("TCP Fast Open is not supported on this platform");
+#endif
+    }
+
     return WSS_SUCCESS;
 }
 
@@ -50,6 +86,27 @@ wss_error_t WSS_socket_reuse(int fd) {
     return WSS_SUCCESS;
 }
 
+/**
+ * Function that allows several sockets to be bound to the same port, such that
+ * the kernel can load balance incoming connections between them.
+ *
+ * @param 	fd		[int]		    "The filedescriptor of the listening socket"
+ * @return 			[wss_error_t]   "The error status"
+ */
+wss_error_t WSS_socket_reuse_port(int fd) {
+#ifdef SO_REUSEPORT
+    int reuse = 1;
+    if ( unlikely((setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse))) < 0) ){
+        WSS_log_fatal("Unable to share port: %s", strerror(errno));
+        return WSS_SOCKET_REUSE_ERROR;
+    }
+    return WSS_SUCCESS;
+#else
+    WSS_log_fatal("Sharing of ports is not supported on this platform");
+    return WSS_SOCKET_REUSE_ERROR;
+#endif
+}
+
 /**
  * Function that binds the socket to a specific port and chooses IPV6.
  *
@@ -136,6 +193,8 @@ wss_error_t WSS_socket_listen(int fd) {
  * @return 			[wss_error_t]       "The error status"
  */
 wss_error_t WSS_socket_threadpool(wss_server_t *server) {
+    int queue;
+
     if ( unlikely(NULL == server) ) {
         WSS_log_fatal("No server structure given");
         return WSS_THREADPOOL_CREATE_ERROR;
@@ -146,14 +205,49 @@ wss_error_t WSS_socket_threadpool(wss_server_t *server) {
         return WSS_THREADPOOL_CREATE_ERROR;
     }
 
+    /**
+     * The queues of the work stealing threadpool cannot grow, hence they are
+     * allocated up front and sized by a bound of their own
+     */
+    queue = server->config->size_thread;
+    if ( server->config->pool_scheduler == POOL_STEALING ) {
+        queue = WSS_STEALING_QUEUE;
+        if ( server->config->pool_max_queue > 0 && server->config->pool_max_queue < WSS_STEALING_QUEUE ) {
+            queue = (int) server->config->pool_max_queue;
+        }
+    }
+
     /**
      * Creating threadpool
      */
     if ( unlikely(NULL == (server->pool = threadpool_create(server->config->pool_workers,
-                        server->config->size_thread, server->config->size_thread, 0))) ) {
+                        queue, server->config->size_thread,
+                        server->config->pool_scheduler == POOL_STEALING ? threadpool_work_stealing : 0))) ) {
         WSS_log_fatal("The threadpool failed to initialize");
         return WSS_THREADPOOL_CREATE_ERROR;
     }
 
+    /**
+     * Allowing the threadpool to grow under load
+     */
+    if ( server->config->pool_scheduler == POOL_QUEUE ) {
+        if ( unlikely(threadpool_set_limits(server->pool, server->config->pool_max_workers,
+                        server->config->pool_max_queue, server->config->pool_idle_timeout) != 0) ) {
+            WSS_log_fatal("The threadpool limits could not be set");
+            return WSS_THREADPOOL_CREATE_ERROR;
+        }
+    } else if ( server->config->pool_max_workers > server->config->pool_workers ) {
+        WSS_log_warn("The work stealing threadpool has a fixed amount of workers");
+    }
+
+    /**
+     * Returning the memory cached by workers that have become idle
+     */
+    if ( unlikely(threadpool_set_idle(server->pool, WSS_alloc_collect,
+                    server->config->memory_collect) != 0) ) {
+        WSS_log_fatal("The threadpool idle routine could not be set");
+        return WSS_THREADPOOL_CREATE_ERROR;
+    }
+
     return WSS_SUCCESS;
 }
@@ -122,8 +122,10 @@ wss_error_t WSS_http_ssl(wss_server_t *server) {
     WSS_log_trace("Allow writes to be partial");
     SSL_CTX_set_mode(server->ssl_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE);
 
-    //WSS_log_trace("Allow write buffer to be moving as it is allocated on the heap");
-    //SSL_CTX_set_mode(server->ssl_ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    // A message whose write has to be retried is moved from the arena of the
+    // thread to the heap, when it is queued
+    WSS_log_trace("Allow write buffer to be moving as it is moved to the heap when queued");
+    SSL_CTX_set_mode(server->ssl_ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 
     WSS_log_trace("Allow read and write buffers to be released when they are no longer needed");
     SSL_CTX_set_mode(server->ssl_ctx, SSL_MODE_RELEASE_BUFFERS);
@@ -265,8 +267,10 @@ wss_error_t WSS_http_ssl(wss_server_t *server) {
     WSS_log_trace("Allow writes to be partial");
     wolfSSL_CTX_set_mode(server->ssl_ctx, SSL_MODE_ENABLE_PARTIAL_WRITE);
 
-    //WSS_log_trace("Allow write buffer to be moving as it is allocated on the heap");
-    //wolfSSL_CTX_set_mode(server->ssl_ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    // A message whose write has to be retried is moved from the arena of the
+    // thread to the heap, when it is queued
+    WSS_log_trace("Allow write buffer to be moving as it is moved to the heap when queued");
+    wolfSSL_CTX_set_mode(server->ssl_ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 
     WSS_log_trace("Allow read and write buffers to be released when they are no longer needed");
     wolfSSL_CTX_set_mode(server->ssl_ctx, SSL_MODE_RELEASE_BUFFERS);
@@ -349,16 +353,16 @@ void WSS_http_ssl_free(wss_server_t *server) {
  * @param   buffer      [char *]            "The buffer to use"
  * @return              [int]
  */
-int WSS_ssl_read(wss_server_t *server, wss_session_t *session, char *buffer) {
+int WSS_ssl_read(wss_server_t *server, wss_session_t *session, char *buffer, size_t length) {
 #if defined(USE_OPENSSL) | defined(USE_WOLFSSL)
     int n;
     unsigned long err;
     
 #if defined(USE_OPENSSL)
-    n = SSL_read(session->ssl, buffer, server->config->size_buffer);
+    n = SSL_read(session->ssl, buffer, length);
     err = SSL_get_error(session->ssl, n);
 #elif defined(USE_WOLFSSL)
-    n = wolfSSL_read(session->ssl, buffer, server->config->size_buffer);
+    n = wolfSSL_read(session->ssl, buffer, length);
     err = SSL_get_error(session->ssl, n);
 #endif
     
@@ -409,12 +413,11 @@ int WSS_ssl_read(wss_server_t *server, wss_session_t *session, char *buffer) {
  * Function that performs a ssl write to the connecting client.
  *
  * @param   session       [wss_session_t *]   "The connecting client session"
- * @param   message_index [unsigned int]      "The message index"
  * @param   message       [wss_message_t *]   "The message"
  * @param   bytes_sent    [unsigned int]      "The amount of bytes currently sent"
  * @return                [bool]
  */
-bool WSS_ssl_write_partial(wss_session_t *session, unsigned int message_index, wss_message_t *message, unsigned int *bytes_sent) {
+bool WSS_ssl_write_partial(wss_session_t *session, wss_message_t *message, unsigned int *bytes_sent) {
 #if defined(USE_OPENSSL) | defined(USE_WOLFSSL)
     int n;
     unsigned long err;
@@ -433,7 +436,6 @@ bool WSS_ssl_write_partial(wss_session_t *session, unsigned int message_index, w
         WSS_log_trace("Needs to wait for further reads");
 
         session->written = *bytes_sent;
-        ringbuf_release(session->ringbuf, message_index);
 
         session->event = READ;
 
@@ -446,8 +448,6 @@ bool WSS_ssl_write_partial(wss_session_t *session, unsigned int message_index, w
 
         session->written = *bytes_sent;
 
-        ringbuf_release(session->ringbuf, message_index);
-
         session->event = WRITE;
 
         return false;
@@ -650,10 +650,9 @@ bool WSS_session_ssl(wss_server_t *server, wss_session_t *session) {
  * Function frees SSL session instance that was used to serve over https.
  *
  * @param   session	[wss_session_t *] 	    "The session instance"
- * @param   lock	[pthread_rwlock_t *] 	"The read/write session lock"
  * @return 			[wss_error_t]           "An error or success"
  */
-wss_error_t WSS_session_ssl_free(wss_session_t *session, pthread_rwlock_t *lock) {
+wss_error_t WSS_session_ssl_free(wss_session_t *session) {
     int err = WSS_SUCCESS;
 
 #if defined(USE_OPENSSL)
@@ -662,10 +661,8 @@ wss_error_t WSS_session_ssl_free(wss_session_t *session, pthread_rwlock_t *lock)
         err = SSL_get_error(session->ssl, err);
         switch (err) {
             case SSL_ERROR_WANT_READ:
-                pthread_rwlock_unlock(lock);
                 return WSS_SSL_SHUTDOWN_READ_ERROR;
             case SSL_ERROR_WANT_WRITE:
-                pthread_rwlock_unlock(lock);
                 return WSS_SSL_SHUTDOWN_WRITE_ERROR;
             case SSL_ERROR_SYSCALL:
                 WSS_log_error("SSL_shutdown failed: %s", strerror(errno));
@@ -691,10 +688,8 @@ wss_error_t WSS_session_ssl_free(wss_session_t *session, pthread_rwlock_t *lock)
         err = SSL_get_error(session->ssl, err);
         switch (err) {
             case SSL_ERROR_WANT_READ:
-                pthread_rwlock_unlock(lock);
                 return WSS_SSL_SHUTDOWN_READ_ERROR;
             case SSL_ERROR_WANT_WRITE:
-                pthread_rwlock_unlock(lock);
                 return WSS_SSL_SHUTDOWN_WRITE_ERROR;
             case SSL_ERROR_SYSCALL:
                 WSS_log_error("SSL_shutdown failed: %s", strerror(errno));
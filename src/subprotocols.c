@@ -67,7 +67,10 @@ void WSS_load_subprotocols(wss_config_t *config)
             continue;
         }
 
-        if ( unlikely((*(void**)(&proto->init) = dlsym(proto->handle, "onInit")) == NULL) ) {
+        // The onInit2 function supersedes onInit and is optional
+        *(void**)(&proto->init2) = dlsym(proto->handle, "onInit2");
+
+        if ( unlikely((*(void**)(&proto->init) = dlsym(proto->handle, "onInit")) == NULL && NULL == proto->init2) ) {
             WSS_log_error("Failed to find 'onInit' function: %s", dlerror());
             dlclose(proto->handle);
             WSS_free((void **) &proto);
@@ -148,7 +151,11 @@ void WSS_load_subprotocols(wss_config_t *config)
         WSS_log_trace("Initializing subprotocol %s", proto->name);
 
         // Initialize subprotocol
-        proto->init(config->subprotocols_config[i], WSS_message_send);
+        if ( NULL != proto->init2 ) {
+            proto->init2(config->subprotocols_config[i], WSS_message_send, WSS_message_send_many);
+        } else {
+            proto->init(config->subprotocols_config[i], WSS_message_send);
+        }
 
         WSS_log_info("Successfully loaded %s extension", proto->name);
     }
@@ -0,0 +1,244 @@
+#include <time.h>
+#include <string.h>
+
+#include "timer.h"
+#include "alloc.h"
+#include "log.h"
+#include "predict.h"
+
+/**
+ * Function that unlinks a timer from the slot it is scheduled in. The lock of
+ * the wheel must be held.
+ *
+ * @param 	wheel	[wss_timer_wheel_t *] 	"The timer wheel"
+ * @param 	timer	[wss_timer_t *] 	    "The timer"
+ * @return 	        [void]
+ */
+static inline void timer_unlink(wss_timer_wheel_t *wheel, wss_timer_t *timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = NULL;
+    timer->next = NULL;
+    atomic_store_explicit(&timer->deadline, 0, memory_order_relaxed);
+    wheel->count--;
+}
+
+/**
+ * Function that returns the current time of the monotonic clock.
+ *
+ * @return 	[uint64_t] 	"The time in milliseconds"
+ */
+uint64_t WSS_timer_clock() {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec*1000 + (uint64_t) now.tv_nsec/1000000;
+}
+
+/**
+ * Function that creates a hashed timer wheel.
+ *
+ * @param 	slots	    [unsigned int] 	        "The amount of slots, rounded up to a power of two"
+ * @param 	resolution	[unsigned int] 	        "The amount of milliseconds covered by each slot"
+ * @param 	now	        [uint64_t] 	            "The current time in milliseconds"
+ * @return 	            [wss_timer_wheel_t *] 	"The timer wheel or NULL on error"
+ */
+wss_timer_wheel_t *WSS_timer_wheel_create(unsigned int slots, unsigned int resolution, uint64_t now) {
+    unsigned int i, length = 1;
+    wss_timer_wheel_t *wheel;
+
+    if ( unlikely(slots == 0 || resolution == 0) ) {
+        return NULL;
+    }
+
+    while ( length < slots ) {
+        length <<= 1;
+    }
+
+    if ( unlikely(NULL == (wheel = WSS_malloc(sizeof(wss_timer_wheel_t)))) ) {
+        WSS_log_error("Unable to allocate timer wheel");
+        return NULL;
+    }
+
+    if ( unlikely(NULL == (wheel->slots = WSS_calloc(length, sizeof(wss_timer_t)))) ) {
+        WSS_log_error("Unable to allocate slots of timer wheel");
+        WSS_free((void **) &wheel);
+        return NULL;
+    }
+
+    if ( unlikely(pthread_mutex_init(&wheel->lock, NULL) != 0) ) {
+        WSS_log_error("Unable to initialize lock of timer wheel");
+        WSS_free((void **) &wheel->slots);
+        WSS_free((void **) &wheel);
+        return NULL;
+    }
+
+    for (i = 0; i < length; i++) {
+        wheel->slots[i].prev = &wheel->slots[i];
+        wheel->slots[i].next = &wheel->slots[i];
+    }
+
+    wheel->length = length;
+    wheel->resolution = resolution;
+    wheel->tick = now/resolution;
+
+    return wheel;
+}
+
+/**
+ * Function that frees a timer wheel. Timers still scheduled are left untouched.
+ *
+ * @param 	wheel	[wss_timer_wheel_t *] 	"The timer wheel"
+ * @return 	        [void]
+ */
+void WSS_timer_wheel_destroy(wss_timer_wheel_t *wheel) {
+    if ( unlikely(NULL == wheel) ) {
+        return;
+    }
+
+    pthread_mutex_destroy(&wheel->lock);
+    WSS_free((void **) &wheel->expired);
+    WSS_free((void **) &wheel->slots);
+    WSS_free((void **) &wheel);
+}
+
+/**
+ * Function that schedules a timer to expire at the given deadline, unless it
+ * is already scheduled to expire before that. Runs in constant time.
+ *
+ * @param 	wheel	    [wss_timer_wheel_t *] 	"The timer wheel"
+ * @param 	timer	    [wss_timer_t *] 	    "The timer"
+ * @param 	deadline	[uint64_t] 	            "The deadline in milliseconds"
+ * @return 	            [bool]                  "Whether the timer was (re)scheduled"
+ */
+bool WSS_timer_schedule(wss_timer_wheel_t *wheel, wss_timer_t *timer, uint64_t deadline) {
+    uint64_t current, tick;
+    wss_timer_t *slot;
+
+    if ( unlikely(deadline == 0) ) {
+        deadline = 1;
+    }
+
+    // Activity only ever postpones deadlines, hence the common case is decided
+    // without taking the lock
+    current = atomic_load_explicit(&timer->deadline, memory_order_relaxed);
+    if ( likely(current != 0 && current <= deadline) ) {
+        return false;
+    }
+
+    pthread_mutex_lock(&wheel->lock);
+
+    current = atomic_load_explicit(&timer->deadline, memory_order_relaxed);
+    if ( unlikely(current != 0 && current <= deadline) ) {
+        pthread_mutex_unlock(&wheel->lock);
+        return false;
+    }
+
+    if (current != 0) {
+        timer_unlink(wheel, timer);
+    }
+
+    tick = deadline/wheel->resolution;
+    if (tick < wheel->tick) {
+        tick = wheel->tick;
+    }
+
+    slot = &wheel->slots[tick & (wheel->length-1)];
+    timer->prev = slot->prev;
+    timer->next = slot;
+    slot->prev->next = timer;
+    slot->prev = timer;
+    atomic_store_explicit(&timer->deadline, deadline, memory_order_relaxed);
+    wheel->count++;
+
+    pthread_mutex_unlock(&wheel->lock);
+
+    return true;
+}
+
+/**
+ * Function that removes a timer from the wheel, if it is scheduled.
+ *
+ * @param 	wheel	[wss_timer_wheel_t *] 	"The timer wheel"
+ * @param 	timer	[wss_timer_t *] 	    "The timer"
+ * @return 	        [void]
+ */
+void WSS_timer_cancel(wss_timer_wheel_t *wheel, wss_timer_t *timer) {
+    pthread_mutex_lock(&wheel->lock);
+    if ( likely(atomic_load_explicit(&timer->deadline, memory_order_relaxed) != 0) ) {
+        timer_unlink(wheel, timer);
+    }
+    pthread_mutex_unlock(&wheel->lock);
+}
+
+/**
+ * Function that removes the timers whose deadline has passed from the wheel.
+ * Only the slots elapsed since the last call are visited.
+ *
+ * @param 	wheel	[wss_timer_wheel_t *] 	"The timer wheel"
+ * @param 	now	    [uint64_t] 	            "The current time in milliseconds"
+ * @param 	fds	    [int **] 	            "Set to the file descriptors of the expired timers, valid until the next call"
+ * @return 	        [size_t]                "The amount of expired timers"
+ */
+size_t WSS_timer_expire(wss_timer_wheel_t *wheel, uint64_t now, int **fds) {
+    unsigned int i;
+    int *expired;
+    bool catchup;
+    size_t size, n = 0;
+    uint64_t tick, target = now/wheel->resolution;
+    wss_timer_t *slot, *timer, *next;
+
+    pthread_mutex_lock(&wheel->lock);
+
+    // If more than a full rotation has elapsed, every slot is visited once and
+    // expires everything due
+    catchup = wheel->tick < target && target - wheel->tick >= wheel->length;
+
+    // Only slots whose time span has fully elapsed are expired, such that no
+    // timer expires before its deadline
+    for (i = 0; wheel->tick < target && i < wheel->length; i++, wheel->tick++) {
+        slot = &wheel->slots[wheel->tick & (wheel->length-1)];
+        tick = catchup ? target-1 : wheel->tick;
+
+        for (timer = slot->next; timer != slot; timer = next) {
+            next = timer->next;
+
+            if (atomic_load_explicit(&timer->deadline, memory_order_relaxed)/wheel->resolution > tick) {
+                continue;
+            }
+
+            if ( unlikely(n == wheel->expired_size) ) {
+                size = wheel->expired_size == 0 ? 64 : wheel->expired_size*2;
+
+                // The slot is visited again by the next call, if out of memory
+                if ( unlikely(NULL == (expired = WSS_malloc(size*sizeof(int)))) ) {
+                    WSS_log_error("Unable to allocate expired timers");
+                    pthread_mutex_unlock(&wheel->lock);
+                    *fds = wheel->expired;
+                    return n;
+                }
+
+                if (n > 0) {
+                    memcpy(expired, wheel->expired, n*sizeof(int));
+                }
+                WSS_free((void **) &wheel->expired);
+                wheel->expired = expired;
+                wheel->expired_size = size;
+            }
+
+            wheel->expired[n++] = timer->fd;
+            timer_unlink(wheel, timer);
+        }
+    }
+
+    if (wheel->tick < target) {
+        wheel->tick = target;
+    }
+
+    pthread_mutex_unlock(&wheel->lock);
+
+    *fds = wheel->expired;
+
+    return n;
+}
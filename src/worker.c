@@ -1,3 +1,7 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* accept4 */
+#endif
+
 
 #include <errno.h> 				/* errno */
 #include <stdio.h> 				/* printf, fflush, fprintf, fopen, fclose */
@@ -7,11 +11,13 @@
 #include <math.h> 				/* log10 */
 #include <time.h>
 #include <locale.h>
+#include <limits.h>             /* IOV_MAX */
 
 #include <sys/types.h>          /* socket, setsockopt, accept, send, recv */
 #include <sys/stat.h> 			/* stat */
 #include <sys/socket.h>         /* socket, setsockopt, inet_ntoa, accept */
 #include <sys/select.h>         /* socket, setsockopt, inet_ntoa, accept */
+#include <sys/uio.h>            /* writev, struct iovec */
 #include <netinet/in.h>         /* sockaddr_in, inet_ntoa */
 #include <arpa/inet.h>          /* htonl, htons, inet_ntoa */
 
@@ -19,6 +25,7 @@
                                    pthread_mutex_init */
 
 #include "alloc.h"
+#include "arena.h"
 #include "worker.h"
 #include "server.h"
 #include "event.h"
@@ -37,6 +44,21 @@
 #include "predict.h"
 #include "ssl.h"
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/**
+ * The amount of bytes of queued messages that is gathered into a single write
+ */
+#define WSS_WRITE_BUDGET 262144
+
+/**
+ * The amount of segments of queued messages that the event loop is given to
+ * send at once
+ */
+#define WSS_SEND_SEGMENTS 64
+
 /**
  * Function that generates a handshake response, used to authorize a websocket
  * session.
@@ -400,6 +422,7 @@ static wss_message_t *http_response(wss_header_t *header, enum HttpStatus_Code c
  */
 void WSS_disconnect(wss_server_t *server, wss_session_t *session) {
     int i;
+    size_t j;
     wss_error_t err;
     bool dc;
 
@@ -415,9 +438,14 @@ void WSS_disconnect(wss_server_t *server, wss_session_t *session) {
 
     WSS_log_trace("Informing subprotocol of client with file descriptor %d disconnecting", session->fd);
 
-    if ( NULL != session->header && session->header->ws_protocol != NULL ) {
+    if ( NULL != session->protocol ) {
+        WSS_log_trace("Informing extensions about session close");
+        for (j = 0; j < session->extensions_count; j++) {
+            session->extensions[j]->close(session->fd);
+        }
+
         WSS_log_trace("Informing subprotocol about session close");
-        session->header->ws_protocol->close(session->fd);
+        session->protocol->close(session->fd);
     }
 
     WSS_log_trace("Removing poll filedescriptor from eventlist");
@@ -427,12 +455,12 @@ void WSS_disconnect(wss_server_t *server, wss_session_t *session) {
     WSS_log_trace("Deleting client session");
 
     if (NULL == server->ssl_ctx) {
-        WSS_log_info("Session %d disconnected from ip: %s:%d using HTTP request", session->fd, session->ip, session->port);
+        WSS_log_info("Session %d disconnected from ip: %s:%d using HTTP request", session->fd, WSS_session_ip(session), session->port);
     } else {
-        WSS_log_info("Session %d disconnected from ip: %s:%d using HTTPS request", session->fd, session->ip, session->port);
+        WSS_log_info("Session %d disconnected from ip: %s:%d using HTTPS request", session->fd, WSS_session_ip(session), session->port);
     }
 
-    for (i = 0; i < session->jobs; i++) {
+    for (i = 0; i < atomic_load(&session->jobs); i++) {
         pthread_mutex_unlock(&session->lock);
     }
 
@@ -452,130 +480,278 @@ void WSS_disconnect(wss_server_t *server, wss_session_t *session) {
     }
 }
 
+/**
+ * Function that creates the session of an accepted connection and starts
+ * communicating with it.
+ *
+ * @param 	server	    [wss_server_t *] 	    "The server structure"
+ * @param 	client_fd	[int] 	                "The file descriptor of the connection"
+ * @param 	client	    [struct sockaddr_in6 *] "The address of the connection"
+ * @return              [void]
+ */
+static void connect_session(wss_server_t *server, int client_fd, struct sockaddr_in6 *client) {
+    wss_session_t *session;
+
+    WSS_log_trace("Received incoming connection");
+
+#if !defined(__linux__)
+    WSS_socket_non_blocking(client_fd);
+
+    WSS_log_trace("Client filedescriptor was set to non-blocking");
+#endif
+
+    if ( unlikely(NULL == (session = WSS_session_add(client_fd,
+                    &client->sin6_addr, ntohs(client->sin6_port)))) ) {
+        close(client_fd);
+        return;
+    }
+
+    WSS_session_jobs_inc(session);
+    pthread_mutex_lock(&session->lock);
+
+    session->server = server;
+    session->state = CONNECTING;
+    WSS_log_trace("Created client session: %d", client_fd);
+
+    if (NULL != server->ssl_ctx) {
+        if (! WSS_session_ssl(server, session)) {
+            return;
+        }
+
+        WSS_ssl_handshake(server, session);
+    } else {
+        session->state = IDLE;
+        session->ring = WSS_poll_io(server);
+
+        clock_gettime(CLOCK_MONOTONIC, &session->alive);
+
+        WSS_poll_set_read(server, session->fd);
+
+        WSS_log_info("Client with session %d connected", session->fd);
+
+    }
+
+    WSS_session_jobs_dec(session);
+    pthread_mutex_unlock(&session->lock);
+}
+
 /**
  * Function that handles new connections. This function creates a new session and
  * associates the sessions filedescriptor to the epoll instance such that we can
- * start communicating with the session.
+ * start communicating with the session. At most the configured budget of
+ * sessions is accepted, such that a burst of connections does not starve the
+ * other events, while the rest is left for a later event. Connections that the
+ * poll instance accepted itself are only given a session.
  *
  * @param 	server	[wss_server_t *] 	"The server structure"
- * @param 	session	[wss_session_t *] 	"The session structure"
+ * @param 	fd	    [int] 	            "The file descriptor of a connection accepted by the poll instance or -1"
  * @return          [void]
  */
-void WSS_connect(wss_server_t *server) {
+void WSS_connect(wss_server_t *server, int fd) {
     int client_fd;
-    struct sockaddr_in client;
-    size_t ringbuf_obj_size;
+    unsigned int accepted;
+    struct sockaddr_in6 client;
     socklen_t client_size;
-    wss_session_t *session;
-    ringbuf_t *ringbuf;
-    size_t workers = server->config->pool_workers+1;
-
-    client_size	= sizeof(client);
-    memset((char *) &client, '\0', sizeof(client));
-
-    while (1) {
-        if ( (client_fd = accept(server->fd, (struct sockaddr *) &client,
-                        &client_size)) < 0 ) {
-            if ( likely(EAGAIN == errno || EWOULDBLOCK == errno) ) {
-                break;
-            }
+    unsigned int budget = server->config->accept_budget;
 
-            WSS_log_fatal("Accept failed: %s", strerror(errno));
-            break;
+    if (fd >= 0) {
+        client_size = sizeof(client);
+        if ( unlikely(getpeername(fd, (struct sockaddr *) &client, &client_size) < 0) ) {
+            memset(&client, 0, sizeof(client));
         }
 
-        WSS_log_trace("Received incoming connection");
+        connect_session(server, fd, &client);
+        return;
+    }
 
-        WSS_socket_non_blocking(client_fd);
+    // The listening socket cannot be rearmed in leader/follower mode
+    if (server->config->pool_mode == POOL_LEADER) {
+        budget = 0;
+    }
 
-        WSS_log_trace("Client filedescriptor was set to non-blocking");
+    for (accepted = 0; budget == 0 || accepted < budget; accepted++) {
+        client_size	= sizeof(client);
 
-        if ( unlikely(NULL == (session = WSS_session_add(client_fd,
-                        inet_ntoa(client.sin_addr), ntohs(client.sin_port)))) ) {
-            continue;
-        }
+#if defined(__linux__)
+        client_fd = accept4(server->fd, (struct sockaddr *) &client,
+                &client_size, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        client_fd = accept(server->fd, (struct sockaddr *) &client,
+                &client_size);
+#endif
 
-        WSS_session_jobs_inc(session);
-        pthread_mutex_lock(&session->lock);
+        if ( unlikely(client_fd < 0) ) {
+            if ( likely(EAGAIN == errno || EWOULDBLOCK == errno) ) {
+                return;
+            }
 
-        session->state = CONNECTING;
-        WSS_log_trace("Created client session: %d", client_fd);
+            // The connection was aborted before it was accepted
+            if ( likely(ECONNABORTED == errno || EINTR == errno) ) {
+                continue;
+            }
 
-        // Creating ringbuffer for session
-        ringbuf_get_sizes(0, workers, &ringbuf_obj_size, NULL);
-        if ( unlikely(NULL == (ringbuf = WSS_malloc(ringbuf_obj_size))) ) {
-            WSS_log_fatal("Failed to allocate memory for ringbuffer");
-            WSS_disconnect(server, session);
+            WSS_log_fatal("Accept failed: %s", strerror(errno));
             return;
         }
 
-        if ( unlikely(NULL == (session->messages = WSS_malloc(server->config->size_ringbuffer*sizeof(wss_message_t *)))) ) {
-            WSS_log_fatal("Failed to allocate memory for ringbuffer messages");
-            WSS_free((void **)&ringbuf);
-            WSS_disconnect(server, session);
-            return;
-        }
-        session->messages_count = server->config->size_ringbuffer;
+        connect_session(server, client_fd, &client);
+    }
 
-        ringbuf_setup(ringbuf, 0, workers, server->config->size_ringbuffer);
-        session->ringbuf = ringbuf;
+    WSS_log_trace("Accept budget is spent");
 
-        if (NULL == server->ssl_ctx) {
-            WSS_log_trace("User connected from ip: %s:%d using HTTP request", session->ip, session->port);
-        } else {
-            WSS_log_trace("User connected from ip: %s:%d using HTTPS request", session->ip, session->port);
+    if ( unlikely(WSS_poll_set_accept(server) != WSS_SUCCESS) ) {
+        WSS_log_error("Unable to rearm server file descriptor");
+    }
+}
+
+/**
+ * Function that checks whether a message starts with a closing frame.
+ *
+ * @param 	message	    [wss_message_t *] 	"The message"
+ * @return              [bool]              "Whether the message is a closing frame"
+ */
+static inline bool closing_message(wss_message_t *message) {
+    return message->framed && ((message->msg[0] & 0xF) & 0x8) == (message->msg[0] & 0xF);
+}
+
+/**
+ * Function that writes as much of a message to a session as possible without
+ * waiting for the session to become writeable.
+ *
+ * @param 	session	    [wss_session_t *] 	"The client session"
+ * @param 	message	    [wss_message_t *] 	"The message to write"
+ * @param 	bytes_sent	[unsigned int *] 	"The amount of bytes of the message written so far"
+ * @param 	closing	    [bool *] 	        "Set if the message is a closing frame"
+ * @return              [bool]              "Whether the whole message was written"
+ */
+static bool write_message(wss_session_t *session, wss_message_t *message, unsigned int *bytes_sent, bool *closing) {
+    ssize_t n;
+    size_t count;
+    unsigned int message_length = message->length;
+    struct iovec iov[NULL != message->iov ? MIN(message->iov_count, IOV_MAX) : 1];
+
+    while ( likely(*bytes_sent < message_length) ) {
+        // Check if message contains closing byte
+        if ( unlikely(*bytes_sent == 0 && closing_message(message)) ) {
+            *closing = true;
         }
 
-        if (NULL != server->ssl_ctx) {
-            if (! WSS_session_ssl(server, session)) {
-                WSS_free((void **)&ringbuf);
-                return;
+        if (NULL != session->ssl) {
+            if (! WSS_ssl_write_partial(session, message, bytes_sent)) {
+                return false;
             }
-
-            WSS_ssl_handshake(server, session);
         } else {
-            session->state = IDLE;
-
-            clock_gettime(CLOCK_MONOTONIC, &session->alive);
+            count = WSS_message_iov(message, *bytes_sent, iov, sizeof(iov)/sizeof(iov[0]));
+            n = writev(session->fd, iov, count);
+            if (unlikely(n == -1)) {
+                if ( unlikely(errno == EINTR) ) {
+                    errno = 0;
+                    continue;
+                } else if ( unlikely(errno != EAGAIN && errno != EWOULDBLOCK) ) {
+                    WSS_log_error("Write failed: %s", strerror(errno));
+                    session->closing = true;
+                    return false;
+                }
 
-            WSS_poll_set_read(server, session->fd);
+                session->written = *bytes_sent;
+                session->event = WRITE;
 
-            WSS_log_info("Client with session %d connected", session->fd);
+                return false;
+            }
 
+            *bytes_sent += n;
         }
-
-        WSS_session_jobs_dec(session);
-        pthread_mutex_unlock(&session->lock);
     }
+
+    return true;
 }
 
 /**
- * Puts a message in the client sessions writing buffer.
+ * Function that writes a message to a session, or puts it in the queue of the
+ * session if other messages are queued or the write would block. The queue is
+ * only allocated once a message has to be queued, such that idle sessions
+ * whose writes complete right away never hold one.
  *
- * @param 	session     [wss_session_t *] 	"The client session"
- * @param 	message     [wss_message_t *] 	"The message to send"
- * @return              [void]
+ * @param 	session	[wss_session_t *] 	"The client session"
+ * @param 	message	[wss_message_t *] 	"The message to send"
+ * @param 	direct	[bool] 	            "Whether the message may be written right away, which requires the lock of the session to be held"
+ * @return          [wss_error_t]       "The error status"
  */
-static wss_error_t write_internal(wss_session_t *session, wss_message_t *mes) {
+wss_error_t WSS_write_message(wss_session_t *session, wss_message_t *message, bool direct) {
     ssize_t off;
+    size_t pending;
+    bool closing = false;
+    unsigned int bytes_sent = 0;
     ringbuf_worker_t *w = NULL;
+    wss_session_queue_t *queue = atomic_load_explicit(&session->queue, memory_order_acquire);
+
+    // The holder of the lock is the only consumer of the queue, hence nothing
+    // can be consumed from the queue while it is checked
+    if ( direct && likely(NULL == queue || 0 == ringbuf_consume(queue->ringbuf, &pending)) ) {
+        WSS_log_trace("Writing message right away as no messages are queued");
+
+        if ( likely(write_message(session, message, &bytes_sent, &closing)) ) {
+            WSS_message_free(message);
+
+            if ( unlikely(closing) ) {
+                WSS_log_trace("Closing connection, since closing frame has been sent");
+                session->closing = true;
+            }
+
+            return WSS_SUCCESS;
+        }
+
+        if ( unlikely(session->closing) ) {
+            WSS_message_free(message);
+            return WSS_SUCCESS;
+        }
+    }
 
     WSS_log_trace("Putting message into ringbuffer");
 
-    if ( unlikely(-1 == (off = ringbuf_acquire(session->ringbuf, &w, 1))) ) {
-        WSS_free((void **) &mes->msg);
-        WSS_free((void **) &mes);
+    // The arena of the thread is reset once the event has been handled, hence
+    // a queued message is moved to the heap
+    if ( unlikely(NULL == (message = WSS_message_promote(message))) ) {
+        WSS_log_error("Unable to promote message");
+
+        return WSS_MEMORY_ERROR;
+    }
+
+    if ( unlikely(NULL == (queue = WSS_session_queue(session))) ) {
+        WSS_message_free(message);
+
+        return WSS_MEMORY_ERROR;
+    }
+
+    if ( unlikely(-1 == (off = ringbuf_acquire(queue->ringbuf, &w, 1))) ) {
+        WSS_message_free(message);
 
         WSS_log_error("Failed to acquire space in ringbuffer");
 
         return WSS_RINGBUFFER_ERROR;
     }
-    session->messages[off] = mes;
-    ringbuf_produce(session->ringbuf, &w);
+    queue->messages[off] = message;
+    ringbuf_produce(queue->ringbuf, &w);
+
+    // Mark the session as having messages to write, such that the holder of
+    // the lock writes them once it is done
+    atomic_store(&session->write_pending, true);
 
     return WSS_SUCCESS;
 }
 
+/**
+ * Puts a message in the client sessions writing buffer, unless it can be
+ * written right away. The lock of the session must be held.
+ *
+ * @param 	session     [wss_session_t *] 	"The client session"
+ * @param 	message     [wss_message_t *] 	"The message to send"
+ * @return              [void]
+ */
+static wss_error_t write_internal(wss_session_t *session, wss_message_t *mes) {
+    return WSS_write_message(session, mes, true);
+}
+
 /**
  * Performs the actual IO read operation using either the read or SSL_read
  * system calls.
@@ -583,16 +759,20 @@ static wss_error_t write_internal(wss_session_t *session, wss_message_t *mes) {
  * @param 	server      [wss_server_t *] 	"A server instance"
  * @param 	session     [wss_session_t *] 	"The client session"
  * @param 	buffer      [char *] 		    "The buffer to put the data into"
+ * @param 	length      [size_t] 		    "The amount of bytes that fit in the buffer"
  * @return              [int]               "The amount of bytes read or -1 for error or -2 for wait for IO"
  */
-static int read_internal(wss_server_t *server, wss_session_t *session, char *buffer) {
+static int read_internal(wss_server_t *server, wss_session_t *session, char *buffer, size_t length) {
     int n;
 
     if ( NULL != session->ssl ) {
-        n = WSS_ssl_read(server, session, buffer);
+        n = WSS_ssl_read(server, session, buffer, length);
+    } else if ( session->ring ) {
+        // The data was already received by the event loop
+        n = (int) WSS_session_read(session, buffer, length);
     } else {
         do {
-            n = read(session->fd, buffer, server->config->size_buffer);
+            n = read(session->fd, buffer, length);
             if (n == -1) {
                 if ( unlikely(errno == EINTR) ) {
                     errno = 0;
@@ -619,15 +799,11 @@ static int read_internal(wss_server_t *server, wss_session_t *session, char *buf
  */
 static void handshake(wss_server_t *server, wss_session_t *session) {
     int n;
+    unsigned int i;
     wss_header_t *header;
     wss_message_t *message;
     enum HttpStatus_Code code;
-    char *buffer;
-
-    if ( unlikely(NULL == (buffer = WSS_malloc(server->config->size_buffer)))) {
-        WSS_log_fatal("Unable to allocate buffer");
-        return;
-    }
+    size_t size;
 
     WSS_log_trace("Preparing client header");
 
@@ -663,9 +839,23 @@ static void handshake(wss_server_t *server, wss_session_t *session) {
 
     WSS_log_trace("Reading headers");
 
+    // The header is read directly into its content, which always has room
+    // for another read
+    size = header->length;
+
     // Continue reading until we get no bytes back
     do {
-        n = read_internal(server, session, buffer);
+        if (size < header->length+server->config->size_buffer+1) {
+            size = header->length+server->config->size_buffer+1;
+            if ( unlikely(NULL == (header->content = WSS_realloc_normal(header->content, size*sizeof(char)))) ) {
+                WSS_log_fatal("Unable to realloc header content");
+                WSS_free_header(header);
+                session->closing = true;
+                return;
+            }
+        }
+
+        n = read_internal(server, session, header->content+header->length, server->config->size_buffer);
 
         switch (n) {
             // Wait for IO for either read or write on the filedescriptor
@@ -692,14 +882,7 @@ static void handshake(wss_server_t *server, wss_session_t *session) {
             case 0:
                 break;
             default:
-                // Reallocate space for the header and copy buffer into it
-                if ( unlikely(NULL == (header->content = WSS_realloc((void **) &header->content, header->length*sizeof(char), (header->length+n+1)*sizeof(char)))) ) {
-                    WSS_log_fatal("Unable to realloc header content");
-                    return;
-                }
-                memcpy(header->content+header->length, buffer, n);
                 header->length += n;
-                memset(buffer, '\0', server->config->size_buffer);
 
                 // Check if payload from client is too large for the server to handle.
                 // If so write error back to the client
@@ -722,7 +905,11 @@ static void handshake(wss_server_t *server, wss_session_t *session) {
         }
     } while ( likely(n != 0) );
 
-    WSS_free((void **)&buffer);
+    if ( unlikely(header->length == 0) ) {
+        WSS_free((void **) &header->content);
+    } else {
+        header->content[header->length] = '\0';
+    }
 
     WSS_log_debug("Client header: \n%s", header->content);
 
@@ -832,12 +1019,37 @@ static void handshake(wss_server_t *server, wss_session_t *session) {
         header->ws_protocol = WSS_find_subprotocol("echo");
     }
 
+    // Only the negotiated subprotocol and extensions are kept once
+    // handshaked, such that the header can be freed
+    if (header->ws_extensions_count > 0) {
+        if ( unlikely(NULL == (session->extensions = WSS_malloc(header->ws_extensions_count*sizeof(wss_extension_t *)))) ) {
+            WSS_log_error("Unable to allocate extensions of session");
+
+            for (i = 0; i < header->ws_extensions_count; i++) {
+                header->ws_extensions[i]->ext->close(session->fd);
+            }
+            WSS_free_header(header);
+            WSS_message_free(message);
+            session->closing = true;
+
+            return;
+        }
+
+        for (i = 0; i < header->ws_extensions_count; i++) {
+            session->extensions[i] = header->ws_extensions[i]->ext;
+        }
+        session->extensions_count = header->ws_extensions_count;
+    }
+    session->protocol = header->ws_protocol;
+    session->type = header->ws_type;
+
     // Notify websocket protocol of the connection
-    header->ws_protocol->connect(session->fd, session->ip, session->port, header->path, header->cookies);
+    session->protocol->connect(session->fd, WSS_session_ip(session), session->port, header->path, header->cookies);
 
     // Set session as fully handshaked
     session->handshaked = true;
-    session->header = header;
+    WSS_free_header(header);
+    clock_gettime(CLOCK_MONOTONIC, &session->pinged);
 
     if ( likely(WSS_SUCCESS == write_internal(session, message)) ) {
         session->state = WRITING;
@@ -846,6 +1058,177 @@ static void handshake(wss_server_t *server, wss_session_t *session) {
     }
 }
 
+/**
+ * Stores the part of the payload that has not yet been parsed into frames in
+ * the receive buffer of the session, such that the next read can continue
+ * from it. The parsed bytes before the offset are kept until the buffer is
+ * full, unless the unparsed part is small enough to be moved into a smaller
+ * buffer. A payload that was read into the receive buffer of the thread is
+ * always moved, as that buffer is reused by the next event.
+ *
+ * @param 	server          [wss_server_t *] 	"The server structure"
+ * @param 	session         [wss_session_t *] 	"The session structure"
+ * @param 	payload         [char *] 	        "The payload"
+ * @param 	size            [size_t] 	        "The capacity of the payload"
+ * @param 	payload_length  [size_t] 	        "The length of the payload"
+ * @param 	offset          [size_t] 	        "The offset of the first byte not parsed"
+ * @param 	borrowed        [bool] 	            "Whether the payload is the receive buffer of the thread"
+ * @return                  [bool]              "Whether the payload was stored"
+ */
+static bool store_payload(wss_server_t *server, wss_session_t *session, char *payload, size_t size, size_t payload_length, size_t offset, bool borrowed) {
+    char *copy;
+    size_t remaining = payload_length-offset;
+
+    if ( unlikely(remaining == 0) ) {
+        if (! borrowed) {
+            WSS_free((void **) &payload);
+        }
+        return true;
+    }
+
+    if ( borrowed || (size > server->config->size_buffer && remaining <= size/4) ) {
+        size = MAX(remaining*2, server->config->size_buffer);
+        if ( unlikely(NULL == (copy = WSS_realloc_normal(NULL, (size+1)*sizeof(char)))) ) {
+            WSS_log_error("Unable to allocate the payload");
+            if (! borrowed) {
+                WSS_free((void **) &payload);
+            }
+            session->closing = true;
+            return false;
+        }
+        memcpy(copy, payload+offset, remaining);
+        if (! borrowed) {
+            WSS_free((void **) &payload);
+        }
+        payload = copy;
+        payload_length = remaining;
+        offset = 0;
+    }
+
+    session->payload = payload;
+    session->payload_size = size;
+    session->payload_length = payload_length;
+    session->offset = offset;
+
+    return true;
+}
+
+/**
+ * Appends a frame of a fragmented message to the message reassembled for the
+ * session. The first frame of the message is copied and its payload becomes
+ * the message, which capacity is doubled whenever it is exhausted.
+ *
+ * @param 	server  [wss_server_t *] 	"The server structure"
+ * @param 	session [wss_session_t *] 	"The session structure"
+ * @param 	frame   [wss_frame_t *] 	"The frame to append"
+ * @return          [wss_close_t]       "0 or the reason the session should be closed"
+ */
+static wss_close_t append_fragment(wss_server_t *server, wss_session_t *session, wss_frame_t *frame) {
+    wss_frame_t *message = session->message;
+    size_t length;
+
+    if ( NULL == message ) {
+        if ( unlikely(NULL == (message = WSS_copy(frame, sizeof(wss_frame_t)))) ) {
+            WSS_log_error("Unable to allocate fragmented message");
+            return CLOSE_UNEXPECTED;
+        }
+        message->payload = NULL;
+        message->payloadLength = 0;
+        message->extensionDataLength = 0;
+        message->applicationDataLength = 0;
+        session->message = message;
+    }
+
+    if ( unlikely(++session->message_frames > server->config->max_frames) ) {
+        WSS_log_trace("Fragmented message consists of too many frames");
+        return CLOSE_BIG;
+    }
+
+    length = message->payloadLength+frame->payloadLength;
+    if ( unlikely(length > session->message_size) ) {
+        session->message_size = MAX(length, session->message_size*2);
+        if ( unlikely(NULL == (message->payload = WSS_realloc_normal(message->payload, (session->message_size+1)*sizeof(char)))) ) {
+            WSS_log_error("Unable to reallocate fragmented message");
+            session->message_size = 0;
+            return CLOSE_UNEXPECTED;
+        }
+    }
+
+    if ( likely(frame->payloadLength > 0) ) {
+        memcpy(message->payload+message->payloadLength, frame->payload, frame->payloadLength);
+    }
+    message->payloadLength = length;
+    message->applicationDataLength = length;
+    message->fin = frame->fin;
+
+    return 0;
+}
+
+/**
+ * Applies the extensions of the session to a complete message and notifies
+ * the subprotocol of it. The message is terminated in place for the duration
+ * of the call, hence there must be room for one more byte after the message,
+ * and the frame must own its payload if the session uses extensions.
+ *
+ * @param 	session [wss_session_t *] 	"The session structure"
+ * @param 	frame   [wss_frame_t *] 	"The message as a single frame"
+ * @return          [wss_close_t]       "0 or the reason the session should be closed"
+ */
+static wss_close_t deliver_message(wss_session_t *session, wss_frame_t *frame) {
+    size_t j;
+    char empty = '\0';
+    char terminator;
+    char *msg;
+    size_t msg_length;
+
+    if ( unlikely(session->extensions_count > 0) ) {
+        WSS_log_trace("Applying %d extensions on input", session->extensions_count);
+
+        for (j = 0; likely(j < session->extensions_count); j++) {
+            session->extensions[j]->inframe(session->fd, frame);
+            session->extensions[j]->inframes(session->fd, &frame, 1);
+        }
+
+        // The extensions may have replaced the payload
+        if ( likely(NULL != frame->payload) ) {
+            if ( unlikely(NULL == (frame->payload = WSS_arena_realloc(frame->payload, (frame->payloadLength+1)*sizeof(char)))) ) {
+                WSS_log_error("Unable to reallocate message");
+                return CLOSE_UNEXPECTED;
+            }
+        }
+    }
+
+    if ( unlikely(NULL == frame->payload) ) {
+        msg = &empty;
+        msg_length = 0;
+    } else {
+        msg = frame->payload+frame->extensionDataLength;
+        msg_length = frame->applicationDataLength;
+    }
+
+    // Check utf8 for text frames
+    if ( unlikely(frame->opcode == TEXT_FRAME && ! utf8_check(msg, msg_length)) ) {
+        WSS_log_trace("UTF8 Error: the text was not UTF8 encoded correctly");
+        return CLOSE_UTF8;
+    }
+
+    // The byte after the message is kept aside while the message is terminated
+    terminator = msg[msg_length];
+    msg[msg_length] = '\0';
+
+    WSS_log_debug("Unmasked message (%d bytes): %s\n", msg_length, msg);
+    WSS_log_trace("Notifying subprotocol of message");
+
+    // Sessions the subprotocol sends the message to share a copy of it
+    WSS_message_delivery_begin(frame->opcode, msg, msg_length);
+    session->protocol->message(session->fd, frame->opcode, msg, msg_length);
+    WSS_message_delivery_end();
+
+    msg[msg_length] = terminator;
+
+    return 0;
+}
+
 /**
  * Function that reads information from a session.
  *
@@ -853,27 +1236,22 @@ static void handshake(wss_server_t *server, wss_session_t *session) {
  * @param 	session	[wss_session_t *] 	"The session structure"
  * @return          [void]
  */
-void WSS_read(wss_server_t *server, wss_session_t *session) {
+static void read_session(wss_server_t *server, wss_session_t *session) {
     int n;
-    size_t len;
     uint16_t code;
+    wss_close_t reason;
     wss_frame_t *frame;
-    char *msg;
+    wss_frame_t view;
     bool closing = false;
     size_t offset = 0, prev_offset = 0;
-    wss_frame_t **frames = NULL;
     char *payload = NULL;
     size_t payload_length = 0;
-    size_t frames_length = 0;
     char *message;
     size_t message_length;
     wss_message_t *m;
-    size_t i, j, k;
-    size_t msg_length = 0;
-    size_t msg_offset = 0;
-    size_t starting_frame = 0;
-    bool fragmented = false;
-    char *buffer;
+    bool borrowed = false;
+    size_t size;
+    char *data;
 
     // If no initial header has been seen for the session, the websocket
     // handshake is yet to be made.
@@ -885,50 +1263,88 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
 
     WSS_log_trace("Starting initial steps to read from client");
 
-    if ( unlikely(NULL == (buffer = WSS_malloc(server->config->size_buffer)))) {
-        WSS_log_error("Unable to allocate buffer");
-        session->closing = true;
-        return;
-    }
-
     // Use earlier payload
     payload = session->payload;
     payload_length = session->payload_length;
+    size = session->payload_size;
     offset = session->offset;
-    frames = session->frames;
-    frames_length = session->frames_length;
     session->payload = NULL;
+    session->payload_size = 0;
     session->payload_length = 0;
     session->offset = 0;
-    session->frames = NULL;
-    session->frames_length = 0;
+
+    // Without an earlier payload the data is read into the receive buffer of
+    // the thread, otherwise it is appended to the earlier payload directly
+    if ( likely(NULL == payload) ) {
+        if ( unlikely(NULL == (payload = WSS_session_buffer(server->config->size_buffer+1))) ) {
+            session->closing = true;
+            return;
+        }
+        size = server->config->size_buffer;
+        borrowed = true;
+    }
 
     // If handshake has been made, we can read the websocket frames from
     // the connection
     do {
-        n = read_internal(server, session, buffer);
+        // Make room for the next read, when the payload is full. If at least
+        // half of the payload was parsed already, the unparsed bytes are
+        // moved to the front, otherwise the capacity is doubled, such that
+        // large messages are received with a logarithmic amount of copies.
+        // The receive buffer of the thread is reused by the next event,
+        // hence the data is moved to memory of its own. One byte more than
+        // the capacity is always allocated, such that messages can be
+        // terminated in place.
+        if ( unlikely(payload_length == size) ) {
+            if ( ! borrowed && offset >= size/2 ) {
+                memmove(payload, payload+offset, payload_length-offset);
+                payload_length -= offset;
+                offset = 0;
+            } else {
+                size = MAX(size*2, server->config->size_buffer);
+                if (borrowed) {
+                    if ( unlikely(NULL == (data = WSS_realloc_normal(NULL, (size+1)*sizeof(char)))) ) {
+                        WSS_log_error("Unable to allocate the payload");
+                        session->closing = true;
+                        return;
+                    }
+                    memcpy(data, payload, payload_length);
+                    payload = data;
+                    borrowed = false;
+                } else if ( unlikely(NULL == (payload = WSS_realloc_normal(payload, (size+1)*sizeof(char)))) ) {
+                    WSS_log_error("Unable to reallocate the payload");
+                    session->closing = true;
+                    return;
+                }
+            }
+        }
+
+        n = read_internal(server, session, payload+payload_length, size-payload_length);
 
         switch (n) {
             // Wait for IO for either read or write on the filedescriptor
             case -2:
                 WSS_log_trace("Detected that server needs further IO to complete the reading");
-                session->payload = payload;
-                session->payload_length = payload_length;
+                if ( unlikely(! store_payload(server, session, payload, size, payload_length, offset, borrowed)) ) {
+                    return;
+                }
 
                 session->event = WRITE;
 
                 return;
             // An error occured
             case -1:
-                WSS_free((void **) &payload);
+                if (! borrowed) {
+                    WSS_free((void **) &payload);
+                }
 
                 frame = WSS_closing_frame(CLOSE_UNEXPECTED, NULL);
                 message_length = WSS_stringify_frame(frame, &message);
                 WSS_free_frame(frame);
 
-                if ( unlikely(NULL == (m = WSS_malloc(sizeof(wss_message_t)))) ) {
+                if ( unlikely(NULL == (m = WSS_arena_malloc(sizeof(wss_message_t)))) ) {
                     WSS_log_error("Unable to allocate the message structure");
-                    WSS_free((void **) &message);
+                    WSS_arena_free((void **) &message);
                     session->closing = true;
                     return;
                 }
@@ -945,33 +1361,31 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
             // No new data received
             case 0:
                 break;
-            // Empty buffer into payload
+            // The data was read into the payload
             default:
-                if ( unlikely(NULL == (payload = WSS_realloc((void **) &payload, payload_length*sizeof(char), (payload_length+n+1)*sizeof(char)))) ) {
-                    WSS_log_error("Unable to reallocate the payload");
-                    session->closing = true;
-                    return;
-                }
-
-                memcpy(payload+payload_length, buffer, n);
                 payload_length += n;
-                memset(buffer, '\0', server->config->size_buffer);
-
         }
     } while ( likely(n != 0) );
 
-    // Release memory used for buffer
-    WSS_free((void **) &buffer);
+    if ( unlikely(payload_length == 0) ) {
+        if (! borrowed) {
+            WSS_free((void **) &payload);
+        }
+        payload = NULL;
+    }
 
     WSS_log_trace("Payload from client was read. Continues flow by parsing frames.");
 
-    // Parse the payload into websocket frames
+    // Parse the payload into websocket frames and handle every frame as soon
+    // as it has been parsed
     do {
         prev_offset = offset;
 
-        if ( unlikely(NULL == (frame = WSS_parse_frame(payload, payload_length, &offset))) ) {
+        if ( unlikely(! WSS_parse_frame_view(payload, payload_length, &offset, &view, server->config->size_frame)) ) {
             WSS_log_trace("Unable to parse frame");
-            WSS_free((void **) &payload);
+            if (! borrowed) {
+                WSS_free((void **) &payload);
+            }
             session->closing = true;
             return;
         }
@@ -980,22 +1394,19 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
         if ( unlikely(offset > payload_length) ) {
             WSS_log_trace("Detected that data was missing in order to complete frame, will wait for more");
 
-            WSS_free_frame(frame);
-
-            session->payload = payload;
-            session->payload_length = payload_length;
-            session->offset = prev_offset;
-            session->frames = frames;
-            session->frames_length = frames_length;
+            if ( unlikely(! store_payload(server, session, payload, size, payload_length, prev_offset, borrowed)) ) {
+                return;
+            }
             session->event = READ;
 
             return;
         }
 
+        frame = &view;
+
         // If no extension is negotiated, the rsv bits must not be used
-        if ( unlikely(NULL == session->header->ws_extensions && (frame->rsv1 || frame->rsv2 || frame->rsv3)) ) {
+        if ( unlikely(NULL == session->extensions && (frame->rsv1 || frame->rsv2 || frame->rsv3)) ) {
             WSS_log_trace("Protocol Error: rsv bits must not be set without using extensions");
-            WSS_free_frame(frame);
             frame = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
         } else
 
@@ -1003,42 +1414,36 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
         if ( unlikely((frame->opcode >= 0x3 && frame->opcode <= 0x7) ||
                 (frame->opcode >= 0xB && frame->opcode <= 0xF)) ) {
             WSS_log_trace("Type Error: Unknown upcode");
-            WSS_free_frame(frame);
             frame = WSS_closing_frame(CLOSE_TYPE, NULL);
         } else
 
         // Server expects all received data to be masked
         if ( unlikely(! frame->mask) ) {
             WSS_log_trace("Protocol Error: Client message should always be masked");
-            WSS_free_frame(frame);
             frame = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
         } else
 
         // Control frames cannot be fragmented
         if ( unlikely(! frame->fin && frame->opcode >= 0x8 && frame->opcode <= 0xA) ) {
             WSS_log_trace("Protocol Error: Control frames cannot be fragmented");
-            WSS_free_frame(frame);
             frame = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
         } else
 
         // Check that frame is not too large
         if ( unlikely(frame->payloadLength > server->config->size_frame) ) {
             WSS_log_trace("Protocol Error: Control frames cannot be fragmented");
-            WSS_free_frame(frame);
             frame = WSS_closing_frame(CLOSE_BIG, NULL);
         } else 
 
         // Control frames cannot have a payload length larger than 125 bytes
         if ( unlikely(frame->opcode >= 0x8 && frame->opcode <= 0xA && frame->payloadLength > 125) ) {
             WSS_log_trace("Protocol Error: Control frames cannot have payload larger than 125 bytes");
-            WSS_free_frame(frame);
             frame = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
         } else
 
         // In HYBI10 specification the most significant bit must not be set
-        if ( unlikely((session->header->ws_type == HYBI10 || session->header->ws_type == HYBI07) && frame->payloadLength & ((uint64_t)1 << (sizeof(uint64_t)*8-1))) ) {
+        if ( unlikely((session->type == HYBI10 || session->type == HYBI07) && frame->payloadLength & ((uint64_t)1 << (sizeof(uint64_t)*8-1))) ) {
             WSS_log_trace("Protocol Error: Frame payload length must not use MSB");
-            WSS_free_frame(frame);
             frame = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
         } else
 
@@ -1047,7 +1452,6 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
             // A code of 2 byte must be present if there is any application data for closing frame
             if ( unlikely(frame->applicationDataLength > 0 && frame->applicationDataLength < 2) ) {
                 WSS_log_trace("Protocol Error: Closing frame with payload too small bytewise error code");
-                WSS_free_frame(frame);
                 frame = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
             } else 
 
@@ -1055,7 +1459,6 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
             // The payload after the code, must be valid UTF8
             if ( unlikely(frame->applicationDataLength >= 2 && ! utf8_check(frame->payload+2, frame->applicationDataLength-2)) ) {
                 WSS_log_trace("Protocol Error: Payload of error frame must be valid UTF8.");
-                WSS_free_frame(frame);
                 frame = WSS_closing_frame(CLOSE_UTF8, NULL);
             } else 
             
@@ -1070,7 +1473,6 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
                 // Current rfc6455 codes
                 if ( unlikely(code < 1000 || (code >= 1004 && code <= 1006) || (code >= 1015 && code < 3000) || code >= 5000) ) {
                     WSS_log_trace("Protocol Error: Closing frame has invalid error code");
-                    WSS_free_frame(frame);
                     frame = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
                 }
             }
@@ -1080,8 +1482,6 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
         if ( unlikely(frame->opcode == PONG_FRAME) ) {
             WSS_log_trace("Pong received");
 
-            WSS_free_frame(frame);
-
             continue;
         } else
 
@@ -1089,234 +1489,297 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
         if ( unlikely(frame->opcode == PING_FRAME) ) {
             WSS_log_trace("Ping received");
             frame = WSS_pong_frame(frame);
-        }
+        } else
 
-        if ( unlikely(NULL == (frames = WSS_realloc((void **) &frames, frames_length*sizeof(wss_frame_t *),
-                        (frames_length+1)*sizeof(wss_frame_t *)))) ) {
-            WSS_log_error("Unable to reallocate frames");
-            session->closing = true;
-            return;
-        }
-        frames[frames_length] = frame;
-        frames_length += 1;
+        // If we are not processing a fragmented message, expect the opcode
+        // different from the continuation frame, otherwise expect it to be
+        // the continuation frame
+        if ( unlikely((NULL == session->message) == (frame->opcode == CONTINUATION_FRAME)) ) {
+            WSS_log_trace("Protocol Error: continuation opcode used out of fragmented message or other opcode used within");
+            frame = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
+        } else
 
-        // Check if frame count is exceeded
-        if ( unlikely(frames_length > server->config->max_frames) ) {
-            WSS_free_frame(frame);
-            frame = WSS_closing_frame(CLOSE_BIG, NULL);
-            frames[frames_length-1] = frame;
-        }
+        // A message consisting of a single frame is delivered straight from
+        // the receive buffer, unless extensions have to transform it first
+        if ( likely(frame->fin && frame->opcode != CONTINUATION_FRAME) ) {
+            if ( unlikely(session->extensions_count > 0) ) {
+                if ( unlikely(NULL == (frame = WSS_copy_frame(&view))) ) {
+                    WSS_log_error("Unable to copy frame");
+                    session->closing = true;
+                    return;
+                }
+                reason = deliver_message(session, frame);
+                WSS_free_frame(frame);
+            } else {
+                reason = deliver_message(session, frame);
+            }
 
-        // Close
-        if ( unlikely(frame->opcode == CLOSE_FRAME) ) {
-            closing = true;
-            WSS_log_trace("Stopping frame validation as closing frame was parsed");
-            break;
-        }
-    } while ( likely(offset < payload_length) );
+            frame = &view;
+            if ( unlikely(reason != 0) ) {
+                frame = WSS_closing_frame(reason, NULL);
+            }
+        } else
 
-    WSS_free((void **) &payload);
+        // The frame is part of a fragmented message, which is reassembled
+        // into the payload of the first frame of the message
+        {
+            reason = append_fragment(server, session, frame);
 
-    WSS_log_trace("A total of %lu frames was parsed.", frames_length);
+            if ( likely(reason == 0 && frame->fin) ) {
+                WSS_log_trace("Fragmented message was reassembled");
 
-    WSS_log_trace("Starting frame validation");
+                reason = deliver_message(session, session->message);
+                WSS_free_frame(session->message);
+                session->message = NULL;
+                session->message_size = 0;
+                session->message_frames = 0;
+            }
 
-    // Validating frames.
-    for (i = 0; likely(i < frames_length); i++) {
-        // If we are not processing a fragmented set of frames, expect the
-        // opcode different from the continuation frame.
-        if ( unlikely(! fragmented && (frames[i]->opcode == CONTINUATION_FRAME)) ) {
-            WSS_log_trace("Protocol Error: continuation opcode used in non-fragmented message");
-            for (j = i; likely(j < frames_length); j++) {
-                WSS_free_frame(frames[j]);
+            if ( unlikely(reason != 0) ) {
+                frame = WSS_closing_frame(reason, NULL);
             }
-            frames[i] = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
-            frames_length = i+1;
-            closing = true;
-            break;
         }
 
-        // If we receive control frame within fragmented frames.
-        if ( unlikely(fragmented && (frames[i]->opcode >= 0x8 && frames[i]->opcode <= 0xA)) ) {
-            WSS_log_trace("Received control frame within fragmented message");
-
-            frame = frames[i];
-            // If we received a closing frame substitue the fragment with the
-            // closing frame and end validation
-            if (frames[i]->opcode == CLOSE_FRAME) {
-                WSS_log_trace("Stopping further validation of fragmented message as a closing frame was detected");
-
-                for (j = starting_frame; likely(j < frames_length); j++) {
-                    if ( unlikely(j != i) ) {
-                        WSS_free_frame(frames[j]);
-                    } else {
-                        frames[j] = NULL;
-                    }
-                }
-                frames[starting_frame] = frame;
-                frames_length = starting_frame+1;
-                fragmented = false;
+        // Control frames are written right away, before the remaining frames
+        // of a fragmented message are received
+        if ( unlikely(frame->opcode >= 0x8 && frame->opcode <= 0xA) ) {
+            WSS_log_trace("Writing control frame message");
+
+            WSS_session_jobs_inc(session);
+            WSS_message_send_frames((void *)server, (void *)session, &frame, 1);
+
+            if ( unlikely(frame->opcode == CLOSE_FRAME) ) {
                 closing = true;
-                break;
-            // Else rearrange the frames, such that control frame is first
-            } else {
-                WSS_log_trace("Rearranging frames such that control frame will be written before fragmented frames");
-                for (j = i; likely(j > starting_frame); j--) {
-                    frames[j] = frames[j-1];
-                }
-                frames[starting_frame] = frame;
-                starting_frame++;
             }
-        } else
 
-        // If we are processing a fragmented set of frames, expect the opcode
-        // to be a contination frame.
-        if ( unlikely(fragmented && frames[i]->opcode != CONTINUATION_FRAME) ) {
-            WSS_log_trace("Protocol Error: during fragmented message received other opcode than continuation");
-            for (j = starting_frame; likely(j < frames_length); j++) {
-                WSS_free_frame(frames[j]);
+            if ( frame != &view ) {
+                WSS_free_frame(frame);
             }
-            frames[starting_frame] = WSS_closing_frame(CLOSE_PROTOCOL, NULL);
-            frames_length = starting_frame+1;
-            fragmented = false;
-            closing = true;
-            break;
-        }
 
-        // If message consists of single frame or we have the starting frame of
-        // a multiframe message, store the starting index
-        if ( frames[i]->fin && frames[i]->opcode != CONTINUATION_FRAME ) {
-            starting_frame = i;
-        } else if ( ! frames[i]->fin && frames[i]->opcode != CONTINUATION_FRAME ) {
-            starting_frame = i;
-            fragmented = true;
+            if ( unlikely(closing) ) {
+                WSS_log_trace("Stopping frame validation as closing frame was parsed");
+                break;
+            }
         }
+    } while ( likely(offset < payload_length) );
 
-        if (frames[i]->fin) {
-            fragmented = false;
-        }
+    if (! borrowed) {
+        WSS_free((void **) &payload);
     }
 
-    // If fragmented is still true, we did not receive the whole message, and
-    // we hence want to wait until we get the rest.
-    if ( unlikely(fragmented) ) {
+    // If a fragmented message is still being reassembled, we did not receive
+    // the whole message, and we hence want to wait until we get the rest.
+    if ( unlikely(! closing && NULL != session->message) ) {
         WSS_log_trace("Detected missing frames in fragmented message, will wait for further IO");
 
-        session->frames = frames;
-        session->frames_length = frames_length;
         session->event = READ;
 
         return;
     }
 
-    WSS_log_trace("Frames was validated");
-    
     session->state = IDLE;
 
-    WSS_log_trace("Sending frames to receivers");
+    if (! closing && session->event == NONE) {
+        WSS_log_trace("Set epoll file descriptor to read mode after finishing read");
+        session->event = READ;
+    }
+}
+
+/**
+ * Function that reads information from a session. Frames, replies and other
+ * temporary objects of the read are allocated from the arena of the thread,
+ * which is reset at once when the read is done.
+ *
+ * @param 	server	[wss_server_t *] 	"The server structure"
+ * @param 	session	[wss_session_t *] 	"The session structure"
+ * @return          [void]
+ */
+void WSS_read(wss_server_t *server, wss_session_t *session) {
+    WSS_arena_enter();
+    read_session(server, session);
+    WSS_arena_leave();
+}
+
+/**
+ * Function that frees the consumed messages of the queue of a session that
+ * were completely written, and remembers how much of the next message was.
+ *
+ * @param 	session	[wss_session_t *] 	    "The session structure"
+ * @param 	queue	[wss_session_queue_t *] "The queue of the session"
+ * @param 	off	    [size_t] 	            "The offset of the consumed messages"
+ * @param 	len	    [size_t] 	            "The amount of consumed messages"
+ * @param 	n	    [size_t] 	            "The amount of bytes written"
+ * @param 	closing	[bool *] 	            "Set if a closing frame has been written"
+ * @return          [size_t]                "The amount of messages that were completely written"
+ */
+static size_t written_messages(wss_session_t *session, wss_session_queue_t *queue, size_t off, size_t len, size_t n, bool *closing) {
+    size_t i, bytes;
+    wss_message_t *message;
+
+    for (i = 0; likely(i < len); i++) {
+        message = queue->messages[off+i];
+        bytes = message->length-session->written;
 
-    // Sending message to subprotocol and sending it to the filedescriptors
-    // returned by the subprotocol.
-    for (i = 0; likely(i < frames_length); i++) {
-        // If message consists of single frame or we have the starting frame of
-        // a multiframe message, store the starting index
-        if ( (frames[i]->fin && !(frames[i]->opcode == 0x0)) ||
-             (! frames[i]->fin && frames[i]->opcode != 0x0) ) {
-            starting_frame = i;
+        if ( n < bytes ) {
+            session->written += n;
+            break;
         }
 
-        if (frames[i]->fin) {
-            len = i-starting_frame+1;
+        n -= bytes;
+        session->written = 0;
 
-            WSS_log_trace("Applying %d extensions on input", session->header->ws_extensions_count);
+        if ( unlikely(closing_message(message)) ) {
+            *closing = true;
+        }
 
-            // Apply extensions to collection of frames (message)
-            for (j = 0; likely(j < session->header->ws_extensions_count); j++) {
-                // Apply extension perframe
-                for (k = 0; likely(k < len); k++) {
-                    session->header->ws_extensions[j]->ext->inframe(
-                            session->fd,
-                            (void *)frames[k+starting_frame]);
-                }
+        WSS_message_free(message);
+        queue->messages[off+i] = NULL;
+    }
 
-                // Apply extension for set of frames
-                session->header->ws_extensions[j]->ext->inframes(
-                        session->fd,
-                        frames+starting_frame,
-                        len);
-            }
+    return i;
+}
 
-            WSS_log_trace("Assembling message");
+/**
+ * Function that writes consumed messages of the queue of a session with as few
+ * system calls as possible. The segments of the messages are gathered into a
+ * single writev, until IOV_MAX segments or WSS_WRITE_BUDGET bytes are gathered,
+ * and partial writes are continued from the first message that was not
+ * completely written.
+ *
+ * @param 	session	[wss_session_t *] 	    "The session structure"
+ * @param 	queue	[wss_session_queue_t *] "The queue of the session"
+ * @param 	off	    [size_t] 	            "The offset of the consumed messages"
+ * @param 	len	    [size_t] 	            "The amount of consumed messages"
+ * @param 	closing	[bool *] 	            "Set if a closing frame has been written"
+ * @return          [size_t]                "The amount of messages that were completely written"
+ */
+static size_t write_messages(wss_session_t *session, wss_session_queue_t *queue, size_t off, size_t len, bool *closing) {
+    ssize_t n;
+    size_t i, j, count, bytes, budget;
+    bool last;
+    wss_message_t *message;
+    struct iovec iov[IOV_MAX];
 
-            for (j = starting_frame; likely(j <= i); j++) {
-                msg_length += frames[j]->applicationDataLength;
-            }
+    for (i = 0; likely(i < len); ) {
+        if ( unlikely(session->handshaked && *closing) ) {
+            WSS_log_trace("No further messages are necessary as client connection is closing");
+            break;
+        }
 
-            if ( unlikely(NULL == (msg = WSS_malloc((msg_length+1)*sizeof(char)))) ) {
-                WSS_log_error("Unable to allocate message");
+        // Gather the messages up to and including a closing frame
+        last = false;
+        budget = 0;
+        for (count = 0, j = i; likely(j < len && count < IOV_MAX && budget < WSS_WRITE_BUDGET && ! last); j++) {
+            message = queue->messages[off+j];
+            bytes = j == i ? session->written : 0;
+            last = session->handshaked && closing_message(message);
 
-                for (k = 0; likely(k < frames_length); k++) {
-                    WSS_free_frame(frames[k]);
-                }
-                WSS_free((void **) &frames);
+            count += WSS_message_iov(message, bytes, iov+count, IOV_MAX-count);
+            budget += message->length-bytes;
+        }
 
-                session->closing = true;
+        WSS_log_trace("Gathering %zu queued messages into a single write", count);
 
-                return;
+        n = writev(session->fd, iov, count);
+        if ( unlikely(n == -1) ) {
+            if ( unlikely(errno == EINTR) ) {
+                errno = 0;
+                continue;
+            } else if ( unlikely(errno != EAGAIN && errno != EWOULDBLOCK) ) {
+                WSS_log_error("Write failed: %s", strerror(errno));
+                session->closing = true;
+                return i;
             }
 
-            for (j = starting_frame; likely(j <= i); j++) {
-                memcpy(msg+msg_offset, frames[j]->payload+frames[j]->extensionDataLength, frames[j]->applicationDataLength);
-                msg_offset += frames[j]->applicationDataLength;
-            }
+            session->event = WRITE;
 
-            WSS_log_debug("Unmasked message (%d bytes): %s\n", msg_length, msg);
+            return i;
+        }
 
-            // Check utf8 for text frames
-            if ( unlikely(frames[starting_frame]->opcode == TEXT_FRAME && ! utf8_check(msg, msg_length)) ) {
-                WSS_log_trace("UTF8 Error: the text was not UTF8 encoded correctly");
+        i += written_messages(session, queue, off+i, j-i, (size_t) n, closing);
+    }
 
-                for (j = starting_frame; likely(j < frames_length); j++) {
-                    WSS_free_frame(frames[j]);
-                }
-                frames[starting_frame] = WSS_closing_frame(CLOSE_UTF8, NULL);
-                frames_length = starting_frame+1;
-                i = starting_frame;
-                len = 1;
-                WSS_free((void **) &msg);
-                msg_length = 0;
-                closing = true;
-            }
+    return len;
+}
 
-            if ( likely(frames[starting_frame]->opcode == TEXT_FRAME || frames[starting_frame]->opcode == BINARY_FRAME) ) {
-                WSS_log_trace("Notifying subprotocol of message");
+/**
+ * Function that hands the consumed messages of a session to the event loop,
+ * which sends them once the session is writable instead of reporting when it
+ * is. The messages are kept in the queue until the sends are done.
+ *
+ * @param 	server	[wss_server_t *] 	    "The server structure"
+ * @param 	session	[wss_session_t *] 	    "The session structure"
+ * @param 	queue	[wss_session_queue_t *] "The queue of the session"
+ * @return          [bool]                  "Whether the messages are being sent by the event loop"
+ */
+static bool write_async(wss_server_t *server, wss_session_t *session, wss_session_queue_t *queue) {
+    size_t i, off, len, count, bytes;
+    wss_message_t *message;
+    struct iovec iov[WSS_SEND_SEGMENTS];
 
-                // Use subprotocol
-                session->header->ws_protocol->message(session->fd, frames[starting_frame]->opcode, msg, msg_length);
-            } else {
-                WSS_log_trace("Writing control frame message");
+    if ( unlikely(0 == (len = ringbuf_consume(queue->ringbuf, &off))) ) {
+        return false;
+    }
 
-                WSS_session_jobs_inc(session);
-                WSS_message_send_frames((void *)server, (void *)session, &frames[starting_frame], len);
-            }
+    // Gather the messages up to and including a closing frame
+    for (count = 0, i = 0; likely(i < len && count < WSS_SEND_SEGMENTS); i++) {
+        message = queue->messages[off+i];
+        count += WSS_message_iov(message, i == 0 ? session->written : 0, iov+count, WSS_SEND_SEGMENTS-count);
 
-            WSS_free((void **) &msg);
-            msg_length = 0;
-            msg_offset = 0;
+        if ( unlikely(session->handshaked && closing_message(message)) ) {
+            break;
         }
     }
 
-    if ( likely(frames_length > 0) ) {
-        for (i = 0; likely(i < frames_length); i++) {
-            WSS_free_frame(frames[i]);
-        }
-        WSS_free((void **) &frames);
+    for (bytes = 0, i = 0; likely(i < count); i++) {
+        bytes += iov[i].iov_len;
     }
 
-    if (! closing && session->event == NONE) {
-        WSS_log_trace("Set epoll file descriptor to read mode after finishing read");
-        session->event = READ;
+    // The event loop may report the sends as soon as they are submitted
+    session->sending = (unsigned int) bytes;
+    atomic_store(&session->sent, 0);
+
+    if ( unlikely(WSS_poll_send(server, session->fd, iov, count) != WSS_SUCCESS) ) {
+        WSS_log_error("Unable to send to session %d through the event loop", session->fd);
+        session->sending = 0;
+        session->closing = true;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Function that continues writing to a session once the event loop is done
+ * sending on its behalf, by releasing the messages that were sent.
+ *
+ * @param 	session	[wss_session_t *] 	    "The session structure"
+ * @param 	queue	[wss_session_queue_t *] "The queue of the session"
+ * @param 	closing	[bool *] 	            "Set if a closing frame has been written"
+ * @return          [bool]                  "Whether writing can be continued"
+ */
+static bool write_sent(wss_session_t *session, wss_session_queue_t *queue, bool *closing) {
+    size_t off, len;
+    int sent = atomic_load(&session->sent);
+
+    // The session is still waiting for the sends
+    if ( unlikely(sent == 0) ) {
+        session->event = WRITE;
+        return false;
+    }
+
+    if ( unlikely(sent < 0) ) {
+        WSS_log_error("Sending to session %d failed", session->fd);
+        session->sending = 0;
+        session->closing = true;
+        return false;
     }
+
+    len = ringbuf_consume(queue->ringbuf, &off);
+    ringbuf_release(queue->ringbuf, written_messages(session, queue, off, len, session->sending, closing));
+    session->sending = 0;
+
+    return true;
 }
 
 /**
@@ -1328,17 +1791,41 @@ void WSS_read(wss_server_t *server, wss_session_t *session) {
  * @return          [void]
  */
 void WSS_write(wss_server_t *server, wss_session_t *session) {
-    int n;
     wss_message_t *message;
     unsigned int i;
-    unsigned int message_length;
     unsigned int bytes_sent;
-    size_t len, off;
+    size_t len, off, written;
     bool closing = false;
+    wss_session_queue_t *queue = atomic_load_explicit(&session->queue, memory_order_acquire);
 
     WSS_log_trace("Performing write by popping messages from ringbuffer");
 
-    while ( likely(0 != (len = ringbuf_consume(session->ringbuf, &off))) ) {
+    if ( unlikely(session->sending > 0 && ! write_sent(session, queue, &closing)) ) {
+        return;
+    }
+
+    while ( likely(NULL != queue && 0 != (len = ringbuf_consume(queue->ringbuf, &off))) ) {
+        // Without SSL the messages are gathered into as few writes as possible
+        if ( likely(NULL == session->ssl) ) {
+            if ( unlikely((written = write_messages(session, queue, off, len, &closing)) < len) ) {
+                // Keep the messages that were not written, such that they are
+                // continued once the session is writeable, or sent by the
+                // event loop if it sends on behalf of the session
+                if ( likely(! session->closing) ) {
+                    ringbuf_release(queue->ringbuf, written);
+
+                    if ( session->ring ) {
+                        write_async(server, session, queue);
+                    }
+                }
+
+                return;
+            }
+
+            ringbuf_release(queue->ringbuf, len);
+            continue;
+        }
+
         for (i = 0; likely(i < len); i++) {
             if ( unlikely(session->handshaked && closing) ) {
                 WSS_log_trace("No further messages are necessary as client connection is closing");
@@ -1347,57 +1834,23 @@ void WSS_write(wss_server_t *server, wss_session_t *session) {
 
             bytes_sent = session->written;
             session->written = 0;
-            message = session->messages[off+i];
-            message_length = message->length;
-
-            while ( likely(bytes_sent < message_length) ) {
-                // Check if message contains closing byte
-                if ( unlikely(message->framed && bytes_sent == 0 &&
-                     ((message->msg[0] & 0xF) & 0x8) == (message->msg[0] & 0xF)) ) {
-                    closing = true;
-                }
+            message = queue->messages[off+i];
 
-                if (NULL != session->ssl) {
-                    if (! WSS_ssl_write_partial(session, i, message, &bytes_sent)) {
-                        return;
-                    }
-                } else {
-                    do {
-                        n = write(session->fd, message->msg+bytes_sent, message_length-bytes_sent);
-                        if (unlikely(n == -1)) {
-                            if ( unlikely(errno == EINTR) ) {
-                                errno = 0;
-                                continue;
-                            } else if ( unlikely(errno != EAGAIN && errno != EWOULDBLOCK) ) {
-                                WSS_log_error("Write failed: %s", strerror(errno));
-                                session->closing = true;
-                                return;
-                            }
-
-                            session->written = bytes_sent;
-                            ringbuf_release(session->ringbuf, i);
-
-                            session->event = WRITE;
-
-                            return;
-                        } else {
-                            bytes_sent += n;
-                        }
-                    } while ( unlikely(0) );
+            if ( unlikely(! write_message(session, message, &bytes_sent, &closing)) ) {
+                // Keep the message that was not written, such that it is
+                // continued once the session is writeable
+                if ( likely(! session->closing) ) {
+                    ringbuf_release(queue->ringbuf, i);
                 }
-            }
 
-            if ( likely(session->messages != NULL) ) {
-                if ( likely(session->messages[off+i] != NULL) ) {
-                    if ( likely(session->messages[off+i]->msg != NULL) ) {
-                        WSS_free((void **)&session->messages[off+i]->msg);
-                    }
-                    WSS_free((void **)&session->messages[off+i]);
-                }
+                return;
             }
+
+            WSS_message_free(message);
+            queue->messages[off+i] = NULL;
         }
 
-        ringbuf_release(session->ringbuf, len);
+        ringbuf_release(queue->ringbuf, len);
     }
 
     WSS_log_trace("Done writing to filedescriptors");
@@ -1414,26 +1867,212 @@ void WSS_write(wss_server_t *server, wss_session_t *session) {
 }
 
 /**
- * Function that performs and distributes the IO work.
+ * Function that writes the messages queued by other threads while the session
+ * was busy. The lock of the session must be held.
  *
- * @param 	args	[void *] 	"Is a args_t structure holding server_t, filedescriptor, and the state"
+ * @param 	server	[wss_server_t *] 	"The server structure"
+ * @param 	session	[wss_session_t *] 	"The session structure"
  * @return          [void]
  */
-void WSS_work(void *args) {
+static void write_pending(wss_server_t *server, wss_session_t *session) {
+    if ( likely(session->state != IDLE || session->closing) ) {
+        return;
+    }
+
+    if ( likely(! atomic_exchange(&session->write_pending, false)) ) {
+        return;
+    }
+
+    WSS_log_trace("Writing messages queued while session %d was busy", session->fd);
+
+    session->state = WRITING;
+    WSS_write(server, session);
+
+    // Wait for the socket to become writable, if not everything was written
+    if ( unlikely(session->state == WRITING && ! session->closing) ) {
+        WSS_poll_set_write(server, session->fd);
+    }
+}
+
+/**
+ * Function that releases the IO lock of a session. Messages queued by other
+ * threads while the lock was held are written first, if the session is idle.
+ *
+ * @param 	server	[wss_server_t *] 	"The server structure"
+ * @param 	session	[wss_session_t *] 	"The session structure"
+ * @return          [void]
+ */
+void WSS_release(wss_server_t *server, wss_session_t *session) {
+    // A sender that fails to take the lock relies on the holder to write its
+    // message, hence the flag is checked again once the lock is released
+    do {
+        write_pending(server, session);
+        pthread_mutex_unlock(&session->lock);
+    } while ( unlikely(atomic_load(&session->write_pending)) &&
+              session->state == IDLE && ! session->closing &&
+              pthread_mutex_trylock(&session->lock) == 0 );
+}
+
+/**
+ * Function that computes the next deadline of a session, that is when it
+ * should be pinged or when it times out reading, writing or being idle.
+ *
+ * @param 	server	[wss_server_t *] 	"The server structure"
+ * @param 	session	[wss_session_t *] 	"The session structure"
+ * @return          [uint64_t]          "The deadline in milliseconds or 0 if the session has none"
+ */
+static uint64_t deadline(wss_server_t *server, wss_session_t *session) {
+    uint64_t next = 0;
+    uint64_t alive = (uint64_t) session->alive.tv_sec*1000 + (uint64_t) session->alive.tv_nsec/1000000;
+    uint64_t pinged = (uint64_t) session->pinged.tv_sec*1000 + (uint64_t) session->pinged.tv_nsec/1000000;
+    wss_config_t *config = server->config;
+
+    if (session->state == READING && config->timeout_read >= 0) {
+        next = alive + (uint64_t) config->timeout_read;
+    } else if (session->state == WRITING && config->timeout_write >= 0) {
+        next = alive + (uint64_t) config->timeout_write;
+    }
+
+    if (session->handshaked && config->timeout_client >= 0) {
+        if (next == 0 || alive + (uint64_t) config->timeout_client < next) {
+            next = alive + (uint64_t) config->timeout_client;
+        }
+
+        if (config->timeout_pings > 0) {
+            pinged += (uint64_t) MAX(1, config->timeout_client/config->timeout_pings);
+            if (pinged < next) {
+                next = pinged;
+            }
+        }
+    }
+
+    return next;
+}
+
+/**
+ * Function that closes a session that timed out or pings it if idle, before
+ * the timer is scheduled for the next deadline.
+ *
+ * @param 	server	[wss_server_t *] 	"The server structure"
+ * @param 	fd	    [int] 	            "The file descriptor of the session"
+ * @return          [void]
+ */
+static void timeout(wss_server_t *server, int fd) {
+    wss_frame_t *frame;
     wss_session_t *session;
-    long unsigned int ms;
-    struct timespec now;
+    uint64_t now, alive, pinged, next;
+    wss_config_t *config = server->config;
+
+    if ( unlikely(NULL == (session = WSS_session_find(fd))) ) {
+        WSS_log_trace("Unable to find client with session %d", fd);
+        return;
+    }
+
+    WSS_session_jobs_inc(session);
+    pthread_mutex_lock(&session->lock);
+
+    if ( unlikely(session->state == CLOSING || session->closing) ) {
+        pthread_mutex_unlock(&session->lock);
+        WSS_session_jobs_dec(session);
+        return;
+    }
+
+    now = WSS_timer_clock();
+    alive = (uint64_t) session->alive.tv_sec*1000 + (uint64_t) session->alive.tv_nsec/1000000;
+    pinged = (uint64_t) session->pinged.tv_sec*1000 + (uint64_t) session->pinged.tv_nsec/1000000;
+
+    if ( unlikely(session->state == READING && config->timeout_read >= 0 &&
+                now >= alive + (uint64_t) config->timeout_read) ) {
+        WSS_log_trace("Read timeout detected for session %d", fd);
+        session->closing = true;
+    } else if ( unlikely(session->state == WRITING && config->timeout_write >= 0 &&
+                now >= alive + (uint64_t) config->timeout_write) ) {
+        WSS_log_trace("Write timeout detected for session %d", fd);
+        session->closing = true;
+    } else if ( session->handshaked && config->timeout_client >= 0 &&
+                now >= alive + (uint64_t) config->timeout_client ) {
+        WSS_log_info("Session %d has timedout", fd);
+
+        frame = WSS_closing_frame(CLOSE_TRY_AGAIN, NULL);
+
+        WSS_session_jobs_inc(session);
+        WSS_message_send_frames(server, session, &frame, 1);
+        WSS_free_frame(frame);
+
+        session->closing = true;
+    } else if ( session->handshaked && config->timeout_client >= 0 && config->timeout_pings > 0 &&
+                now >= pinged + (uint64_t) MAX(1, config->timeout_client/config->timeout_pings) ) {
+        WSS_log_info("Pinging session %d", fd);
+
+        frame = WSS_ping_frame();
+
+        WSS_free((void **) &session->pong);
+        session->pong_length = 0;
+
+        if ( likely(NULL != (session->pong = WSS_malloc(frame->applicationDataLength))) ) {
+            session->pong_length = frame->applicationDataLength;
+            memcpy(session->pong, frame->payload+frame->extensionDataLength, frame->applicationDataLength);
+
+            WSS_session_jobs_inc(session);
+            WSS_message_send_frames(server, session, &frame, 1);
+        }
+        WSS_free_frame(frame);
+
+        clock_gettime(CLOCK_MONOTONIC, &session->pinged);
+    }
+
+    WSS_release(server, session);
+    WSS_session_jobs_dec(session);
+
+    if (session->closing) {
+        WSS_disconnect(server, session);
+        return;
+    }
+
+    if ( likely(0 != (next = deadline(server, session))) ) {
+        WSS_session_timeout(session, next);
+    }
+}
+
+/**
+ * Function that handles a session whose timer expired. Sessions that timed
+ * out are closed and idle sessions are pinged, before the timer is scheduled
+ * for the next deadline.
+ *
+ * @param 	args	[void *] 	"Is a args_t structure holding server_t and filedescriptor"
+ * @return          [void]
+ */
+void WSS_timeout(void *args) {
     wss_thread_args_t *arguments = (wss_thread_args_t *) args;
     wss_server_t *server = (wss_server_t *) arguments->server;
-    wss_session_state_t session_state = arguments->state;
     int fd = arguments->fd;
 
     // Free arguments structure as this won't be needed no more
     WSS_free((void **) &arguments);
 
+    WSS_session_enter();
+    timeout(server, fd);
+    WSS_session_leave();
+}
+
+/**
+ * Function that performs the IO work of a single event, while the calling
+ * thread is marked as accessing sessions.
+ *
+ * @param 	server	        [wss_server_t *] 	    "The server structure"
+ * @param 	fd	            [int] 	                "The file descriptor of the session"
+ * @param 	session_state	[wss_session_state_t] 	"The state of the session"
+ * @return                  [void]
+ */
+static void work_event(wss_server_t *server, int fd, wss_session_state_t session_state) {
+    wss_session_t *session;
+    uint64_t next;
+    long unsigned int ms;
+    struct timespec now;
+
     if ( unlikely(session_state == CONNECTING) ) {
         WSS_log_trace("Handling connect event");
-        WSS_connect(server);
+        WSS_connect(server, fd);
         return;
     }
 
@@ -1472,8 +2111,8 @@ void WSS_work(void *args) {
         case CONNECTING:
             if (NULL != server->ssl_ctx) {
                 WSS_ssl_handshake(server, session);
+                WSS_release(server, session);
                 WSS_session_jobs_dec(session);
-                pthread_mutex_unlock(&session->lock);
                 return;
             }
 
@@ -1513,8 +2152,8 @@ void WSS_work(void *args) {
             }
     }
 
+    WSS_release(server, session);
     WSS_session_jobs_dec(session);
-    pthread_mutex_unlock(&session->lock);
 
     if (session->closing) {
         session->event = NONE;
@@ -1531,6 +2170,44 @@ void WSS_work(void *args) {
             WSS_poll_set_read(server, session->fd);
             break;
         case NONE: 
-            break;
+            return;
+    }
+
+    // Activity only postpones deadlines, so the wheel is only touched when the
+    // session has no timer yet or starts waiting on a partial read or write
+    if ( likely(0 != (next = deadline(server, session))) ) {
+        WSS_session_timeout(session, next);
     }
 }
+
+/**
+ * Function that performs the IO work of a single event.
+ *
+ * @param 	server	        [wss_server_t *] 	    "The server structure"
+ * @param 	fd	            [int] 	                "The file descriptor of the session"
+ * @param 	session_state	[wss_session_state_t] 	"The state of the session"
+ * @return                  [void]
+ */
+void WSS_work_event(wss_server_t *server, int fd, wss_session_state_t session_state) {
+    WSS_session_enter();
+    work_event(server, fd, session_state);
+    WSS_session_leave();
+}
+
+/**
+ * Function that performs and distributes the IO work.
+ *
+ * @param 	args	[void *] 	"Is a args_t structure holding server_t, filedescriptor, and the state"
+ * @return          [void]
+ */
+void WSS_work(void *args) {
+    wss_thread_args_t *arguments = (wss_thread_args_t *) args;
+    wss_server_t *server = (wss_server_t *) arguments->server;
+    wss_session_state_t session_state = arguments->state;
+    int fd = arguments->fd;
+
+    // Return arguments structure to the event loop, which reuses it
+    WSS_thread_args_release(arguments);
+
+    WSS_work_event(server, fd, session_state);
+}
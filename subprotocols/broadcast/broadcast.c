@@ -29,6 +29,8 @@ allocators allocs = {
 
 WSS_send send = NULL;
 
+WSS_send_many send_many = NULL;
+
 /**
  * A lock that ensures the hash table is update atomically
  */
@@ -46,6 +48,20 @@ void onInit(char *config, WSS_send s) {
     return;
 }
 
+/**
+ * Event called when subprotocol is initialized, which is preferred over onInit.
+ *
+ * @param 	config	    [char *]            "The configuration of the subprotocol"
+ * @param 	s	        [WSS_send]          "Function that send message to a single recipient"
+ * @param 	sm	        [WSS_send_many]     "Function that send message to several recipients"
+ * @return 	            [void]
+ */
+void onInit2(char *config, WSS_send s, WSS_send_many sm) {
+    send = s;
+    send_many = sm;
+    return;
+}
+
 /**
  * Sets the allocators to use instead of the default ones
  *
@@ -124,19 +140,36 @@ void onConnect(int fd, char *ip, int port, char *path, char *cookies) {
  * @return 	                [void]
  */
 void onMessage(int fd, wss_opcode_t opcode, char *message, size_t message_length) {
+    size_t n = 0;
+    int *fds = NULL;
     wss_client_t *client, *tmp;
 
     if ( unlikely(pthread_rwlock_rdlock(&lock) != 0) ) {
         return;
     }
 
+    // Collect the recipients, such that the message is framed once and the
+    // lock is not held while it is sent
+    if ( likely(NULL != send_many) ) {
+        fds = (int *) allocs.malloc(HASH_COUNT(clients)*sizeof(int));
+    }
+
     HASH_ITER(hh, clients, client, tmp) {
         if (client->fd != fd) {
-            send(client->fd, opcode, message, message_length);
+            if ( likely(NULL != fds) ) {
+                fds[n++] = client->fd;
+            } else {
+                send(client->fd, opcode, message, message_length);
+            }
         }
     }
 
     pthread_rwlock_unlock(&lock);
+
+    if ( likely(NULL != fds) ) {
+        send_many(fds, n, opcode, message, message_length);
+        allocs.free(fds);
+    }
 }
 
 /**
@@ -23,6 +23,16 @@ typedef struct {
  */
 void __attribute__((visibility("default"))) onInit(char *config, WSS_send send);
 
+/**
+ * Event called when subprotocol is initialized, which is preferred over onInit.
+ *
+ * @param 	config	    [char *]            "The configuration of the subprotocol"
+ * @param 	send        [WSS_send]          "Function that send message to a single recipient"
+ * @param 	send_many   [WSS_send_many]     "Function that send message to several recipients"
+ * @return 	            [void]
+ */
+void __attribute__((visibility("default"))) onInit2(char *config, WSS_send send, WSS_send_many send_many);
+
 /**
  * Sets the allocators to use instead of the default ones
  *
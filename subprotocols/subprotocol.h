@@ -23,6 +23,13 @@ typedef enum {
  * server.
  */
 typedef void (*WSS_send)(int fd, wss_opcode_t opcode, char *message, uint64_t message_length);
+
+/**
+ * A function that the subprotocol can use to send a message to several
+ * clients of the server, such that the message is only framed once.
+ */
+typedef void (*WSS_send_many)(int *fds, size_t fds_count, wss_opcode_t opcode, char *message, uint64_t message_length);
+
 typedef void *(*WSS_malloc_t)(size_t size);
 typedef void *(*WSS_realloc_t)(void *ptr, size_t size);
 typedef void (*WSS_free_t)(void *ptr);
@@ -32,6 +39,7 @@ typedef void (*WSS_free_t)(void *ptr);
  */
 typedef void (*subAlloc)(WSS_malloc_t submalloc, WSS_realloc_t subrealloc, WSS_free_t subfree);
 typedef void (*subInit)(char *config, WSS_send send);
+typedef void (*subInit2)(char *config, WSS_send send, WSS_send_many send_many);
 typedef void (*subConnect)(int fd, char *ip, int port, char *path, char *cookies);
 typedef void (*subMessage)(int fd, wss_opcode_t opcode, char *message, size_t message_length);
 typedef void (*subWrite)(int fd, char *message, size_t message_length);
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "arena.h"
+#include "frame.h"
+#include "message.h"
+#include "config.h"
+#include "rpmalloc.h"
+
+#define MESSAGES 1000000
+#define SIZE 64
+
+/**
+ * Handles a message the way a read does, when the echo subprotocol replies
+ * to it and a session with extensions receives it: the received frame is
+ * copied, the reply is framed, converted into bytes and wrapped into a
+ * message, which is written right away.
+ */
+static void cycle(wss_config_t *config, wss_frame_t *received, char *message, size_t length) {
+    size_t j, count;
+    char *out;
+    size_t out_length;
+    wss_frame_t *copy;
+    wss_frame_t **frames;
+    wss_message_t *m;
+
+    copy = WSS_copy_frame(received);
+
+    count = WSS_create_frames(config, TEXT_FRAME, message, length, &frames);
+    out_length = WSS_stringify_frames(frames, count, &out);
+
+    if ( NULL != (m = WSS_arena_malloc(sizeof(wss_message_t))) ) {
+        m->msg = out;
+        m->length = out_length;
+        m->framed = true;
+    }
+    WSS_message_free(m);
+
+    for (j = 0; j < count; j++) {
+        WSS_free_frame(frames[j]);
+    }
+    WSS_arena_free((void **) &frames);
+    WSS_free_frame(copy);
+}
+
+static double run(const char *name, wss_config_t *config, size_t length, unsigned long messages, bool arena) {
+    unsigned long i;
+    double seconds;
+    size_t allocations;
+    struct timespec begin, end;
+    char message[length+1];
+    wss_frame_t received;
+
+    memset(message, 'x', length);
+    message[length] = '\0';
+
+    memset(&received, 0, sizeof(received));
+    received.fin = 1;
+    received.opcode = TEXT_FRAME;
+    received.payload = message;
+    received.payloadLength = length;
+    received.applicationDataLength = length;
+
+    allocations = WSS_allocations();
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    for (i = 0; i < messages; i++) {
+        if (arena) {
+            WSS_arena_enter();
+        }
+        cycle(config, &received, message, length);
+        if (arena) {
+            WSS_arena_leave();
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    allocations = WSS_allocations()-allocations;
+
+    seconds = (double) (end.tv_sec - begin.tv_sec) + (double) (end.tv_nsec - begin.tv_nsec)/1e9;
+
+    printf("%-10s %8zu bytes %8.2f allocations/message %12.0f messages/s\n", name, length,
+            (double) allocations/(double) messages, (double) messages/seconds);
+
+    return seconds;
+}
+
+int main(int argc, char *argv[]) {
+    size_t i;
+    double before, after;
+    unsigned long messages = MESSAGES;
+    size_t sizes[] = { SIZE, 4096, 65536 };
+    wss_config_t config;
+
+    if (argc > 1) {
+        messages = strtoul(argv[1], NULL, 10);
+    }
+
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+
+    memset(&config, 0, sizeof(config));
+    config.size_frame = 16777216;
+
+    for (i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+        before = run("heap", &config, sizes[i], messages, false);
+        after = run("arena", &config, sizes[i], messages, true);
+
+        printf("speedup %.2fx\n", before/after);
+    }
+
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#include "alloc.h"
+#include "event.h"
+#include "pool.h"
+#include "config.h"
+#include "session.h"
+#include "rpmalloc.h"
+
+#define EVENTS 1000000
+#define WORKERS 4
+#define BATCH 64
+#define QUEUE 65536
+#define INFLIGHT 4096
+#define STACK 2097152
+
+/**
+ * Dispatches events the way an event loop in dispatcher mode does, by
+ * collecting the jobs of a wait and handing them to the threadpool at once.
+ * The workers return the arguments of the jobs, which the next waits reuse.
+ * No session is registered for the file descriptors, such that the workers
+ * do nothing but return the arguments.
+ */
+static void run(const char *name, wss_server_t *server, unsigned long events) {
+    unsigned long i, failed = 0;
+    double seconds;
+    size_t allocations, allocated;
+    struct timespec begin, end;
+
+    allocations = WSS_allocations();
+    allocated = server->jobs_allocated;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    for (i = 0; i < events; i++) {
+        // Like an event loop waits for the kernel, the next events are only
+        // received once the workers are done with some of the jobs
+        while ( server->jobs_allocated >= INFLIGHT && NULL == server->jobs_cache &&
+                NULL == atomic_load(&server->jobs_returned) ) {
+            sched_yield();
+        }
+
+        if ( WSS_SUCCESS != WSS_thread_args_dispatch(server, 1000+(int) (i%BATCH), READING) ) {
+            failed++;
+        }
+
+        if ( (i+1)%BATCH == 0 && WSS_SUCCESS != WSS_thread_args_flush(server) ) {
+            failed++;
+        }
+    }
+
+    if ( WSS_SUCCESS != WSS_thread_args_flush(server) ) {
+        failed++;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    allocations = WSS_allocations()-allocations;
+    allocated = server->jobs_allocated-allocated;
+
+    seconds = (double) (end.tv_sec - begin.tv_sec) + (double) (end.tv_nsec - begin.tv_nsec)/1e9;
+
+    printf("%-6s %8.4f allocations/event %8zu arguments allocated %12.0f events/s %8lu failed\n", name,
+            (double) allocations/(double) events, allocated, (double) events/seconds, failed);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long events = EVENTS;
+    unsigned int workers = WORKERS;
+    wss_config_t config;
+    wss_server_t server;
+
+    if (argc > 1) {
+        events = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        workers = (unsigned int) strtoul(argv[2], NULL, 10);
+    }
+
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+
+    WSS_session_init_lock();
+
+    memset(&config, 0, sizeof(config));
+    config.pool_mode = POOL_DISPATCHER;
+
+    memset(&server, 0, sizeof(server));
+    server.config = &config;
+
+    if ( NULL == (server.pool = threadpool_create((int) workers, QUEUE, STACK, 0)) ) {
+        fprintf(stderr, "Unable to create threadpool\n");
+        return EXIT_FAILURE;
+    }
+
+    // The first run allocates the arguments of as many jobs as are in flight
+    // at once, after which the arguments returned by the workers are reused
+    run("cold", &server, events);
+    run("warm", &server, events);
+
+    threadpool_destroy(server.pool, threadpool_graceful);
+    WSS_thread_args_free(&server);
+
+    WSS_session_destroy_lock();
+
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+
+#include "session.h"
+#include "log.h"
+#include "rpmalloc.h"
+
+#define SESSIONS 1000000
+#define MESSAGES 1024
+#define WORKERS 8
+
+/**
+ * The amounts of sessions at which the memory usage is reported
+ */
+static const unsigned long steps[] = { 10000, 100000, 1000000 };
+
+/**
+ * Function that returns the resident set size of the process in bytes.
+ */
+static size_t resident() {
+    FILE *fp;
+    unsigned long size, pages = 0;
+
+    if ( NULL == (fp = fopen("/proc/self/statm", "r")) ) {
+        return 0;
+    }
+    if ( fscanf(fp, "%lu %lu", &size, &pages) != 2 ) {
+        pages = 0;
+    }
+    fclose(fp);
+
+    return pages*(size_t) sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Function that raises the limit of open file descriptors, such that every
+ * session can hold one, and returns the amount of sessions that fit.
+ */
+static unsigned long raise_limit(unsigned long sessions) {
+    struct rlimit limit;
+    rlim_t needed = (rlim_t) sessions + 64;
+
+    if ( getrlimit(RLIMIT_NOFILE, &limit) != 0 ) {
+        return 0;
+    }
+
+    if ( limit.rlim_cur < needed ) {
+        limit.rlim_cur = needed;
+        if ( limit.rlim_max < needed ) {
+            limit.rlim_max = needed;
+        }
+        if ( setrlimit(RLIMIT_NOFILE, &limit) != 0 ) {
+            getrlimit(RLIMIT_NOFILE, &limit);
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+
+    return limit.rlim_cur > 64 ? (unsigned long) MIN((rlim_t) sessions, limit.rlim_cur - 64) : 0;
+}
+
+int main(int argc, char *argv[]) {
+    int fd, dup_fd;
+    unsigned long i, n = 0, sessions = SESSIONS;
+    size_t base, rss;
+    struct in6_addr addr = IN6ADDR_LOOPBACK_INIT;
+    wss_session_t *session;
+
+    if (argc > 1) {
+        sessions = strtoul(argv[1], NULL, 10);
+    }
+
+    if ( (i = raise_limit(sessions)) < sessions ) {
+        fprintf(stderr, "Only %lu file descriptors are available, hence only %lu sessions are created\n", i, i);
+        sessions = i;
+    }
+
+    if ( (fd = open("/dev/null", O_RDONLY)) < 0 ) {
+        perror("open");
+        return EXIT_FAILURE;
+    }
+
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+
+    WSS_session_init_lock();
+    WSS_session_slab_init(MESSAGES, WORKERS, 0, 0);
+
+    printf("session structure %zu bytes, message queue allocated on first queued write\n", sizeof(wss_session_t));
+    printf("%12s %14s %18s\n", "sessions", "rss", "bytes per session");
+
+    base = resident();
+
+    // The sessions are handshaked and idle, i.e. the header of the handshake
+    // has been freed and every message has been written right away
+    for (i = 0; i < sizeof(steps)/sizeof(steps[0]) && steps[i] <= sessions; i++) {
+        for (; n < steps[i]; n++) {
+            // Duplicates share the open file, such that the kernel only
+            // grows the table of file descriptors
+            if ( (dup_fd = dup(fd)) < 0 ) {
+                perror("dup");
+                return EXIT_FAILURE;
+            }
+
+            if ( NULL == (session = WSS_session_add(dup_fd, &addr, 0)) ) {
+                fprintf(stderr, "Unable to add session %d\n", dup_fd);
+                return EXIT_FAILURE;
+            }
+            session->handshaked = true;
+        }
+
+        rss = resident();
+        printf("%12lu %12zu kB %18.1f\n", n, (rss-base)/1024, (double) (rss-base)/(double) n);
+    }
+
+    // Closes the file descriptors of the sessions
+    WSS_session_delete_all();
+    WSS_session_slab_destroy();
+    WSS_session_destroy_lock();
+    close(fd);
+
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <netinet/in.h>
+
+#define uthash_malloc(sz) malloc(sz)
+#define uthash_free(ptr,sz) free(ptr)
+#include "uthash.h"
+
+#include "session.h"
+#include "log.h"
+#include "rpmalloc.h"
+
+#define SESSIONS 512
+#define THREADS 64
+#define LOOKUPS 1000000
+
+/**
+ * Structure holding a session of the hash table the session table replaced
+ */
+typedef struct {
+    int fd;
+    UT_hash_handle hh;
+} bench_session_t;
+
+static bench_session_t *hashtable = NULL;
+static pthread_rwlock_t hashtable_lock;
+
+static int fds[SESSIONS];
+static unsigned long lookups = LOOKUPS;
+static atomic_bool start;
+static atomic_ulong found;
+
+/**
+ * Lookup as performed by the hash table protected by a read/write lock.
+ */
+static bench_session_t *hashtable_find(int fd) {
+    bench_session_t *session = NULL;
+
+    WSS_log_trace("Finding session");
+
+    pthread_rwlock_rdlock(&hashtable_lock);
+    HASH_FIND_INT(hashtable, &fd, session);
+    pthread_rwlock_unlock(&hashtable_lock);
+
+    return session;
+}
+
+static void *hashtable_worker(void *arg) {
+    unsigned long i, hits = 0;
+    unsigned int seed = (unsigned int) (uintptr_t) arg;
+
+    while (! atomic_load(&start)) {}
+
+    for (i = 0; i < lookups; i++) {
+        if ( NULL != hashtable_find(fds[rand_r(&seed)%SESSIONS]) ) {
+            hits++;
+        }
+    }
+
+    atomic_fetch_add(&found, hits);
+
+    return NULL;
+}
+
+static void *table_worker(void *arg) {
+    unsigned long i, hits = 0;
+    unsigned int seed = (unsigned int) (uintptr_t) arg;
+
+#ifdef USE_RPMALLOC
+    rpmalloc_thread_initialize();
+#endif
+
+    while (! atomic_load(&start)) {}
+
+    // Every event handled by the server enters and leaves once
+    for (i = 0; i < lookups; i++) {
+        WSS_session_enter();
+        if ( NULL != WSS_session_find(fds[rand_r(&seed)%SESSIONS]) ) {
+            hits++;
+        }
+        WSS_session_leave();
+    }
+
+    atomic_fetch_add(&found, hits);
+
+#ifdef USE_RPMALLOC
+    rpmalloc_thread_finalize();
+#endif
+
+    return NULL;
+}
+
+static double run(const char *name, void *(*worker)(void *), unsigned int threads) {
+    unsigned int i;
+    double seconds;
+    struct timespec begin, end;
+    pthread_t *ids = malloc(threads*sizeof(pthread_t));
+
+    atomic_store(&start, false);
+    atomic_store(&found, 0);
+
+    for (i = 0; i < threads; i++) {
+        pthread_create(&ids[i], NULL, worker, (void *) (uintptr_t) (i+1));
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    atomic_store(&start, true);
+
+    for (i = 0; i < threads; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(ids);
+
+    seconds = (double) (end.tv_sec - begin.tv_sec) + (double) (end.tv_nsec - begin.tv_nsec)/1e9;
+
+    if ( atomic_load(&found) != lookups*threads ) {
+        fprintf(stderr, "%s: only found %lu of %lu sessions\n", name, atomic_load(&found), lookups*threads);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("%-28s %3u threads %12.0f lookups/s\n", name, threads, (double) (lookups*threads)/seconds);
+
+    return seconds;
+}
+
+int main(int argc, char *argv[]) {
+    int i;
+    double before, after;
+    unsigned int threads = THREADS;
+    struct in6_addr addr = IN6ADDR_LOOPBACK_INIT;
+    bench_session_t *entry, *tmp;
+
+    if (argc > 1) {
+        threads = (unsigned int) strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        lookups = strtoul(argv[2], NULL, 10);
+    }
+
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+
+    pthread_rwlock_init(&hashtable_lock, NULL);
+    WSS_session_init_lock();
+    WSS_session_slab_init(128, 2, SESSIONS, 0);
+
+    for (i = 0; i < SESSIONS; i++) {
+        if ( (fds[i] = open("/dev/null", O_RDONLY)) < 0 ) {
+            perror("open");
+            return EXIT_FAILURE;
+        }
+
+        entry = malloc(sizeof(bench_session_t));
+        entry->fd = fds[i];
+        HASH_ADD_INT(hashtable, fd, entry);
+
+        if ( NULL == WSS_session_add(fds[i], &addr, 0) ) {
+            fprintf(stderr, "Unable to add session %d\n", fds[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    before = run("uthash and read/write lock", hashtable_worker, threads);
+    after = run("session table", table_worker, threads);
+
+    printf("speedup %.2fx\n", before/after);
+
+    HASH_ITER(hh, hashtable, entry, tmp) {
+        HASH_DEL(hashtable, entry);
+        free(entry);
+    }
+    pthread_rwlock_destroy(&hashtable_lock);
+
+    // Closes the file descriptors of the sessions
+    WSS_session_delete_all();
+    WSS_session_slab_destroy();
+    WSS_session_destroy_lock();
+
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+
+    return EXIT_SUCCESS;
+}
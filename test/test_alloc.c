@@ -173,3 +173,56 @@ Test(WSS_realloc, shrinking) {
 
     cr_assert(res == NULL);
 }
+
+TestSuite(WSS_alloc_initialize, .init = setup, .fini = teardown);
+
+Test(WSS_alloc_initialize, regular_pages) {
+    char *test;
+
+    cr_assert(HUGE_PAGES_OFF == WSS_alloc_initialize(HUGE_PAGES_OFF));
+    cr_assert(NULL != (test = (char *)WSS_malloc(65536)));
+    WSS_free((void **) &test);
+}
+
+Test(WSS_alloc_initialize, falls_back) {
+    char *test;
+
+    cr_assert(HUGE_PAGES_HUGETLB != WSS_alloc_initialize(HUGE_PAGES_TRANSPARENT));
+    cr_assert(NULL != (test = (char *)WSS_malloc(65536)));
+    test[65535] = 'x';
+    WSS_free((void **) &test);
+}
+
+TestSuite(WSS_alloc_trim, .init = setup, .fini = teardown);
+
+Test(WSS_alloc_trim, without_target) {
+    cr_assert(0 == WSS_alloc_trim(0, false));
+}
+
+Test(WSS_alloc_trim, returns_cached_memory) {
+    int i;
+    size_t cached;
+    wss_alloc_statistics_t stats;
+    char *test[64];
+
+    for (i = 0; i < 64; i++) {
+        cr_assert(NULL != (test[i] = (char *)WSS_malloc(65536)));
+    }
+    for (i = 0; i < 64; i++) {
+        WSS_free((void **) &test[i]);
+    }
+
+    WSS_alloc_collect();
+    WSS_alloc_statistics(&stats);
+    cr_assert(stats.thread_cached == 0);
+    cr_assert(stats.collects > 0);
+    cached = stats.cached;
+
+    cr_assert(WSS_alloc_trim(1, false) > 0);
+
+    WSS_alloc_statistics(&stats);
+    cr_assert(stats.resident > 0);
+    cr_assert(stats.cached < cached);
+    cr_assert(stats.trims > 0);
+    cr_assert(stats.trimmed > 0);
+}
@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include <string.h>
+#include <criterion/criterion.h>
+
+#include "alloc.h"
+#include "arena.h"
+#include "rpmalloc.h"
+
+static void setup(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+}
+
+static void teardown(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+}
+
+TestSuite(WSS_arena_malloc, .init = setup, .fini = teardown);
+
+Test(WSS_arena_malloc, zero_size) {
+    WSS_arena_enter();
+    cr_assert(NULL == WSS_arena_malloc(0));
+    WSS_arena_leave();
+}
+
+Test(WSS_arena_malloc, heap_outside_scope) {
+    char *ptr;
+
+    cr_assert(NULL != (ptr = WSS_arena_malloc(32)));
+    cr_assert(! WSS_arena_owns(ptr));
+    WSS_arena_free((void **) &ptr);
+    cr_assert(NULL == ptr);
+}
+
+Test(WSS_arena_malloc, zeroed_and_aligned) {
+    size_t i;
+    char *ptr, *next;
+    size_t allocations = WSS_allocations();
+
+    WSS_arena_enter();
+    cr_assert(NULL != (ptr = WSS_arena_malloc(13)));
+    cr_assert(WSS_arena_owns(ptr));
+    cr_assert(0 == (uintptr_t) ptr % 16);
+    for (i = 0; i < 13; i++) {
+        cr_assert(ptr[i] == '\0');
+    }
+    memset(ptr, 'x', 13);
+
+    cr_assert(NULL != (next = WSS_arena_malloc(7)));
+    cr_assert(WSS_arena_owns(next));
+    cr_assert(0 == (uintptr_t) next % 16);
+    cr_assert(next >= ptr+13);
+    WSS_arena_leave();
+
+    cr_assert(allocations == WSS_allocations());
+}
+
+Test(WSS_arena_malloc, reset_when_left) {
+    char *ptr, *nested;
+
+    WSS_arena_enter();
+    cr_assert(NULL != (ptr = WSS_arena_malloc(64)));
+    memset(ptr, 'x', 64);
+
+    // Leaving a nested scope keeps the allocations of the outer scope
+    WSS_arena_enter();
+    cr_assert(NULL != (nested = WSS_arena_malloc(64)));
+    cr_assert(nested != ptr);
+    WSS_arena_leave();
+    cr_assert(ptr[63] == 'x');
+    WSS_arena_leave();
+
+    WSS_arena_enter();
+    cr_assert(ptr == WSS_arena_malloc(64));
+    cr_assert(ptr[63] == '\0');
+    WSS_arena_leave();
+}
+
+Test(WSS_arena_malloc, heap_when_exhausted) {
+    char *ptr;
+
+    WSS_arena_enter();
+    cr_assert(NULL != (ptr = WSS_arena_malloc(WSS_ARENA_SIZE)));
+    cr_assert(! WSS_arena_owns(ptr));
+    WSS_arena_free((void **) &ptr);
+    WSS_arena_leave();
+}
+
+TestSuite(WSS_arena_realloc, .init = setup, .fini = teardown);
+
+Test(WSS_arena_realloc, grows_latest_in_place) {
+    char *ptr;
+
+    WSS_arena_enter();
+    cr_assert(NULL != (ptr = WSS_arena_malloc(16)));
+    memcpy(ptr, "0123456789abcdef", 16);
+    cr_assert(ptr == WSS_arena_realloc(ptr, 1024));
+    cr_assert(0 == memcmp(ptr, "0123456789abcdef", 16));
+    WSS_arena_leave();
+}
+
+Test(WSS_arena_realloc, copies_earlier) {
+    char *ptr, *moved;
+
+    WSS_arena_enter();
+    cr_assert(NULL != (ptr = WSS_arena_malloc(16)));
+    memcpy(ptr, "0123456789abcdef", 16);
+    cr_assert(NULL != WSS_arena_malloc(16));
+    cr_assert(NULL != (moved = WSS_arena_realloc(ptr, 32)));
+    cr_assert(moved != ptr);
+    cr_assert(WSS_arena_owns(moved));
+    cr_assert(0 == memcmp(moved, "0123456789abcdef", 16));
+    WSS_arena_leave();
+}
+
+Test(WSS_arena_realloc, heap_stays_on_heap) {
+    char *ptr;
+
+    WSS_arena_enter();
+    cr_assert(NULL != (ptr = WSS_malloc(16)));
+    cr_assert(NULL != (ptr = WSS_arena_realloc(ptr, 32)));
+    cr_assert(! WSS_arena_owns(ptr));
+    WSS_arena_free_normal(ptr);
+    WSS_arena_leave();
+}
+
+TestSuite(WSS_arena_promote, .init = setup, .fini = teardown);
+
+Test(WSS_arena_promote, outlives_scope) {
+    char *ptr, *kept;
+
+    WSS_arena_enter();
+    cr_assert(NULL != (ptr = WSS_arena_malloc(6)));
+    memcpy(ptr, "hello", 6);
+    cr_assert(NULL != (kept = WSS_arena_promote(ptr)));
+    cr_assert(kept != ptr);
+    cr_assert(! WSS_arena_owns(kept));
+    cr_assert(kept == WSS_arena_promote(kept));
+    WSS_arena_leave();
+
+    cr_assert(0 == strcmp(kept, "hello"));
+    WSS_free((void **) &kept);
+}
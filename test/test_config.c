@@ -186,7 +186,12 @@ Test(WSS_config_load, valid_config_empty_arrays) {
 
     // Pool
     cr_expect(conf->pool_workers == 4); 
-    cr_expect(conf->pool_retries == 5); 
+    cr_expect(conf->pool_max_workers == 4);
+    cr_expect(conf->pool_max_queue == conf->size_thread);
+    cr_expect(conf->pool_idle_timeout == 60000);
+    cr_expect(conf->pool_mode == POOL_DISPATCHER); 
+    cr_expect(conf->pool_scheduler == POOL_QUEUE);
+    cr_expect(conf->pool_backend == POOL_EPOLL);
 
     // Subprotocols
     cr_expect(conf->subprotocols_length == 0); 
@@ -262,7 +267,27 @@ Test(WSS_config_load, valid_config) {
 
     // Pool
     cr_expect(conf->pool_workers == 4); 
-    cr_expect(conf->pool_retries == 5); 
+    cr_expect(conf->pool_max_workers == 16);
+    cr_expect(conf->pool_max_queue == 4194304);
+    cr_expect(conf->pool_idle_timeout == 5000);
+    cr_expect(conf->pool_mode == POOL_SHARDED); 
+    cr_expect(conf->pool_loops == 8); 
+    cr_expect(conf->pool_fanout == 512); 
+    cr_expect(conf->pool_scheduler == POOL_STEALING);
+    cr_expect(conf->pool_backend == POOL_IOURING);
+
+    // Accept
+    cr_expect(conf->accept_budget == 128);
+    cr_expect(conf->accept_defer == 5);
+    cr_expect(conf->accept_fastopen == 256);
+    cr_expect(conf->session_prewarm == 512);
+    cr_expect(conf->session_cache == 4096);
+
+    // Memory
+    cr_expect(conf->memory_collect == 5000);
+    cr_expect(conf->memory_rss == 268435456);
+    cr_expect(conf->memory_decommit == true);
+    cr_expect(conf->memory_huge_pages == HUGE_PAGES_HUGETLB);
 
     // Subprotocols
     cr_expect(conf->subprotocols_length == 2); 
@@ -0,0 +1,59 @@
+#include <string.h>
+#include <criterion/criterion.h>
+
+#include "alloc.h"
+#include "event.h"
+#include "config.h"
+#include "rpmalloc.h"
+
+static void setup(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+}
+
+static void teardown(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+}
+
+TestSuite(WSS_thread_args_dispatch, .init = setup, .fini = teardown);
+
+Test(WSS_thread_args_dispatch, reuses_returned_arguments) {
+    size_t allocations;
+    wss_config_t config;
+    wss_server_t server;
+    wss_thread_args_t *args;
+
+    memset(&config, 0, sizeof(config));
+    config.pool_mode = POOL_DISPATCHER;
+
+    memset(&server, 0, sizeof(server));
+    server.config = &config;
+
+    cr_assert(WSS_SUCCESS == WSS_thread_args_dispatch(&server, 5, READING));
+    cr_assert(1 == server.jobs_length);
+    cr_assert(1 == server.jobs_allocated);
+    args = (wss_thread_args_t *) server.jobs[0];
+    cr_assert(5 == args->fd);
+
+    // The job is taken by a worker, which returns its arguments
+    server.jobs_length = 0;
+    WSS_thread_args_release(args);
+    cr_assert(args == atomic_load(&server.jobs_returned));
+
+    allocations = WSS_allocations();
+    cr_assert(WSS_SUCCESS == WSS_thread_args_dispatch(&server, 6, WRITING));
+    cr_assert(WSS_allocations() == allocations);
+
+    cr_assert(1 == server.jobs_length);
+    cr_assert(1 == server.jobs_allocated);
+    cr_assert(2 == server.jobs_dispatched);
+    cr_assert(args == (wss_thread_args_t *) server.jobs[0]);
+    cr_assert(6 == args->fd);
+    cr_assert(WRITING == args->state);
+    cr_assert(NULL == atomic_load(&server.jobs_returned));
+
+    WSS_thread_args_free(&server);
+}
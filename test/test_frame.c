@@ -6,6 +6,8 @@
 #include "frame.h"
 #include "rpmalloc.h"
 
+#define FRAME_LIMIT 65536
+
 static void setup(void) {
 #ifdef USE_RPMALLOC
     rpmalloc_initialize();
@@ -118,6 +120,140 @@ Test(WSS_parse_frame, large_client_frame) {
     WSS_free((void **)&payload_frame);
 }
 
+TestSuite(WSS_parse_frame_view, .init = setup, .fini = teardown);
+
+Test(WSS_parse_frame_view, null_payload) {
+    size_t offset = 0;
+    wss_frame_t frame;
+    cr_assert(! WSS_parse_frame_view(NULL, 0, &offset, &frame, FRAME_LIMIT));
+}
+
+Test(WSS_parse_frame_view, small_client_frame) {
+    size_t offset = 0;
+    size_t allocations;
+    wss_frame_t frame;
+    char payload[] = "\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58";
+    size_t length = strlen(payload);
+
+    allocations = WSS_allocations();
+    cr_assert(WSS_parse_frame_view(payload, length, &offset, &frame, FRAME_LIMIT));
+    cr_assert(allocations == WSS_allocations());
+    cr_assert(offset == length);
+    cr_assert(frame.fin);
+    cr_assert(frame.opcode == TEXT_FRAME);
+    cr_assert(frame.payload == payload+6);
+    cr_assert(frame.applicationDataLength == 5);
+    cr_assert(strncmp(frame.payload, "Hello", frame.payloadLength) == 0);
+}
+
+Test(WSS_parse_frame_view, multiple_frames) {
+    size_t offset = 0;
+    size_t allocations;
+    wss_frame_t frame;
+    char payload[] = "\x89\x80\x37\xfa\x21\x3d\x82\x83\x37\xfa\x21\x3d\x06\xc8\x12";
+    size_t length = sizeof(payload)-1;
+
+    allocations = WSS_allocations();
+    cr_assert(WSS_parse_frame_view(payload, length, &offset, &frame, FRAME_LIMIT));
+    cr_assert(frame.opcode == PING_FRAME);
+    cr_assert(frame.payload == NULL);
+    cr_assert(offset == 6);
+    cr_assert(WSS_parse_frame_view(payload, length, &offset, &frame, FRAME_LIMIT));
+    cr_assert(frame.opcode == BINARY_FRAME);
+    cr_assert(offset == length);
+    cr_assert(memcmp(frame.payload, "123", 3) == 0);
+    cr_assert(allocations == WSS_allocations());
+}
+
+Test(WSS_parse_frame_view, incomplete_frame) {
+    size_t offset = 0;
+    wss_frame_t frame;
+    char payload[] = "\x81\x85\x37\xfa\x21\x3d\x7f\x9f";
+    size_t length = sizeof(payload)-1;
+
+    cr_assert(WSS_parse_frame_view(payload, length, &offset, &frame, FRAME_LIMIT));
+    cr_assert(offset > length);
+    cr_assert(frame.payload == NULL);
+    // The payload is left masked, such that it can be parsed again
+    cr_assert(memcmp(payload+6, "\x7f\x9f", 2) == 0);
+}
+
+Test(WSS_parse_frame_view, truncated_extended_payload) {
+    size_t offset = 0;
+    wss_frame_t frame;
+    char payload[] = "\x82\xFE\x01\x00\x37\xfa\x21\x3d\x01\x02\x03\x04";
+    size_t length = sizeof(payload)-1;
+
+    cr_assert(WSS_parse_frame_view(payload, length, &offset, &frame, FRAME_LIMIT));
+    cr_assert(frame.payloadLength == 256);
+    cr_assert(offset == 8+256);
+    cr_assert(frame.payload == NULL);
+    cr_assert(memcmp(payload+8, "\x01\x02\x03\x04", 4) == 0);
+}
+
+Test(WSS_parse_frame_view, extended_length_past_end) {
+    size_t offset = 0;
+    wss_frame_t frame;
+    char medium[] = "\x82\xFE\x01";
+    char large[] = "\x82\xFF\x00\x00\x00";
+
+    cr_assert(WSS_parse_frame_view(medium, sizeof(medium)-1, &offset, &frame, FRAME_LIMIT));
+    cr_assert(offset > sizeof(medium)-1);
+    cr_assert(frame.payload == NULL);
+
+    offset = 0;
+    cr_assert(WSS_parse_frame_view(large, sizeof(large)-1, &offset, &frame, FRAME_LIMIT));
+    cr_assert(offset > sizeof(large)-1);
+    cr_assert(frame.payload == NULL);
+}
+
+Test(WSS_parse_frame_view, masking_key_split_across_reads) {
+    size_t offset = 0;
+    wss_frame_t frame;
+    char payload[] = "\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58";
+    size_t length = sizeof(payload)-1;
+
+    // Only half of the masking key has been read
+    cr_assert(WSS_parse_frame_view(payload, 4, &offset, &frame, FRAME_LIMIT));
+    cr_assert(offset > 4);
+    cr_assert(frame.payload == NULL);
+    cr_assert(memcmp(payload+6, "\x7f\x9f\x4d\x51\x58", 5) == 0);
+
+    // The frame is parsed again once the rest has been read
+    offset = 0;
+    cr_assert(WSS_parse_frame_view(payload, length, &offset, &frame, FRAME_LIMIT));
+    cr_assert(offset == length);
+    cr_assert(frame.payload == payload+6);
+    cr_assert(strncmp(frame.payload, "Hello", frame.payloadLength) == 0);
+}
+
+Test(WSS_parse_frame_view, payload_length_msb) {
+    size_t offset = 0;
+    wss_frame_t frame;
+    char payload[] = "\x82\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xF8\x37\xfa\x21\x3d\x01\x02\x03\x04";
+    size_t length = sizeof(payload)-1;
+
+    cr_assert(WSS_parse_frame_view(payload, length, &offset, &frame, FRAME_LIMIT));
+    cr_assert(frame.payloadLength == 0xFFFFFFFFFFFFFFF8ULL);
+    cr_assert(frame.payload == NULL);
+    cr_assert(offset == 14);
+    // Nothing is unmasked beyond the header
+    cr_assert(memcmp(payload+14, "\x01\x02\x03\x04", 4) == 0);
+}
+
+Test(WSS_parse_frame_view, payload_length_over_limit) {
+    size_t offset = 0;
+    wss_frame_t frame;
+    char payload[] = "\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58";
+    size_t length = sizeof(payload)-1;
+
+    cr_assert(WSS_parse_frame_view(payload, length, &offset, &frame, 4));
+    cr_assert(frame.payloadLength == 5);
+    cr_assert(frame.payload == NULL);
+    cr_assert(offset == 6);
+    cr_assert(memcmp(payload+6, "\x7f\x9f\x4d\x51\x58", 5) == 0);
+}
+
 TestSuite(WSS_stringify_frame, .init = setup, .fini = teardown);
 
 Test(WSS_stringify_frame, null_frame) {
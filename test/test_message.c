@@ -0,0 +1,339 @@
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <criterion/criterion.h>
+
+#include "alloc.h"
+#include "arena.h"
+#include "frame.h"
+#include "message.h"
+#include "config.h"
+#include "server.h"
+#include "session.h"
+#include "pool.h"
+#include "rpmalloc.h"
+
+#define FANOUT_RECIPIENTS 10
+#define FANOUT_CHUNK 3
+
+static void setup(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+}
+
+static void teardown(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+}
+
+static size_t concat(struct iovec *iov, size_t count, char *out) {
+    size_t i, length = 0;
+
+    for (i = 0; i < count; i++) {
+        memcpy(out+length, iov[i].iov_base, iov[i].iov_len);
+        length += iov[i].iov_len;
+    }
+
+    return length;
+}
+
+TestSuite(WSS_message_create, .init = setup, .fini = teardown);
+
+Test(WSS_message_create, null_config) {
+    cr_assert(NULL == WSS_message_create(NULL, TEXT_FRAME, "hello", 5, false));
+}
+
+Test(WSS_message_create, references_payload) {
+    char payload[] = "hello world";
+    wss_config_t config;
+    wss_message_t *m;
+
+    memset(&config, 0, sizeof(config));
+    config.size_frame = 4;
+
+    cr_assert(NULL != (m = WSS_message_create(&config, TEXT_FRAME, payload, 11, false)));
+    cr_assert(m->framed);
+    cr_assert(! m->owned);
+    cr_assert(m->iov_count == 6);
+    cr_assert(m->length == 3*2+11);
+
+    cr_assert(m->msg[0] == TEXT_FRAME);
+    cr_assert(m->msg[1] == 4);
+    cr_assert(m->msg[2] == CONTINUATION_FRAME);
+    cr_assert(m->msg[3] == 4);
+    cr_assert((unsigned char) m->msg[4] == (0x80 | CONTINUATION_FRAME));
+    cr_assert(m->msg[5] == 3);
+
+    cr_assert(m->iov[1].iov_base == payload);
+    cr_assert(m->iov[3].iov_base == payload+4);
+    cr_assert(m->iov[5].iov_base == payload+8);
+
+    WSS_message_free(m);
+}
+
+Test(WSS_message_create, matches_frames) {
+    size_t i, length, frames_count;
+    char payload[300], out[400];
+    char *bytes;
+    wss_frame_t **frames;
+    wss_config_t config;
+    wss_message_t *m;
+
+    memset(&config, 0, sizeof(config));
+    config.size_frame = 200;
+    memset(payload, 'x', sizeof(payload));
+
+    cr_assert(NULL != (m = WSS_message_create(&config, BINARY_FRAME, payload, sizeof(payload), false)));
+    length = concat(m->iov, m->iov_count, out);
+    cr_assert(length == m->length);
+
+    frames_count = WSS_create_frames(&config, BINARY_FRAME, payload, sizeof(payload), &frames);
+    cr_assert(length == WSS_stringify_frames(frames, frames_count, &bytes));
+    cr_assert(0 == memcmp(out, bytes, length));
+
+    for (i = 0; i < frames_count; i++) {
+        WSS_free_frame(frames[i]);
+    }
+    WSS_free((void **) &frames);
+    WSS_free((void **) &bytes);
+    WSS_message_free(m);
+}
+
+TestSuite(WSS_message_iov, .init = setup, .fini = teardown);
+
+Test(WSS_message_iov, contiguous) {
+    struct iovec iov[2];
+    wss_message_t m;
+
+    memset(&m, 0, sizeof(m));
+    m.msg = "hello";
+    m.length = 5;
+
+    cr_assert(1 == WSS_message_iov(&m, 2, iov, 2));
+    cr_assert(iov[0].iov_base == m.msg+2);
+    cr_assert(iov[0].iov_len == 3);
+    cr_assert(0 == WSS_message_iov(&m, 5, iov, 2));
+}
+
+Test(WSS_message_iov, from_offset) {
+    size_t n;
+    char payload[] = "hello world";
+    char out[32];
+    struct iovec iov[6];
+    wss_config_t config;
+    wss_message_t *m;
+
+    memset(&config, 0, sizeof(config));
+    config.size_frame = 4;
+
+    cr_assert(NULL != (m = WSS_message_create(&config, TEXT_FRAME, payload, 11, false)));
+
+    // Skips the first frame and half of the header of the second
+    n = WSS_message_iov(m, 7, iov, 6);
+    cr_assert(n == 4);
+    cr_assert(concat(iov, n, out) == m->length-7);
+    cr_assert(out[0] == 4);
+    cr_assert(0 == memcmp(out+1, "o wo", 4));
+
+    // Only fills as many segments as there is room for
+    cr_assert(2 == WSS_message_iov(m, 0, iov, 2));
+
+    WSS_message_free(m);
+}
+
+TestSuite(WSS_message_promote, .init = setup, .fini = teardown);
+
+Test(WSS_message_promote, flattens_referenced_payload) {
+    size_t length;
+    char payload[] = "hello world";
+    char expected[32];
+    wss_config_t config;
+    wss_message_t *m;
+
+    memset(&config, 0, sizeof(config));
+    config.size_frame = 4;
+
+    WSS_arena_enter();
+    cr_assert(NULL != (m = WSS_message_create(&config, TEXT_FRAME, payload, 11, false)));
+    length = concat(m->iov, m->iov_count, expected);
+    cr_assert(NULL != (m = WSS_message_promote(m)));
+    WSS_arena_leave();
+
+    cr_assert(NULL == m->iov);
+    cr_assert(! WSS_arena_owns(m->msg));
+    cr_assert(m->length == length);
+    cr_assert(0 == memcmp(m->msg, expected, length));
+
+    WSS_message_free(m);
+}
+
+Test(WSS_message_promote, keeps_owned_payload) {
+    size_t length;
+    char *payload;
+    char expected[32], out[32];
+    wss_config_t config;
+    wss_message_t *m;
+
+    memset(&config, 0, sizeof(config));
+    config.size_frame = 4;
+
+    cr_assert(NULL != (payload = WSS_copy("hello world", 11)));
+
+    WSS_arena_enter();
+    cr_assert(NULL != (m = WSS_message_create(&config, TEXT_FRAME, payload, 11, true)));
+    length = concat(m->iov, m->iov_count, expected);
+    cr_assert(NULL != (m = WSS_message_promote(m)));
+    WSS_arena_leave();
+
+    cr_assert(m->payload == payload);
+    cr_assert(m->iov[1].iov_base == payload);
+    cr_assert(! WSS_arena_owns(m->msg));
+    cr_assert(! WSS_arena_owns(m->iov));
+    cr_assert(concat(m->iov, m->iov_count, out) == length);
+    cr_assert(0 == memcmp(out, expected, length));
+
+    WSS_message_free(m);
+}
+
+TestSuite(WSS_shared_create, .init = setup, .fini = teardown);
+
+Test(WSS_shared_create, framed_once) {
+    size_t length;
+    char payload[] = "hello world";
+    char expected[32];
+    wss_config_t config;
+    wss_shared_t *shared;
+    wss_message_t *m, *first, *second;
+
+    memset(&config, 0, sizeof(config));
+    config.size_frame = 4;
+
+    cr_assert(NULL != (shared = WSS_shared_create(&config, TEXT_FRAME, payload, 11)));
+    cr_assert(1 == atomic_load(&shared->references));
+
+    cr_assert(NULL != (m = WSS_message_create(&config, TEXT_FRAME, payload, 11, false)));
+    length = concat(m->iov, m->iov_count, expected);
+    WSS_message_free(m);
+
+    cr_assert(shared->length == length);
+    cr_assert(0 == memcmp(shared->bytes, expected, length));
+
+    cr_assert(NULL != (first = WSS_message_share(shared)));
+    cr_assert(NULL != (second = WSS_message_share(shared)));
+    cr_assert(3 == atomic_load(&shared->references));
+    cr_assert(first->msg == shared->bytes);
+    cr_assert(second->msg == shared->bytes);
+    cr_assert(first->length == length);
+
+    // The bytes outlive the reference of the creator
+    WSS_shared_release(shared);
+    WSS_message_free(first);
+    cr_assert(1 == atomic_load(&shared->references));
+    cr_assert(0 == memcmp(second->msg, expected, length));
+    WSS_message_free(second);
+}
+
+Test(WSS_message_promote, shares_delivered_payload) {
+    char payload[] = "hello world";
+    wss_config_t config;
+    wss_message_t *first, *second, *other;
+
+    memset(&config, 0, sizeof(config));
+    config.size_frame = 4;
+
+    WSS_arena_enter();
+    WSS_message_delivery_begin(TEXT_FRAME, payload, 11);
+
+    cr_assert(NULL != (first = WSS_message_create(&config, TEXT_FRAME, payload, 11, false)));
+    first->shareable = true;
+    cr_assert(NULL != (first = WSS_message_promote(first)));
+
+    cr_assert(NULL != (second = WSS_message_create(&config, TEXT_FRAME, payload, 11, false)));
+    second->shareable = true;
+    cr_assert(NULL != (second = WSS_message_promote(second)));
+
+    cr_assert(NULL != (other = WSS_message_create(&config, TEXT_FRAME, payload, 11, false)));
+    cr_assert(NULL != (other = WSS_message_promote(other)));
+
+    WSS_message_delivery_end();
+    WSS_arena_leave();
+
+    cr_assert(NULL != first->shared);
+    cr_assert(first->shared == second->shared);
+    cr_assert(first->msg == second->msg);
+    cr_assert(2 == atomic_load(&first->shared->references));
+    cr_assert(other->shared != first->shared);
+    cr_assert(other->length == first->length);
+    cr_assert(0 == memcmp(other->msg, first->msg, first->length));
+
+    WSS_message_free(first);
+    WSS_message_free(second);
+    WSS_message_free(other);
+}
+
+static void setup_sessions(void) {
+    setup();
+    WSS_session_init_lock();
+    WSS_session_slab_init(8, 2, 0, 0);
+}
+
+static void teardown_sessions(void) {
+    WSS_session_delete_all();
+    WSS_session_slab_destroy();
+    WSS_session_destroy_lock();
+    teardown();
+}
+
+TestSuite(WSS_message_send_many, .init = setup_sessions, .fini = teardown_sessions);
+
+Test(WSS_message_send_many, fanout_in_chunks) {
+    size_t i, length;
+    int fds[FANOUT_RECIPIENTS], peers[FANOUT_RECIPIENTS], pair[2];
+    char payload[] = "hello";
+    char expected[32], out[64];
+    struct in6_addr addr = IN6ADDR_LOOPBACK_INIT;
+    wss_config_t config;
+    wss_server_t server;
+    wss_session_t *session;
+    wss_message_t *m;
+
+    memset(&config, 0, sizeof(config));
+    config.size_frame = 1024;
+    config.pool_workers = 4;
+    config.pool_fanout = FANOUT_CHUNK;
+
+    memset(&server, 0, sizeof(server));
+    server.config = &config;
+    cr_assert(NULL != (server.pool = threadpool_create((int) config.pool_workers, 64, 0, 0)));
+
+    cr_assert(NULL != (m = WSS_message_create(&config, TEXT_FRAME, payload, 5, false)));
+    length = concat(m->iov, m->iov_count, expected);
+    WSS_message_free(m);
+
+    WSS_session_enter();
+    for (i = 0; i < FANOUT_RECIPIENTS; i++) {
+        cr_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+        cr_assert(NULL != (session = WSS_session_add(pair[0], &addr, 80)));
+        session->server = &server;
+        fds[i] = pair[0];
+        peers[i] = pair[1];
+    }
+    WSS_session_leave();
+
+    WSS_message_send_many(fds, FANOUT_RECIPIENTS, TEXT_FRAME, payload, 5);
+
+    // Every chunk has been sent once the call returns, hence each recipient
+    // can be read without waiting and holds exactly one copy of the frame
+    for (i = 0; i < FANOUT_RECIPIENTS; i++) {
+        cr_assert((ssize_t) length == recv(peers[i], out, sizeof(out), MSG_DONTWAIT));
+        cr_assert(0 == memcmp(out, expected, length));
+        cr_assert(-1 == recv(peers[i], out, sizeof(out), MSG_DONTWAIT));
+        cr_assert(EAGAIN == errno || EWOULDBLOCK == errno);
+        close(peers[i]);
+    }
+
+    threadpool_destroy(server.pool, threadpool_graceful);
+}
@@ -0,0 +1,264 @@
+#include <criterion/criterion.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "pool.h"
+#include "rpmalloc.h"
+
+#define TASKS 1000
+
+static atomic_int counter;
+static threadpool_t *pool;
+
+static void setup(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+    atomic_store(&counter, 0);
+}
+
+static void teardown(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+}
+
+static void increment(void *arg) {
+    (void) arg;
+    atomic_fetch_add(&counter, 1);
+}
+
+static void slow(void *arg) {
+    struct timespec tim = { .tv_sec = 0, .tv_nsec = 10000000 };
+    (void) arg;
+    nanosleep(&tim, NULL);
+    atomic_fetch_add(&counter, 1);
+}
+
+static void spawn(void *arg) {
+    (void) arg;
+    atomic_fetch_add(&counter, 1);
+    while (threadpool_add(pool, increment, NULL, 0) == threadpool_queue_full) {
+        sched_yield();
+    }
+}
+
+TestSuite(threadpool_create, .init = setup, .fini = teardown);
+
+Test(threadpool_create, queue) {
+    threadpool_stats_t stats;
+
+    cr_assert(NULL != (pool = threadpool_create(4, 4*TASKS, 1048576, 0)));
+
+    for (int i = 0; i < TASKS; i++) {
+        cr_assert(0 == threadpool_add(pool, increment, NULL, 0));
+    }
+
+    while (atomic_load(&counter) < TASKS) {
+        sched_yield();
+    }
+
+    cr_assert(0 == threadpool_stats(pool, &stats));
+    cr_assert(stats.tasks == TASKS);
+    cr_assert(stats.steals == 0);
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+Test(threadpool_create, work_stealing) {
+    threadpool_stats_t stats;
+
+    cr_assert(NULL != (pool = threadpool_create(4, 4*TASKS, 1048576, threadpool_work_stealing)));
+
+    for (int i = 0; i < TASKS; i++) {
+        cr_assert(0 == threadpool_add(pool, spawn, NULL, 0));
+    }
+
+    while (atomic_load(&counter) < 2*TASKS) {
+        sched_yield();
+    }
+
+    cr_assert(0 == threadpool_stats(pool, &stats));
+    cr_assert(stats.tasks == 2*TASKS);
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+    cr_assert(atomic_load(&counter) == 2*TASKS);
+}
+
+static void flood(void *arg) {
+    (void) arg;
+    // Schedules more tasks than the deque of the worker can hold
+    for (int i = 0; i < 4*TASKS; i++) {
+        cr_assert(0 == threadpool_add(pool, increment, NULL, 0));
+    }
+}
+
+Test(threadpool_create, work_stealing_overflow) {
+    cr_assert(NULL != (pool = threadpool_create(1, 8*TASKS, 1048576, threadpool_work_stealing)));
+    cr_assert(0 == threadpool_add(pool, flood, NULL, 0));
+
+    while (atomic_load(&counter) < 4*TASKS) {
+        sched_yield();
+    }
+
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+    cr_assert(atomic_load(&counter) == 4*TASKS);
+}
+
+TestSuite(threadpool_set_limits, .init = setup, .fini = teardown);
+
+Test(threadpool_set_limits, invalid_arguments) {
+    cr_assert(threadpool_invalid == threadpool_set_limits(NULL, 4, 64, 0));
+
+    cr_assert(NULL != (pool = threadpool_create(1, 16, 1048576, threadpool_work_stealing)));
+    cr_assert(threadpool_invalid == threadpool_set_limits(pool, 4, 64, 0));
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+Test(threadpool_set_limits, full_without_limits) {
+    cr_assert(NULL != (pool = threadpool_create(1, 4, 1048576, 0)));
+
+    for (int i = 0; i < 8; i++) {
+        threadpool_add(pool, slow, NULL, 0);
+    }
+    cr_assert(threadpool_queue_full == threadpool_add(pool, slow, NULL, 0));
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+Test(threadpool_set_limits, grow_and_retire) {
+    threadpool_stats_t stats;
+    struct timespec tim = { .tv_sec = 0, .tv_nsec = 200000000 };
+
+    cr_assert(NULL != (pool = threadpool_create(1, 4, 1048576, 0)));
+    cr_assert(0 == threadpool_set_limits(pool, 4, 64, 10));
+
+    for (int i = 0; i < 64; i++) {
+        cr_assert(0 == threadpool_add(pool, slow, NULL, 0));
+    }
+
+    cr_assert(0 == threadpool_stats(pool, &stats));
+    cr_assert(stats.spawned == 3);
+    cr_assert(stats.resizes > 0);
+
+    while (atomic_load(&counter) < 64) {
+        sched_yield();
+    }
+    nanosleep(&tim, NULL);
+
+    cr_assert(0 == threadpool_stats(pool, &stats));
+    cr_assert(stats.retired == 3);
+    cr_assert(stats.threads == 1);
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+TestSuite(threadpool_set_idle, .init = setup, .fini = teardown);
+
+static void idle(void) {
+    atomic_fetch_add(&counter, 1);
+}
+
+Test(threadpool_set_idle, invalid_arguments) {
+    cr_assert(threadpool_invalid == threadpool_set_idle(NULL, idle, 10));
+
+    cr_assert(NULL != (pool = threadpool_create(1, 16, 1048576, 0)));
+    cr_assert(threadpool_invalid == threadpool_set_idle(pool, idle, -1));
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+Test(threadpool_set_idle, once_per_idle_period) {
+    struct timespec tim = { .tv_sec = 0, .tv_nsec = 100000000 };
+
+    cr_assert(NULL != (pool = threadpool_create(2, 16, 1048576, 0)));
+    cr_assert(0 == threadpool_set_idle(pool, idle, 10));
+    nanosleep(&tim, NULL);
+    cr_assert(atomic_load(&counter) == 2);
+
+    cr_assert(0 == threadpool_add(pool, increment, NULL, 0));
+    nanosleep(&tim, NULL);
+    cr_assert(atomic_load(&counter) == 4);
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+Test(threadpool_set_idle, work_stealing) {
+    struct timespec tim = { .tv_sec = 0, .tv_nsec = 100000000 };
+
+    cr_assert(NULL != (pool = threadpool_create(2, 16, 1048576, threadpool_work_stealing)));
+    cr_assert(0 == threadpool_set_idle(pool, idle, 10));
+    nanosleep(&tim, NULL);
+    cr_assert(atomic_load(&counter) == 2);
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+TestSuite(threadpool_add, .init = setup, .fini = teardown);
+
+Test(threadpool_add, invalid_arguments) {
+    cr_assert(threadpool_invalid == threadpool_add(NULL, increment, NULL, 0));
+
+    cr_assert(NULL != (pool = threadpool_create(1, 16, 1048576, threadpool_work_stealing)));
+    cr_assert(threadpool_invalid == threadpool_add(pool, NULL, NULL, 0));
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+Test(threadpool_add, stats_invalid_arguments) {
+    threadpool_stats_t stats;
+
+    cr_assert(threadpool_invalid == threadpool_stats(NULL, &stats));
+}
+
+TestSuite(threadpool_add_batch, .init = setup, .fini = teardown);
+
+Test(threadpool_add_batch, invalid_arguments) {
+    void *arguments[1] = { NULL };
+
+    cr_assert(threadpool_invalid == threadpool_add_batch(NULL, increment, arguments, 1, 0));
+
+    cr_assert(NULL != (pool = threadpool_create(1, 16, 1048576, 0)));
+    cr_assert(threadpool_invalid == threadpool_add_batch(pool, NULL, arguments, 1, 0));
+    cr_assert(threadpool_invalid == threadpool_add_batch(pool, increment, NULL, 1, 0));
+    cr_assert(0 == threadpool_add_batch(pool, increment, arguments, 0, 0));
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+Test(threadpool_add_batch, queue) {
+    threadpool_stats_t stats;
+    void *arguments[TASKS] = { NULL };
+
+    cr_assert(NULL != (pool = threadpool_create(4, 16, 1048576, 0)));
+    cr_assert(0 == threadpool_set_limits(pool, 4, 4*TASKS, 0));
+
+    cr_assert(TASKS == threadpool_add_batch(pool, increment, arguments, TASKS, 0));
+
+    while (atomic_load(&counter) < TASKS) {
+        sched_yield();
+    }
+
+    cr_assert(0 == threadpool_stats(pool, &stats));
+    cr_assert(stats.tasks == TASKS);
+    cr_assert(stats.resizes > 0);
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+Test(threadpool_add_batch, partially_full) {
+    void *arguments[16] = { NULL };
+
+    cr_assert(NULL != (pool = threadpool_create(1, 4, 1048576, 0)));
+
+    // The queue is locked during the whole batch, hence no task is taken
+    cr_assert(4 == threadpool_add_batch(pool, slow, arguments, 16, 0));
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+}
+
+Test(threadpool_add_batch, work_stealing) {
+    void *arguments[TASKS] = { NULL };
+
+    cr_assert(NULL != (pool = threadpool_create(4, 4*TASKS, 1048576, threadpool_work_stealing)));
+
+    cr_assert(TASKS == threadpool_add_batch(pool, spawn, arguments, TASKS, 0));
+
+    while (atomic_load(&counter) < 2*TASKS) {
+        sched_yield();
+    }
+
+    cr_assert(0 == threadpool_destroy(pool, threadpool_graceful));
+    cr_assert(atomic_load(&counter) == 2*TASKS);
+}
@@ -0,0 +1,178 @@
+#include <string.h>
+#include <criterion/criterion.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "session.h"
+#include "subprotocols.h"
+#include "rpmalloc.h"
+
+static struct in6_addr addr = IN6ADDR_LOOPBACK_INIT;
+
+static int closed = 0;
+
+static void protocol_close(int fd) {
+    (void) fd;
+    closed++;
+}
+
+static void setup(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+    WSS_session_init_lock();
+    WSS_session_slab_init(8, 2, 0, 0);
+}
+
+static void teardown(void) {
+    WSS_session_delete_all();
+    WSS_session_slab_destroy();
+    WSS_session_destroy_lock();
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+}
+
+TestSuite(WSS_session_add, .init = setup, .fini = teardown);
+
+Test(WSS_session_add, invalid_fd) {
+    cr_assert(NULL == WSS_session_add(-1, &addr, 80));
+}
+
+Test(WSS_session_add, add_and_find) {
+    int fds[2];
+    wss_session_t *session;
+
+    cr_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    WSS_session_enter();
+    cr_assert(NULL != (session = WSS_session_add(fds[0], &addr, 80)));
+    cr_assert(session == WSS_session_find(fds[0]));
+    cr_assert(session->port == 80);
+    cr_assert(NULL == atomic_load(&session->queue));
+    cr_assert(NULL == WSS_session_add(fds[0], &addr, 80));
+    cr_assert(NULL == WSS_session_find(fds[1]));
+    WSS_session_leave();
+
+    close(fds[1]);
+}
+
+Test(WSS_session_add, queue_allocated_when_needed) {
+    int fds[2];
+    wss_session_t *session;
+    wss_session_queue_t *queue;
+
+    cr_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    WSS_session_enter();
+    cr_assert(NULL != (session = WSS_session_add(fds[0], &addr, 80)));
+
+    // A fresh session has no queue
+    cr_assert(NULL == atomic_load(&session->queue));
+
+    // The first call allocates the queue, which later calls return
+    cr_assert(NULL != (queue = WSS_session_queue(session)));
+    cr_assert(queue == atomic_load(&session->queue));
+    cr_assert(queue->count == 8);
+    cr_assert(NULL != queue->ringbuf);
+    cr_assert(queue == WSS_session_queue(session));
+
+    cr_assert(WSS_SUCCESS == WSS_session_delete(session));
+    WSS_session_leave();
+    close(fds[1]);
+
+    // The queue is freed with the session, once no thread can reference it
+    WSS_session_reclaim();
+    WSS_session_reclaim();
+    cr_assert(NULL == atomic_load(&session->queue));
+}
+
+TestSuite(WSS_session_buffer, .init = setup, .fini = teardown);
+
+Test(WSS_session_buffer, reused_by_thread) {
+    char *buffer;
+
+    WSS_session_enter();
+    cr_assert(NULL != (buffer = WSS_session_buffer(64)));
+    buffer[63] = 'x';
+    cr_assert(buffer == WSS_session_buffer(32));
+    cr_assert(buffer == WSS_session_buffer(64));
+    cr_assert(NULL != (buffer = WSS_session_buffer(4096)));
+    buffer[4095] = 'x';
+    cr_assert(buffer == WSS_session_buffer(4096));
+    WSS_session_leave();
+}
+
+TestSuite(WSS_session_delete, .init = setup, .fini = teardown);
+
+Test(WSS_session_delete, recycles_session) {
+    int fds[2];
+    wss_session_t *session, *recycled;
+
+    cr_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    WSS_session_enter();
+    cr_assert(NULL != (session = WSS_session_add(fds[0], &addr, 80)));
+    session->closing = true;
+    cr_assert(WSS_SUCCESS == WSS_session_delete(session));
+    cr_assert(NULL == WSS_session_find(fds[0]));
+    close(fds[1]);
+
+    // The session is not freed while the thread may still reference it
+    WSS_session_reclaim();
+    WSS_session_reclaim();
+    cr_assert(session->closing);
+    WSS_session_leave();
+
+    WSS_session_reclaim();
+    WSS_session_reclaim();
+
+    cr_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    WSS_session_enter();
+    cr_assert(NULL != (recycled = WSS_session_add(fds[0], &addr, 443)));
+    cr_assert(recycled == session);
+    cr_assert(! recycled->closing);
+    cr_assert(recycled->port == 443);
+    WSS_session_leave();
+
+    close(fds[1]);
+}
+
+Test(WSS_session_delete, protocol_closed_once) {
+    int fds[2];
+    wss_session_t *session;
+    wss_subprotocol_t protocol;
+
+    memset(&protocol, 0, sizeof(protocol));
+    protocol.close = protocol_close;
+    closed = 0;
+
+    // The subprotocol is informed when the session is disconnected, hence
+    // freeing the retired session must not inform it again
+    cr_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    WSS_session_enter();
+    cr_assert(NULL != (session = WSS_session_add(fds[0], &addr, 80)));
+    session->protocol = &protocol;
+    cr_assert(WSS_SUCCESS == WSS_session_delete(session));
+    WSS_session_leave();
+    close(fds[1]);
+
+    WSS_session_reclaim();
+    WSS_session_reclaim();
+    cr_assert(0 == closed);
+
+    // Sessions that were never disconnected are informed on shutdown
+    cr_assert(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    WSS_session_enter();
+    cr_assert(NULL != (session = WSS_session_add(fds[0], &addr, 80)));
+    session->protocol = &protocol;
+    WSS_session_leave();
+
+    cr_assert(WSS_SUCCESS == WSS_session_delete_all());
+    cr_assert(1 == closed);
+    close(fds[1]);
+}
@@ -1,4 +1,5 @@
 #include <criterion/criterion.h>
+#include <netinet/tcp.h>
 
 #include "alloc.h"
 #include "server.h"
@@ -35,6 +36,31 @@ Test(WSS_socket_create, creating_socket) {
     WSS_free((void **) &server);
 }
 
+Test(WSS_socket_create, creating_socket_with_accept_options) {
+    int value = 0;
+    socklen_t length = sizeof(value);
+    wss_server_t *server = (wss_server_t *) WSS_malloc(sizeof(wss_server_t));
+    wss_config_t *conf = (wss_config_t *) WSS_malloc(sizeof(wss_config_t));
+
+    conf->accept_defer = 5;
+    conf->accept_fastopen = 16;
+    server->config = conf;
+
+    cr_assert(WSS_SUCCESS == WSS_socket_create(server));
+
+#ifdef TCP_DEFER_ACCEPT
+    cr_assert(0 == getsockopt(server->fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &value, &length));
+    cr_assert(value > 0);
+#endif
+
+    // Cleanup
+    server->config = NULL;
+    WSS_http_server_free(server);
+    pthread_mutex_destroy(&server->lock);
+    WSS_free((void **) &server);
+    WSS_free((void **) &conf);
+}
+
 TestSuite(WSS_socket_reuse, .init = setup, .fini = teardown);
 
 Test(WSS_socket_reuse, invalid_fd) {
@@ -53,6 +79,24 @@ Test(WSS_socket_reuse, reuse_socket) {
     WSS_free((void **) &server);
 }
 
+TestSuite(WSS_socket_reuse_port, .init = setup, .fini = teardown);
+
+Test(WSS_socket_reuse_port, invalid_fd) {
+    cr_assert(WSS_SOCKET_REUSE_ERROR == WSS_socket_reuse_port(-1));
+}
+
+Test(WSS_socket_reuse_port, reuse_port_socket) {
+    wss_server_t *server = (wss_server_t *) WSS_malloc(sizeof(wss_server_t));
+
+    cr_assert(WSS_SUCCESS == WSS_socket_create(server));
+    cr_assert(WSS_SUCCESS == WSS_socket_reuse_port(server->fd));
+
+    // Cleanup
+    WSS_http_server_free(server);
+    pthread_mutex_destroy(&server->lock);
+    WSS_free((void **) &server);
+}
+
 TestSuite(WSS_socket_bind, .init = setup, .fini = teardown);
 
 Test(WSS_socket_bind, null_server) {
@@ -223,6 +223,10 @@ Test(WSS_load_subprotocols, successful) {
     cr_assert(NULL != WSS_find_subprotocol("echo"));
     cr_assert(NULL != WSS_find_subprotocol("broadcast"));
 
+    // Only the broadcast subprotocol sends to several recipients at once
+    cr_assert(NULL == WSS_find_subprotocol("echo")->init2);
+    cr_assert(NULL != WSS_find_subprotocol("broadcast")->init2);
+
     WSS_destroy_subprotocols();
     WSS_config_free(conf);
     WSS_free((void**) &conf);
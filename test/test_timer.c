@@ -0,0 +1,109 @@
+#include <criterion/criterion.h>
+
+#include "alloc.h"
+#include "timer.h"
+#include "rpmalloc.h"
+
+static void setup(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_initialize();
+#endif
+}
+
+static void teardown(void) {
+#ifdef USE_RPMALLOC
+    rpmalloc_finalize();
+#endif
+}
+
+TestSuite(WSS_timer_wheel_create, .init = setup, .fini = teardown);
+
+Test(WSS_timer_wheel_create, invalid_arguments) {
+    cr_assert(NULL == WSS_timer_wheel_create(0, 10, 0));
+    cr_assert(NULL == WSS_timer_wheel_create(16, 0, 0));
+}
+
+Test(WSS_timer_wheel_create, slots_are_power_of_two) {
+    wss_timer_wheel_t *wheel = WSS_timer_wheel_create(100, 10, 1000);
+
+    cr_assert(NULL != wheel);
+    cr_assert(wheel->length == 128);
+    cr_assert(wheel->count == 0);
+
+    WSS_timer_wheel_destroy(wheel);
+}
+
+TestSuite(WSS_timer_schedule, .init = setup, .fini = teardown);
+
+Test(WSS_timer_schedule, only_moves_deadline_earlier) {
+    wss_timer_t timer = { .fd = 1 };
+    wss_timer_wheel_t *wheel = WSS_timer_wheel_create(16, 10, 1000);
+
+    cr_assert(WSS_timer_schedule(wheel, &timer, 1500));
+    cr_assert(! WSS_timer_schedule(wheel, &timer, 2000));
+    cr_assert(atomic_load(&timer.deadline) == 1500);
+    cr_assert(WSS_timer_schedule(wheel, &timer, 1200));
+    cr_assert(atomic_load(&timer.deadline) == 1200);
+    cr_assert(wheel->count == 1);
+
+    WSS_timer_cancel(wheel, &timer);
+    cr_assert(atomic_load(&timer.deadline) == 0);
+    cr_assert(wheel->count == 0);
+
+    WSS_timer_wheel_destroy(wheel);
+}
+
+TestSuite(WSS_timer_expire, .init = setup, .fini = teardown);
+
+Test(WSS_timer_expire, expires_only_passed_deadlines) {
+    int *fds;
+    wss_timer_t first = { .fd = 1 }, second = { .fd = 2 };
+    wss_timer_wheel_t *wheel = WSS_timer_wheel_create(16, 10, 1000);
+
+    cr_assert(WSS_timer_schedule(wheel, &first, 1050));
+    cr_assert(WSS_timer_schedule(wheel, &second, 1100));
+
+    cr_assert(0 == WSS_timer_expire(wheel, 1049, &fds));
+    cr_assert(1 == WSS_timer_expire(wheel, 1060, &fds));
+    cr_assert(fds[0] == 1);
+    cr_assert(atomic_load(&first.deadline) == 0);
+
+    cr_assert(1 == WSS_timer_expire(wheel, 1110, &fds));
+    cr_assert(fds[0] == 2);
+    cr_assert(wheel->count == 0);
+
+    WSS_timer_wheel_destroy(wheel);
+}
+
+Test(WSS_timer_expire, deadlines_beyond_a_rotation) {
+    int *fds;
+    wss_timer_t timer = { .fd = 3 };
+    wss_timer_wheel_t *wheel = WSS_timer_wheel_create(16, 10, 1000);
+
+    // The wheel covers 160 ms, so the timer shares its slot with earlier ticks
+    cr_assert(WSS_timer_schedule(wheel, &timer, 1500));
+
+    cr_assert(0 == WSS_timer_expire(wheel, 1200, &fds));
+    cr_assert(0 == WSS_timer_expire(wheel, 1400, &fds));
+    cr_assert(1 == WSS_timer_expire(wheel, 1510, &fds));
+    cr_assert(fds[0] == 3);
+
+    WSS_timer_wheel_destroy(wheel);
+}
+
+Test(WSS_timer_expire, catches_up_after_several_rotations) {
+    int i, *fds;
+    wss_timer_t timers[100];
+    wss_timer_wheel_t *wheel = WSS_timer_wheel_create(16, 10, 1000);
+
+    for (i = 0; i < 100; i++) {
+        timers[i].fd = i;
+        atomic_init(&timers[i].deadline, 0);
+        cr_assert(WSS_timer_schedule(wheel, &timers[i], 1000 + i*7));
+    }
+
+    cr_assert(100 == WSS_timer_expire(wheel, 5000, &fds));
+    cr_assert(wheel->count == 0);
+
+    WSS_timer_wheel_destroy(wheel);
+}